@@ -0,0 +1,68 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 执行器编号
+ *
+ * 设备内部的控制流程 (如 function_controller 的蒸汽水位闭环) 通过编号直接控制硬件，
+ * 不再拼接 "relay:on" 之类的命令字符串交给分发器重新解析。
+ * 文本命令仍由各模块的命令处理器处理，与这里调用的是同一组硬件操作。
+ */
+typedef enum {
+    ACTUATOR_HEATER = 0,  // 加热继电器 (relay)
+    ACTUATOR_PUMP,        // 蒸汽水泵直流电机 (motor)，只正转
+    ACTUATOR_VALVE,       // 蒸汽电磁阀 (valve)
+    ACTUATOR_FAN,         // 风扇 (fan)
+    ACTUATOR_MAX,
+} actuator_id_t;
+
+/**
+ * @brief 执行器描述，由各模块在初始化完成后注册
+ *
+ * set 和 set_pwm 至少提供一个，缺少的一个由另一个代替：
+ * 只有 set 时 set_pwm(>0) 等同于 set(true)；只有 set_pwm 时 set(true) 等同于 set_pwm(100)。
+ * 两个函数可能在任何任务中被调用 (包括 esp_timer 任务)，只能做短暂的 GPIO/LEDC 操作，不能阻塞。
+ * 状态未变化时应直接返回，控制流程会周期性地重复设置同一状态。
+ */
+typedef struct {
+    actuator_id_t id;
+    const char   *name;                          // 用于日志，例如 "relay"
+    esp_err_t   (*set)(bool on);                 // 开/关
+    esp_err_t   (*set_pwm)(uint8_t percent);     // 0~100，0 表示关闭
+} actuator_ops_t;
+
+/**
+ * @brief 注册执行器
+ *
+ * @param ops 执行器描述，必须在程序运行期间一直有效 (通常为 static const)
+ * @return ESP_OK 成功; ESP_ERR_INVALID_ARG 描述无效; ESP_ERR_INVALID_STATE 该编号已被注册
+ */
+esp_err_t actuator_register(const actuator_ops_t *ops);
+
+/**
+ * @brief 打开/关闭执行器
+ *
+ * @return ESP_OK 成功; ESP_ERR_NOT_FOUND 执行器未注册; 其它为执行器返回的错误
+ */
+esp_err_t actuator_set(actuator_id_t id, bool on);
+
+/**
+ * @brief 设置执行器的输出百分比 (0~100，超过 100 按 100 处理)
+ *
+ * @return ESP_OK 成功; ESP_ERR_NOT_FOUND 执行器未注册; 其它为执行器返回的错误
+ */
+esp_err_t actuator_set_pwm(actuator_id_t id, uint8_t percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACTUATOR_H
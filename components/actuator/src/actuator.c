@@ -0,0 +1,43 @@
+#include "actuator.h"
+#include "esp_log.h"
+
+static const char *TAG = "ACTUATOR";
+
+// 注册只在各模块初始化时进行 (app_main 中依次调用)，之后只读，无需加锁
+static const actuator_ops_t *s_actuators[ACTUATOR_MAX];
+
+esp_err_t actuator_register(const actuator_ops_t *ops)
+{
+    if (ops == NULL || ops->id >= ACTUATOR_MAX || (ops->set == NULL && ops->set_pwm == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_actuators[ops->id] != NULL) {
+        ESP_LOGE(TAG, "执行器 %d 已被 '%s' 注册", ops->id, s_actuators[ops->id]->name);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_actuators[ops->id] = ops;
+    ESP_LOGI(TAG, "注册执行器 %d: '%s'", ops->id, ops->name ? ops->name : "");
+    return ESP_OK;
+}
+
+esp_err_t actuator_set(actuator_id_t id, bool on)
+{
+    const actuator_ops_t *ops = (id < ACTUATOR_MAX) ? s_actuators[id] : NULL;
+    if (ops == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ops->set ? ops->set(on) : ops->set_pwm(on ? 100 : 0);
+}
+
+esp_err_t actuator_set_pwm(actuator_id_t id, uint8_t percent)
+{
+    const actuator_ops_t *ops = (id < ACTUATOR_MAX) ? s_actuators[id] : NULL;
+    if (ops == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (percent > 100) {
+        percent = 100;
+    }
+    return ops->set_pwm ? ops->set_pwm(percent) : ops->set(percent > 0);
+}
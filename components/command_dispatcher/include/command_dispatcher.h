@@ -1,47 +1,376 @@
-#ifndef COMMAND_DISPATCHER_H  
-#define COMMAND_DISPATCHER_H  
-
-#include <stddef.h>  
-#include "esp_err.h"  
-
-/**  
- * @brief 命令处理函数的标准原型 (函数指针类型)  
- *  
- * 所有希望接收转发命令的模块，其处理函数都必须符合这个格式。  
- * @param command 完整的命令字符串 (例如 "led:on" 或者是一个JSON字符串)  
- * @param len     命令字符串的长度  
- */  
-typedef void (*command_handler_t)(const char *command, size_t len);  
-
-/**  
- * @brief 初始化命令分发器服务  
- *  
- * 在系统启动时调用一次，用于清空和准备命令注册表。  
- * @return esp_err_t 总是返回 ESP_OK  
- */  
-esp_err_t command_dispatcher_init(void);  
-
-/**  
- * @brief 注册一个命令处理器  
- *  
- * 各个业务模块（如 led_controller, motor_controller）在初始化时调用此函数，  
- * 将自己能处理的命令前缀和对应的处理函数告诉分发中心。  
- *  
- * @param command_prefix 命令前缀 (例如 "led", "motor", "system")  
- * @param handler       当收到此前缀的命令时，要调用的处理函数  
- * @return esp_err_t 成功返回 ESP_OK, 如果注册表满了或前缀已存在则返回错误  
- */  
-esp_err_t command_dispatcher_register(const char *command_prefix, command_handler_t handler);  
-
-/**  
- * @brief 分发一个收到的命令  
- *  
- * 这个函数由消息的源头（如 UART 消息处理器或 MQTT 消息处理器）调用。  
- * 它会根据命令的前缀，查找注册表，并将完整的命令字符串转发给正确的处理器。  
- *  
- * @param full_command  完整的命令字符串  
- * @param len           字符串长度  
- */  
-void command_dispatcher_forward(const char *full_command, size_t len);  
-
-#endif // COMMAND_DISPATCHER_H  
\ No newline at end of file
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define COMMAND_MAX_LEN   96   // 单条命令的最大长度 (含结尾 '\0')
+#define COMMAND_MAX_ARGS  4    // 子命令之后最多解析的参数个数
+#define COMMAND_REPLY_TO_LEN 64 // 回复地址的最大长度 (例如 MQTT 应答主题)
+
+/**
+ * @brief 命令来源
+ *
+ * 处理函数的回复只发回命令的来源：屏幕经 UART 发来的命令回复到 UART，
+ * MQTT 发来的命令回复到请求中指定的应答主题。
+ * LOCAL 是设备内部发出的命令 (如 function_controller 的流程)，
+ * 其回复以及不属于任何命令的主动上报 (command_dispatcher_reply(NULL, ...)) 都走 LOCAL 通道。
+ */
+typedef enum {
+    COMMAND_ORIGIN_LOCAL = 0,
+    COMMAND_ORIGIN_UART,
+    COMMAND_ORIGIN_MQTT,
+    COMMAND_ORIGIN_MAX,
+} command_origin_t;
+
+/**
+ * @brief 命令来源及回复地址
+ *
+ * reply_to 的含义由该来源的回复通道决定 (MQTT 为应答主题)，可以为 NULL。
+ * 指定了 reply_to 的请求者期望每条命令都有应答，无法识别的命令也会回复 "ERROR:<原因>"。
+ */
+typedef struct {
+    command_origin_t origin;
+    const char      *reply_to;
+    bool             no_rate_limit; // 不计入速率限制 (如定时器触发的命令，创建定时器时已经计入)
+    int64_t          arrival_us;    // 传输层收到命令的时间 (esp_timer, us)，0 表示以进入分发器的时间为准
+} command_source_t;
+
+/**
+ * @brief 单个已解析的参数
+ *
+ * 参数文本保存在所属 command_args_t 的 line 中，这里只记录偏移和长度，
+ * 因此整个 command_args_t 可以按值拷贝 (例如放入队列)。
+ */
+typedef struct {
+    uint8_t offset;     // 参数文本在 line 中的偏移
+    uint8_t len;        // 参数文本长度
+    bool    is_number;  // 参数是否为合法数字
+    int32_t ival;       // 数字参数的整数值 (小数按截断处理)
+    float   fval;       // 数字参数的浮点值
+} command_arg_t;
+
+/**
+ * @brief 分发器预先解析好的命令
+ *
+ * 分发器在一次扫描中完成 前缀查找 / 子命令匹配 / 参数切分，
+ * 处理函数直接使用 verb_id 和 argv，无需再做 strncmp/sscanf/atoi。
+ * 例如 "motor:speed:80" -> verb_id = 模块定义的 speed 编号, argv[0].ival = 80
+ *      "fan:75"         -> verb_id = 模块为 "" 定义的编号,   argv[0].ival = 75
+ */
+typedef struct {
+    char          line[COMMAND_MAX_LEN]; // 命令原文 (已去除行尾空白，以 '\0' 结尾)
+    uint8_t       len;                   // 命令原文长度
+    uint8_t       prefix_len;            // 前缀长度 (不含 ':')
+    uint8_t       priority;              // 子命令的优先级 (command_priority_t)
+    bool          coalesce;              // 是否为可合并的设定值命令
+    bool          no_throttle;           // 子命令不受速率限制 (COMMAND_VERB_FLAG_NO_THROTTLE)
+    int           verb_id;               // 子命令编号，由模块的子命令表决定
+    uint8_t       argc;                  // 参数个数
+    command_arg_t argv[COMMAND_MAX_ARGS];
+    int64_t       arrival_us;            // 传输层收到命令的时间 (esp_timer, us)
+    int64_t       rx_us;                 // 命令到达分发器的时间 (esp_timer, us)
+    int64_t       dispatch_us;           // 解析和限速完成、交给执行通道的时间 (esp_timer, us)
+    void         *reply_ctx;             // 批量命令的回复汇总缓冲，NULL 表示直接回复
+    uint8_t       origin;                // 命令来源 (command_origin_t)
+    char          reply_to[COMMAND_REPLY_TO_LEN]; // 来源的回复地址，"" 表示默认
+} command_args_t;
+
+/**
+ * @brief 命令处理函数的标准原型 (函数指针类型)
+ *
+ * 所有希望接收转发命令的模块，其处理函数都必须符合这个格式。
+ * @param args 分发器解析好的命令
+ * @return esp_err_t 执行成功返回 ESP_OK，参数错误等返回对应错误码
+ */
+typedef esp_err_t (*command_handler_t)(const command_args_t *args);
+
+/**
+ * @brief 批量命令的状态快照函数 (可选)
+ *
+ * 批量命令 ("batch:fan:75;relay:on;stepper:open") 在执行每一步之前调用，
+ * 模块把"恢复到当前状态"的命令写入 restore，例如继电器当前是关的，
+ * 执行 "relay:on" 之前写入 "relay:off"。某一步失败时分发器按相反顺序执行
+ * 已完成步骤的恢复命令。恢复命令应是设定绝对状态的命令，而不是相对动作。
+ *
+ * @param args     即将执行的命令
+ * @param restore  恢复命令的输出缓冲
+ * @param size     缓冲大小
+ * @return 写入了恢复命令返回 true，该命令无法回滚时返回 false
+ */
+typedef bool (*command_snapshot_t)(const command_args_t *args, char *restore, size_t size);
+
+/**
+ * @brief 回复通道
+ *
+ * @param reply_to 命令来源给出的回复地址，可能为 ""
+ * @param line     回复内容，例如 "STATUS:RELAY_ON"
+ */
+typedef void (*command_reply_sink_t)(const char *reply_to, const char *line);
+
+/**
+ * @brief 子命令优先级
+ *
+ * COMMAND_PRIORITY_HIGH 用于 "relay:off" / "motor:stop" 这类安全相关的命令：
+ * 不进入模块的普通队列，而是交给分发器的高优先级任务立即执行，
+ * 同时清空该模块队列中尚未执行的普通命令。
+ * 高优先级子命令的处理必须足够短 (几次GPIO操作)。它与模块工作任务互斥执行：
+ * 先等待正在执行的普通命令结束，最多 CONFIG_COMMAND_DISPATCHER_PRIORITY_LOCK_TIMEOUT_MS，
+ * 超时后记录日志并不持锁直接执行 (此时可能与卡住的普通命令并发)。
+ */
+typedef enum {
+    COMMAND_PRIORITY_NORMAL = 0,
+    COMMAND_PRIORITY_HIGH,
+} command_priority_t;
+
+/**
+ * @brief 子命令标志
+ *
+ * COMMAND_VERB_FLAG_COALESCE 标记幂等的设定值命令 (如 "fan:NN", "motor:speed:NN")。
+ * 对带命令队列的模块，同一子命令在队列中最多只有一份：尚未执行时再收到新值，
+ * 只覆盖数值而不再入队 (最后写入者生效)，滑条拖动产生的大量命令只会执行最新的一条。
+ * 合并后的命令保持第一次入队时的位置，因此只应标记与其它子命令相互独立的设定值。
+ */
+#define COMMAND_VERB_FLAG_COALESCE  (1 << 0)
+
+/**
+ * @brief COMMAND_VERB_FLAG_NO_THROTTLE 标记不受速率限制的诊断命令 (如 "probe")，
+ * 处理函数必须足够轻，大量发送也不会影响其它命令。
+ */
+#define COMMAND_VERB_FLAG_NO_THROTTLE (1 << 1)
+
+/**
+ * @brief 子命令表项
+ *
+ * name 为 "" 表示前缀后直接跟数值的写法 (例如 "fan:75")。
+ */
+typedef struct {
+    const char        *name;     // 子命令名，例如 "on", "speed"
+    int                id;       // 模块自定义的子命令编号
+    command_priority_t priority; // 子命令优先级，默认为普通
+    uint8_t            flags;    // COMMAND_VERB_FLAG_*
+} command_verb_t;
+
+/**
+ * @brief 高优先级通道的延迟统计
+ *
+ * 延迟从传输层收到命令 (command_source_t.arrival_us，UART 为字节到达的时间) 开始计算，
+ * 到处理函数返回 (GPIO 已经改变) 为止，包括 UART 组行和分发器解析的时间。
+ */
+typedef struct {
+    uint32_t count;          // 已执行的高优先级命令数
+    uint32_t dropped;        // 因队列满被丢弃的高优先级命令数
+    uint32_t lock_timeouts;  // 等待正在执行的普通命令超时、不持锁执行的次数
+    int64_t  last_latency_us;
+    int64_t  max_latency_us; // 最坏延迟
+} command_priority_stats_t;
+
+/**
+ * @brief 单个前缀的执行统计 (时间单位均为 us)
+ *
+ * 执行时间为处理函数本身的耗时；等待时间从命令到达分发器开始，
+ * 到处理函数开始执行为止，包括在模块队列中排队的时间。
+ * p99 由 log2 直方图估算，取所在桶的上界。
+ */
+typedef struct {
+    const char *prefix;
+    uint32_t    count;        // 处理函数调用次数
+    uint32_t    errors;       // 处理函数返回错误的次数
+    uint32_t    unsupported;  // 子命令无法识别的次数
+    uint32_t    min_us;
+    uint32_t    avg_us;
+    uint32_t    p99_us;
+    uint32_t    max_us;
+    uint32_t    wait_avg_us;
+    uint32_t    wait_max_us;
+    uint32_t    dropped;      // 因队列满或被高优先级命令清空而丢弃的命令数
+    uint32_t    coalesced;    // 被合并掉的设定值命令数
+    uint32_t    throttled;    // 超出本前缀速率限制被丢弃的命令数
+} command_prefix_stats_t;
+
+/**
+ * @brief 模块命令队列满时的处理策略
+ */
+typedef enum {
+    COMMAND_OVERFLOW_DROP_NEWEST = 0, // 丢弃新到的命令 (默认)
+    COMMAND_OVERFLOW_DROP_OLDEST,     // 丢弃队列中最旧的命令，保留新命令
+    COMMAND_OVERFLOW_BLOCK,           // 调用者最多等待 CONFIG_COMMAND_DISPATCHER_BLOCK_TIMEOUT_MS
+} command_overflow_policy_t;
+
+/**
+ * @brief 模块注册描述
+ *
+ * 描述本身及其引用的字符串/子命令表必须是静态生命周期，分发器只保存指针。
+ * verbs 为 NULL 时不做子命令匹配，verb_id 固定为 0，所有字段都作为参数。
+ *
+ * queue_depth 为 0 时处理函数在调用 command_dispatcher_forward 的任务中同步执行，
+ * 适用于只改一下GPIO/PWM的快速命令；大于 0 时分发器为该模块创建专属的命令队列
+ * 和工作任务，forward 只负责入队，耗时的处理函数 (如 ds18b20 读温度) 不会阻塞
+ * UART 接收任务，同一模块的命令仍按顺序逐条执行。
+ */
+typedef struct {
+    const char               *prefix;      // 命令前缀 (例如 "led", "motor")
+    command_handler_t         handler;     // 收到此前缀的命令时调用的处理函数
+    const command_verb_t     *verbs;       // 子命令表
+    size_t                    verb_count;  // 子命令表长度
+    uint8_t                   queue_depth; // 命令队列深度，0 表示同步执行
+    command_overflow_policy_t overflow;    // 队列满时的处理策略
+    command_snapshot_t        snapshot;    // 批量命令回滚用的状态快照，NULL 表示不支持回滚
+} command_module_t;
+
+/**
+ * @brief 初始化命令分发器服务
+ *
+ * 在系统启动时调用一次，用于清空和准备命令注册表。
+ * @return esp_err_t 总是返回 ESP_OK
+ */
+esp_err_t command_dispatcher_init(void);
+
+/**
+ * @brief 注册一个命令处理模块
+ *
+ * 各个业务模块（如 led_controller, motor_controller）在初始化时调用此函数，
+ * 将自己能处理的命令前缀、子命令表和对应的处理函数告诉分发中心。
+ *
+ * @param module 模块注册描述 (必须是静态生命周期)
+ * @return esp_err_t 成功返回 ESP_OK, 如果注册表满了或前缀已存在则返回错误
+ */
+esp_err_t command_dispatcher_register(const command_module_t *module);
+
+/**
+ * @brief 分发一个设备内部发出的命令 (来源为 COMMAND_ORIGIN_LOCAL)
+ *
+ * 等同于以 LOCAL 来源调用 command_dispatcher_forward_from。
+ */
+void command_dispatcher_forward(const char *full_command, size_t len);
+
+/**
+ * @brief 分发一个收到的命令
+ *
+ * 这个函数由消息的源头（如 UART 消息处理器或 MQTT 消息处理器）调用。
+ * 它会根据命令的前缀查找注册表，解析子命令和参数后交给正确的处理器；
+ * 对带命令队列的模块只做入队，不等待处理函数执行完成。
+ * "batch:" 开头的批量命令交给分发器的批量任务，整批解析、按顺序执行、失败回滚，
+ * 并只回复一帧汇总状态。
+ *
+ * @param source        命令来源，处理函数的回复只发回这里
+ * @param full_command  完整的命令字符串
+ * @param len           字符串长度
+ */
+void command_dispatcher_forward_from(const command_source_t *source, const char *full_command, size_t len);
+
+/**
+ * @brief 设置某个来源的回复通道
+ *
+ * 没有设置回复通道的来源，其命令的回复被丢弃。
+ */
+void command_dispatcher_set_reply_sink(command_origin_t origin, command_reply_sink_t sink);
+
+/**
+ * @brief 回复一条命令的执行状态
+ *
+ * 处理函数应通过此函数而不是直接调用 uart_service_send_line 回复 STATUS，
+ * 批量命令中的回复会被汇总成一帧，执行完整批命令后统一发送。
+ *
+ * @param args 正在处理的命令，不是由命令触发的主动上报传 NULL
+ * @param line 回复内容，例如 "STATUS:RELAY_ON"
+ */
+void command_dispatcher_reply(const command_args_t *args, const char *line);
+
+/**
+ * @brief 不属于任何命令的主动上报，发给指定来源 (例如状态订阅者)
+ *
+ * @param origin   来源
+ * @param reply_to 该来源的回复地址，可以为 ""
+ * @param line     上报内容
+ */
+void command_dispatcher_send(command_origin_t origin, const char *reply_to, const char *line);
+
+/**
+ * @brief 取得模块的执行锁，用于绕过命令队列直接改变模块状态的接口 (如执行器接口)
+ *
+ * 与模块工作任务和高优先级命令互斥；同步执行的模块没有锁，在持有该锁的任务中
+ * (模块自己的处理函数) 调用时不重复加锁，*locked 为 false。
+ *
+ * @param module     已注册的模块
+ * @param timeout_ms 最长等待时间
+ * @param locked     输出: 是否需要调用 command_dispatcher_unlock_module 释放
+ * @return ESP_OK；超时返回 ESP_ERR_TIMEOUT，模块未注册返回 ESP_ERR_NOT_FOUND
+ */
+esp_err_t command_dispatcher_lock_module(const command_module_t *module, uint32_t timeout_ms, bool *locked);
+
+/**
+ * @brief 释放 command_dispatcher_lock_module 取得的执行锁
+ */
+void command_dispatcher_unlock_module(const command_module_t *module, bool locked);
+
+/**
+ * @brief 获取高优先级通道的延迟统计
+ */
+void command_dispatcher_get_priority_stats(command_priority_stats_t *stats);
+
+/**
+ * @brief 获取各前缀的执行统计
+ *
+ * 同样的内容也可以通过内置命令 "diag:dispatch[:<页>]" 分页获取 (每页 8 个前缀，
+ * 以 "STATUS:DIAG:unmatched:...,page=<页>/<总页数>" 结束)，"diag:reset" 清零。
+ *
+ * @param stats     输出数组
+ * @param max_count 数组长度
+ * @return 写入的条数
+ */
+size_t command_dispatcher_get_prefix_stats(command_prefix_stats_t *stats, size_t max_count);
+
+/**
+ * @brief 逐条获取第 index 个前缀的执行统计，不需要按前缀总数准备数组
+ *
+ * @return index 超出已注册的前缀数时返回 false
+ */
+bool command_dispatcher_get_prefix_stats_at(size_t index, command_prefix_stats_t *stats);
+
+/**
+ * @brief 获取没有模块能处理的命令数
+ */
+uint32_t command_dispatcher_get_unmatched_count(void);
+
+/**
+ * @brief 获取某个来源因超出速率限制被丢弃的命令数
+ *
+ * UART/MQTT 来源和每个前缀各有一个令牌桶 (menuconfig 中配置速率和突发量)，
+ * 超出时命令被丢弃，并向来源回复 "STATUS:THROTTLED:<前缀>:<丢弃数>" (同一来源有最小间隔)。
+ * LOCAL 来源、高优先级命令和可合并的设定值命令不限速。
+ */
+uint32_t command_dispatcher_get_throttled_count(command_origin_t origin);
+
+/**
+ * @brief 清零所有执行统计
+ */
+void command_dispatcher_reset_stats(void);
+
+/**
+ * @brief 获取第 index 个参数的文本
+ *
+ * @note 返回的文本不以 '\0' 结尾，长度为 args->argv[index].len
+ */
+static inline const char *command_args_str(const command_args_t *args, int index)
+{
+    return args->line + args->argv[index].offset;
+}
+
+/**
+ * @brief 判断第 index 个参数是否为数字，并取出整数值
+ *
+ * @return 参数存在且为数字时返回 true
+ */
+static inline bool command_args_int(const command_args_t *args, int index, int32_t *out)
+{
+    if (index >= args->argc || !args->argv[index].is_number) {
+        return false;
+    }
+    *out = args->argv[index].ival;
+    return true;
+}
+
+#endif // COMMAND_DISPATCHER_H
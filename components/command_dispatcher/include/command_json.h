@@ -0,0 +1,91 @@
+#ifndef COMMAND_JSON_H
+#define COMMAND_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/*
+ * MQTT 命令消息的解析，不分配内存
+ *
+ * 消息格式: {"command": "fan:75", "args": [...], "id": "abc", ...}
+ *   command  必需，字符串
+ *   args     可选，字符串 / 数字 / 布尔，或由它们组成的数组，依次以 ':' 接在 command 之后，
+ *            {"command":"fan","args":[75]} 与 {"command":"fan:75"} 等价
+ *   id       可选，字符串或数字，决定应答主题 (device/<sn>/resp/<id>)
+ * 其它字段跳过。键名不区分大小写、同名取第一个 (与 cJSON_GetObjectItem 相同)。
+ *
+ * 也可以不用 JSON，由主题指定前缀和 id (command_json_parse_topic):
+ *   device/<sn>/cmd/<prefix>[/<id>]   负载为前缀之后的命令文本
+ */
+
+#define COMMAND_JSON_MSG_MAX     (CONFIG_COMMAND_DISPATCHER_JSON_MSG_MAX)
+#define COMMAND_JSON_COMMAND_LEN (CONFIG_COMMAND_DISPATCHER_BATCH_MAX_LEN) // 含结尾 '\0'，可以是 batch 命令
+#define COMMAND_JSON_ID_LEN      33                                       // 含结尾 '\0'
+
+typedef struct {
+    char command[COMMAND_JSON_COMMAND_LEN]; // command 与 args 拼接后的命令
+    char id[COMMAND_JSON_ID_LEN];           // 请求 id，数字保留原文，没有时为空串
+} command_json_t;
+
+/**
+ * @brief 分片消息的拼接缓冲 (每个 MQTT 客户端一个，只在其事件任务中使用)
+ */
+typedef struct {
+    char      buf[COMMAND_JSON_MSG_MAX];
+    uint32_t  total;     // 正在拼接的消息总长度，0 表示空闲
+    uint32_t  received;  // 已收到的长度
+    esp_err_t dropped;   // 不为 ESP_OK 时丢弃到该消息结束 (超长或分片不连续)，结束时返回该错误
+} command_json_assembler_t;
+
+/**
+ * @brief 送入 MQTT_EVENT_DATA 的一个分片
+ *
+ * 未分片的消息 (offset 为 0 且 len 等于 total) 不复制，*msg 直接指向 data；
+ * 分片按顺序复制进缓冲，最后一片到达时 *msg 指向缓冲。
+ *
+ * @param data    event->data
+ * @param len     event->data_len
+ * @param offset  event->current_data_offset
+ * @param total   event->total_data_len
+ * @return ESP_OK 消息完整，*msg / *msg_len 有效，直到下一次调用
+ *         ESP_ERR_NOT_FINISHED 还有后续分片
+ *         ESP_ERR_INVALID_SIZE 消息超过 COMMAND_JSON_MSG_MAX，在其最后一个分片时返回
+ *         ESP_ERR_INVALID_STATE 分片不连续 (丢失或乱序)，在该消息最后一个分片时返回
+ */
+esp_err_t command_json_assemble(command_json_assembler_t *as, const char *data, size_t len, size_t offset, size_t total,
+                                const char **msg, size_t *msg_len);
+
+/**
+ * @brief 从一条完整的 JSON 消息中取出 command / args / id
+ *
+ * 单遍扫描，不要求以 '\0' 结尾，不分配内存；不关心的字段只做语法检查后跳过。
+ *
+ * @return ESP_OK 成功
+ *         ESP_ERR_NOT_FOUND 没有字符串类型的 command 字段
+ *         ESP_ERR_INVALID_SIZE 命令 (含 args) 或 id 过长
+ *         ESP_ERR_INVALID_ARG JSON 语法错误、顶层不是对象、嵌套过深，或 args 含有数组 / 对象
+ * id 不是字符串或数字时按没有 id 处理。
+ */
+esp_err_t command_json_parse(const char *json, size_t len, command_json_t *out);
+
+/**
+ * @brief 从按主题路由的命令中取出命令和 id，负载是命令文本而不是 JSON
+ *
+ * route 为主题中 "device/<sn>/cmd/" 之后的部分 "<prefix>[/<id>]"，负载原样接在 "<prefix>:" 之后，
+ * 负载为空时命令就是前缀本身，例如
+ *   route "fan/a1"   负载 "75"               -> command "fan:75",                id "a1"
+ *   route "batch"    负载 "fan:60;relay:on"  -> command "batch:fan:60;relay:on", id ""
+ *   route "ping/7"   负载 ""                 -> command "ping",                  id "7"
+ * 不要求以 '\0' 结尾，不复制负载以外的数据；负载结尾的空白、换行和 '\0' 去掉。
+ *
+ * @return ESP_OK 成功
+ *         ESP_ERR_INVALID_ARG 前缀或 id 为空，前缀含有 ':' ';'，id 含有 '/'，或含有控制字符
+ *         ESP_ERR_INVALID_SIZE 命令或 id 过长
+ */
+esp_err_t command_json_parse_topic(const char *route, size_t route_len, const char *payload, size_t payload_len,
+                                   command_json_t *out);
+
+#endif // COMMAND_JSON_H
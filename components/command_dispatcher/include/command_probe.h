@@ -0,0 +1,27 @@
+#ifndef COMMAND_PROBE_H
+#define COMMAND_PROBE_H
+
+#include "esp_err.h"
+
+/**
+ * @brief 初始化命令路径延迟探测
+ *
+ * 由 command_dispatcher_init 调用，注册 "ping" / "probe" 两个命令，分别走三条执行通道：
+ *   "ping:<id>"        同步通道，在接收任务中直接执行 (与 relay/fan 等快速命令相同)
+ *   "probe:<id>"       模块队列通道，在 probe 的工作任务中执行 (与 ds18b20/stepper 相同)
+ *   "probe:high:<id>"  高优先级通道 (与 relay:off/motor:stop 相同)
+ * 每条探测回复一帧 "STATUS:PROBE:<id>:<通道>:in=..,parse=..,queue=..,run=..,reply=..,total=.."，
+ * 通道为 sync / queue / high，各段单位为 us：
+ *   in     传输层收到 -> 进入分发器 (UART 组行 / MQTT 解析 JSON)
+ *   parse  进入分发器 -> 交给执行通道 (前缀查找、参数切分、限速)
+ *   queue  交给执行通道 -> 处理函数开始 (排队和任务切换)
+ *   run    处理函数开始 -> 处理函数结束
+ *   total  传输层收到 -> 处理函数结束
+ *   reply  生成回复帧并交给回复通道 (UART 环形缓冲 / MQTT 发布) 的耗时；一帧发出之前
+ *          无法包含它自己的发送耗时，所以取同一通道上一条探测的实测值 (第一条为 0)
+ * 主机测得的往返时间减去 total 即为回复路径 (含 reply)、线路和主机自身的耗时。
+ * 探测命令不受速率限制，回复发回命令的来源。
+ */
+esp_err_t command_probe_init(void);
+
+#endif // COMMAND_PROBE_H
@@ -0,0 +1,50 @@
+#ifndef COMMAND_TIMER_H
+#define COMMAND_TIMER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "command_dispatcher.h"
+
+/**
+ * @brief 定时命令句柄，0 表示无效
+ */
+typedef uint32_t command_timer_handle_t;
+
+/**
+ * @brief 初始化定时命令服务
+ *
+ * 由 command_dispatcher_init 调用，注册 "at" / "every" / "timer" 三个命令：
+ *   "at:+1800s:function:stop_steam"   1800 秒后执行一次 function:stop_steam
+ *   "every:500ms:waterlevel:check"    每 500ms 执行一次 waterlevel:check
+ *   "timer:cancel:<句柄>"              取消定时命令
+ *   "timer:list"                      列出所有定时命令
+ * 创建成功回复 "STATUS:TIMER:<句柄>"。时间单位支持 ms / s / m / h，不带单位按 ms。
+ *
+ * 所有定时命令由一个分层时间轮管理，精度为 CONFIG_COMMAND_TIMER_TICK_MS。
+ * 周期性 esp_timer 只在有定时命令时运行，回调只通知定时任务；到期的命令在定时任务中经
+ * command_dispatcher_forward_from 分发，不占用 esp_timer 任务。同步处理函数慢时
+ * 后面的定时命令随之推迟，慢的处理函数仍应使用模块命令队列。
+ */
+esp_err_t command_timer_init(void);
+
+/**
+ * @brief 创建一个定时命令
+ *
+ * @param source    命令来源，到期执行的命令以此来源分发，回复也发回这里 (NULL 表示 LOCAL)
+ * @param delay_ms  首次执行前的延时
+ * @param period_ms 重复周期，0 表示只执行一次
+ * @param command   要执行的命令，例如 "waterlevel:check"
+ * @param out_handle 输出句柄，可以为 NULL
+ * @return ESP_OK 成功; ESP_ERR_NO_MEM 定时命令已满; ESP_ERR_INVALID_ARG 命令为空或过长
+ */
+esp_err_t command_timer_schedule(const command_source_t *source, uint32_t delay_ms, uint32_t period_ms,
+                                 const char *command, command_timer_handle_t *out_handle);
+
+/**
+ * @brief 取消一个定时命令
+ *
+ * @return ESP_OK 成功; ESP_ERR_NOT_FOUND 句柄无效或一次性命令已经执行
+ */
+esp_err_t command_timer_cancel(command_timer_handle_t handle);
+
+#endif // COMMAND_TIMER_H
@@ -0,0 +1,107 @@
+#ifndef STATUS_REGISTRY_H
+#define STATUS_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "command_dispatcher.h"
+
+/**
+ * @brief 状态字段类型
+ *
+ * FLOAT 保留一位小数，变化小于 0.1 不算变化 (例如温度抖动不会产生上报)。
+ */
+typedef enum {
+    STATUS_FIELD_BOOL = 0,
+    STATUS_FIELD_INT,
+    STATUS_FIELD_FLOAT,
+} status_field_type_t;
+
+/**
+ * @brief 状态字段编号，由 status_field_register 分配，负数表示无效
+ *
+ * 对无效编号调用 status_field_set_* 不做任何事，注册失败时模块无需特殊处理。
+ */
+typedef int status_field_t;
+
+/**
+ * @brief 初始化状态发布服务
+ *
+ * 由 command_dispatcher_init 调用，创建发布任务并注册 "status" 命令：
+ *   "status:list"                  列出所有字段 "STATUS:FIELDS:0=heater:b,1=fan:i,..."
+ *   "status:sub:<字段|*>"           字段变化时上报
+ *   "status:sub:<字段|*>:<ms>"      最多每 ms 上报一次，期间没有变化则不上报
+ *   "status:unsub[:<字段|*>]"       取消订阅，不带参数时取消该来源的全部订阅
+ *   "status:get"                   回复全部字段的当前值 "STATUS:S:<序号>:0=1,1=75,..."
+ * 订阅属于发出命令的来源 (origin + reply_to)。发布任务把同一来源本轮变化的字段合并为
+ * 一帧增量 "STATUS:D:<序号>:0=1,3=21.5"，只包含与上次发给该来源不同的值；
+ * 序号每帧加一，接收方发现序号不连续时应发送 "status:get" 重新同步。
+ */
+esp_err_t status_registry_init(void);
+
+/**
+ * @brief 注册一个状态字段
+ *
+ * @param name 字段名，必须是静态字符串，例如 "heater"
+ * @param type 字段类型
+ * @return 字段编号；字段已满时返回 -1。同名字段重复注册返回原编号
+ */
+status_field_t status_field_register(const char *name, status_field_type_t type);
+
+/**
+ * @brief 更新字段的值，可以在任意任务中调用，值不变时开销只有一次原子操作
+ */
+void status_field_set_bool(status_field_t field, bool value);
+void status_field_set_int(status_field_t field, int32_t value);
+void status_field_set_float(status_field_t field, float value);
+
+/**
+ * @brief 已注册的字段数，字段编号为 0 .. 字段数 - 1
+ */
+int status_field_count(void);
+
+/**
+ * @brief 读取字段的名称、类型和当前值 (原始值: BOOL 为 0/1，FLOAT 以 0.1 为单位)
+ *
+ * 不需要的输出传 NULL。
+ * @return 编号无效时返回 false
+ */
+bool status_field_get(status_field_t field, const char **name, status_field_type_t *type, int32_t *value);
+
+/**
+ * @brief 字段值变化的观察者，在写入字段的任务中同步调用，必须很快返回 (例如只写入缓冲)
+ *
+ * value 为原始值，与 status_field_get 相同。
+ */
+typedef void (*status_observer_t)(status_field_t field, int32_t value);
+
+/**
+ * @brief 设置观察者 (只有一个，由遥测使用)，NULL 表示取消
+ */
+void status_registry_set_observer(status_observer_t observer);
+
+/**
+ * @brief 让某个来源的所有订阅者在下一帧收到全部已订阅字段的当前值
+ *
+ * 用于链路恢复后重新同步 (例如屏幕重启)，序号照常递增。
+ * 只记录请求并唤醒发布任务，由发布任务修改订阅表，不会阻塞，可以在 esp_timer 回调中调用。
+ */
+void status_registry_resync(command_origin_t origin);
+
+/**
+ * @brief 发布统计
+ */
+typedef struct {
+    uint32_t fields;       // 已注册字段数
+    uint32_t subscribers;  // 当前订阅者数
+    uint32_t updates;      // 字段值发生变化的次数
+    uint32_t frames;       // 已发出的增量帧数
+    uint32_t values;       // 增量帧中携带的字段值总数
+} status_registry_stats_t;
+
+/**
+ * @brief 读取发布统计
+ */
+void status_registry_get_stats(status_registry_stats_t *stats);
+
+#endif // STATUS_REGISTRY_H
@@ -1,84 +1,1422 @@
-#include "esp_log.h"  
-#include <string.h>  
-#include "esp_err.h"  
-#include "command_dispatcher.h"  
-#include "fan_controller.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "command_dispatcher.h"
+#include "command_timer.h"
+#include "status_registry.h"
+#include "command_probe.h"
 
-static const char *TAG = "CMD_DISPATCHER";  
+static const char *TAG = "CMD_DISPATCHER";
 
 
-#define MAX_COMMAND_HANDLERS 30  
+#define MAX_COMMAND_HANDLERS 30
+#define COMMAND_HASH_SLOTS   64          // 必须是2的幂，且大于 MAX_COMMAND_HANDLERS
+#define FNV_OFFSET_BASIS     2166136261u
+#define FNV_PRIME            16777619u
 
-// 这是命令注册表的核心结构  
-typedef struct {  
-    const char*       prefix;     // 命令前缀, e.g., "led"  
-    command_handler_t handler;    // 对应的处理函数  
-    size_t            prefix_len; // 缓存前缀长度，避免在循环中反复计算，提高效率  
-} command_entry_t;  
+#define WORKER_STACK_SIZE    (CONFIG_COMMAND_DISPATCHER_WORKER_STACK_SIZE)
+#define WORKER_PRIORITY      (CONFIG_COMMAND_DISPATCHER_WORKER_PRIORITY)
+#define BLOCK_TIMEOUT_MS     (CONFIG_COMMAND_DISPATCHER_BLOCK_TIMEOUT_MS)
+#define PRIORITY_TASK_PRIO   (CONFIG_COMMAND_DISPATCHER_PRIORITY_TASK_PRIORITY)
+#define PRIORITY_QUEUE_DEPTH (CONFIG_COMMAND_DISPATCHER_PRIORITY_QUEUE_DEPTH)
+#define PRIORITY_TASK_STACK  (4096)
+#define PRIORITY_LOCK_TIMEOUT_MS (CONFIG_COMMAND_DISPATCHER_PRIORITY_LOCK_TIMEOUT_MS)
+#define BATCH_MAX_LEN        (CONFIG_COMMAND_DISPATCHER_BATCH_MAX_LEN)
+#define BATCH_MAX_COMMANDS   (CONFIG_COMMAND_DISPATCHER_BATCH_MAX_COMMANDS)
+#define BATCH_STEP_TIMEOUT_MS (CONFIG_COMMAND_DISPATCHER_BATCH_STEP_TIMEOUT_MS)
+#define BATCH_TASK_STACK     (4096)
+#define BATCH_QUEUE_DEPTH    (2)
+#define BATCH_REPLY_LEN      (256)
+#define BATCH_PREFIX         "batch:"
+#define UART_RATE            (CONFIG_COMMAND_DISPATCHER_UART_RATE)
+#define UART_BURST           (CONFIG_COMMAND_DISPATCHER_UART_BURST)
+#define MQTT_RATE            (CONFIG_COMMAND_DISPATCHER_MQTT_RATE)
+#define MQTT_BURST           (CONFIG_COMMAND_DISPATCHER_MQTT_BURST)
+#define PREFIX_RATE          (CONFIG_COMMAND_DISPATCHER_PREFIX_RATE)
+#define PREFIX_BURST         (CONFIG_COMMAND_DISPATCHER_PREFIX_BURST)
+#define THROTTLE_NOTICE_US   ((int64_t)CONFIG_COMMAND_DISPATCHER_THROTTLE_NOTICE_MS * 1000)
+#define DIAG_PAGE_SIZE       (8)         // diag:dispatch 每页的前缀行数，加上汇总行须小于 UART 发送队列 (16)
+#define STATS_BUCKETS        (24)        // 执行时间直方图: 第 i 桶为 [2^i, 2^(i+1)) us，最后一桶包含更长的
 
-// 静态分配的命令注册表  
-static command_entry_t s_command_table[MAX_COMMAND_HANDLERS];  
-static int s_handler_count = 0; // 当前已注册的处理器数量  
+// 设定值合并槽：同一子命令在队列中只保留一份，内容始终是最新的一条
+typedef struct {
+    int            verb_id;
+    bool           pending;  // 队列中是否已有指向本槽的任务
+    command_args_t args;
+} coalesce_slot_t;
 
-/**  
- * @brief 初始化命令分发器  
- */  
-esp_err_t command_dispatcher_init(void) {  
+// 令牌桶：tokens 以 1/1000 个令牌为单位，rate 为 0 表示不限速
+typedef struct {
+    uint32_t rate;    // 每秒补充的令牌数
+    uint32_t burst;   // 桶容量
+    uint32_t tokens;  // 当前令牌数 (x1000)
+    int64_t  last_us; // 上次补充的时间
+} token_bucket_t;
+
+// 每个前缀的执行统计，由 s_stats_lock 保护
+typedef struct {
+    uint32_t count;        // 处理函数调用次数
+    uint32_t errors;       // 处理函数返回非 ESP_OK 的次数
+    uint32_t unsupported;  // 子命令不在子命令表中的次数
+    uint32_t throttled;    // 超出本前缀速率限制被丢弃的次数
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint64_t wait_total_us; // 从到达分发器到开始执行的等待时间 (含排队)
+    uint32_t wait_max_us;
+    uint32_t hist[STATS_BUCKETS];
+} command_stats_t;
+
+// 这是命令注册表的核心结构
+typedef struct {
+    const command_module_t *module;     // 模块注册描述
+    uint32_t                hash;       // 前缀的 FNV-1a 哈希
+    size_t                  prefix_len; // 缓存前缀长度，避免在分发时反复计算
+    QueueHandle_t           queue;      // 模块命令队列，NULL 表示同步执行
+    SemaphoreHandle_t       run_lock;   // 有队列的模块: 工作任务与高优先级任务互斥执行处理函数
+    TaskHandle_t            run_owner;  // 持有 run_lock 的任务
+    volatile uint32_t       generation; // 每条高优先级命令加一，之前入队的命令作废
+    uint32_t                dropped;    // 因队列满被丢弃的命令数
+    coalesce_slot_t        *slots;      // 设定值合并槽，只为有可合并子命令的模块分配
+    uint8_t                 slot_count;
+    uint32_t                coalesced;  // 被更新的设定值覆盖掉的命令数
+    command_stats_t         stats;
+    token_bucket_t          bucket;     // 本前缀的速率限制，由 s_limit_lock 保护
+} command_entry_t;
+
+// 模块队列中的任务：slot >= 0 时命令内容在合并槽中，args 不使用
+typedef struct {
+    int8_t         slot;
+    command_args_t args;
+    TaskHandle_t   waiter; // 批量命令：执行完后通知等待的批量任务，NULL 表示不通知
+    uint32_t       token;  // 批量命令：本步骤的编号，用于识别超时后迟到的通知
+    uint32_t       generation; // 入队时模块的 generation
+} command_job_t;
+
+// 静态分配的命令注册表
+static command_entry_t s_command_table[MAX_COMMAND_HANDLERS];
+static int s_handler_count = 0; // 当前已注册的处理器数量
+
+// 前缀哈希索引 (开放寻址)，存放 s_command_table 的下标，-1 表示空槽
+static int8_t s_hash_index[COMMAND_HASH_SLOTS];
+
+// 高优先级通道：队列项需要带上目标模块
+typedef struct {
+    command_entry_t *entry;
+    command_args_t   args;
+} priority_job_t;
+
+static QueueHandle_t s_priority_queue = NULL;
+static TaskHandle_t s_priority_task = NULL;
+static command_priority_stats_t s_priority_stats = {0};   // 由 s_stats_lock 保护
+
+// 批量命令：原始命令行排队交给批量任务，解析和执行的状态只有批量任务使用
+typedef struct {
+    char    line[BATCH_MAX_LEN];
+    size_t  len;
+    int64_t arrival_us;
+    int64_t rx_us;
+    uint8_t origin;
+    char    reply_to[COMMAND_REPLY_TO_LEN];
+} batch_request_t;
+
+// 批量命令中回复的汇总缓冲，command_args_t.reply_ctx 指向它
+typedef struct {
+    char   buf[BATCH_REPLY_LEN];
+    size_t len;
+    bool   discard; // 回滚时恢复命令的回复不上报
+} batch_reply_t;
+
+typedef struct {
+    command_entry_t *entry;
+    command_args_t   args;
+    char             restore[COMMAND_MAX_LEN]; // 回滚命令，'\0' 表示该步骤无法回滚
+} batch_step_t;
+
+static QueueHandle_t s_batch_queue = NULL;
+static TaskHandle_t s_batch_task = NULL;
+static batch_step_t s_batch_steps[BATCH_MAX_COMMANDS];
+static batch_reply_t s_batch_reply;
+static uint32_t s_batch_token = 0;
+
+// 各来源的回复通道，回复只发回命令的来源
+static command_reply_sink_t s_reply_sinks[COMMAND_ORIGIN_MAX];
+
+// 保护合并槽，持锁时间只有一次结构体拷贝
+static portMUX_TYPE s_slot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// 保护执行统计，同一模块的处理函数可能同时在工作任务和高优先级任务中执行
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_unmatched = 0; // 没有模块处理的命令数
+
+// 各来源的速率限制，由 s_limit_lock 保护
+static portMUX_TYPE s_limit_lock = portMUX_INITIALIZER_UNLOCKED;
+static token_bucket_t s_source_buckets[COMMAND_ORIGIN_MAX];
+static uint32_t s_source_throttled[COMMAND_ORIGIN_MAX];    // 各来源被限速丢弃的命令数
+static uint32_t s_throttle_pending[COMMAND_ORIGIN_MAX];    // 上次提示之后新丢弃的命令数
+static int64_t  s_throttle_notice_us[COMMAND_ORIGIN_MAX];  // 上次发送限速提示的时间
+
+static uint32_t prefix_hash(const char *s, size_t len)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)s[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static command_entry_t *lookup_entry(const char *prefix, size_t len, uint32_t hash)
+{
+    for (uint32_t i = 0; i < COMMAND_HASH_SLOTS; i++) {
+        int8_t idx = s_hash_index[(hash + i) & (COMMAND_HASH_SLOTS - 1)];
+        if (idx < 0) {
+            return NULL;
+        }
+        command_entry_t *entry = &s_command_table[idx];
+        if (entry->hash == hash && entry->prefix_len == len &&
+            memcmp(entry->module->prefix, prefix, len) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 判断一个字段是否为数字，并同时给出整数与浮点值
+ */
+static bool parse_number(const char *s, size_t len, int32_t *ival, float *fval)
+{
+    if (len == 0) {
+        return false;
+    }
+    char c = s[0];
+    if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.')) {
+        return false;
+    }
+    char *end = NULL;
+    float f = strtof(s, &end);
+    if (end != s + len) {
+        return false;
+    }
+    long l = strtol(s, &end, 10);
+    *ival = (end == s + len) ? (int32_t)l : (int32_t)f;
+    *fval = f;
+    return true;
+}
+
+static int match_verb(const command_module_t *module, const char *verb, size_t len)
+{
+    for (size_t i = 0; i < module->verb_count; i++) {
+        const char *name = module->verbs[i].name;
+        if (strlen(name) == len && memcmp(name, verb, len) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 单次扫描完成 前缀查找 + 子命令匹配 + 参数切分
+ *
+ * @return ESP_OK 解析成功; ESP_ERR_NOT_FOUND 没有模块处理此前缀;
+ *         ESP_ERR_NOT_SUPPORTED 子命令不在模块的子命令表中;
+ *         ESP_ERR_INVALID_SIZE 命令过长; ESP_ERR_INVALID_ARG 命令为空
+ */
+static esp_err_t parse_command(const char *full_command, size_t len,
+                               command_args_t *args, command_entry_t **out_entry)
+{
+    // 去除行尾的换行/空白，屏幕端发送的命令通常带有 "\r\n"
+    while (len > 0 && (full_command[len - 1] == '\n' || full_command[len - 1] == '\r' ||
+                       full_command[len - 1] == ' '  || full_command[len - 1] == '\0')) {
+        len--;
+    }
+    if (len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len >= COMMAND_MAX_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(args->line, full_command, len);
+    args->line[len] = '\0';
+    args->len = (uint8_t)len;
+    args->priority = COMMAND_PRIORITY_NORMAL;
+    args->coalesce = false;
+    args->no_throttle = false;
+    args->verb_id = 0;
+    args->argc = 0;
+
+    // 前缀: 到第一个 ':' 为止，边扫描边计算哈希
+    uint32_t hash = FNV_OFFSET_BASIS;
+    size_t pos = 0;
+    while (pos < len && args->line[pos] != ':') {
+        hash = (hash ^ (uint8_t)args->line[pos]) * FNV_PRIME;
+        pos++;
+    }
+    // 约定前缀后必须跟着一个分隔符 ':'，例如 "led:on"
+    command_entry_t *entry = (pos == len) ? NULL : lookup_entry(args->line, pos, hash);
+    if (entry == NULL) {
+        s_unmatched++;
+        return ESP_ERR_NOT_FOUND;
+    }
+    args->prefix_len = (uint8_t)pos;
+    *out_entry = entry;
+
+    // 其余字段按 ':' 切分；超出 COMMAND_MAX_ARGS 的部分并入最后一个参数
+    const command_module_t *module = entry->module;
+    bool expect_verb = (module->verbs != NULL);
+    pos++;
+    while (pos <= len) {
+        size_t start = pos;
+        size_t end = start;
+        bool last = !expect_verb && args->argc == COMMAND_MAX_ARGS - 1;
+        while (end < len && (last || args->line[end] != ':')) {
+            end++;
+        }
+
+        command_arg_t field = {
+            .offset = (uint8_t)start,
+            .len = (uint8_t)(end - start),
+        };
+        field.is_number = parse_number(&args->line[start], field.len, &field.ival, &field.fval);
+
+        if (expect_verb) {
+            expect_verb = false;
+            // 数值直接跟在前缀后面 (如 "fan:75")，对应子命令 ""
+            int verb = match_verb(module, field.is_number ? "" : &args->line[start],
+                                  field.is_number ? 0 : field.len);
+            if (verb < 0) {
+                entry->stats.unsupported++;
+                return ESP_ERR_NOT_SUPPORTED;
+            }
+            args->verb_id = module->verbs[verb].id;
+            args->priority = (uint8_t)module->verbs[verb].priority;
+            args->coalesce = (module->verbs[verb].flags & COMMAND_VERB_FLAG_COALESCE) != 0;
+            args->no_throttle = (module->verbs[verb].flags & COMMAND_VERB_FLAG_NO_THROTTLE) != 0;
+            if (!field.is_number) {
+                pos = end + 1;
+                continue;
+            }
+        }
+
+        // "relay:on" 之后没有参数时不产生空字段
+        if (field.len > 0 || end < len) {
+            args->argv[args->argc++] = field;
+        }
+        pos = end + 1;
+    }
+    return ESP_OK;
+}
+
+static uint32_t clamp_us(int64_t us)
+{
+    if (us < 0) {
+        return 0;
+    }
+    return (us > UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+}
+
+static void record_stats(command_entry_t *entry, uint32_t wait_us, uint32_t exec_us, bool failed)
+{
+    int bucket = 0;
+    while (bucket < STATS_BUCKETS - 1 && (exec_us >> (bucket + 1)) != 0) {
+        bucket++;
+    }
+
+    command_stats_t *stats = &entry->stats;
+    taskENTER_CRITICAL(&s_stats_lock);
+    if (stats->count == 0 || exec_us < stats->min_us) {
+        stats->min_us = exec_us;
+    }
+    if (exec_us > stats->max_us) {
+        stats->max_us = exec_us;
+    }
+    stats->count++;
+    stats->errors += failed;
+    stats->total_us += exec_us;
+    stats->hist[bucket]++;
+    stats->wait_total_us += wait_us;
+    if (wait_us > stats->wait_max_us) {
+        stats->wait_max_us = wait_us;
+    }
+    taskEXIT_CRITICAL(&s_stats_lock);
+}
+
+/**
+ * @brief 取得模块的执行锁，*locked 表示是否需要释放
+ *
+ * 同步模块没有锁；已持有锁的任务 (高优先级处理函数再发同一模块的高优先级命令) 不重复加锁。
+ * 在 wait 内没有取得锁时返回 ESP_ERR_TIMEOUT。
+ */
+static esp_err_t entry_lock(command_entry_t *entry, TickType_t wait, bool *locked)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    *locked = false;
+    if (entry->run_lock == NULL || entry->run_owner == self) {
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(entry->run_lock, wait) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    entry->run_owner = self;
+    *locked = true;
+    return ESP_OK;
+}
+
+static void entry_unlock(command_entry_t *entry, bool locked)
+{
+    if (locked) {
+        entry->run_owner = NULL;
+        xSemaphoreGive(entry->run_lock);
+    }
+}
+
+static esp_err_t run_handler(command_entry_t *entry, const command_args_t *args)
+{
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = entry->module->handler(args);
+    int64_t end = esp_timer_get_time();
+
+    record_stats(entry, clamp_us(start - args->rx_us), clamp_us(end - start), err != ESP_OK);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "命令 '%s' 执行失败: %s", args->line, esp_err_to_name(err));
+    }
+    return err;
+}
+
+/**
+ * @brief 模块工作任务：按顺序逐条执行队列中的命令
+ */
+static void command_worker_task(void *pvParameters)
+{
+    command_entry_t *entry = (command_entry_t *)pvParameters;
+    command_job_t job;
+
+    for (;;) {
+        if (xQueueReceive(entry->queue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (job.slot >= 0) {
+            // 取出合并槽中最新的设定值，之后再到的同类命令会重新入队
+            taskENTER_CRITICAL(&s_slot_lock);
+            job.args = entry->slots[job.slot].args;
+            entry->slots[job.slot].pending = false;
+            taskEXIT_CRITICAL(&s_slot_lock);
+        }
+        // 取出之后、执行之前到达的高优先级命令 (例如调速之后的 motor:stop) 使这条命令作废
+        esp_err_t err;
+        bool locked;
+        entry_lock(entry, portMAX_DELAY, &locked);
+        if (job.generation != entry->generation) {
+            entry->dropped++;
+            ESP_LOGW(TAG, "命令 '%s' 已被高优先级命令取代，不再执行", job.args.line);
+            err = ESP_ERR_INVALID_STATE;
+        } else {
+            err = run_handler(entry, &job.args);
+        }
+        entry_unlock(entry, locked);
+        if (job.waiter != NULL) {
+            xTaskNotify(job.waiter, (job.token << 1) | (err != ESP_OK), eSetValueWithOverwrite);
+        }
+    }
+}
+
+static esp_err_t create_worker(command_entry_t *entry)
+{
+    const command_module_t *module = entry->module;
+
+    // 每个可合并的子命令对应一个合并槽
+    uint8_t coalesce_verbs = 0;
+    for (size_t i = 0; i < module->verb_count; i++) {
+        if (module->verbs[i].flags & COMMAND_VERB_FLAG_COALESCE) {
+            coalesce_verbs++;
+        }
+    }
+    if (coalesce_verbs > 0) {
+        entry->slots = calloc(coalesce_verbs, sizeof(coalesce_slot_t));
+        if (entry->slots == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        for (size_t i = 0; i < module->verb_count; i++) {
+            if (module->verbs[i].flags & COMMAND_VERB_FLAG_COALESCE) {
+                entry->slots[entry->slot_count++].verb_id = module->verbs[i].id;
+            }
+        }
+    }
+
+    entry->queue = xQueueCreate(module->queue_depth, sizeof(command_job_t));
+    entry->run_lock = xSemaphoreCreateMutex();
+    if (entry->queue == NULL || entry->run_lock == NULL) {
+        if (entry->queue != NULL) {
+            vQueueDelete(entry->queue);
+            entry->queue = NULL;
+        }
+        if (entry->run_lock != NULL) {
+            vSemaphoreDelete(entry->run_lock);
+            entry->run_lock = NULL;
+        }
+        free(entry->slots);
+        entry->slots = NULL;
+        entry->slot_count = 0;
+        return ESP_ERR_NO_MEM;
+    }
+
+    char task_name[configMAX_TASK_NAME_LEN];
+    snprintf(task_name, sizeof(task_name), "cmd_%s", module->prefix);
+    if (xTaskCreate(command_worker_task, task_name, WORKER_STACK_SIZE, entry,
+                    WORKER_PRIORITY, NULL) != pdPASS) {
+        vQueueDelete(entry->queue);
+        entry->queue = NULL;
+        vSemaphoreDelete(entry->run_lock);
+        entry->run_lock = NULL;
+        free(entry->slots);
+        entry->slots = NULL;
+        entry->slot_count = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static void release_slot(command_entry_t *entry, const command_job_t *job)
+{
+    if (job->slot >= 0) {
+        taskENTER_CRITICAL(&s_slot_lock);
+        entry->slots[job->slot].pending = false;
+        taskEXIT_CRITICAL(&s_slot_lock);
+    }
+}
+
+/**
+ * @brief 尝试把设定值合并到队列中已有的同类命令上
+ *
+ * @return true 已合并 (队列中已有该子命令，只更新了数值)，调用者无需再入队;
+ *         false 需要入队，job->slot 指明使用的合并槽
+ */
+static bool coalesce_command(command_entry_t *entry, const command_args_t *args, command_job_t *job)
+{
+    job->slot = -1;
+    if (!args->coalesce) {
+        return false;
+    }
+    for (uint8_t i = 0; i < entry->slot_count; i++) {
+        coalesce_slot_t *slot = &entry->slots[i];
+        if (slot->verb_id != args->verb_id) {
+            continue;
+        }
+        taskENTER_CRITICAL(&s_slot_lock);
+        bool merged = slot->pending;
+        slot->args = *args;
+        slot->pending = true;
+        taskEXIT_CRITICAL(&s_slot_lock);
+        if (merged) {
+            entry->coalesced++;
+            ESP_LOGD(TAG, "设定值合并: '%s'", args->line);
+            return true;
+        }
+        job->slot = (int8_t)i;
+        return false;
+    }
+    return false;
+}
+
+/**
+ * @brief 把命令放入模块队列，按模块的溢出策略处理队列满的情况
+ */
+static void enqueue_command(command_entry_t *entry, const command_args_t *args)
+{
+    command_job_t job = { .waiter = NULL, .generation = entry->generation };
+    if (coalesce_command(entry, args, &job)) {
+        return;
+    }
+    if (job.slot < 0) {
+        job.args = *args;
+    }
+
+    TickType_t wait = (entry->module->overflow == COMMAND_OVERFLOW_BLOCK) ?
+                      pdMS_TO_TICKS(BLOCK_TIMEOUT_MS) : 0;
+    if (xQueueSend(entry->queue, &job, wait) == pdTRUE) {
+        return;
+    }
+
+    if (entry->module->overflow == COMMAND_OVERFLOW_DROP_OLDEST) {
+        command_job_t oldest;
+        if (xQueueReceive(entry->queue, &oldest, 0) == pdTRUE) {
+            entry->dropped++;
+            release_slot(entry, &oldest);
+            ESP_LOGW(TAG, "模块 '%s' 队列已满，丢弃最旧的命令", entry->module->prefix);
+        }
+        if (xQueueSend(entry->queue, &job, 0) == pdTRUE) {
+            return;
+        }
+    }
+
+    release_slot(entry, &job);
+    entry->dropped++;
+    ESP_LOGW(TAG, "模块 '%s' 队列已满，丢弃命令: '%s' (累计丢弃 %lu)",
+             entry->module->prefix, args->line, (unsigned long)entry->dropped);
+}
+
+/**
+ * @brief 执行一条高优先级命令并记录从到达到执行完毕的延迟
+ *
+ * 与模块工作任务互斥: 正在执行的普通命令先执行完，工作任务已经取出但还没执行的命令
+ * 因 generation 变化而作废，不会在停止之后重新生效。
+ * 等锁最多 PRIORITY_LOCK_TIMEOUT_MS：普通命令卡住时不再等待，记录超时后不持锁直接执行
+ * (安全命令只做几次 GPIO 操作)，高优先级任务和后面的安全命令不会被一个模块拖住。
+ */
+static esp_err_t run_priority_job(command_entry_t *entry, const command_args_t *args)
+{
+    bool locked;
+    if (entry_lock(entry, pdMS_TO_TICKS(PRIORITY_LOCK_TIMEOUT_MS), &locked) != ESP_OK) {
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_priority_stats.lock_timeouts++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        ESP_LOGE(TAG, "模块 '%s' 的普通命令 %d ms 内没有执行完，不等待直接执行 '%s'",
+                 entry->module->prefix, PRIORITY_LOCK_TIMEOUT_MS, args->line);
+    }
+    entry->generation++;
+
+    // 模块队列里还没执行的普通命令已经过时 (例如停止之前的调速)，直接丢弃；
+    // 等待结果的批量步骤收到失败通知，不必等到超时
+    if (entry->queue != NULL) {
+        unsigned pending = 0;
+        command_job_t stale;
+        while (xQueueReceive(entry->queue, &stale, 0) == pdTRUE) {
+            pending++;
+            release_slot(entry, &stale);
+            if (stale.waiter != NULL) {
+                xTaskNotify(stale.waiter, (stale.token << 1) | 1, eSetValueWithOverwrite);
+            }
+        }
+        if (pending > 0) {
+            entry->dropped += pending;
+            ESP_LOGW(TAG, "高优先级命令 '%s' 清空了模块队列中的 %u 条命令", args->line, pending);
+        }
+    }
+
+    esp_err_t err = run_handler(entry, args);
+    entry_unlock(entry, locked);
+
+    // 从传输层收到命令 (UART 字节到达) 算起，到处理函数返回 (GPIO 已经改变)
+    int64_t latency = esp_timer_get_time() - args->arrival_us;
+    bool new_max = false;
+    taskENTER_CRITICAL(&s_stats_lock);
+    s_priority_stats.count++;
+    s_priority_stats.last_latency_us = latency;
+    if (latency > s_priority_stats.max_latency_us) {
+        s_priority_stats.max_latency_us = latency;
+        new_max = true;
+    }
+    taskEXIT_CRITICAL(&s_stats_lock);
+    if (new_max) {
+        ESP_LOGI(TAG, "高优先级命令最坏延迟更新: %lld us ('%s')", (long long)latency, args->line);
+    }
+    return err;
+}
+
+/**
+ * @brief 高优先级任务：立即执行安全相关命令，抢占 UART 接收任务和各模块工作任务
+ */
+static void command_priority_task(void *pvParameters)
+{
+    priority_job_t job;
+
+    for (;;) {
+        if (xQueueReceive(s_priority_queue, &job, portMAX_DELAY) == pdTRUE) {
+            run_priority_job(job.entry, &job.args);
+        }
+    }
+}
+
+static void dispatch_priority(command_entry_t *entry, const command_args_t *args)
+{
+    // 在高优先级任务自身中 (例如 function:stop_steam 内部再发 relay:off) 直接执行，保持顺序
+    if (s_priority_task == NULL || xTaskGetCurrentTaskHandle() == s_priority_task) {
+        run_priority_job(entry, args);
+        return;
+    }
+
+    priority_job_t job = { .entry = entry, .args = *args };
+    // 队列中全是高优先级命令，按到达顺序执行 (例如先 relay:off 再 function:stop_steam)
+    if (xQueueSend(s_priority_queue, &job, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_priority_stats.dropped++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        ESP_LOGE(TAG, "高优先级队列已满，丢弃命令: '%s'", args->line);
+    }
+}
+
+/**
+ * @brief 把一条回复追加到批量命令的汇总缓冲
+ *
+ * 各条回复去掉 "STATUS:" 前缀后以 '|' 分隔，缓冲满时截断。
+ */
+static void batch_reply_append(batch_reply_t *reply, const char *line)
+{
+    if (reply->discard || reply->len >= sizeof(reply->buf) - 1) {
+        return;
+    }
+    if (strncmp(line, "STATUS:", 7) == 0) {
+        line += 7;
+    }
+    int n = snprintf(reply->buf + reply->len, sizeof(reply->buf) - reply->len, "%s%s",
+                     reply->len > 0 ? "|" : "", line);
+    if (n > 0) {
+        reply->len += (size_t)n;
+        if (reply->len >= sizeof(reply->buf)) {
+            reply->len = sizeof(reply->buf) - 1;
+        }
+    }
+}
+
+static void send_reply(uint8_t origin, const char *reply_to, const char *line)
+{
+    command_reply_sink_t sink = (origin < COMMAND_ORIGIN_MAX) ? s_reply_sinks[origin] : NULL;
+    if (sink != NULL) {
+        sink(reply_to, line);
+    } else {
+        ESP_LOGD(TAG, "来源 %u 未设置回复通道，丢弃回复: %s", (unsigned)origin, line);
+    }
+}
+
+static void bucket_init(token_bucket_t *bucket, uint32_t rate, uint32_t burst)
+{
+    bucket->rate = rate;
+    bucket->burst = (burst > 0) ? burst : 1;
+    bucket->tokens = bucket->burst * 1000;
+    bucket->last_us = esp_timer_get_time();
+}
+
+static void bucket_refill(token_bucket_t *bucket, int64_t now)
+{
+    if (bucket->rate == 0) {
+        return;
+    }
+    int64_t elapsed = now - bucket->last_us;
+    uint64_t add = (elapsed > 0) ? (uint64_t)elapsed * bucket->rate / 1000 : 0;
+    uint64_t tokens = bucket->tokens + add;
+    uint32_t cap = bucket->burst * 1000;
+    bucket->tokens = (tokens > cap) ? cap : (uint32_t)tokens;
+    bucket->last_us = now;
+}
+
+static bool bucket_ready(const token_bucket_t *bucket)
+{
+    return bucket == NULL || bucket->rate == 0 || bucket->tokens >= 1000;
+}
+
+static void bucket_take(token_bucket_t *bucket)
+{
+    if (bucket != NULL && bucket->rate != 0) {
+        bucket->tokens -= 1000;
+    }
+}
+
+/**
+ * @brief 速率限制：来源和前缀的令牌桶都有余量时才放行，并各消耗一个令牌
+ *
+ * @param entry 目标模块，批量命令只按来源限速时传 NULL
+ * @return true 放行; false 超出限制，命令应被丢弃
+ */
+static bool rate_limit_admit(uint8_t origin, command_entry_t *entry, int64_t now)
+{
+    // 设备内部发出的命令不限速
+    if (origin == COMMAND_ORIGIN_LOCAL || origin >= COMMAND_ORIGIN_MAX) {
+        return true;
+    }
+
+    token_bucket_t *source = &s_source_buckets[origin];
+    token_bucket_t *prefix = entry ? &entry->bucket : NULL;
+    bool admitted;
+
+    taskENTER_CRITICAL(&s_limit_lock);
+    bucket_refill(source, now);
+    if (prefix != NULL) {
+        bucket_refill(prefix, now);
+    }
+    admitted = bucket_ready(source) && bucket_ready(prefix);
+    if (admitted) {
+        bucket_take(source);
+        bucket_take(prefix);
+    } else {
+        s_source_throttled[origin]++;
+        s_throttle_pending[origin]++;
+        if (prefix != NULL && !bucket_ready(prefix)) {
+            entry->stats.throttled++;
+        }
+    }
+    taskEXIT_CRITICAL(&s_limit_lock);
+    return admitted;
+}
+
+/**
+ * @brief 被限速时向来源发送提示，同一来源每 THROTTLE_NOTICE_MS 最多一条
+ */
+static void throttle_notice(uint8_t origin, const char *reply_to, const char *target, int64_t now)
+{
+    uint32_t pending = 0;
+    taskENTER_CRITICAL(&s_limit_lock);
+    if (now - s_throttle_notice_us[origin] >= THROTTLE_NOTICE_US) {
+        s_throttle_notice_us[origin] = now;
+        pending = s_throttle_pending[origin];
+        s_throttle_pending[origin] = 0;
+    }
+    taskEXIT_CRITICAL(&s_limit_lock);
+
+    if (pending > 0) {
+        char line[64];
+        snprintf(line, sizeof(line), "STATUS:THROTTLED:%s:%lu", target, (unsigned long)pending);
+        ESP_LOGW(TAG, "命令超出速率限制 (来源 %u, %s)，%lu 条已丢弃", (unsigned)origin, target,
+                 (unsigned long)pending);
+        send_reply(origin, reply_to, line);
+    }
+}
+
+static void set_source(command_args_t *args, const command_source_t *source)
+{
+    args->origin = (uint8_t)source->origin;
+    if (source->reply_to != NULL) {
+        snprintf(args->reply_to, sizeof(args->reply_to), "%s", source->reply_to);
+    } else {
+        args->reply_to[0] = '\0';
+    }
+}
+
+/**
+ * @brief 执行批量命令中的一步，并等待处理函数执行完毕
+ *
+ * 带队列的模块仍在自己的工作任务中执行，保证同一模块的命令不会并发，
+ * 批量任务通过任务通知等待结果。
+ */
+static esp_err_t batch_run_step(command_entry_t *entry, const command_args_t *args)
+{
+    if (args->priority == COMMAND_PRIORITY_HIGH) {
+        return run_priority_job(entry, args);
+    }
+    if (entry->queue == NULL) {
+        return run_handler(entry, args);
+    }
+
+    s_batch_token = (s_batch_token + 1) & 0x7FFFFFFF;
+    command_job_t job = {
+        .slot = -1,
+        .args = *args,
+        .waiter = s_batch_task,
+        .token = s_batch_token,
+        .generation = entry->generation,
+    };
+    TickType_t timeout = pdMS_TO_TICKS(BATCH_STEP_TIMEOUT_MS);
+    TickType_t start = xTaskGetTickCount();
+    if (xQueueSend(entry->queue, &job, timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    for (;;) {
+        uint32_t value = 0;
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout ||
+            xTaskNotifyWait(0, UINT32_MAX, &value, timeout - elapsed) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+        // 编号不一致的是之前超时步骤迟到的通知，忽略
+        if ((value >> 1) == job.token) {
+            return (value & 1) ? ESP_FAIL : ESP_OK;
+        }
+    }
+}
+
+/**
+ * @brief 解析并执行一条批量命令，最后只回复一帧汇总状态
+ *
+ * "batch:fan:75;relay:on;stepper:open"
+ *   -> 全部解析成功才开始执行，否则回复 "STATUS:BATCH:REJECTED:<序号>:<原因>"，不执行任何一步
+ *   -> 全部成功回复 "STATUS:BATCH:OK:<条数>|FAN_SPEED_SET:75|RELAY_ON|..."
+ *   -> 第 N 步失败时，按相反顺序执行第 N..0 步执行前记录的恢复命令，
+ *      回复 "STATUS:BATCH:FAILED:<N>:<原因>:ROLLBACK:<已恢复的步数>"
+ */
+static void batch_execute(const batch_request_t *request)
+{
+    char frame[BATCH_REPLY_LEN + 48];
+    const char *line = request->line;
+    size_t len = request->len;
+    size_t count = 0;
+    size_t pos = strlen(BATCH_PREFIX);
+
+    s_batch_reply.len = 0;
+    s_batch_reply.buf[0] = '\0';
+    s_batch_reply.discard = false;
+
+    // 第一步：解析所有子命令
+    while (pos < len) {
+        while (pos < len && line[pos] == ' ') {
+            pos++;
+        }
+        size_t end = pos;
+        while (end < len && line[end] != ';') {
+            end++;
+        }
+        if (end > pos) {
+            esp_err_t err = ESP_ERR_INVALID_SIZE;
+            if (count < BATCH_MAX_COMMANDS) {
+                batch_step_t *step = &s_batch_steps[count];
+                step->entry = NULL;
+                err = parse_command(&line[pos], end - pos, &step->args, &step->entry);
+                step->args.arrival_us = request->arrival_us;
+                step->args.rx_us = request->rx_us;
+                step->args.reply_ctx = &s_batch_reply;
+                step->args.origin = request->origin;
+                snprintf(step->args.reply_to, sizeof(step->args.reply_to), "%s", request->reply_to);
+            }
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "批量命令第 %u 条 '%.*s' 无效: %s，整批不执行",
+                         (unsigned)count, (int)(end - pos), &line[pos], esp_err_to_name(err));
+                snprintf(frame, sizeof(frame), "STATUS:BATCH:REJECTED:%u:%s",
+                         (unsigned)count, esp_err_to_name(err));
+                send_reply(request->origin, request->reply_to, frame);
+                return;
+            }
+            count++;
+        }
+        pos = end + 1;
+    }
+    if (count == 0) {
+        send_reply(request->origin, request->reply_to, "STATUS:BATCH:REJECTED:0:ESP_ERR_INVALID_ARG");
+        return;
+    }
+
+    // 第二步：逐条执行，执行前记录恢复命令
+    size_t failed = count;
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < count; i++) {
+        batch_step_t *step = &s_batch_steps[i];
+        command_snapshot_t snapshot = step->entry->module->snapshot;
+        if (snapshot == NULL || !snapshot(&step->args, step->restore, sizeof(step->restore))) {
+            step->restore[0] = '\0';
+        }
+        step->args.dispatch_us = esp_timer_get_time();
+        err = batch_run_step(step->entry, &step->args);
+        if (err != ESP_OK) {
+            failed = i;
+            break;
+        }
+    }
+
+    if (failed == count) {
+        snprintf(frame, sizeof(frame), "STATUS:BATCH:OK:%u|%s", (unsigned)count, s_batch_reply.buf);
+        send_reply(request->origin, request->reply_to, frame);
+        return;
+    }
+
+    // 第三步：回滚。失败的一步可能已经执行了一部分，也一并恢复
+    ESP_LOGW(TAG, "批量命令第 %u 条 '%s' 执行失败，开始回滚", (unsigned)failed, s_batch_steps[failed].args.line);
+    s_batch_reply.discard = true;
+    unsigned restored = 0;
+    for (size_t i = failed + 1; i-- > 0;) {
+        const char *restore = s_batch_steps[i].restore;
+        if (restore[0] == '\0') {
+            ESP_LOGW(TAG, "'%s' 无法回滚", s_batch_steps[i].args.line);
+            continue;
+        }
+        command_args_t args;
+        command_entry_t *entry = NULL;
+        if (parse_command(restore, strlen(restore), &args, &entry) != ESP_OK) {
+            ESP_LOGE(TAG, "回滚命令 '%s' 无效", restore);
+            continue;
+        }
+        args.rx_us = esp_timer_get_time();
+        args.arrival_us = args.rx_us;
+        args.dispatch_us = args.rx_us;
+        args.reply_ctx = &s_batch_reply;
+        args.origin = request->origin;
+        snprintf(args.reply_to, sizeof(args.reply_to), "%s", request->reply_to);
+        if (batch_run_step(entry, &args) == ESP_OK) {
+            restored++;
+        }
+    }
+    snprintf(frame, sizeof(frame), "STATUS:BATCH:FAILED:%u:%s:ROLLBACK:%u",
+             (unsigned)failed, esp_err_to_name(err), restored);
+    send_reply(request->origin, request->reply_to, frame);
+}
+
+/**
+ * @brief 批量命令任务：逐个执行排队的批量命令，不阻塞 UART 接收任务
+ */
+static void command_batch_task(void *pvParameters)
+{
+    batch_request_t request;
+
+    for (;;) {
+        if (xQueueReceive(s_batch_queue, &request, portMAX_DELAY) == pdTRUE) {
+            batch_execute(&request);
+        }
+    }
+}
+
+static void dispatch_batch(const command_source_t *source, const char *full_command, size_t len,
+                           int64_t arrival_us, int64_t rx_us)
+{
+    const char *reply_to = source->reply_to ? source->reply_to : "";
+    // 去除行尾的换行/空白
+    while (len > 0 && (full_command[len - 1] == '\n' || full_command[len - 1] == '\r' ||
+                       full_command[len - 1] == ' '  || full_command[len - 1] == '\0')) {
+        len--;
+    }
+    if (len >= BATCH_MAX_LEN) {
+        ESP_LOGW(TAG, "批量命令过长 (%d 字节)，已丢弃", (int)len);
+        send_reply(source->origin, reply_to, "STATUS:BATCH:REJECTED:0:ESP_ERR_INVALID_SIZE");
+        return;
+    }
+
+    batch_request_t request;
+    memcpy(request.line, full_command, len);
+    request.line[len] = '\0';
+    request.len = len;
+    request.arrival_us = arrival_us;
+    request.rx_us = rx_us;
+    request.origin = (uint8_t)source->origin;
+    snprintf(request.reply_to, sizeof(request.reply_to), "%s", reply_to);
+    if (s_batch_queue == NULL || xQueueSend(s_batch_queue, &request, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "批量命令队列已满，丢弃: '%s'", request.line);
+        send_reply(source->origin, reply_to, "STATUS:BATCH:BUSY");
+    }
+}
+
+static uint32_t stats_percentile(const command_stats_t *stats, uint32_t permille)
+{
+    // 取直方图中累计到该百分位的桶的上界，不超过实测最大值
+    uint64_t target = ((uint64_t)stats->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_BUCKETS - 1; i++) {
+        seen += stats->hist[i];
+        if (seen >= target) {
+            uint32_t upper = (2u << i) - 1;
+            return (upper < stats->max_us) ? upper : stats->max_us;
+        }
+    }
+    return stats->max_us;
+}
+
+static void fill_prefix_stats(const command_entry_t *entry, command_prefix_stats_t *out)
+{
+    command_stats_t stats;
+    taskENTER_CRITICAL(&s_stats_lock);
+    stats = entry->stats;
+    taskEXIT_CRITICAL(&s_stats_lock);
+
+    memset(out, 0, sizeof(*out));
+    out->prefix = entry->module->prefix;
+    out->count = stats.count;
+    out->errors = stats.errors;
+    out->unsupported = stats.unsupported;
+    out->dropped = entry->dropped;
+    out->coalesced = entry->coalesced;
+    if (stats.count > 0) {
+        out->min_us = stats.min_us;
+        out->avg_us = (uint32_t)(stats.total_us / stats.count);
+        out->p99_us = stats_percentile(&stats, 990);
+        out->max_us = stats.max_us;
+        out->wait_avg_us = (uint32_t)(stats.wait_total_us / stats.count);
+        out->wait_max_us = stats.wait_max_us;
+    }
+    out->throttled = stats.throttled;
+}
+
+// --- 内置诊断命令 "diag:dispatch[:<页>]" / "diag:reset" / "diag:cpu" ---
+enum {
+    DIAG_VERB_DISPATCH,
+    DIAG_VERB_RESET,
+    DIAG_VERB_CPU,
+};
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static configRUN_TIME_COUNTER_TYPE s_cpu_idle_last[portNUM_PROCESSORS];
+static configRUN_TIME_COUNTER_TYPE s_cpu_total_last;
+static int64_t s_cpu_last_us;
+#endif
+
+/**
+ * @brief 回复自上一次 diag:cpu 以来各核的负载 (千分比)，即 1000 减去空闲任务所占的运行时间
+ *
+ * 用于对比不同实现 (例如串口驱动与 DMA) 在同样负载下的 CPU 占用：
+ * 开始前发一次清零窗口，结束后再发一次读取。
+ */
+static esp_err_t diag_cpu(const command_args_t *args)
+{
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    char line[96];
+    int64_t now = esp_timer_get_time();
+    configRUN_TIME_COUNTER_TYPE total = portGET_RUN_TIME_COUNTER_VALUE();
+    configRUN_TIME_COUNTER_TYPE window = total - s_cpu_total_last;
+    int len = snprintf(line, sizeof(line), "STATUS:DIAG:CPU:window_ms=%lu",
+                       (unsigned long)((now - s_cpu_last_us) / 1000));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        configRUN_TIME_COUNTER_TYPE idle = ulTaskGetIdleRunTimeCounterForCore(core);
+        configRUN_TIME_COUNTER_TYPE idle_delta = idle - s_cpu_idle_last[core];
+        s_cpu_idle_last[core] = idle;
+        uint32_t load = 0;
+        if (window > 0 && idle_delta < window) {
+            load = (uint32_t)(1000 - (uint64_t)idle_delta * 1000 / window);
+        }
+        len += snprintf(line + len, sizeof(line) - len, ",core%d=%lu", core, (unsigned long)load);
+    }
+    s_cpu_total_last = total;
+    s_cpu_last_us = now;
+    command_dispatcher_reply(args, line);
+    return ESP_OK;
+#else
+    command_dispatcher_reply(args, "STATUS:DIAG:CPU:UNSUPPORTED");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static esp_err_t diag_command_handler(const command_args_t *args)
+{
+    char line[160];
+
+    switch (args->verb_id) {
+    case DIAG_VERB_DISPATCH: {
+        // 分页回复，一次连续发出的行数不超过 UART 发送队列；"diag:dispatch" 即第 0 页
+        int32_t page = 0;
+        if (args->argc > 0 && !command_args_int(args, 0, &page)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        int pages = (s_handler_count + DIAG_PAGE_SIZE - 1) / DIAG_PAGE_SIZE;
+        if (page < 0 || page >= pages) {
+            command_dispatcher_reply(args, "STATUS:DIAG:PAGE_INVALID");
+            return ESP_ERR_INVALID_ARG;
+        }
+        // 每个前缀一行: 次数/失败/执行时间 min/avg/p99/max/等待时间 avg/max/丢弃/合并 (us)
+        int end = (page + 1) * DIAG_PAGE_SIZE;
+        if (end > s_handler_count) {
+            end = s_handler_count;
+        }
+        for (int i = page * DIAG_PAGE_SIZE; i < end; i++) {
+            command_prefix_stats_t stats;
+            fill_prefix_stats(&s_command_table[i], &stats);
+            snprintf(line, sizeof(line),
+                     "STATUS:DIAG:%s:n=%lu,err=%lu,unsup=%lu,min=%lu,avg=%lu,p99=%lu,max=%lu,"
+                     "wait=%lu,wait_max=%lu,drop=%lu,merge=%lu,thr=%lu",
+                     stats.prefix, (unsigned long)stats.count, (unsigned long)stats.errors,
+                     (unsigned long)stats.unsupported, (unsigned long)stats.min_us,
+                     (unsigned long)stats.avg_us, (unsigned long)stats.p99_us,
+                     (unsigned long)stats.max_us, (unsigned long)stats.wait_avg_us,
+                     (unsigned long)stats.wait_max_us, (unsigned long)stats.dropped,
+                     (unsigned long)stats.coalesced, (unsigned long)stats.throttled);
+            command_dispatcher_reply(args, line);
+        }
+        // 每页以汇总行结束，page=<页号>/<总页数> 告诉请求者还有没有下一页
+        snprintf(line, sizeof(line), "STATUS:DIAG:unmatched:%lu,thr_uart=%lu,thr_mqtt=%lu,page=%ld/%d",
+                 (unsigned long)s_unmatched,
+                 (unsigned long)s_source_throttled[COMMAND_ORIGIN_UART],
+                 (unsigned long)s_source_throttled[COMMAND_ORIGIN_MQTT], (long)page, pages);
+        command_dispatcher_reply(args, line);
+        break;
+    }
+    case DIAG_VERB_RESET:
+        command_dispatcher_reset_stats();
+        command_dispatcher_reply(args, "STATUS:DIAG:RESET");
+        break;
+    case DIAG_VERB_CPU:
+        return diag_cpu(args);
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+static const command_verb_t s_diag_verbs[] = {
+    { "dispatch", DIAG_VERB_DISPATCH },
+    { "reset",    DIAG_VERB_RESET },
+    { "cpu",      DIAG_VERB_CPU },
+};
+
+static const command_module_t s_diag_module = {
+    .prefix     = "diag",
+    .handler    = diag_command_handler,
+    .verbs      = s_diag_verbs,
+    .verb_count = sizeof(s_diag_verbs) / sizeof(s_diag_verbs[0]),
+};
+
+/**
+ * @brief 初始化命令分发器
+ */
+esp_err_t command_dispatcher_init(void) {
     memset(s_command_table, 0, sizeof(s_command_table));  //注册表
-    s_handler_count = 0;  
-    ESP_LOGI(TAG, "命令分发中心已初始化，准备接收模块注册...");  
-    return ESP_OK;  
-}  
-
-/**  
- * @brief 注册命令处理器  
- */  
-esp_err_t command_dispatcher_register(const char *command_prefix, command_handler_t handler) {  
-    if (s_handler_count >= MAX_COMMAND_HANDLERS) {  
-        ESP_LOGE(TAG, "命令注册表已满，无法注册 '%s'", command_prefix);  
-        return ESP_ERR_NO_MEM;  
-    }  
- 
-    for (int i = 0; i < s_handler_count; i++) {  
-        if (strcmp(s_command_table[i].prefix, command_prefix) == 0) {  
-            ESP_LOGE(TAG, "命令前缀 '%s' 已经被注册，请勿重复注册！", command_prefix);  
-            return ESP_ERR_INVALID_STATE;  
-        }  
-    }  
-
-    s_command_table[s_handler_count].prefix = command_prefix;  
-    s_command_table[s_handler_count].handler = handler;  
-    s_command_table[s_handler_count].prefix_len = strlen(command_prefix);  
-    s_handler_count++;  
-
-    ESP_LOGI(TAG, "命令处理器为 '%s' 注册成功！", command_prefix);  
-    return ESP_OK;  
-}  
-
-/**  
- * @brief 核心分发逻辑  
- */  
-void command_dispatcher_forward(const char *full_command, size_t len) {  
-    ESP_LOGD(TAG, "收到命令，准备分发: %.*s", len, full_command);  
- 
-    for (int i = 0; i < s_handler_count; i++) {  
-        const command_entry_t* entry = &s_command_table[i];  
-        
-        // 检查命令是否以此前缀开头，并且后面必须跟着一个分隔符 (我们约定用':')  
-        // 例如，命令 "led:on" 匹配前缀 "led"  
-        if (len > entry->prefix_len &&   
-            strncmp(full_command, entry->prefix, entry->prefix_len) == 0 &&  
-            full_command[entry->prefix_len] == ':')   
-        {  
-            ESP_LOGI(TAG, "命令匹配到前缀 '%s'，转发给对应的处理器。", entry->prefix);  
-             
-            entry->handler(full_command, len);  
-            
-            // 假设一条命令只会被一个模块处理，找到后就立即返回  
-            return;  
-        }  
-    }  
-
-    // 如果循环结束都没有找到匹配的处理器  
-    ESP_LOGW(TAG, "未找到能处理此命令的模块: '%.*s'", len, full_command);  
-}  
\ No newline at end of file
+    memset(s_hash_index, -1, sizeof(s_hash_index));
+    s_handler_count = 0;
+    memset(&s_priority_stats, 0, sizeof(s_priority_stats));
+
+    if (s_priority_queue == NULL) {
+        s_priority_queue = xQueueCreate(PRIORITY_QUEUE_DEPTH, sizeof(priority_job_t));
+        if (s_priority_queue == NULL ||
+            xTaskCreate(command_priority_task, "cmd_priority", PRIORITY_TASK_STACK, NULL,
+                        PRIORITY_TASK_PRIO, &s_priority_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建高优先级命令通道失败");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (s_batch_queue == NULL) {
+        s_batch_queue = xQueueCreate(BATCH_QUEUE_DEPTH, sizeof(batch_request_t));
+        if (s_batch_queue == NULL ||
+            xTaskCreate(command_batch_task, "cmd_batch", BATCH_TASK_STACK, NULL,
+                        WORKER_PRIORITY, &s_batch_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建批量命令任务失败");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_unmatched = 0;
+    memset(s_source_throttled, 0, sizeof(s_source_throttled));
+    memset(s_throttle_pending, 0, sizeof(s_throttle_pending));
+    memset(s_throttle_notice_us, 0, sizeof(s_throttle_notice_us));
+    bucket_init(&s_source_buckets[COMMAND_ORIGIN_LOCAL], 0, 0);
+    bucket_init(&s_source_buckets[COMMAND_ORIGIN_UART], UART_RATE, UART_BURST);
+    bucket_init(&s_source_buckets[COMMAND_ORIGIN_MQTT], MQTT_RATE, MQTT_BURST);
+    command_dispatcher_register(&s_diag_module);
+    command_timer_init();
+    status_registry_init();
+    command_probe_init();
+    ESP_LOGI(TAG, "命令分发中心已初始化，准备接收模块注册...");
+    return ESP_OK;
+}
+
+/**
+ * @brief 注册命令处理模块
+ */
+esp_err_t command_dispatcher_register(const command_module_t *module) {
+    if (module == NULL || module->prefix == NULL || module->handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_handler_count >= MAX_COMMAND_HANDLERS) {
+        ESP_LOGE(TAG, "命令注册表已满，无法注册 '%s'", module->prefix);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t prefix_len = strlen(module->prefix);
+    uint32_t hash = prefix_hash(module->prefix, prefix_len);
+    if (lookup_entry(module->prefix, prefix_len, hash) != NULL) {
+        ESP_LOGE(TAG, "命令前缀 '%s' 已经被注册，请勿重复注册！", module->prefix);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    command_entry_t *entry = &s_command_table[s_handler_count];
+    entry->module = module;
+    entry->hash = hash;
+    entry->prefix_len = prefix_len;
+    entry->queue = NULL;
+    entry->run_lock = NULL;
+    entry->run_owner = NULL;
+    entry->generation = 0;
+    entry->dropped = 0;
+    entry->slots = NULL;
+    entry->slot_count = 0;
+    entry->coalesced = 0;
+    memset(&entry->stats, 0, sizeof(entry->stats));
+    bucket_init(&entry->bucket, PREFIX_RATE, PREFIX_BURST);
+
+    if (module->queue_depth > 0) {
+        esp_err_t err = create_worker(entry);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "为 '%s' 创建命令队列/工作任务失败", module->prefix);
+            return err;
+        }
+    }
+
+    uint32_t slot = hash & (COMMAND_HASH_SLOTS - 1);
+    while (s_hash_index[slot] >= 0) {
+        slot = (slot + 1) & (COMMAND_HASH_SLOTS - 1);
+    }
+    s_hash_index[slot] = (int8_t)s_handler_count;
+    s_handler_count++;
+
+    ESP_LOGI(TAG, "命令处理器为 '%s' 注册成功！(%s)", module->prefix,
+             entry->queue ? "独立队列执行" : "同步执行");
+    return ESP_OK;
+}
+
+/**
+ * @brief 核心分发逻辑
+ */
+void command_dispatcher_forward_from(const command_source_t *source, const char *full_command, size_t len) {
+    ESP_LOGD(TAG, "收到命令，准备分发: %.*s", (int)len, full_command);
+
+    int64_t rx_us = esp_timer_get_time();
+    int64_t arrival_us = source->arrival_us != 0 ? source->arrival_us : rx_us;
+    size_t batch_prefix_len = strlen(BATCH_PREFIX);
+    if (len > batch_prefix_len && memcmp(full_command, BATCH_PREFIX, batch_prefix_len) == 0) {
+        // 批量命令整体按一条命令计入来源的速率限制
+        if (!source->no_rate_limit && !rate_limit_admit((uint8_t)source->origin, NULL, rx_us)) {
+            throttle_notice((uint8_t)source->origin, source->reply_to ? source->reply_to : "", "batch", rx_us);
+            return;
+        }
+        dispatch_batch(source, full_command, len, arrival_us, rx_us);
+        return;
+    }
+
+    command_args_t args;
+    command_entry_t *entry = NULL;
+    args.arrival_us = arrival_us;
+    args.rx_us = rx_us;
+    args.reply_ctx = NULL;
+    set_source(&args, source);
+    esp_err_t err = parse_command(full_command, len, &args, &entry);
+    switch (err) {
+    case ESP_OK:
+        break;
+    case ESP_ERR_NOT_SUPPORTED:
+        ESP_LOGW(TAG, "模块 '%s' 不支持此子命令: '%s'", entry->module->prefix, args.line);
+        break;
+    case ESP_ERR_INVALID_SIZE:
+        ESP_LOGW(TAG, "命令过长 (%d 字节)，已丢弃", (int)len);
+        break;
+    case ESP_ERR_INVALID_ARG:
+        return;
+    default:
+        // 如果注册表中没有找到匹配的处理器
+        ESP_LOGW(TAG, "未找到能处理此命令的模块: '%.*s'", (int)len, full_command);
+        break;
+    }
+    if (err != ESP_OK) {
+        // 指定了 reply_to 的请求者 (如 MQTT) 等待每条命令的应答，无效命令也要回复
+        if (args.reply_to[0] != '\0') {
+            char line[48];
+            snprintf(line, sizeof(line), "ERROR:%s", esp_err_to_name(err));
+            send_reply(args.origin, args.reply_to, line);
+        }
+        return;
+    }
+
+    // 安全相关命令和可合并的设定值 (泛洪时本来就只执行最新一条) 不限速
+    if (!source->no_rate_limit && args.priority != COMMAND_PRIORITY_HIGH && !args.coalesce &&
+        !args.no_throttle && !rate_limit_admit(args.origin, entry, rx_us)) {
+        throttle_notice(args.origin, args.reply_to, entry->module->prefix, rx_us);
+        return;
+    }
+
+    args.dispatch_us = esp_timer_get_time();
+
+    ESP_LOGD(TAG, "命令匹配到前缀 '%s'，转发给对应的处理器。", entry->module->prefix);
+    if (args.priority == COMMAND_PRIORITY_HIGH) {
+        dispatch_priority(entry, &args);
+        return;
+    }
+    if (entry->queue != NULL) {
+        enqueue_command(entry, &args);
+        return;
+    }
+    run_handler(entry, &args);
+}
+
+void command_dispatcher_forward(const char *full_command, size_t len)
+{
+    static const command_source_t local = { .origin = COMMAND_ORIGIN_LOCAL };
+    command_dispatcher_forward_from(&local, full_command, len);
+}
+
+void command_dispatcher_set_reply_sink(command_origin_t origin, command_reply_sink_t sink)
+{
+    if (origin < COMMAND_ORIGIN_MAX) {
+        s_reply_sinks[origin] = sink;
+    }
+}
+
+void command_dispatcher_reply(const command_args_t *args, const char *line)
+{
+    if (args == NULL) {
+        send_reply(COMMAND_ORIGIN_LOCAL, "", line);
+        return;
+    }
+    if (args->reply_ctx != NULL) {
+        batch_reply_append((batch_reply_t *)args->reply_ctx, line);
+        return;
+    }
+    send_reply(args->origin, args->reply_to, line);
+}
+
+void command_dispatcher_send(command_origin_t origin, const char *reply_to, const char *line)
+{
+    send_reply(origin, reply_to != NULL ? reply_to : "", line);
+}
+
+static command_entry_t *module_entry(const command_module_t *module)
+{
+    size_t len = strlen(module->prefix);
+    command_entry_t *entry = lookup_entry(module->prefix, len, prefix_hash(module->prefix, len));
+    return (entry != NULL && entry->module == module) ? entry : NULL;
+}
+
+esp_err_t command_dispatcher_lock_module(const command_module_t *module, uint32_t timeout_ms, bool *locked)
+{
+    *locked = false;
+    command_entry_t *entry = module_entry(module);
+    if (entry == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return entry_lock(entry, pdMS_TO_TICKS(timeout_ms), locked);
+}
+
+void command_dispatcher_unlock_module(const command_module_t *module, bool locked)
+{
+    if (locked) {
+        entry_unlock(module_entry(module), true);
+    }
+}
+
+void command_dispatcher_get_priority_stats(command_priority_stats_t *stats)
+{
+    if (stats != NULL) {
+        taskENTER_CRITICAL(&s_stats_lock);
+        *stats = s_priority_stats;
+        taskEXIT_CRITICAL(&s_stats_lock);
+    }
+}
+
+size_t command_dispatcher_get_prefix_stats(command_prefix_stats_t *stats, size_t max_count)
+{
+    size_t n = 0;
+    for (int i = 0; i < s_handler_count && n < max_count; i++) {
+        fill_prefix_stats(&s_command_table[i], &stats[n++]);
+    }
+    return n;
+}
+
+bool command_dispatcher_get_prefix_stats_at(size_t index, command_prefix_stats_t *stats)
+{
+    if (stats == NULL || index >= (size_t)s_handler_count) {
+        return false;
+    }
+    fill_prefix_stats(&s_command_table[index], stats);
+    return true;
+}
+
+uint32_t command_dispatcher_get_unmatched_count(void)
+{
+    return s_unmatched;
+}
+
+void command_dispatcher_reset_stats(void)
+{
+    taskENTER_CRITICAL(&s_stats_lock);
+    for (int i = 0; i < s_handler_count; i++) {
+        memset(&s_command_table[i].stats, 0, sizeof(s_command_table[i].stats));
+        s_command_table[i].dropped = 0;
+        s_command_table[i].coalesced = 0;
+    }
+    s_unmatched = 0;
+    taskEXIT_CRITICAL(&s_stats_lock);
+
+    taskENTER_CRITICAL(&s_limit_lock);
+    memset(s_source_throttled, 0, sizeof(s_source_throttled));
+    taskEXIT_CRITICAL(&s_limit_lock);
+}
+
+uint32_t command_dispatcher_get_throttled_count(command_origin_t origin)
+{
+    return (origin < COMMAND_ORIGIN_MAX) ? s_source_throttled[origin] : 0;
+}
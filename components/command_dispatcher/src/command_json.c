@@ -0,0 +1,471 @@
+#include <string.h>
+#include <strings.h>
+#include "esp_err.h"
+#include "command_json.h"
+
+#define JSON_MAX_DEPTH 32   // 跳过的值的最大嵌套层数 (容器类型用一个 uint32_t 的位栈记录)
+#define JSON_KEY_LEN   8    // 只需要比较 "command" / "args" / "id"，更长的键不会命中
+
+typedef struct {
+    const char *p;
+    const char *end;
+} json_scan_t;
+
+// 写入定长缓冲，超出后继续扫描但记为溢出
+typedef struct {
+    char  *buf;
+    size_t cap;
+    size_t len;
+    bool   overflow;
+} json_out_t;
+
+static void json_out_put(json_out_t *out, char c)
+{
+    if (out == NULL) {
+        return;
+    }
+    if (out->len + 1 < out->cap) {
+        out->buf[out->len++] = c;
+        out->buf[out->len] = '\0';
+    } else {
+        out->overflow = true;
+    }
+}
+
+static void json_out_append(json_out_t *out, const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        json_out_put(out, s[i]);
+    }
+}
+
+// 跳过空白，返回下一个字符，到结尾返回 -1
+static int json_peek(json_scan_t *s)
+{
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r')) {
+        s->p++;
+    }
+    return s->p < s->end ? (unsigned char)*s->p : -1;
+}
+
+static bool json_expect(json_scan_t *s, char c)
+{
+    if (json_peek(s) != c) {
+        return false;
+    }
+    s->p++;
+    return true;
+}
+
+static int json_hex4(json_scan_t *s)
+{
+    if (s->end - s->p < 4) {
+        return -1;
+    }
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = *s->p++;
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v |= c - 'A' + 10;
+        } else {
+            return -1;
+        }
+    }
+    return v;
+}
+
+static void json_put_utf8(json_out_t *out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        json_out_put(out, (char)cp);
+    } else if (cp < 0x800) {
+        json_out_put(out, (char)(0xC0 | (cp >> 6)));
+        json_out_put(out, (char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        json_out_put(out, (char)(0xE0 | (cp >> 12)));
+        json_out_put(out, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        json_out_put(out, (char)(0x80 | (cp & 0x3F)));
+    } else {
+        json_out_put(out, (char)(0xF0 | (cp >> 18)));
+        json_out_put(out, (char)(0x80 | ((cp >> 12) & 0x3F)));
+        json_out_put(out, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        json_out_put(out, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+/**
+ * @brief 扫描一个字符串，转义解码后写入 out (可为 NULL，只做检查)
+ */
+static bool json_string(json_scan_t *s, json_out_t *out)
+{
+    if (!json_expect(s, '"')) {
+        return false;
+    }
+    while (s->p < s->end) {
+        unsigned char c = (unsigned char)*s->p++;
+        if (c == '"') {
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            json_out_put(out, (char)c);
+            continue;
+        }
+        if (s->p == s->end) {
+            return false;
+        }
+        switch (*s->p++) {
+        case '"':  json_out_put(out, '"');  break;
+        case '\\': json_out_put(out, '\\'); break;
+        case '/':  json_out_put(out, '/');  break;
+        case 'b':  json_out_put(out, '\b'); break;
+        case 'f':  json_out_put(out, '\f'); break;
+        case 'n':  json_out_put(out, '\n'); break;
+        case 'r':  json_out_put(out, '\r'); break;
+        case 't':  json_out_put(out, '\t'); break;
+        case 'u': {
+            int hi = json_hex4(s);
+            if (hi < 0 || (hi >= 0xDC00 && hi <= 0xDFFF)) {
+                return false;
+            }
+            uint32_t cp = hi;
+            if (hi >= 0xD800 && hi <= 0xDBFF) {
+                // 代理对，必须紧跟低位
+                if (s->end - s->p < 2 || s->p[0] != '\\' || s->p[1] != 'u') {
+                    return false;
+                }
+                s->p += 2;
+                int lo = json_hex4(s);
+                if (lo < 0xDC00 || lo > 0xDFFF) {
+                    return false;
+                }
+                cp = 0x10000 + (((uint32_t)hi - 0xD800) << 10) + ((uint32_t)lo - 0xDC00);
+            }
+            json_put_utf8(out, cp);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+static bool json_digits(json_scan_t *s)
+{
+    const char *start = s->p;
+    while (s->p < s->end && *s->p >= '0' && *s->p <= '9') {
+        s->p++;
+    }
+    return s->p > start;
+}
+
+/**
+ * @brief 扫描一个数字，原文追加到 out (可为 NULL)
+ */
+static bool json_number(json_scan_t *s, json_out_t *out)
+{
+    json_peek(s);
+    const char *start = s->p;
+    if (s->p < s->end && *s->p == '-') {
+        s->p++;
+    }
+    if (s->p < s->end && *s->p == '0') {
+        s->p++;
+    } else if (!json_digits(s)) {
+        return false;
+    }
+    if (s->p < s->end && *s->p == '.') {
+        s->p++;
+        if (!json_digits(s)) {
+            return false;
+        }
+    }
+    if (s->p < s->end && (*s->p == 'e' || *s->p == 'E')) {
+        s->p++;
+        if (s->p < s->end && (*s->p == '+' || *s->p == '-')) {
+            s->p++;
+        }
+        if (!json_digits(s)) {
+            return false;
+        }
+    }
+    json_out_append(out, start, s->p - start);
+    return true;
+}
+
+static bool json_literal(json_scan_t *s, const char *word, json_out_t *out)
+{
+    size_t n = strlen(word);
+    json_peek(s);
+    if ((size_t)(s->end - s->p) < n || memcmp(s->p, word, n) != 0) {
+        return false;
+    }
+    s->p += n;
+    json_out_append(out, word, n);
+    return true;
+}
+
+/**
+ * @brief 扫描一个标量 (字符串、数字、true/false/null)，字符串解码、其它保留原文写入 out
+ */
+static bool json_scalar(json_scan_t *s, json_out_t *out)
+{
+    switch (json_peek(s)) {
+    case '"': return json_string(s, out);
+    case 't': return json_literal(s, "true", out);
+    case 'f': return json_literal(s, "false", out);
+    case 'n': return json_literal(s, "null", out);
+    default:  return json_number(s, out);
+    }
+}
+
+// 对象成员的键和冒号，key 可为 NULL
+static bool json_member_key(json_scan_t *s, json_out_t *key)
+{
+    return json_string(s, key) && json_expect(s, ':');
+}
+
+/**
+ * @brief 跳过一个任意值，只检查语法
+ *
+ * 不递归，嵌套的容器类型记在位栈里 (1 为对象，0 为数组)。
+ */
+static bool json_skip(json_scan_t *s)
+{
+    uint32_t stack = 0;
+    int depth = 0;
+    while (true) {
+        // 读一个值
+        int c = json_peek(s);
+        if (c == '{' || c == '[') {
+            if (depth == JSON_MAX_DEPTH) {
+                return false;
+            }
+            s->p++;
+            stack = (stack << 1) | (c == '{');
+            depth++;
+            if (json_peek(s) == (c == '{' ? '}' : ']')) {
+                s->p++;
+                stack >>= 1;
+                depth--;
+            } else {
+                if (c == '{' && !json_member_key(s, NULL)) {
+                    return false;
+                }
+                continue;
+            }
+        } else if (!json_scalar(s, NULL)) {
+            return false;
+        }
+        // 值之后: 逗号继续同一容器，或关闭一层或多层
+        while (depth > 0) {
+            c = json_peek(s);
+            if (c == ',') {
+                s->p++;
+                if ((stack & 1) && !json_member_key(s, NULL)) {
+                    return false;
+                }
+                break;
+            }
+            if (c != ((stack & 1) ? '}' : ']')) {
+                return false;
+            }
+            s->p++;
+            stack >>= 1;
+            depth--;
+        }
+        if (depth == 0) {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief 把 args 的值依次以 ':' 接在命令之后
+ */
+static esp_err_t json_append_args(json_scan_t *s, json_out_t *cmd)
+{
+    int c = json_peek(s);
+    if (c == 'n') {
+        return json_literal(s, "null", NULL) ? ESP_OK : ESP_ERR_INVALID_ARG;
+    }
+    if (c != '[') {
+        json_out_put(cmd, ':');
+        return json_scalar(s, cmd) ? ESP_OK : ESP_ERR_INVALID_ARG;
+    }
+    s->p++;
+    if (json_peek(s) == ']') {
+        s->p++;
+        return ESP_OK;
+    }
+    do {
+        c = json_peek(s);
+        if (c == '[' || c == '{') {
+            return ESP_ERR_INVALID_ARG;
+        }
+        json_out_put(cmd, ':');
+        if (!json_scalar(s, cmd)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    } while (json_expect(s, ','));
+    return json_expect(s, ']') ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t command_json_parse(const char *json, size_t len, command_json_t *out)
+{
+    json_scan_t s = { .p = json, .end = json + len };
+    json_out_t cmd = { .buf = out->command, .cap = sizeof(out->command) };
+    json_out_t id = { .buf = out->id, .cap = sizeof(out->id) };
+    const char *args = NULL;
+    bool seen_command = false, have_command = false, seen_id = false;
+    out->command[0] = '\0';
+    out->id[0] = '\0';
+
+    if (!json_expect(&s, '{')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!json_expect(&s, '}')) {
+        do {
+            char key_buf[JSON_KEY_LEN];
+            json_out_t key = { .buf = key_buf, .cap = sizeof(key_buf) };
+            key_buf[0] = '\0';
+            if (!json_member_key(&s, &key)) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            const char *name = key.overflow ? "" : key_buf;
+            bool ok;
+            if (!seen_command && strcasecmp(name, "command") == 0) {
+                seen_command = true;
+                have_command = json_peek(&s) == '"';
+                ok = have_command ? json_string(&s, &cmd) : json_skip(&s);
+            } else if (!seen_id && strcasecmp(name, "id") == 0) {
+                seen_id = true;
+                int c = json_peek(&s);
+                ok = (c == '"' || c == '-' || (c >= '0' && c <= '9')) ? json_scalar(&s, &id) : json_skip(&s);
+            } else if (args == NULL && strcasecmp(name, "args") == 0) {
+                json_peek(&s);
+                args = s.p;
+                ok = json_skip(&s);
+            } else {
+                ok = json_skip(&s);
+            }
+            if (!ok) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        } while (json_expect(&s, ','));
+        if (!json_expect(&s, '}')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    // 对象之后只允许空白和结尾的 '\0' (有的客户端把字符串结束符一起发出)
+    while (json_peek(&s) == '\0') {
+        s.p++;
+    }
+    if (s.p != s.end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!have_command) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (args != NULL) {
+        json_scan_t a = { .p = args, .end = s.end };
+        esp_err_t err = json_append_args(&a, &cmd);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (cmd.overflow || id.overflow) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+// 前缀、id、负载中不允许出现的字符 (空白和控制字符会破坏一行一条的串口格式)
+static bool topic_text_valid(const char *s, size_t len, const char *reject)
+{
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c < 0x20 || c == 0x7F || (reject != NULL && strchr(reject, c) != NULL)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t command_json_parse_topic(const char *route, size_t route_len, const char *payload, size_t payload_len,
+                                   command_json_t *out)
+{
+    out->command[0] = '\0';
+    out->id[0] = '\0';
+    const char *slash = memchr(route, '/', route_len);
+    size_t prefix_len = slash != NULL ? (size_t)(slash - route) : route_len;
+    const char *id = slash != NULL ? slash + 1 : route + route_len;
+    size_t id_len = route_len - (size_t)(id - route);
+    while (payload_len > 0 && (payload[payload_len - 1] == '\0' || payload[payload_len - 1] == ' ' ||
+                               payload[payload_len - 1] == '\r' || payload[payload_len - 1] == '\n')) {
+        payload_len--;
+    }
+    if (prefix_len == 0 || (slash != NULL && id_len == 0) || !topic_text_valid(route, prefix_len, " :;") ||
+        !topic_text_valid(id, id_len, "/") || !topic_text_valid(payload, payload_len, NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t cmd_len = prefix_len + (payload_len > 0 ? 1 + payload_len : 0);
+    if (cmd_len >= sizeof(out->command) || id_len >= sizeof(out->id)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out->command, route, prefix_len);
+    if (payload_len > 0) {
+        out->command[prefix_len] = ':';
+        memcpy(out->command + prefix_len + 1, payload, payload_len);
+    }
+    out->command[cmd_len] = '\0';
+    memcpy(out->id, id, id_len);
+    out->id[id_len] = '\0';
+    return ESP_OK;
+}
+
+esp_err_t command_json_assemble(command_json_assembler_t *as, const char *data, size_t len, size_t offset, size_t total,
+                                const char **msg, size_t *msg_len)
+{
+    if (offset == 0 && len >= total) {
+        // 未分片，直接使用事件的缓冲
+        as->total = 0;
+        *msg = data;
+        *msg_len = len;
+        return ESP_OK;
+    }
+    if (offset == 0) {
+        as->total = total;
+        as->received = 0;
+        as->dropped = total > sizeof(as->buf) ? ESP_ERR_INVALID_SIZE : ESP_OK;
+    } else if (as->total != total || as->received != offset || offset + len > total) {
+        // 丢了开头或中间的分片，或者与正在拼接的消息对不上
+        if (as->total != total || as->dropped == ESP_OK) {
+            as->dropped = ESP_ERR_INVALID_STATE;
+        }
+        as->total = total;
+    }
+    if (as->dropped == ESP_OK) {
+        memcpy(as->buf + offset, data, len);
+    }
+    as->received = offset + len;
+    if (as->received < total) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    as->total = 0;
+    if (as->dropped != ESP_OK) {
+        return as->dropped;
+    }
+    *msg = as->buf;
+    *msg_len = total;
+    return ESP_OK;
+}
@@ -0,0 +1,109 @@
+#include "esp_log.h"
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "command_dispatcher.h"
+#include "command_probe.h"
+
+static const char *TAG = "CMD_PROBE";
+
+enum {
+    PROBE_VERB_QUEUE = 0,
+    PROBE_VERB_HIGH,
+};
+
+typedef enum {
+    PROBE_LANE_SYNC = 0,
+    PROBE_LANE_QUEUE,
+    PROBE_LANE_HIGH,
+    PROBE_LANE_MAX,
+} probe_lane_t;
+
+static const char *const s_lane_names[PROBE_LANE_MAX] = { "sync", "queue", "high" };
+
+// 各通道上一条探测从生成回复到交给回复通道返回的耗时 (us)
+static volatile uint32_t s_last_reply_us[PROBE_LANE_MAX];
+
+static uint32_t probe_span(int64_t from, int64_t to)
+{
+    return to > from ? (uint32_t)(to - from) : 0;
+}
+
+/**
+ * @brief 回复一条探测的各段耗时
+ *
+ * 处理函数本身只记录时间，没有其它工作，run 段即为测量自身的开销。
+ * 回复帧发出之前无法测量它自己的发送耗时，reply 段取同一通道上一条探测的实测值
+ * (生成本帧 + command_dispatcher_reply 交给 UART 环形缓冲 / MQTT 发布)。
+ */
+static esp_err_t probe_reply(const command_args_t *args, probe_lane_t lane)
+{
+    int64_t start = esp_timer_get_time();
+    if (args->argc < 1 || !args->argv[0].is_number) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t end = esp_timer_get_time();
+
+    char line[128];
+    snprintf(line, sizeof(line), "STATUS:PROBE:%ld:%s:in=%lu,parse=%lu,queue=%lu,run=%lu,reply=%lu,total=%lu",
+             (long)args->argv[0].ival, s_lane_names[lane],
+             (unsigned long)probe_span(args->arrival_us, args->rx_us),
+             (unsigned long)probe_span(args->rx_us, args->dispatch_us),
+             (unsigned long)probe_span(args->dispatch_us, start),
+             (unsigned long)probe_span(start, end),
+             (unsigned long)s_last_reply_us[lane],
+             (unsigned long)probe_span(args->arrival_us, end));
+    command_dispatcher_reply(args, line);
+    s_last_reply_us[lane] = probe_span(end, esp_timer_get_time());
+    return ESP_OK;
+}
+
+static esp_err_t ping_command_handler(const command_args_t *args)
+{
+    return probe_reply(args, PROBE_LANE_SYNC);
+}
+
+static esp_err_t probe_command_handler(const command_args_t *args)
+{
+    return probe_reply(args, args->verb_id == PROBE_VERB_HIGH ? PROBE_LANE_HIGH : PROBE_LANE_QUEUE);
+}
+
+static const command_verb_t s_ping_verbs[] = {
+    { "", 0, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+};
+
+static const command_verb_t s_probe_verbs[] = {
+    { "",     PROBE_VERB_QUEUE, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+    { "high", PROBE_VERB_HIGH,  COMMAND_PRIORITY_HIGH },
+};
+
+// 同步通道
+static const command_module_t s_ping_module = {
+    .prefix     = "ping",
+    .handler    = ping_command_handler,
+    .verbs      = s_ping_verbs,
+    .verb_count = sizeof(s_ping_verbs) / sizeof(s_ping_verbs[0]),
+};
+
+// 模块队列通道；队列满时丢弃新探测，主机按超时统计
+static const command_module_t s_probe_module = {
+    .prefix      = "probe",
+    .handler     = probe_command_handler,
+    .verbs       = s_probe_verbs,
+    .verb_count  = sizeof(s_probe_verbs) / sizeof(s_probe_verbs[0]),
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+    .overflow    = COMMAND_OVERFLOW_DROP_NEWEST,
+};
+
+esp_err_t command_probe_init(void)
+{
+    esp_err_t err = command_dispatcher_register(&s_ping_module);
+    if (err == ESP_OK) {
+        err = command_dispatcher_register(&s_probe_module);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "注册探测命令失败: %s", esp_err_to_name(err));
+    }
+    return err;
+}
@@ -0,0 +1,487 @@
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "command_timer.h"
+
+static const char *TAG = "CMD_TIMER";
+
+#define TIMER_MAX     (CONFIG_COMMAND_TIMER_MAX)
+#define TICK_MS       (CONFIG_COMMAND_TIMER_TICK_MS)
+#define TASK_STACK    (CONFIG_COMMAND_DISPATCHER_WORKER_STACK_SIZE)
+#define TASK_PRIORITY (CONFIG_COMMAND_DISPATCHER_WORKER_PRIORITY)
+#define WHEEL_BITS    6
+#define WHEEL_SLOTS   (1 << WHEEL_BITS)
+#define WHEEL_MASK    (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS  4                                   // 10ms 一格时 4 层共约 46 小时
+#define WHEEL_RANGE   (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) // 可表示的最大延时 (tick)
+#define PENDING_LEVEL WHEEL_LEVELS                        // 本 tick 已到期、等待执行的链表
+#define NO_TIMER      (-1)
+
+/*
+ * 分层时间轮 (与 Linux 经典 timer wheel 相同)：
+ * 第 0 层每格 1 tick，第 L 层每格 64^L tick。定时器按剩余时间放入能容纳它的最低一层，
+ * 低一层转完一圈时，把高一层当前格子里的定时器重新分配到低层 (cascade)。
+ * 插入、取消都是 O(1)，每个 tick 只处理一个格子。
+ */
+typedef struct {
+    command_timer_handle_t handle;  // 0 表示空闲
+    uint64_t expires;               // 到期时刻 (tick)
+    uint32_t period;                // 重复周期 (tick)，0 表示一次性
+    int8_t   prev;                  // 所在链表的前后节点
+    int8_t   next;
+    uint8_t  level;                 // 所在层，PENDING_LEVEL 表示已到期
+    uint8_t  slot;
+    uint8_t  origin;                // 创建者的来源，到期命令以此来源分发
+    char     reply_to[COMMAND_REPLY_TO_LEN];
+    char     command[COMMAND_MAX_LEN];
+} command_timer_t;
+
+static command_timer_t s_timers[TIMER_MAX];
+static int8_t s_wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static int8_t s_pending = NO_TIMER;
+static uint64_t s_now = 0;            // 当前 tick
+static uint32_t s_generation = 0;     // 句柄的高位，避免取消到复用同一位置的新定时器
+static uint32_t s_active = 0;         // 尚未取消或执行完的定时命令数
+static esp_timer_handle_t s_tick_timer = NULL;
+static bool s_running = false;        // tick 是否在运行，与 s_active 一起由 s_timer_lock 保护
+static portMUX_TYPE s_timer_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_tick_lock = NULL;  // 串行化 tick 的启动和停止
+static TaskHandle_t s_timer_task = NULL;
+
+static int8_t *list_head(uint8_t level, uint8_t slot)
+{
+    return (level == PENDING_LEVEL) ? &s_pending : &s_wheel[level][slot];
+}
+
+static void list_unlink(int8_t idx)
+{
+    command_timer_t *t = &s_timers[idx];
+    if (t->prev != NO_TIMER) {
+        s_timers[t->prev].next = t->next;
+    } else {
+        *list_head(t->level, t->slot) = t->next;
+    }
+    if (t->next != NO_TIMER) {
+        s_timers[t->next].prev = t->prev;
+    }
+    t->prev = t->next = NO_TIMER;
+}
+
+static void list_push(int8_t idx, uint8_t level, uint8_t slot)
+{
+    command_timer_t *t = &s_timers[idx];
+    int8_t *head = list_head(level, slot);
+    t->level = level;
+    t->slot = slot;
+    t->prev = NO_TIMER;
+    t->next = *head;
+    if (*head != NO_TIMER) {
+        s_timers[*head].prev = idx;
+    }
+    *head = idx;
+}
+
+/**
+ * @brief 按剩余时间把定时器放入能容纳它的最低一层 (调用者持有 s_timer_lock)
+ */
+static void wheel_insert(int8_t idx)
+{
+    command_timer_t *t = &s_timers[idx];
+    uint64_t expires = (t->expires > s_now) ? t->expires : s_now;
+    uint64_t delta = expires - s_now;
+
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    list_push(idx, (uint8_t)level, (uint8_t)((expires >> (WHEEL_BITS * level)) & WHEEL_MASK));
+}
+
+static void cascade(int level)
+{
+    int8_t *head = &s_wheel[level][(s_now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    int8_t idx = *head;
+    *head = NO_TIMER;
+    while (idx != NO_TIMER) {
+        int8_t next = s_timers[idx].next;
+        wheel_insert(idx);
+        idx = next;
+    }
+}
+
+/**
+ * @brief 有定时命令时运行 tick，全部取消或执行完后停止，时间轮为空时不再周期唤醒
+ *
+ * 是否运行在 s_timer_lock 中按 s_active 决定并记入 s_running，esp_timer 的启动和停止
+ * 由 s_tick_lock 串行化，最后一次调用的结果总与 s_running 一致。
+ */
+static void tick_sync(void)
+{
+    xSemaphoreTake(s_tick_lock, portMAX_DELAY);
+    taskENTER_CRITICAL(&s_timer_lock);
+    bool run = s_active > 0;
+    bool change = run != s_running;
+    s_running = run;
+    taskEXIT_CRITICAL(&s_timer_lock);
+    if (change) {
+        esp_err_t err = run ? esp_timer_start_periodic(s_tick_timer, (uint64_t)TICK_MS * 1000)
+                            : esp_timer_stop(s_tick_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "%s定时器失败: %s", run ? "启动" : "停止", esp_err_to_name(err));
+        }
+    }
+    xSemaphoreGive(s_tick_lock);
+}
+
+/**
+ * @brief esp_timer 回调：只通知定时任务，到期命令不在 esp_timer 任务中执行，
+ *        慢的同步处理函数不会推迟其它 esp_timer 回调 (如串口心跳检查)
+ */
+static void timer_tick(void *arg)
+{
+    xTaskNotifyGive(s_timer_task);
+}
+
+/**
+ * @brief 推进一个 tick，逐个分发到期的命令 (定时任务)
+ */
+static void timer_advance(void)
+{
+    char command[COMMAND_MAX_LEN];
+    char reply_to[COMMAND_REPLY_TO_LEN];
+
+    taskENTER_CRITICAL(&s_timer_lock);
+    s_now++;
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if ((s_now & ((1ULL << (WHEEL_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+    // 先把整个格子移到到期链表，周期定时器重新插入时不会在本 tick 再次被取出
+    int8_t *head = &s_wheel[0][s_now & WHEEL_MASK];
+    while (*head != NO_TIMER) {
+        int8_t idx = *head;
+        list_unlink(idx);
+        list_push(idx, PENDING_LEVEL, 0);
+    }
+    taskEXIT_CRITICAL(&s_timer_lock);
+
+    for (;;) {
+        taskENTER_CRITICAL(&s_timer_lock);
+        int8_t idx = s_pending;
+        if (idx == NO_TIMER) {
+            taskEXIT_CRITICAL(&s_timer_lock);
+            break;
+        }
+        command_timer_t *t = &s_timers[idx];
+        list_unlink(idx);
+        memcpy(command, t->command, sizeof(command));
+        memcpy(reply_to, t->reply_to, sizeof(reply_to));
+        uint8_t origin = t->origin;
+        if (t->period > 0) {
+            t->expires = s_now + t->period;
+            wheel_insert(idx);
+        } else {
+            t->handle = 0;
+            s_active--;
+        }
+        taskEXIT_CRITICAL(&s_timer_lock);
+
+        // 创建定时器时已经计入速率限制，到期执行的命令不再限速
+        const command_source_t source = {
+            .origin = (command_origin_t)origin,
+            .reply_to = reply_to,
+            .no_rate_limit = true,
+        };
+        command_dispatcher_forward_from(&source, command, strlen(command));
+    }
+}
+
+/**
+ * @brief 定时任务：按 tick 通知的次数推进时间轮，处理函数慢时积累的 tick 依次补上
+ */
+static void command_timer_task(void *arg)
+{
+    for (;;) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (ticks-- > 0) {
+            timer_advance();
+        }
+        if (s_active == 0) {
+            tick_sync();
+        }
+    }
+}
+
+static uint64_t ms_to_ticks(uint32_t ms)
+{
+    uint64_t ticks = ((uint64_t)ms + TICK_MS - 1) / TICK_MS;
+    return (ticks > 0) ? ticks : 1;
+}
+
+esp_err_t command_timer_schedule(const command_source_t *source, uint32_t delay_ms, uint32_t period_ms,
+                                 const char *command, command_timer_handle_t *out_handle)
+{
+    if (command == NULL || command[0] == '\0' || strlen(command) >= COMMAND_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint64_t delay = ms_to_ticks(delay_ms);
+    uint64_t period = (period_ms > 0) ? ms_to_ticks(period_ms) : 0;
+    if (delay >= WHEEL_RANGE || period >= WHEEL_RANGE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_tick_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    command_timer_handle_t handle = 0;
+    taskENTER_CRITICAL(&s_timer_lock);
+    for (int i = 0; i < TIMER_MAX; i++) {
+        command_timer_t *t = &s_timers[i];
+        if (t->handle != 0) {
+            continue;
+        }
+        s_generation = (s_generation + 1) & 0x7FFFFF; // 句柄保持为正的 int32，便于文本命令解析
+        if (s_generation == 0) {
+            s_generation = 1;
+        }
+        handle = (s_generation << 8) | (uint32_t)(i + 1);
+        t->handle = handle;
+        t->expires = s_now + delay;
+        t->period = (uint32_t)period;
+        t->origin = source ? (uint8_t)source->origin : COMMAND_ORIGIN_LOCAL;
+        snprintf(t->reply_to, sizeof(t->reply_to), "%s",
+                 (source && source->reply_to) ? source->reply_to : "");
+        snprintf(t->command, sizeof(t->command), "%s", command);
+        wheel_insert((int8_t)i);
+        s_active++;
+        break;
+    }
+    taskEXIT_CRITICAL(&s_timer_lock);
+
+    if (handle == 0) {
+        ESP_LOGW(TAG, "定时命令已满 (%d)，无法添加: '%s'", TIMER_MAX, command);
+        return ESP_ERR_NO_MEM;
+    }
+    // 时间轮从空变为非空时启动 tick
+    tick_sync();
+    ESP_LOGD(TAG, "定时命令 %lu: '%s' (延时 %lu ms, 周期 %lu ms)", (unsigned long)handle, command,
+             (unsigned long)delay_ms, (unsigned long)period_ms);
+    if (out_handle != NULL) {
+        *out_handle = handle;
+    }
+    return ESP_OK;
+}
+
+esp_err_t command_timer_cancel(command_timer_handle_t handle)
+{
+    uint32_t idx = (handle & 0xFF) - 1;
+    if (handle == 0 || idx >= TIMER_MAX) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_timer_lock);
+    if (s_timers[idx].handle == handle) {
+        list_unlink((int8_t)idx);
+        s_timers[idx].handle = 0;
+        s_active--;
+        err = ESP_OK;
+    }
+    bool idle = s_active == 0;
+    taskEXIT_CRITICAL(&s_timer_lock);
+    // 取消了最后一个定时命令时停止 tick
+    if (err == ESP_OK && idle) {
+        tick_sync();
+    }
+    return err;
+}
+
+// --- 文本命令 "at" / "every" / "timer" ---
+
+/**
+ * @brief 解析时间，例如 "+1800s"、"500ms"、"2m"，不带单位按 ms
+ */
+static bool parse_duration(const char *s, size_t len, uint32_t *ms)
+{
+    size_t pos = 0;
+    if (pos < len && s[pos] == '+') {
+        pos++;
+    }
+    if (pos >= len || s[pos] < '0' || s[pos] > '9') {
+        return false;
+    }
+    uint64_t value = 0;
+    while (pos < len && s[pos] >= '0' && s[pos] <= '9') {
+        value = value * 10 + (uint64_t)(s[pos] - '0');
+        if (value > UINT32_MAX) {
+            return false;
+        }
+        pos++;
+    }
+
+    size_t unit_len = len - pos;
+    const char *unit = s + pos;
+    uint64_t scale;
+    if (unit_len == 0 || (unit_len == 2 && memcmp(unit, "ms", 2) == 0)) {
+        scale = 1;
+    } else if (unit_len == 1 && unit[0] == 's') {
+        scale = 1000;
+    } else if (unit_len == 1 && unit[0] == 'm') {
+        scale = 60 * 1000;
+    } else if (unit_len == 1 && unit[0] == 'h') {
+        scale = 60 * 60 * 1000;
+    } else {
+        return false;
+    }
+    value *= scale;
+    if (value > UINT32_MAX) {
+        return false;
+    }
+    *ms = (uint32_t)value;
+    return true;
+}
+
+/**
+ * @brief "at:<延时>:<命令>" 与 "every:<周期>:<命令>" 的公共处理
+ */
+static esp_err_t schedule_from_args(const command_args_t *args, bool repeat)
+{
+    uint32_t ms = 0;
+    if (args->argc < 2 || !parse_duration(command_args_str(args, 0), args->argv[0].len, &ms) ||
+        (repeat && ms == 0)) {
+        command_dispatcher_reply(args, "ERROR:TIMER_BAD_ARGS");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 第一个参数之后的全部内容都是要执行的命令 (其中可能还有 ':')
+    const command_source_t source = {
+        .origin = (command_origin_t)args->origin,
+        .reply_to = args->reply_to,
+    };
+    command_timer_handle_t handle = 0;
+    esp_err_t err = command_timer_schedule(&source, ms, repeat ? ms : 0,
+                                           command_args_str(args, 1), &handle);
+    char line[32];
+    if (err != ESP_OK) {
+        snprintf(line, sizeof(line), "ERROR:TIMER:%s", esp_err_to_name(err));
+    } else {
+        snprintf(line, sizeof(line), "STATUS:TIMER:%lu", (unsigned long)handle);
+    }
+    command_dispatcher_reply(args, line);
+    return err;
+}
+
+static esp_err_t at_command_handler(const command_args_t *args)
+{
+    return schedule_from_args(args, false);
+}
+
+static esp_err_t every_command_handler(const command_args_t *args)
+{
+    return schedule_from_args(args, true);
+}
+
+enum {
+    TIMER_VERB_CANCEL,
+    TIMER_VERB_LIST,
+};
+
+static esp_err_t timer_command_handler(const command_args_t *args)
+{
+    char line[COMMAND_MAX_LEN + 48];
+
+    switch (args->verb_id) {
+    case TIMER_VERB_CANCEL: {
+        int32_t handle = 0;
+        if (!command_args_int(args, 0, &handle)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t err = command_timer_cancel((command_timer_handle_t)handle);
+        snprintf(line, sizeof(line), "%s:TIMER_CANCEL:%lu", err == ESP_OK ? "STATUS" : "ERROR",
+                 (unsigned long)(uint32_t)handle);
+        command_dispatcher_reply(args, line);
+        return err;
+    }
+    case TIMER_VERB_LIST:
+        // 每个定时命令一行: 句柄:剩余 ms:周期 ms:命令
+        for (int i = 0; i < TIMER_MAX; i++) {
+            command_timer_t t;
+            uint64_t now;
+            taskENTER_CRITICAL(&s_timer_lock);
+            t = s_timers[i];
+            now = s_now;
+            taskEXIT_CRITICAL(&s_timer_lock);
+            if (t.handle == 0) {
+                continue;
+            }
+            snprintf(line, sizeof(line), "STATUS:TIMER:%lu:%llu:%lu:%s", (unsigned long)t.handle,
+                     (unsigned long long)((t.expires > now ? t.expires - now : 0) * TICK_MS),
+                     (unsigned long)(t.period * TICK_MS), t.command);
+            command_dispatcher_reply(args, line);
+        }
+        return ESP_OK;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const command_module_t s_at_module = {
+    .prefix  = "at",
+    .handler = at_command_handler,
+};
+
+static const command_module_t s_every_module = {
+    .prefix  = "every",
+    .handler = every_command_handler,
+};
+
+static const command_verb_t s_timer_verbs[] = {
+    { "cancel", TIMER_VERB_CANCEL },
+    { "list",   TIMER_VERB_LIST },
+};
+
+static const command_module_t s_timer_module = {
+    .prefix     = "timer",
+    .handler    = timer_command_handler,
+    .verbs      = s_timer_verbs,
+    .verb_count = sizeof(s_timer_verbs) / sizeof(s_timer_verbs[0]),
+};
+
+esp_err_t command_timer_init(void)
+{
+    if (s_tick_timer == NULL) {
+        memset(s_timers, 0, sizeof(s_timers));
+        memset(s_wheel, NO_TIMER, sizeof(s_wheel));
+        s_pending = NO_TIMER;
+        s_active = 0;
+
+        s_tick_lock = xSemaphoreCreateMutex();
+        if (s_tick_lock == NULL ||
+            xTaskCreate(command_timer_task, "cmd_timer", TASK_STACK, NULL, TASK_PRIORITY, &s_timer_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建定时任务失败");
+            return ESP_ERR_NO_MEM;
+        }
+        const esp_timer_create_args_t timer_args = {
+            .callback = timer_tick,
+            .name = "cmd_timer",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &s_tick_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "创建定时器失败: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    command_dispatcher_register(&s_at_module);
+    command_dispatcher_register(&s_every_module);
+    command_dispatcher_register(&s_timer_module);
+    return ESP_OK;
+}
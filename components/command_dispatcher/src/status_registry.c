@@ -0,0 +1,594 @@
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+#include "command_dispatcher.h"
+#include "status_registry.h"
+
+static const char *TAG = "STATUS_REG";
+
+#define MAX_FIELDS         (CONFIG_STATUS_REGISTRY_MAX_FIELDS)
+#define MAX_SUBSCRIBERS    (CONFIG_STATUS_REGISTRY_MAX_SUBSCRIBERS)
+#define MIN_INTERVAL_MS    (CONFIG_STATUS_REGISTRY_MIN_INTERVAL_MS)
+#define PUBLISH_TASK_STACK (4096)
+#define PUBLISH_TASK_PRIO  (CONFIG_COMMAND_DISPATCHER_WORKER_PRIORITY)
+#define FRAME_MAX          (200)  // 单帧上限，小于 UART 发送队列的槽位大小
+#define FIELD_BIT(f)       (1UL << (f))
+
+_Static_assert(MAX_FIELDS <= 32, "field masks are 32 bits wide");
+
+typedef struct {
+    const char *name;
+    uint8_t     type;       // status_field_type_t
+    atomic_int  value;      // FLOAT 以 0.1 为单位保存
+} status_field_entry_t;
+
+/*
+ * 每个订阅者记录最后一次发给它的值，发布时只发送与之不同的字段，
+ * 所以无论模块多频繁地写入同一个值，线上流量只与实际变化次数有关。
+ */
+typedef struct {
+    bool       used;
+    uint8_t    origin;
+    char       reply_to[COMMAND_REPLY_TO_LEN];
+    uint16_t   seq;                      // 下一帧的序号
+    uint32_t   change_mask;              // 变化时立即上报的字段
+    uint32_t   period_mask;              // 按周期上报的字段
+    uint32_t   sent_mask;                // sent[] 中有效的字段
+    TickType_t period[MAX_FIELDS];
+    TickType_t next_due[MAX_FIELDS];
+    int32_t    sent[MAX_FIELDS];
+} status_subscriber_t;
+
+static status_field_entry_t s_fields[MAX_FIELDS];
+static atomic_int s_field_count;
+static portMUX_TYPE s_register_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static status_subscriber_t s_subscribers[MAX_SUBSCRIBERS];
+static SemaphoreHandle_t s_sub_lock = NULL;   // 保护订阅表，命令处理和发布任务共用
+static atomic_uint s_change_mask;            // 所有订阅者 change_mask 的并集，写入时据此决定是否唤醒发布任务
+static TaskHandle_t s_publish_task = NULL;
+static atomic_uint s_resync_origins;         // 等待发布任务重新同步的来源 (按位)
+static volatile status_observer_t s_observer = NULL;
+
+static atomic_uint s_updates;
+static atomic_uint s_frames;
+static atomic_uint s_values;
+
+// --- 字段 ---
+
+static status_field_t field_find(const char *name, size_t len)
+{
+    int count = atomic_load(&s_field_count);
+    for (int i = 0; i < count; i++) {
+        if (strncmp(s_fields[i].name, name, len) == 0 && s_fields[i].name[len] == '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+status_field_t status_field_register(const char *name, status_field_type_t type)
+{
+    if (name == NULL) {
+        return -1;
+    }
+
+    status_field_t field;
+    taskENTER_CRITICAL(&s_register_lock);
+    field = field_find(name, strlen(name));
+    if (field < 0) {
+        int count = atomic_load(&s_field_count);
+        if (count < MAX_FIELDS) {
+            s_fields[count].name = name;
+            s_fields[count].type = (uint8_t)type;
+            atomic_store(&s_fields[count].value, 0);
+            atomic_store(&s_field_count, count + 1);
+            field = count;
+        }
+    }
+    taskEXIT_CRITICAL(&s_register_lock);
+
+    if (field < 0) {
+        ESP_LOGE(TAG, "状态字段已满，无法注册 '%s'", name);
+    }
+    return field;
+}
+
+static void field_store(status_field_t field, int32_t value)
+{
+    if (field < 0 || field >= atomic_load(&s_field_count)) {
+        return;
+    }
+    if (atomic_exchange(&s_fields[field].value, value) == value) {
+        return;
+    }
+    atomic_fetch_add(&s_updates, 1);
+    status_observer_t observer = s_observer;
+    if (observer != NULL) {
+        observer(field, value);
+    }
+    if ((atomic_load(&s_change_mask) & FIELD_BIT(field)) && s_publish_task != NULL) {
+        xTaskNotifyGive(s_publish_task);
+    }
+}
+
+void status_field_set_bool(status_field_t field, bool value)
+{
+    field_store(field, value ? 1 : 0);
+}
+
+void status_field_set_int(status_field_t field, int32_t value)
+{
+    field_store(field, value);
+}
+
+void status_field_set_float(status_field_t field, float value)
+{
+    field_store(field, (int32_t)lroundf(value * 10.0f));
+}
+
+int status_field_count(void)
+{
+    return atomic_load(&s_field_count);
+}
+
+bool status_field_get(status_field_t field, const char **name, status_field_type_t *type, int32_t *value)
+{
+    if (field < 0 || field >= atomic_load(&s_field_count)) {
+        return false;
+    }
+    if (name != NULL) {
+        *name = s_fields[field].name;
+    }
+    if (type != NULL) {
+        *type = (status_field_type_t)s_fields[field].type;
+    }
+    if (value != NULL) {
+        *value = atomic_load(&s_fields[field].value);
+    }
+    return true;
+}
+
+void status_registry_set_observer(status_observer_t observer)
+{
+    s_observer = observer;
+}
+
+static int format_value(char *buf, size_t size, uint8_t type, int32_t value)
+{
+    if (type == STATUS_FIELD_FLOAT) {
+        long abs_value = labs((long)value);
+        return snprintf(buf, size, "%s%ld.%ld", value < 0 ? "-" : "", abs_value / 10, abs_value % 10);
+    }
+    return snprintf(buf, size, "%ld", (long)value);
+}
+
+// --- 订阅者 (调用者持有 s_sub_lock) ---
+
+static status_subscriber_t *subscriber_find(uint8_t origin, const char *reply_to, bool create)
+{
+    status_subscriber_t *free_slot = NULL;
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        status_subscriber_t *sub = &s_subscribers[i];
+        if (!sub->used) {
+            if (free_slot == NULL) {
+                free_slot = sub;
+            }
+            continue;
+        }
+        if (sub->origin == origin && strcmp(sub->reply_to, reply_to) == 0) {
+            return sub;
+        }
+    }
+    if (!create || free_slot == NULL) {
+        return NULL;
+    }
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->used = true;
+    free_slot->origin = origin;
+    snprintf(free_slot->reply_to, sizeof(free_slot->reply_to), "%s", reply_to);
+    return free_slot;
+}
+
+static void update_change_mask(void)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (s_subscribers[i].used) {
+            mask |= s_subscribers[i].change_mask;
+        }
+    }
+    atomic_store(&s_change_mask, mask);
+}
+
+/**
+ * @brief 取出本轮应检查的字段：变化即报的字段，以及周期已到的字段 (并重新计时)
+ */
+static uint32_t subscriber_due(status_subscriber_t *sub, TickType_t now)
+{
+    uint32_t due = sub->change_mask;
+    for (int f = 0; f < MAX_FIELDS; f++) {
+        if ((sub->period_mask & FIELD_BIT(f)) && (int32_t)(now - sub->next_due[f]) >= 0) {
+            due |= FIELD_BIT(f);
+            sub->next_due[f] = now + sub->period[f];
+        }
+    }
+    return due;
+}
+
+/**
+ * @brief 把 fields 中的字段写成一帧 "STATUS:<kind>:<序号>:id=值,..."，并记为已发送
+ *
+ * @param only_changed 只写与上次发送不同的字段
+ * @return 写入的字段掩码，0 表示没有需要发送的字段；帧写满时其余字段留给下一帧
+ */
+static uint32_t build_frame(status_subscriber_t *sub, uint32_t fields, bool only_changed,
+                            char kind, char *buf, size_t size)
+{
+    uint32_t written = 0;
+    size_t len = (size_t)snprintf(buf, size, "STATUS:%c:%u:", kind, (unsigned)sub->seq);
+    const size_t header_len = len;
+    int count = atomic_load(&s_field_count);
+
+    for (int f = 0; f < count; f++) {
+        if (!(fields & FIELD_BIT(f))) {
+            continue;
+        }
+        int32_t value = atomic_load(&s_fields[f].value);
+        if (only_changed && (sub->sent_mask & FIELD_BIT(f)) && sub->sent[f] == value) {
+            continue;
+        }
+        char item[24];
+        int n = snprintf(item, sizeof(item), "%s%d=", len > header_len ? "," : "", f);
+        n += format_value(item + n, sizeof(item) - n, s_fields[f].type, value);
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(buf + len, item, n + 1);
+        len += n;
+        sub->sent[f] = value;
+        sub->sent_mask |= FIELD_BIT(f);
+        written |= FIELD_BIT(f);
+    }
+    if (written != 0) {
+        sub->seq++;
+    }
+    return written;
+}
+
+// --- 发布任务 ---
+
+static TickType_t next_wait(TickType_t now)
+{
+    TickType_t wait = portMAX_DELAY;
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        const status_subscriber_t *sub = &s_subscribers[i];
+        if (!sub->used) {
+            continue;
+        }
+        for (int f = 0; f < MAX_FIELDS; f++) {
+            if (sub->period_mask & FIELD_BIT(f)) {
+                int32_t left = (int32_t)(sub->next_due[f] - now);
+                TickType_t ticks = left > 0 ? (TickType_t)left : 0;
+                if (ticks < wait) {
+                    wait = ticks;
+                }
+            }
+        }
+    }
+    return wait;
+}
+
+/**
+ * @brief 执行 status_registry_resync 请求的重新同步：清除已发送记录，周期字段立即到期
+ */
+static void apply_resync(void)
+{
+    uint32_t origins = atomic_exchange(&s_resync_origins, 0);
+    if (origins == 0) {
+        return;
+    }
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        if (s_subscribers[i].used && (origins & (1U << s_subscribers[i].origin))) {
+            s_subscribers[i].sent_mask = 0;
+            // 按周期订阅的字段也立即发送
+            for (int f = 0; f < MAX_FIELDS; f++) {
+                s_subscribers[i].next_due[f] = xTaskGetTickCount();
+            }
+        }
+    }
+    xSemaphoreGive(s_sub_lock);
+}
+
+/**
+ * @brief 给每个订阅者发送本轮的增量帧
+ */
+static void publish_deltas(void)
+{
+    char frame[FRAME_MAX];
+    char reply_to[COMMAND_REPLY_TO_LEN];
+
+    for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+        xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+        status_subscriber_t *sub = &s_subscribers[i];
+        uint32_t due = sub->used ? subscriber_due(sub, xTaskGetTickCount()) : 0;
+        xSemaphoreGive(s_sub_lock);
+
+        // 一帧放不下时分多帧发送，每帧在锁内生成、锁外发送
+        while (due != 0) {
+            xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+            uint32_t written = sub->used ? build_frame(sub, due, true, 'D', frame, sizeof(frame)) : 0;
+            uint8_t origin = sub->origin;
+            memcpy(reply_to, sub->reply_to, sizeof(reply_to));
+            xSemaphoreGive(s_sub_lock);
+            if (written == 0) {
+                break;
+            }
+            due &= ~written;
+            atomic_fetch_add(&s_frames, 1);
+            atomic_fetch_add(&s_values, (unsigned)__builtin_popcount(written));
+            command_dispatcher_send((command_origin_t)origin, reply_to, frame);
+        }
+    }
+}
+
+static void status_publish_task(void *arg)
+{
+    while (1) {
+        xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+        TickType_t wait = next_wait(xTaskGetTickCount());
+        xSemaphoreGive(s_sub_lock);
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        apply_resync();
+        publish_deltas();
+
+        // 合并短时间内的连续变化，避免一个抖动的字段占满链路
+        vTaskDelay(pdMS_TO_TICKS(MIN_INTERVAL_MS));
+    }
+}
+
+// --- "status" 命令 ---
+
+enum {
+    STATUS_VERB_LIST,
+    STATUS_VERB_SUB,
+    STATUS_VERB_UNSUB,
+    STATUS_VERB_GET,
+};
+
+/**
+ * @brief 解析字段参数，"*" 表示全部字段
+ */
+static bool parse_field_mask(const command_args_t *args, int index, uint32_t *mask)
+{
+    int count = atomic_load(&s_field_count);
+    uint32_t all = (count >= 32) ? 0xFFFFFFFFUL : (FIELD_BIT(count) - 1);
+    if (index >= args->argc) {
+        *mask = all;
+        return true;
+    }
+    const char *name = command_args_str(args, index);
+    size_t len = args->argv[index].len;
+    if (len == 1 && name[0] == '*') {
+        *mask = all;
+        return true;
+    }
+    status_field_t field = field_find(name, len);
+    if (field < 0) {
+        return false;
+    }
+    *mask = FIELD_BIT(field);
+    return true;
+}
+
+static esp_err_t status_sub(const command_args_t *args)
+{
+    uint32_t mask = 0;
+    int32_t period_ms = 0;
+    if (args->argc < 1 || !parse_field_mask(args, 0, &mask)) {
+        command_dispatcher_reply(args, "ERROR:STATUS_UNKNOWN_FIELD");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (args->argc >= 2 && (!command_args_int(args, 1, &period_ms) || period_ms < 0)) {
+        command_dispatcher_reply(args, "ERROR:STATUS_INVALID_PERIOD");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (period_ms > 0 && period_ms < MIN_INTERVAL_MS) {
+        period_ms = MIN_INTERVAL_MS;
+    }
+
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    status_subscriber_t *sub = subscriber_find(args->origin, args->reply_to, true);
+    if (sub != NULL) {
+        TickType_t now = xTaskGetTickCount();
+        for (int f = 0; f < MAX_FIELDS; f++) {
+            if (!(mask & FIELD_BIT(f))) {
+                continue;
+            }
+            if (period_ms > 0) {
+                sub->period[f] = pdMS_TO_TICKS(period_ms) > 0 ? pdMS_TO_TICKS(period_ms) : 1;
+                sub->next_due[f] = now;
+            }
+        }
+        if (period_ms > 0) {
+            sub->change_mask &= ~mask;
+            sub->period_mask |= mask;
+        } else {
+            sub->period_mask &= ~mask;
+            sub->change_mask |= mask;
+        }
+        // 新订阅的字段在下一帧中带上当前值
+        sub->sent_mask &= ~mask;
+        update_change_mask();
+    }
+    xSemaphoreGive(s_sub_lock);
+
+    if (sub == NULL) {
+        command_dispatcher_reply(args, "ERROR:STATUS_TOO_MANY_SUBSCRIBERS");
+        return ESP_ERR_NO_MEM;
+    }
+    char line[48];
+    snprintf(line, sizeof(line), "STATUS:SUB:%lu", (unsigned long)period_ms);
+    command_dispatcher_reply(args, line);
+    xTaskNotifyGive(s_publish_task);
+    return ESP_OK;
+}
+
+static esp_err_t status_unsub(const command_args_t *args)
+{
+    uint32_t mask = 0;
+    if (!parse_field_mask(args, 0, &mask)) {
+        command_dispatcher_reply(args, "ERROR:STATUS_UNKNOWN_FIELD");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+    status_subscriber_t *sub = subscriber_find(args->origin, args->reply_to, false);
+    if (sub != NULL) {
+        sub->change_mask &= ~mask;
+        sub->period_mask &= ~mask;
+        if (sub->change_mask == 0 && sub->period_mask == 0) {
+            sub->used = false;
+        }
+        update_change_mask();
+    }
+    xSemaphoreGive(s_sub_lock);
+
+    command_dispatcher_reply(args, "STATUS:UNSUB");
+    return ESP_OK;
+}
+
+/**
+ * @brief 回复全部字段的当前值；订阅者之后的增量以此为基准
+ */
+static esp_err_t status_get(const command_args_t *args)
+{
+    char frame[FRAME_MAX];
+    status_subscriber_t temp;
+    memset(&temp, 0, sizeof(temp));
+
+    int count = atomic_load(&s_field_count);
+    uint32_t remaining = (count >= 32) ? 0xFFFFFFFFUL : (FIELD_BIT(count) - 1);
+    while (remaining != 0) {
+        xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+        status_subscriber_t *sub = subscriber_find(args->origin, args->reply_to, false);
+        uint32_t written = build_frame(sub != NULL ? sub : &temp, remaining, false, 'S', frame, sizeof(frame));
+        xSemaphoreGive(s_sub_lock);
+        if (written == 0) {
+            break;
+        }
+        remaining &= ~written;
+        command_dispatcher_reply(args, frame);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t status_list(const command_args_t *args)
+{
+    static const char type_chars[] = { 'b', 'i', 'f' };
+    char frame[FRAME_MAX];
+    size_t len = 0;
+
+    int count = atomic_load(&s_field_count);
+    for (int f = 0; f <= count; f++) {
+        char item[48] = "";
+        int n = 0;
+        if (f < count) {
+            n = snprintf(item, sizeof(item), "%d=%s:%c", f, s_fields[f].name, type_chars[s_fields[f].type]);
+        }
+        // 放不下或已经结束时发出当前帧
+        if (len > 0 && (f == count || len + 1 + n >= sizeof(frame))) {
+            command_dispatcher_reply(args, frame);
+            len = 0;
+        }
+        if (f < count) {
+            len += (size_t)snprintf(frame + len, sizeof(frame) - len, "%s%s",
+                                    len == 0 ? "STATUS:FIELDS:" : ",", item);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t status_command_handler(const command_args_t *args)
+{
+    switch (args->verb_id) {
+    case STATUS_VERB_LIST:
+        return status_list(args);
+    case STATUS_VERB_SUB:
+        return status_sub(args);
+    case STATUS_VERB_UNSUB:
+        return status_unsub(args);
+    case STATUS_VERB_GET:
+        return status_get(args);
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const command_verb_t s_status_verbs[] = {
+    { "list",  STATUS_VERB_LIST },
+    { "sub",   STATUS_VERB_SUB },
+    { "unsub", STATUS_VERB_UNSUB },
+    { "get",   STATUS_VERB_GET },
+};
+
+static const command_module_t s_status_module = {
+    .prefix     = "status",
+    .handler    = status_command_handler,
+    .verbs      = s_status_verbs,
+    .verb_count = sizeof(s_status_verbs) / sizeof(s_status_verbs[0]),
+};
+
+esp_err_t status_registry_init(void)
+{
+    if (s_publish_task == NULL) {
+        s_sub_lock = xSemaphoreCreateMutex();
+        if (s_sub_lock == NULL ||
+            xTaskCreate(status_publish_task, "status_pub", PUBLISH_TASK_STACK, NULL,
+                        PUBLISH_TASK_PRIO, &s_publish_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建状态发布任务失败");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return command_dispatcher_register(&s_status_module);
+}
+
+void status_registry_resync(command_origin_t origin)
+{
+    if (s_publish_task == NULL) {
+        return;
+    }
+    // 只记录来源并唤醒发布任务，不取订阅表的锁，可以在 esp_timer 回调中调用
+    atomic_fetch_or(&s_resync_origins, 1U << origin);
+    xTaskNotifyGive(s_publish_task);
+}
+
+void status_registry_get_stats(status_registry_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    uint32_t subscribers = 0;
+    if (s_sub_lock != NULL) {
+        xSemaphoreTake(s_sub_lock, portMAX_DELAY);
+        for (int i = 0; i < MAX_SUBSCRIBERS; i++) {
+            subscribers += s_subscribers[i].used ? 1 : 0;
+        }
+        xSemaphoreGive(s_sub_lock);
+    }
+    stats->fields = (uint32_t)atomic_load(&s_field_count);
+    stats->subscribers = subscribers;
+    stats->updates = atomic_load(&s_updates);
+    stats->frames = atomic_load(&s_frames);
+    stats->values = atomic_load(&s_values);
+}
@@ -45,11 +45,32 @@ static struct {
 } s_current_status = {0};
 
 // --- 函数声明 ---
-static void compressor_command_handler(const char *command, size_t len);
+static esp_err_t compressor_command_handler(const command_args_t *args);
 static void compressor_comm_task(void *pvParameters);
 static uint16_t calculate_crc16(const uint8_t *data, uint16_t length);
 static void send_modbus_write_command(uint16_t reg_addr, uint16_t value);
 
+enum {
+    COMPRESSOR_VERB_START,
+    COMPRESSOR_VERB_STOP,
+    COMPRESSOR_VERB_SPEED,
+};
+
+static const command_verb_t s_compressor_verbs[] = {
+    { "start", COMPRESSOR_VERB_START },
+    { "stop",  COMPRESSOR_VERB_STOP,  COMMAND_PRIORITY_HIGH },
+    { "speed", COMPRESSOR_VERB_SPEED, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_COALESCE },
+};
+
+static const command_module_t s_compressor_module = {
+    .prefix     = "compressor",
+    .handler    = compressor_command_handler,
+    .verbs      = s_compressor_verbs,
+    .verb_count = sizeof(s_compressor_verbs) / sizeof(s_compressor_verbs[0]),
+    // 每次 Modbus 写入都要等待应答，转速设定入队合并，避免滑条拖动时堵塞串口
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+};
+
 // --- CRC16-Modbus 校验表 ---
 static const uint8_t crc_hi_table[] = {
     0x00, 0xC1, 0x81, 0x40, 0x01, 0xC0, 0x80, 0x41, 0x01, 0xC0, 0x80, 0x41, 0x00, 0xC1, 0x81,
@@ -107,45 +128,56 @@ static uint16_t calculate_crc16(const uint8_t *data, uint16_t length) {
 }
 
 // 命令处理函数，与您的蓝本一致
-static void compressor_command_handler(const char *command, size_t len)
+static esp_err_t compressor_command_handler(const command_args_t *args)
 {
     if (!s_is_initialized) {
         ESP_LOGE(TAG, "模块未初始化，无法处理命令");
-        return;
+        return ESP_ERR_INVALID_STATE;
     }
 
-    const char *sub_command = command + strlen("compressor:");
-    uint16_t speed_val = 0;
+    int32_t speed_val = 0;
 
-    if (strncmp(sub_command, "start", strlen("start")) == 0) {
+    switch (args->verb_id) {
+    case COMPRESSOR_VERB_START:
         if (xSemaphoreTake(s_target_status_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { 
             s_target_status.run_command = true;
             xSemaphoreGive(s_target_status_mutex);
             ESP_LOGI(TAG, "收到启动指令");
         } else {
             ESP_LOGE(TAG, "获取互斥锁超时");
+            return ESP_ERR_TIMEOUT;
         }
-    } else if (strncmp(sub_command, "stop", strlen("stop")) == 0) {
-         if (xSemaphoreTake(s_target_status_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { 
+        break;
+    case COMPRESSOR_VERB_STOP:
+        if (xSemaphoreTake(s_target_status_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { 
             s_target_status.run_command = false;
             xSemaphoreGive(s_target_status_mutex); 
             ESP_LOGI(TAG, "收到停止指令");
         } else {
             ESP_LOGE(TAG, "获取互斥锁超时");
+            return ESP_ERR_TIMEOUT;
+        }
+        break;
+    case COMPRESSOR_VERB_SPEED:
+        if (!command_args_int(args, 0, &speed_val)) {
+            ESP_LOGW(TAG, "速度参数无效: %s", args->line);
+            return ESP_ERR_INVALID_ARG;
         }
-    } else if (sscanf(sub_command, "speed:%hu", &speed_val) == 1) {
         if (speed_val > 4800) speed_val = 4800;
         if (speed_val < 2000) speed_val = 2000;
-         if (xSemaphoreTake(s_target_status_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { 
-            s_target_status.target_speed_rpm = speed_val;
+        if (xSemaphoreTake(s_target_status_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { 
+            s_target_status.target_speed_rpm = (uint16_t)speed_val;
             xSemaphoreGive(s_target_status_mutex); 
-            ESP_LOGI(TAG, "收到速度设定指令: %d RPM", speed_val);
+            ESP_LOGI(TAG, "收到速度设定指令: %d RPM", (int)speed_val);
         } else {
             ESP_LOGE(TAG, "获取互斥锁超时");
+            return ESP_ERR_TIMEOUT;
         }
-    } else {
-        ESP_LOGW(TAG, "未知的压缩机子命令: %s", sub_command);
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    return ESP_OK;
 }
 
 // 初始化函数，与您的蓝本一致
@@ -177,7 +209,7 @@ esp_err_t compressor_module_init(void)
         return ESP_FAIL;
     }
 
-    ESP_ERROR_CHECK(command_dispatcher_register("compressor", compressor_command_handler));
+    ESP_ERROR_CHECK(command_dispatcher_register(&s_compressor_module));
     
     if (xTaskCreate(compressor_comm_task, "comp_comm_task", COMM_TASK_STACK_SIZE, NULL, 5, &s_comm_task_handle) != pdPASS) {
         ESP_LOGE(TAG, "创建通讯任务失败");
@@ -0,0 +1,89 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "mqtt_client.h"
+
+/**
+ * @brief WiFi / MQTT 连接状态
+ */
+typedef enum {
+    CONN_STATE_IDLE,              // 未启动
+    CONN_STATE_WIFI_CONNECTING,   // 正在连接 AP 并获取 IP
+    CONN_STATE_WIFI_BACKOFF,      // WiFi 连接失败或断开，等待重试
+    CONN_STATE_MQTT_CONNECTING,   // 已获得 IP，正在连接服务器
+    CONN_STATE_MQTT_BACKOFF,      // MQTT 连接失败或断开，等待重试
+    CONN_STATE_CONNECTED,         // MQTT 已连接
+} connection_state_t;
+
+typedef struct {
+    const char *ssid;
+    const char *password;
+    const char *broker_uri;
+    const char *client_id;
+    esp_event_handler_t mqtt_event_handler;   // 应用的 MQTT 事件处理 (收到消息、连接后订阅等)，可为 NULL
+    void *mqtt_handler_arg;
+} connection_manager_config_t;
+
+/**
+ * @brief 初始化 WiFi 和 MQTT 客户端并启动连接管理任务
+ *
+ * WiFi / IP / MQTT 事件处理只把事件放入队列，不在系统事件循环中等待；
+ * 连接管理任务按状态机处理:
+ *   断开或连接失败后按指数退避 (CONFIG_CONN_MANAGER_BACKOFF_MIN_MS 起每次加倍，
+ *   不超过 CONFIG_CONN_MANAGER_BACKOFF_MAX_MS，取其一半到全部之间的随机值) 无限重试；
+ *   MQTT 客户端只创建一次，关闭其自动重连，每次重连由本任务停止再启动客户端 (esp_mqtt_client_stop/start)；
+ *   最近一次成功连接的 AP 的 BSSID 和信道保存在 NVS 中，重连时先只在该信道上直接连接，
+ *   失败后才做全信道扫描。
+ * 同时注册 "net" 命令:
+ *   "net:stats"      回复 "STATUS:NET:state=..,wifi_ms=..,mqtt_ms=..,total_ms=..,..."
+ *   "net:reconnect"  断开 WiFi 并立即重新连接
+ * 须在 nvs_flash_init 和 command_dispatcher_init 之后调用，只能调用一次。
+ */
+esp_err_t connection_manager_start(const connection_manager_config_t *config);
+
+/**
+ * @brief MQTT 客户端 (启动后一直有效，未连接时发布会失败)
+ */
+esp_mqtt_client_handle_t connection_manager_mqtt_client(void);
+
+/**
+ * @brief 当前状态
+ */
+connection_state_t connection_manager_get_state(void);
+
+/**
+ * @brief 状态名 ("idle"、"wifi_connecting"、...)
+ */
+const char *connection_manager_state_name(connection_state_t state);
+
+/**
+ * @brief 连接统计，时间均为 ms
+ */
+typedef struct {
+    connection_state_t state;
+    uint32_t wifi_connects;     // 获得 IP 的次数
+    uint32_t wifi_failures;     // WiFi 连接失败或断开的次数
+    uint32_t fast_connects;     // 用缓存的 BSSID/信道直接连上的次数
+    uint32_t fast_misses;       // 用缓存的 BSSID/信道没有连上、改为全信道扫描的次数
+    uint32_t mqtt_connects;     // MQTT 连接成功的次数
+    uint32_t mqtt_failures;     // MQTT 连接失败或断开的次数
+    uint32_t last_wifi_ms;      // 最近一次从断开 (或启动) 到获得 IP
+    uint32_t last_mqtt_ms;      // 最近一次从获得 IP 到 MQTT 连接
+    uint32_t last_total_ms;     // 最近一次从断开 (或启动) 到 MQTT 连接
+    uint32_t max_total_ms;      // 启动以来 last_total_ms 的最大值
+    uint32_t avg_total_ms;      // 启动以来 last_total_ms 的平均值
+    uint32_t backoff_ms;        // 当前 (或最近一次) 的重试等待
+    uint32_t connected_s;       // 本次已连接的秒数，未连接时为 0
+    uint16_t last_reason;       // 最近一次 WiFi 断开的原因码 (见 main.c 开头的对照表)
+} connection_manager_stats_t;
+
+/**
+ * @brief 读取连接统计
+ */
+void connection_manager_get_stats(connection_manager_stats_t *stats);
+
+#endif // CONNECTION_MANAGER_H
@@ -0,0 +1,579 @@
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include "command_dispatcher.h"
+#include "connection_manager.h"
+
+static const char *TAG = "CONN_MANAGER";
+
+#define BACKOFF_MIN_MS  (CONFIG_CONN_MANAGER_BACKOFF_MIN_MS)
+#define BACKOFF_MAX_MS  (CONFIG_CONN_MANAGER_BACKOFF_MAX_MS)
+#define WIFI_TIMEOUT_MS (CONFIG_CONN_MANAGER_WIFI_TIMEOUT_MS)
+#define MQTT_TIMEOUT_MS (CONFIG_CONN_MANAGER_MQTT_TIMEOUT_MS)
+#define TASK_STACK      (4096)
+#define TASK_PRIO       (CONFIG_CONN_MANAGER_TASK_PRIORITY)
+#define EVENT_QUEUE_LEN (16)
+#define NVS_NAMESPACE   "conn_mgr"
+#define NVS_KEY_AP      "ap"
+
+typedef enum {
+    EV_WIFI_START,
+    EV_WIFI_CONNECTED,
+    EV_WIFI_DISCONNECTED,
+    EV_GOT_IP,
+    EV_MQTT_CONNECTED,
+    EV_MQTT_DISCONNECTED,
+    EV_RECONNECT,
+} conn_event_type_t;
+
+typedef struct {
+    uint8_t  type;
+    uint8_t  channel;
+    uint16_t reason;
+    uint8_t  bssid[6];
+} conn_event_t;
+
+// 最近一次连上的 AP，保存在 NVS 中
+typedef struct {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t reserved;
+    char    ssid[33];
+} ap_cache_t;
+
+static QueueHandle_t s_events = NULL;
+static esp_mqtt_client_handle_t s_mqtt = NULL;
+static connection_manager_config_t s_config;
+
+// 以下只在连接管理任务中修改
+static connection_state_t s_state = CONN_STATE_IDLE;
+static bool s_deadline_active;
+static TickType_t s_deadline;
+static uint32_t s_wifi_attempt;       // 连续失败次数，决定退避时间
+static uint32_t s_mqtt_attempt;
+static bool s_mqtt_started;
+static bool s_fast_attempt;           // 本次连接使用了缓存的 BSSID/信道
+static bool s_use_cache = true;       // 下一次连接是否使用缓存 (直接连接失败后改为全信道扫描)
+static ap_cache_t s_cache;
+static bool s_cache_valid;
+static int64_t s_outage_start_us;     // 断开 (或启动) 的时间
+static int64_t s_got_ip_us;
+static int64_t s_connected_us;
+static uint64_t s_total_sum_ms;
+
+static connection_manager_stats_t s_stats;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const s_state_names[] = {
+    [CONN_STATE_IDLE]            = "idle",
+    [CONN_STATE_WIFI_CONNECTING] = "wifi_connecting",
+    [CONN_STATE_WIFI_BACKOFF]    = "wifi_backoff",
+    [CONN_STATE_MQTT_CONNECTING] = "mqtt_connecting",
+    [CONN_STATE_MQTT_BACKOFF]    = "mqtt_backoff",
+    [CONN_STATE_CONNECTED]       = "connected",
+};
+
+static uint32_t elapsed_ms(int64_t since_us)
+{
+    return (uint32_t)((esp_timer_get_time() - since_us) / 1000);
+}
+
+static void set_state(connection_state_t state)
+{
+    s_state = state;
+    taskENTER_CRITICAL(&s_stats_lock);
+    s_stats.state = state;
+    taskEXIT_CRITICAL(&s_stats_lock);
+}
+
+static void set_deadline(uint32_t ms)
+{
+    s_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(ms);
+    s_deadline_active = true;
+}
+
+// --- 事件处理: 在系统事件循环 / MQTT 任务中调用，只入队 ---
+
+static void post_event(const conn_event_t *ev)
+{
+    if (xQueueSend(s_events, ev, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "事件队列已满，丢弃事件 %u", ev->type);
+    }
+}
+
+static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    conn_event_t ev = { 0 };
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        ev.type = EV_WIFI_START;
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        const wifi_event_sta_connected_t *e = data;
+        ev.type = EV_WIFI_CONNECTED;
+        ev.channel = e->channel;
+        memcpy(ev.bssid, e->bssid, sizeof(ev.bssid));
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *e = data;
+        ev.type = EV_WIFI_DISCONNECTED;
+        ev.reason = e->reason;
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *e = data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&e->ip_info.ip));
+        ev.type = EV_GOT_IP;
+    } else {
+        return;
+    }
+    post_event(&ev);
+}
+
+static void mqtt_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    conn_event_t ev = { 0 };
+    if (id == MQTT_EVENT_CONNECTED) {
+        ev.type = EV_MQTT_CONNECTED;
+    } else if (id == MQTT_EVENT_DISCONNECTED) {
+        ev.type = EV_MQTT_DISCONNECTED;
+    } else {
+        return;
+    }
+    post_event(&ev);
+}
+
+// --- BSSID / 信道缓存 ---
+
+static void ap_cache_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(s_cache);
+    s_cache_valid = nvs_get_blob(nvs, NVS_KEY_AP, &s_cache, &len) == ESP_OK && len == sizeof(s_cache) &&
+                    s_cache.ssid[sizeof(s_cache.ssid) - 1] == '\0' && strcmp(s_cache.ssid, s_config.ssid) == 0 &&
+                    s_cache.channel > 0;
+    nvs_close(nvs);
+    if (s_cache_valid) {
+        ESP_LOGI(TAG, "上次连接的 AP: " MACSTR "，信道 %u", MAC2STR(s_cache.bssid), s_cache.channel);
+    }
+}
+
+// 只在 AP 变化时写入 NVS
+static void ap_cache_store(const uint8_t *bssid, uint8_t channel)
+{
+#if CONFIG_CONN_MANAGER_BSSID_CACHE
+    if (s_cache_valid && s_cache.channel == channel && memcmp(s_cache.bssid, bssid, sizeof(s_cache.bssid)) == 0) {
+        return;
+    }
+    memset(&s_cache, 0, sizeof(s_cache));
+    memcpy(s_cache.bssid, bssid, sizeof(s_cache.bssid));
+    s_cache.channel = channel;
+    strncpy(s_cache.ssid, s_config.ssid, sizeof(s_cache.ssid) - 1);
+    s_cache_valid = true;
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, NVS_KEY_AP, &s_cache, sizeof(s_cache));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "保存 AP 信息失败: %s", esp_err_to_name(err));
+    }
+#endif
+}
+
+// --- 状态机 (连接管理任务) ---
+
+static void enter_backoff(connection_state_t state, uint32_t *attempt)
+{
+    uint32_t shift = *attempt < 16 ? *attempt : 16;
+    uint32_t cap = (uint32_t)BACKOFF_MIN_MS << shift;
+    if (cap > BACKOFF_MAX_MS || cap < BACKOFF_MIN_MS) {
+        cap = BACKOFF_MAX_MS;
+    }
+    // 取 [cap/2, cap] 之间的随机值，避免大量设备在路由器恢复后同时重连
+    uint32_t wait = cap / 2 + esp_random() % (cap / 2 + 1);
+    (*attempt)++;
+    set_state(state);
+    set_deadline(wait);
+    taskENTER_CRITICAL(&s_stats_lock);
+    s_stats.backoff_ms = wait;
+    taskEXIT_CRITICAL(&s_stats_lock);
+    ESP_LOGW(TAG, "%s，%lu ms 后重试 (第 %lu 次)", state == CONN_STATE_WIFI_BACKOFF ? "WiFi 未连接" : "MQTT 未连接",
+             (unsigned long)wait, (unsigned long)*attempt);
+}
+
+static void wifi_connect_attempt(void)
+{
+    wifi_config_t cfg = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .pmf_cfg = { .capable = true, .required = false },
+            .scan_method = WIFI_ALL_CHANNEL_SCAN,
+            .sort_method = WIFI_CONNECT_AP_BY_SIGNAL,
+        },
+    };
+    strncpy((char *)cfg.sta.ssid, s_config.ssid, sizeof(cfg.sta.ssid));
+    strncpy((char *)cfg.sta.password, s_config.password, sizeof(cfg.sta.password));
+    s_fast_attempt = CONFIG_CONN_MANAGER_BSSID_CACHE && s_use_cache && s_cache_valid;
+    if (s_fast_attempt) {
+        // 只在缓存的信道上连接指定的 AP，不做全信道扫描
+        cfg.sta.bssid_set = true;
+        memcpy(cfg.sta.bssid, s_cache.bssid, sizeof(cfg.sta.bssid));
+        cfg.sta.channel = s_cache.channel;
+        cfg.sta.scan_method = WIFI_FAST_SCAN;
+    }
+    set_state(CONN_STATE_WIFI_CONNECTING);
+    set_deadline(WIFI_TIMEOUT_MS);
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    if (err == ESP_OK) {
+        err = esp_wifi_connect();
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_connect 失败: %s", esp_err_to_name(err));
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.wifi_failures++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        enter_backoff(CONN_STATE_WIFI_BACKOFF, &s_wifi_attempt);
+    }
+}
+
+// 关闭了自动重连的客户端断开后不会再自己连接 (esp_mqtt_client_reconnect 也不起作用)，
+// 只能停止后重新启动；停止会等待 MQTT 任务退出，因此只在连接管理任务中调用
+static void mqtt_stop(void)
+{
+    if (s_mqtt_started) {
+        esp_mqtt_client_stop(s_mqtt);
+        s_mqtt_started = false;
+    }
+}
+
+static void mqtt_connect_attempt(void)
+{
+    mqtt_stop();
+    set_state(CONN_STATE_MQTT_CONNECTING);
+    set_deadline(MQTT_TIMEOUT_MS);
+    esp_err_t err = esp_mqtt_client_start(s_mqtt);
+    s_mqtt_started = err == ESP_OK;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "MQTT 连接失败: %s", esp_err_to_name(err));
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.mqtt_failures++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        enter_backoff(CONN_STATE_MQTT_BACKOFF, &s_mqtt_attempt);
+    }
+}
+
+// WiFi 断开: 第一次立即重连，之后退避
+static void wifi_link_lost(uint16_t reason)
+{
+    bool was_connected = s_state == CONN_STATE_CONNECTED;
+    if (was_connected) {
+        s_outage_start_us = esp_timer_get_time();
+    }
+    mqtt_stop();
+    ESP_LOGW(TAG, "WiFi 断开 (原因 %u)，重新连接", reason);
+    s_wifi_attempt = 0;
+    s_use_cache = true;
+    wifi_connect_attempt();
+}
+
+static void conn_handle_event(const conn_event_t *ev)
+{
+    switch (ev->type) {
+    case EV_WIFI_START:
+        wifi_connect_attempt();
+        break;
+    case EV_WIFI_CONNECTED:
+        ap_cache_store(ev->bssid, ev->channel);
+        break;
+    case EV_WIFI_DISCONNECTED:
+        // 超时后主动断开产生的事件在退避状态下到达，不重复计数
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.last_reason = ev->reason;
+        s_stats.wifi_failures += s_state != CONN_STATE_WIFI_BACKOFF && s_state != CONN_STATE_IDLE ? 1 : 0;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        if (s_state == CONN_STATE_WIFI_CONNECTING) {
+            if (s_fast_attempt) {
+                // 缓存的 AP 不可用 (关机、换了信道)，立即改为全信道扫描，不计退避
+                ESP_LOGW(TAG, "直接连接缓存的 AP 失败 (原因 %u)，改为扫描", ev->reason);
+                taskENTER_CRITICAL(&s_stats_lock);
+                s_stats.fast_misses++;
+                taskEXIT_CRITICAL(&s_stats_lock);
+                s_use_cache = false;
+                wifi_connect_attempt();
+            } else {
+                s_use_cache = true;
+                enter_backoff(CONN_STATE_WIFI_BACKOFF, &s_wifi_attempt);
+            }
+        } else if (s_state == CONN_STATE_MQTT_CONNECTING || s_state == CONN_STATE_MQTT_BACKOFF ||
+                   s_state == CONN_STATE_CONNECTED) {
+            wifi_link_lost(ev->reason);
+        }
+        break;
+    case EV_GOT_IP:
+        if (s_state != CONN_STATE_WIFI_CONNECTING && s_state != CONN_STATE_WIFI_BACKOFF) {
+            break;
+        }
+        s_got_ip_us = esp_timer_get_time();
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.wifi_connects++;
+        s_stats.fast_connects += s_fast_attempt ? 1 : 0;
+        s_stats.last_wifi_ms = elapsed_ms(s_outage_start_us);
+        taskEXIT_CRITICAL(&s_stats_lock);
+        s_wifi_attempt = 0;
+        s_use_cache = true;
+        s_mqtt_attempt = 0;
+        mqtt_connect_attempt();
+        break;
+    case EV_MQTT_CONNECTED: {
+        if (s_state != CONN_STATE_MQTT_CONNECTING) {
+            break;
+        }
+        s_deadline_active = false;
+        s_mqtt_attempt = 0;
+        s_connected_us = esp_timer_get_time();
+        uint32_t mqtt_ms = elapsed_ms(s_got_ip_us);
+        uint32_t total_ms = elapsed_ms(s_outage_start_us);
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.mqtt_connects++;
+        s_stats.last_mqtt_ms = mqtt_ms;
+        s_stats.last_total_ms = total_ms;
+        if (total_ms > s_stats.max_total_ms) {
+            s_stats.max_total_ms = total_ms;
+        }
+        s_total_sum_ms += total_ms;
+        s_stats.avg_total_ms = (uint32_t)(s_total_sum_ms / s_stats.mqtt_connects);
+        s_stats.backoff_ms = 0;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        set_state(CONN_STATE_CONNECTED);
+        ESP_LOGI(TAG, "已连接: WiFi %lu ms%s，MQTT %lu ms，共 %lu ms", (unsigned long)s_stats.last_wifi_ms,
+                 s_fast_attempt ? " (直接连接缓存的 AP)" : "", (unsigned long)mqtt_ms, (unsigned long)total_ms);
+        break;
+    }
+    case EV_MQTT_DISCONNECTED:
+        if (s_state == CONN_STATE_CONNECTED) {
+            s_outage_start_us = esp_timer_get_time();
+            s_got_ip_us = s_outage_start_us;
+        } else if (s_state != CONN_STATE_MQTT_CONNECTING) {
+            break;
+        }
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.mqtt_failures++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        enter_backoff(CONN_STATE_MQTT_BACKOFF, &s_mqtt_attempt);
+        break;
+    case EV_RECONNECT:
+        if (s_state == CONN_STATE_CONNECTED) {
+            s_outage_start_us = esp_timer_get_time();
+        }
+        if (s_state == CONN_STATE_WIFI_BACKOFF) {
+            s_wifi_attempt = 0;
+            wifi_connect_attempt();
+        } else {
+            // 断开事件到达后按断线处理，立即重新连接
+            esp_wifi_disconnect();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void conn_handle_timeout(void)
+{
+    switch (s_state) {
+    case CONN_STATE_WIFI_CONNECTING:
+        ESP_LOGW(TAG, "WiFi 连接超时 (%d ms)", WIFI_TIMEOUT_MS);
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.wifi_failures++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        s_use_cache = !s_fast_attempt;
+        esp_wifi_disconnect();
+        enter_backoff(CONN_STATE_WIFI_BACKOFF, &s_wifi_attempt);
+        break;
+    case CONN_STATE_WIFI_BACKOFF:
+        wifi_connect_attempt();
+        break;
+    case CONN_STATE_MQTT_CONNECTING:
+        ESP_LOGW(TAG, "MQTT 连接超时 (%d ms)", MQTT_TIMEOUT_MS);
+        taskENTER_CRITICAL(&s_stats_lock);
+        s_stats.mqtt_failures++;
+        taskEXIT_CRITICAL(&s_stats_lock);
+        mqtt_stop();
+        enter_backoff(CONN_STATE_MQTT_BACKOFF, &s_mqtt_attempt);
+        break;
+    case CONN_STATE_MQTT_BACKOFF:
+        mqtt_connect_attempt();
+        break;
+    default:
+        break;
+    }
+}
+
+static void conn_task(void *arg)
+{
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+        if (s_deadline_active) {
+            int32_t left = (int32_t)(s_deadline - xTaskGetTickCount());
+            wait = left > 0 ? (TickType_t)left : 0;
+        }
+        conn_event_t ev;
+        if (xQueueReceive(s_events, &ev, wait) == pdTRUE) {
+            conn_handle_event(&ev);
+        } else if (s_deadline_active) {
+            s_deadline_active = false;
+            conn_handle_timeout();
+        }
+    }
+}
+
+// --- "net" 命令 ---
+
+enum {
+    NET_VERB_STATS,
+    NET_VERB_RECONNECT,
+};
+
+static esp_err_t net_command_handler(const command_args_t *args)
+{
+    switch (args->verb_id) {
+    case NET_VERB_STATS: {
+        connection_manager_stats_t stats;
+        connection_manager_get_stats(&stats);
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "STATUS:NET:state=%s,wifi_ms=%lu,mqtt_ms=%lu,total_ms=%lu,max_ms=%lu,avg_ms=%lu,wifi=%lu,"
+                 "wifi_fail=%lu,fast=%lu,fast_miss=%lu,mqtt=%lu,mqtt_fail=%lu,backoff_ms=%lu,reason=%u,up_s=%lu",
+                 connection_manager_state_name(stats.state), (unsigned long)stats.last_wifi_ms,
+                 (unsigned long)stats.last_mqtt_ms, (unsigned long)stats.last_total_ms,
+                 (unsigned long)stats.max_total_ms, (unsigned long)stats.avg_total_ms,
+                 (unsigned long)stats.wifi_connects, (unsigned long)stats.wifi_failures,
+                 (unsigned long)stats.fast_connects, (unsigned long)stats.fast_misses,
+                 (unsigned long)stats.mqtt_connects, (unsigned long)stats.mqtt_failures,
+                 (unsigned long)stats.backoff_ms, stats.last_reason, (unsigned long)stats.connected_s);
+        command_dispatcher_reply(args, line);
+        return ESP_OK;
+    }
+    case NET_VERB_RECONNECT: {
+        const conn_event_t ev = { .type = EV_RECONNECT };
+        post_event(&ev);
+        command_dispatcher_reply(args, "STATUS:NET:RECONNECT");
+        return ESP_OK;
+    }
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const command_verb_t s_net_verbs[] = {
+    { "stats",     NET_VERB_STATS },
+    { "reconnect", NET_VERB_RECONNECT },
+};
+
+static const command_module_t s_net_module = {
+    .prefix     = "net",
+    .handler    = net_command_handler,
+    .verbs      = s_net_verbs,
+    .verb_count = sizeof(s_net_verbs) / sizeof(s_net_verbs[0]),
+};
+
+esp_err_t connection_manager_start(const connection_manager_config_t *config)
+{
+    if (config == NULL || config->ssid == NULL || config->password == NULL || config->broker_uri == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_events != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_config = *config;
+    s_events = xQueueCreate(EVENT_QUEUE_LEN, sizeof(conn_event_t));
+    if (s_events == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_CONN_MANAGER_BSSID_CACHE
+    ap_cache_load();
+#endif
+
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
+    assert(sta_netif);
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+
+    // MQTT 客户端只创建一次；关闭自动重连，由连接管理任务在获得 IP 后停止再启动客户端
+    const esp_mqtt_client_config_t mqtt_cfg = {
+        .broker.address.uri = config->broker_uri,
+        .credentials.client_id = config->client_id,
+        .network.disable_auto_reconnect = true,
+    };
+    s_mqtt = esp_mqtt_client_init(&mqtt_cfg);
+    if (s_mqtt == NULL) {
+        ESP_LOGE(TAG, "MQTT客户端初始化失败");
+        return ESP_FAIL;
+    }
+    esp_mqtt_client_register_event(s_mqtt, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
+    if (config->mqtt_event_handler != NULL) {
+        esp_mqtt_client_register_event(s_mqtt, ESP_EVENT_ANY_ID, config->mqtt_event_handler, config->mqtt_handler_arg);
+    }
+
+    s_outage_start_us = esp_timer_get_time();
+    if (xTaskCreate(conn_task, "conn_manager", TASK_STACK, NULL, TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "创建连接管理任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = command_dispatcher_register(&s_net_module);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "Starting WiFi, SSID: %s", config->ssid);
+    return esp_wifi_start();
+}
+
+esp_mqtt_client_handle_t connection_manager_mqtt_client(void)
+{
+    return s_mqtt;
+}
+
+connection_state_t connection_manager_get_state(void)
+{
+    return s_state;
+}
+
+const char *connection_manager_state_name(connection_state_t state)
+{
+    return (unsigned)state < sizeof(s_state_names) / sizeof(s_state_names[0]) ? s_state_names[state] : "unknown";
+}
+
+void connection_manager_get_stats(connection_manager_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    taskENTER_CRITICAL(&s_stats_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_stats_lock);
+    if (stats->state == CONN_STATE_CONNECTED) {
+        stats->connected_s = (uint32_t)((esp_timer_get_time() - s_connected_us) / 1000000);
+    }
+}
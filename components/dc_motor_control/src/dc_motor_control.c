@@ -5,8 +5,11 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "actuator.h"
 #include "command_dispatcher.h"
+#include "status_registry.h"
 #include "uart_service.h"
+#include "sdkconfig.h"
 
 // --- 宏定义 ---
 #define MOTOR_IN1_GPIO          15
@@ -21,54 +24,93 @@
 // --- 模块私有状态 ---
 static const char *TAG = "DC_MOTOR_MODULE";
 static bool s_is_initialized = false;
+static motor_direction_t s_direction = MOTOR_DIR_STOP; // 当前方向
+static uint8_t s_speed = 0;                            // 当前速度百分比
+static status_field_t s_pump_field = -1;               // 状态字段 "pump": 带方向的速度，反转为负
 
 
 
 
 // --- 内部函数声明 ---
-void motor_command_handler(const char *command, size_t len);
+static esp_err_t motor_command_handler(const command_args_t *args);
 static esp_err_t motor_set_direction(motor_direction_t direction);
 static esp_err_t motor_set_speed(uint8_t speed_percentage);
 static void motor_stop_action(void);
+static esp_err_t motor_actuator_set_pwm(uint8_t percent);
+static void motor_publish_status(void);
 esp_err_t dc_motor_module_init(void);
 
+enum {
+    MOTOR_VERB_SPEED,
+    MOTOR_VERB_FORWARD,
+    MOTOR_VERB_REVERSE,
+    MOTOR_VERB_STOP,
+    MOTOR_VERB_BRAKE,
+};
+
+static const command_verb_t s_motor_verbs[] = {
+    { "speed",   MOTOR_VERB_SPEED,   COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_COALESCE },
+    { "forward", MOTOR_VERB_FORWARD },
+    { "reverse", MOTOR_VERB_REVERSE },
+    { "stop",    MOTOR_VERB_STOP,    COMMAND_PRIORITY_HIGH },
+    { "brake",   MOTOR_VERB_BRAKE,   COMMAND_PRIORITY_HIGH },
+};
+
+static const command_module_t s_motor_module = {
+    .prefix     = "motor",
+    .handler    = motor_command_handler,
+    .verbs      = s_motor_verbs,
+    .verb_count = sizeof(s_motor_verbs) / sizeof(s_motor_verbs[0]),
+    // speed 为可合并的设定值，需要命令队列
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+};
+
+static const actuator_ops_t s_motor_actuator = {
+    .id      = ACTUATOR_PUMP,
+    .name    = "motor",
+    .set_pwm = motor_actuator_set_pwm,
+};
+
 //命令处理器，处理所有 "motor:" 前缀的命令
-void motor_command_handler(const char *command, size_t len)
+static esp_err_t motor_command_handler(const command_args_t *args)
 {
     if (!s_is_initialized) {
-        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %.*s", (int)len, command);
-        return;
+        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %s", args->line);
+        return ESP_ERR_INVALID_STATE;
     }
 
-    const char *sub_command = command + strlen("motor:");
-    uint8_t speed_val = 0;
+    int32_t speed_val = 0;
 
-    // 优先检查带参数的 speed 命令
-    if (sscanf(sub_command, "speed:%hhu", &speed_val) == 1) {
-        motor_set_speed(speed_val);
-        ESP_LOGI(TAG, "收到速度指令: %d%%", speed_val);
-    }
-    // 然后检查简单的动作指令，使用 strncmp 忽略末尾的换行符
-    else if (strncmp(sub_command, "forward", strlen("forward")) == 0) {
+    switch (args->verb_id) {
+    case MOTOR_VERB_SPEED:
+        if (!command_args_int(args, 0, &speed_val) || speed_val < 0) {
+            ESP_LOGW(TAG, "速度参数无效: %s", args->line);
+            return ESP_ERR_INVALID_ARG;
+        }
+        motor_set_speed(speed_val > 100 ? 100 : (uint8_t)speed_val);
+        ESP_LOGI(TAG, "收到速度指令: %d%%", (int)speed_val);
+        break;
+    case MOTOR_VERB_FORWARD:
         motor_set_direction(MOTOR_DIR_FORWARD);
         ESP_LOGI(TAG, "收到前进指令");
-    }
-    else if (strncmp(sub_command, "reverse", strlen("reverse")) == 0) {
+        break;
+    case MOTOR_VERB_REVERSE:
         motor_set_direction(MOTOR_DIR_REVERSE);
         ESP_LOGI(TAG, "收到后退指令");
-    }
-    else if (strncmp(sub_command, "stop", strlen("stop")) == 0) {
+        break;
+    case MOTOR_VERB_STOP:
         motor_stop_action();
         ESP_LOGI(TAG, "收到停止指令");
-    }
-    else if (strncmp(sub_command, "brake", strlen("brake")) == 0) {
+        break;
+    case MOTOR_VERB_BRAKE:
         motor_set_direction(MOTOR_DIR_BRAKE);
         motor_set_speed(0);
         ESP_LOGI(TAG, "收到刹车指令");
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    else {
-        ESP_LOGW(TAG, "未知的电机子命令: %s", sub_command);
-    }
+    return ESP_OK;
 }
 
 esp_err_t dc_motor_module_init(void)
@@ -122,15 +164,23 @@ esp_err_t dc_motor_module_init(void)
     }
 
     // 4. 注册命令
-    ret = command_dispatcher_register("motor", motor_command_handler);
+    ret = command_dispatcher_register(&s_motor_module);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "注册 'motor' 命令失败");
         return ret;
     }
 
     // 5. 设置初始状态
+    s_pump_field = status_field_register("pump", STATUS_FIELD_INT);
     motor_stop_action();
     s_is_initialized = true;
+
+    // 6. 注册为水泵执行器，供内部控制流程直接调用
+    ret = actuator_register(&s_motor_actuator);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "注册水泵执行器失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
     ESP_LOGI(TAG, "直流电机模块初始化完成");
     return ESP_OK;
 }
@@ -156,6 +206,8 @@ static esp_err_t motor_set_direction(motor_direction_t direction)
             gpio_set_level(MOTOR_IN2_GPIO, 0);
             break;
     }
+    s_direction = direction;
+    motor_publish_status();
     return ESP_OK;
 }
 
@@ -169,11 +221,24 @@ static esp_err_t motor_set_speed(uint8_t speed_percentage)
 
     ledc_set_duty(MOTOR_LEDC_SPEED_MODE, MOTOR_LEDC_CHANNEL, duty);
     ledc_update_duty(MOTOR_LEDC_SPEED_MODE, MOTOR_LEDC_CHANNEL);
+    s_speed = speed_percentage;
+    motor_publish_status();
 
     ESP_LOGI(TAG, "电机速度设置为: %d%% (Duty: %lu)", speed_percentage, duty);
     return ESP_OK;
 }
 
+static void motor_publish_status(void)
+{
+    int32_t speed = 0;
+    if (s_direction == MOTOR_DIR_FORWARD) {
+        speed = s_speed;
+    } else if (s_direction == MOTOR_DIR_REVERSE) {
+        speed = -(int32_t)s_speed;
+    }
+    status_field_set_int(s_pump_field, speed);
+}
+
 void motor_stop_action(void)
 {
     motor_set_direction(MOTOR_DIR_STOP);
@@ -181,6 +246,41 @@ void motor_stop_action(void)
     ESP_LOGI(TAG, "电机已停止(高阻态)。");
 }
 
+/**
+ * @brief 水泵执行器: 0 等同于 "motor:stop"，其它值等同于 "motor:speed:<n>" + "motor:forward"
+ *        方向和速度都未变化时不操作
+ *
+ * 调用者 (蒸汽水位监控、安全状态) 不经过命令队列，在模块的执行锁内操作，
+ * 不会与工作任务中的 motor 命令同时修改方向和速度。等锁超时时停止仍然执行 (安全优先)，
+ * 启动返回 ESP_ERR_TIMEOUT，由下一次水位检查重试。
+ */
+static esp_err_t motor_actuator_set_pwm(uint8_t percent)
+{
+    bool locked;
+    esp_err_t err = command_dispatcher_lock_module(&s_motor_module,
+                                                   CONFIG_COMMAND_DISPATCHER_PRIORITY_LOCK_TIMEOUT_MS, &locked);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "等待电机命令执行完毕超时 (%s)", esp_err_to_name(err));
+        if (percent != 0) {
+            return err;
+        }
+    }
+    if (percent == 0) {
+        if (s_direction != MOTOR_DIR_STOP || s_speed != 0) {
+            motor_stop_action();
+        }
+    } else {
+        if (s_speed != percent) {
+            motor_set_speed(percent);
+        }
+        if (s_direction != MOTOR_DIR_FORWARD) {
+            motor_set_direction(MOTOR_DIR_FORWARD);
+        }
+    }
+    command_dispatcher_unlock_module(&s_motor_module, locked);
+    return ESP_OK;
+}
+
 // 设置蒸汽电机的方向和速度
 //feng  0 停止 1 前进 2 后退 3 刹车
 void set_steam_motor(motor_direction_t direction, uint8_t speed)
@@ -3,14 +3,36 @@
 #include <string.h>  
 #include "dht.h"  
 #include "command_dispatcher.h"  
+#include "status_registry.h"
 #include "uart_service.h"  
 #include "driver/gpio.h"  
+#include "sdkconfig.h"
 
 
 static const char *TAG = "DHT22_SENSOR";  
 #define SENSOR_GPIO_PIN GPIO_NUM_40
 
-static void sensor_command_handler(const char *command, size_t len);  
+static esp_err_t sensor_command_handler(const command_args_t *args);
+static status_field_t s_temp_field = -1;     // 状态字段 "temp"，每次读取成功时更新
+static status_field_t s_humidity_field = -1; // 状态字段 "humidity"
+
+enum {
+    SENSOR_VERB_GET_TEMP_HUMI,
+};
+
+static const command_verb_t s_sensor_verbs[] = {
+    { "get_temp_humi", SENSOR_VERB_GET_TEMP_HUMI },
+};
+
+static const command_module_t s_sensor_module = {
+    .prefix     = "sensor",
+    .handler    = sensor_command_handler,
+    .verbs      = s_sensor_verbs,
+    .verb_count = sizeof(s_sensor_verbs) / sizeof(s_sensor_verbs[0]),
+    // 单总线读取耗时数十毫秒，放到独立队列中执行
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+    .overflow    = COMMAND_OVERFLOW_DROP_NEWEST,
+};
 
 esp_err_t dht22_sensor_init(void) {  
     ESP_LOGI(TAG, "正在初始化 DHT22 传感器 (GPIO %d)...", SENSOR_GPIO_PIN);  
@@ -18,7 +40,10 @@ esp_err_t dht22_sensor_init(void) {
     ESP_LOGI(TAG, "重置 GPIO %d 以确保禁用内部上拉/下拉...", SENSOR_GPIO_PIN);  
     gpio_reset_pin(SENSOR_GPIO_PIN);  
 
-    esp_err_t err = command_dispatcher_register("sensor", sensor_command_handler);  
+    s_temp_field = status_field_register("temp", STATUS_FIELD_FLOAT);
+    s_humidity_field = status_field_register("humidity", STATUS_FIELD_FLOAT);
+
+    esp_err_t err = command_dispatcher_register(&s_sensor_module);  
     if (err != ESP_OK) {  
         ESP_LOGE(TAG, "注册 'sensor' 命令失败!");  
         return err;  
@@ -28,10 +53,8 @@ esp_err_t dht22_sensor_init(void) {
     return ESP_OK;  
 }  
 
-static void sensor_command_handler(const char *command, size_t len) {  
-    const char *sub_command = command + strlen("sensor:");  
-
-    if (strncmp(sub_command, "get_temp_humi", strlen("get_temp_humi")) == 0) {  
+static esp_err_t sensor_command_handler(const command_args_t *args) {
+    if (args->verb_id == SENSOR_VERB_GET_TEMP_HUMI) {
         ESP_LOGI(TAG, "收到温湿度读取请求...");  
 
         float temperature = 0;  
@@ -47,6 +70,8 @@ static void sensor_command_handler(const char *command, size_t len) {
         char status_buffer[64];  
         if (ret == ESP_OK) {  
             ESP_LOGI(TAG, "读取成功 -> 温度: %.1f°C, 湿度: %.1f%%", temperature, humidity);  
+            status_field_set_float(s_temp_field, temperature);
+            status_field_set_float(s_humidity_field, humidity);
             snprintf(status_buffer, sizeof(status_buffer),   
                      "STATUS:TEMP_HUMI:%.1f:%.1f", temperature, humidity);  
         } else {  
@@ -54,6 +79,8 @@ static void sensor_command_handler(const char *command, size_t len) {
             snprintf(status_buffer, sizeof(status_buffer), "STATUS:TEMP_HUMI_ERROR");  
         }  
         
-        uart_service_send_line(status_buffer);  
-    }  
+        command_dispatcher_reply(args, status_buffer);  
+        return ret;
+    }
+    return ESP_ERR_NOT_SUPPORTED;
 }  
\ No newline at end of file
@@ -7,11 +7,13 @@
 #include "ds18b20.h"
 #include "driver/gpio.h"
 #include "command_dispatcher.h"
+#include "status_registry.h"
 #include "uart_service.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 #include "freertos/semphr.h"
+#include "sdkconfig.h"
 
 static const char *TAG = "DS18B20_MANAGER";
 #define FAILURE_THRESHOLD 5
@@ -27,26 +29,46 @@ typedef enum {
 typedef struct {
     const char* name;
     const gpio_num_t pin;
+    const char* field_name;   // 状态字段名，每次读取成功时更新
 } known_sensor_t;
 
 static const known_sensor_t known_sensors[SENSOR_COUNT] = {
-    [SENSOR_1] = {"sensor_1", GPIO_NUM_39},
-    [SENSOR_2] = {"sensor_2", GPIO_NUM_2},
-    [SENSOR_3] = {"sensor_3", GPIO_NUM_5},
+    [SENSOR_1] = {"sensor_1", GPIO_NUM_39, "ds18b20_1"},
+    [SENSOR_2] = {"sensor_2", GPIO_NUM_2,  "ds18b20_2"},
+    [SENSOR_3] = {"sensor_3", GPIO_NUM_5,  "ds18b20_3"},
 };
 
 static onewire_bus_handle_t bus_handles[SENSOR_COUNT] = {NULL};
 static ds18b20_device_handle_t ds18b20_devices[SENSOR_COUNT] = {NULL};
 static int consecutive_failures[SENSOR_COUNT] = {0};
+static status_field_t status_fields[SENSOR_COUNT] = {-1, -1, -1};
 static TimerHandle_t recovery_timer_handle = NULL;
 static SemaphoreHandle_t ds18b20_mutex = NULL;
 
-static void ds18b20_command_handler(const char *command, size_t len);
+static esp_err_t ds18b20_command_handler(const command_args_t *args);
 static esp_err_t ds18b20_init_single_device(sensor_id_t id);
 static void recovery_timer_callback(TimerHandle_t xTimer);
 static void start_recovery_mode_if_needed(void);
 static void stop_recovery_mode_if_all_ok(void);
 
+enum {
+    DS18B20_VERB_GET_TEMP,
+};
+
+static const command_verb_t s_ds18b20_verbs[] = {
+    { "get_temp", DS18B20_VERB_GET_TEMP },
+};
+
+static const command_module_t s_ds18b20_module = {
+    .prefix     = "ds18b20",
+    .handler    = ds18b20_command_handler,
+    .verbs      = s_ds18b20_verbs,
+    .verb_count = sizeof(s_ds18b20_verbs) / sizeof(s_ds18b20_verbs[0]),
+    // 一次读取需要等待约 800ms 的温度转换，放到独立队列中执行
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+    .overflow    = COMMAND_OVERFLOW_DROP_NEWEST,
+};
+
 static esp_err_t ds18b20_init_single_device(sensor_id_t id)
 {
     if (id >= SENSOR_COUNT) return ESP_ERR_INVALID_ARG;
@@ -142,6 +164,7 @@ esp_err_t ds18b20_manager_init(void)
     int online_count = 0;
     xSemaphoreTake(ds18b20_mutex, portMAX_DELAY);
     for (int i = 0; i < SENSOR_COUNT; i++) {
+        status_fields[i] = status_field_register(known_sensors[i].field_name, STATUS_FIELD_FLOAT);
         if (ds18b20_init_single_device((sensor_id_t)i) == ESP_OK) {
             ESP_LOGI(TAG, "传感器 '%s' (GPIO %d) 初始化成功。", known_sensors[i].name, known_sensors[i].pin);
             online_count++;
@@ -152,7 +175,7 @@ esp_err_t ds18b20_manager_init(void)
     }
     
     ESP_LOGI(TAG, "DS18B20 管理器初始化完成, %d/%d 个设备在线。", online_count, SENSOR_COUNT);
-    command_dispatcher_register("ds18b20", ds18b20_command_handler);
+    command_dispatcher_register(&s_ds18b20_module);
     
     if (online_count < SENSOR_COUNT) {
         start_recovery_mode_if_needed();
@@ -162,19 +185,22 @@ esp_err_t ds18b20_manager_init(void)
     return ESP_OK;
 }
 
-static void ds18b20_command_handler(const char *command, size_t len)
+static esp_err_t ds18b20_command_handler(const command_args_t *args)
 {
-    const char *sub_command = command + strlen("ds18b20:");
     char status_buffer[64];
     
-    if (strncmp(sub_command, "get_temp:", 9) == 0) {
+    if (args->verb_id == DS18B20_VERB_GET_TEMP) {
         char sensor_name[16];
-        if (sscanf(sub_command + 9, "%15s", sensor_name) != 1) return;
+        if (args->argc < 1 || args->argv[0].len == 0 || args->argv[0].len >= sizeof(sensor_name)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        memcpy(sensor_name, command_args_str(args, 0), args->argv[0].len);
+        sensor_name[args->argv[0].len] = '\0';
 
         if (xSemaphoreTake(ds18b20_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
             snprintf(status_buffer, sizeof(status_buffer), "STATUS:DS18B20_ERROR:BUSY");
-            uart_service_send_line(status_buffer);
-            return;
+            command_dispatcher_reply(args, status_buffer);
+            return ESP_ERR_TIMEOUT;
         }
 
         sensor_id_t target_id = -1;
@@ -187,17 +213,17 @@ static void ds18b20_command_handler(const char *command, size_t len)
 
         if (target_id == -1) {
              snprintf(status_buffer, sizeof(status_buffer), "STATUS:DS18B20_ERROR:UNKNOWN_NAME:%s", sensor_name);
-             uart_service_send_line(status_buffer);
+             command_dispatcher_reply(args, status_buffer);
              xSemaphoreGive(ds18b20_mutex);
-             return;
+             return ESP_ERR_NOT_FOUND;
         }
 
         if (ds18b20_devices[target_id] == NULL) {
             snprintf(status_buffer, sizeof(status_buffer), "STATUS:DS18B20_ERROR:OFFLINE:%s", sensor_name);
-            uart_service_send_line(status_buffer);
+            command_dispatcher_reply(args, status_buffer);
             start_recovery_mode_if_needed();
             xSemaphoreGive(ds18b20_mutex);
-            return;
+            return ESP_ERR_INVALID_STATE;
         }
 
         ds18b20_device_handle_t current_device = ds18b20_devices[target_id];
@@ -211,13 +237,14 @@ static void ds18b20_command_handler(const char *command, size_t len)
 
         if (ret == ESP_OK) {
             consecutive_failures[target_id] = 0;
+            status_field_set_float(status_fields[target_id], temperature);
             snprintf(status_buffer, sizeof(status_buffer), "STATUS:DS18B20_TEMP:%s:%.2f", sensor_name, temperature);
         } else {
             consecutive_failures[target_id]++;
             snprintf(status_buffer, sizeof(status_buffer), "STATUS:DS18B20_ERROR:READ_FAIL:%s", sensor_name);
         }
 
-        uart_service_send_line(status_buffer);
+        command_dispatcher_reply(args, status_buffer);
 
         if (consecutive_failures[target_id] >= FAILURE_THRESHOLD) {
             ESP_LOGE(TAG, "传感器 '%s' 连续失败 %d 次, 认定已断开。", sensor_name, FAILURE_THRESHOLD);
@@ -229,5 +256,7 @@ static void ds18b20_command_handler(const char *command, size_t len)
         }
         
         xSemaphoreGive(ds18b20_mutex);
+        return ret;
     }
+    return ESP_ERR_NOT_SUPPORTED;
 }
\ No newline at end of file
@@ -3,9 +3,13 @@
 #include "esp_log.h"  
 #include <stdlib.h>  
 #include <string.h>  
+#include <stdio.h>  
 
+#include "actuator.h"
 #include "command_dispatcher.h"  
+#include "status_registry.h"
 #include "uart_service.h"  
+#include "sdkconfig.h"  
 
 static const char *TAG = "FAN_CONTROLLER";  
 
@@ -16,7 +20,38 @@ static const char *TAG = "FAN_CONTROLLER";
 #define FAN_PWM_FREQUENCY_HZ    25000  
 #define FAN_LEDC_RESOLUTION     LEDC_TIMER_10_BIT  
 
-void fan_command_handler(const char *command, size_t len);  
+static int32_t s_speed_percentage = 0; // 当前转速百分比
+static status_field_t s_fan_field = -1; // 状态字段 "fan"
+
+static esp_err_t fan_command_handler(const command_args_t *args);
+static bool fan_snapshot(const command_args_t *args, char *restore, size_t size);
+static esp_err_t fan_set_speed(const command_args_t *args, int32_t speed_percentage);
+static esp_err_t fan_actuator_set_pwm(uint8_t percent);
+
+// "fan:NN" 直接跟速度百分比，没有子命令
+enum {
+    FAN_VERB_SET_SPEED,
+};
+
+static const command_verb_t s_fan_verbs[] = {
+    { "", FAN_VERB_SET_SPEED, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_COALESCE },
+};
+
+static const command_module_t s_fan_module = {
+    .prefix     = "fan",
+    .handler    = fan_command_handler,
+    .verbs      = s_fan_verbs,
+    .verb_count = sizeof(s_fan_verbs) / sizeof(s_fan_verbs[0]),
+    // 滑条拖动时转速命令很密集，入队后由分发器合并，只执行最新的转速
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+    .snapshot    = fan_snapshot,
+};
+
+static const actuator_ops_t s_fan_actuator = {
+    .id      = ACTUATOR_FAN,
+    .name    = "fan",
+    .set_pwm = fan_actuator_set_pwm,
+};
 
 /**  
  * @brief 初始化风扇控制器  
@@ -45,38 +80,81 @@ esp_err_t fan_controller_init(void) {
     ESP_ERROR_CHECK(ledc_channel_config(&ledc_channel));  
     ESP_LOGI(TAG, "风扇硬件初始化完成，使用GPIO %d", FAN_PWM_PIN);  
 
+    s_fan_field = status_field_register("fan", STATUS_FIELD_INT);
+
     ESP_LOGI(TAG, "正在向命令分发中心注册 'fan' 命令...");  
-    esp_err_t err = command_dispatcher_register("fan", fan_command_handler);  
+    esp_err_t err = command_dispatcher_register(&s_fan_module);  
     if (err != ESP_OK) {  
         ESP_LOGE(TAG, "注册 'fan' 命令失败!");  
         return err;  
     }  
 
+    err = actuator_register(&s_fan_actuator);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "注册风扇执行器失败: %s", esp_err_to_name(err));
+        return err;
+    }
+
     return ESP_OK;  
 }  
 
-void fan_command_handler(const char *command, size_t len)  
-{  
-    ESP_LOGI(TAG, "收到分发中心转发来的风扇命令: %.*s", len, command);  
+static esp_err_t fan_command_handler(const command_args_t *args)
+{
+    ESP_LOGI(TAG, "收到分发中心转发来的风扇命令: %s", args->line);
+
+    int32_t speed_percentage = 0;
+    if (!command_args_int(args, 0, &speed_percentage)) {
+        ESP_LOGW(TAG, "风扇速度参数无效: %s", args->line);
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    const char *sub_command = command + strlen("fan:");  
-    int speed_percentage = atoi(sub_command);  
+    return fan_set_speed(args, speed_percentage);
+}  
 
+/**
+ * @brief 设置风扇转速并回复 "STATUS:FAN_SPEED_SET:<n>"
+ * @param args 回复的目标命令，NULL 表示主动上报
+ */
+static esp_err_t fan_set_speed(const command_args_t *args, int32_t speed_percentage)
+{
     if (speed_percentage < 0) {  
         speed_percentage = 0;  
     } else if (speed_percentage > 100) {  
         speed_percentage = 100;  
     }  
 
-    ESP_LOGI(TAG, "执行风扇调速操作，速度设置为: %d%%", speed_percentage);  
+    ESP_LOGI(TAG, "执行风扇调速操作，速度设置为: %d%%", (int)speed_percentage);  
 
     uint32_t max_duty = (1 << FAN_LEDC_RESOLUTION) - 1;  
     uint32_t duty = (speed_percentage * max_duty) / 100;  
 
     ESP_ERROR_CHECK(ledc_set_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL, duty));  
     ESP_ERROR_CHECK(ledc_update_duty(FAN_LEDC_MODE, FAN_LEDC_CHANNEL));  
+    s_speed_percentage = speed_percentage;
+    status_field_set_int(s_fan_field, speed_percentage);
  
     char status_buffer[32];  
-    snprintf(status_buffer, sizeof(status_buffer), "STATUS:FAN_SPEED_SET:%d", speed_percentage);  
-    uart_service_send_line(status_buffer);  
-}  
\ No newline at end of file
+    snprintf(status_buffer, sizeof(status_buffer), "STATUS:FAN_SPEED_SET:%d", (int)speed_percentage);
+    command_dispatcher_reply(args, status_buffer);
+    return ESP_OK;
+}
+
+/**
+ * @brief 风扇执行器: 与 "fan:<n>" 相同的动作，转速变化时才上报
+ */
+static esp_err_t fan_actuator_set_pwm(uint8_t percent)
+{
+    if (percent == s_speed_percentage) {
+        return ESP_OK;
+    }
+    return fan_set_speed(NULL, percent);
+}
+
+/**
+ * @brief 批量命令回滚: 记录恢复到当前转速的命令
+ */
+static bool fan_snapshot(const command_args_t *args, char *restore, size_t size)
+{
+    snprintf(restore, size, "fan:%d", (int)s_speed_percentage);
+    return true;
+}
@@ -4,9 +4,14 @@
 #include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"   
+#include "freertos/semphr.h"
+#include "actuator.h"
 #include "command_dispatcher.h"
+#include "command_timer.h"
+#include "status_registry.h"
 #include "uart_service.h"
 #include "driver/gpio.h"  
+#include "sdkconfig.h"
 #include "dc_motor_control.h"
 #include "water_level_sensor_module.h"
 // #include "steam_valve_module.h"
@@ -19,33 +24,61 @@
 static const char *TAG = "FUNCTION_CONTROLLER";
 static bool s_is_initialized = false;
 
-static TaskHandle_t s_steam_monitor_task_handle = NULL; 
-
-// --- 外部组件的命令处理器声明 ---
-extern void relay_command_handler(const char *command, size_t len);
-extern void fan_command_handler(const char *command, size_t len);
-extern void stepper_command_handler(const char *command, size_t len);
-extern void relay_two_command_handler(const char *command, size_t len);
-extern void motor_command_handler(const char *command, size_t len);
-extern void valve_command_handler(const char *command, size_t len);
+static command_timer_handle_t s_steam_timer = 0; // 蒸汽水位监控的定时命令，0 表示未运行
+// 水位监控在定时任务中运行，启动命令在调用者的任务中运行，停止命令在分发器的高优先级任务中运行，
+// 几者可能在不同核上同时执行；s_steam_timer 的检查和修改都在互斥锁内，保证不会重复启动，
+// 停止之后也不会再打开加热或水泵
+static SemaphoreHandle_t s_steam_lock = NULL;
+static status_field_t s_steam_field = -1; // 状态字段 "steam": 蒸汽除皱是否在运行
 
 // extern bool water_level_is_reached(void); // 直接获取水位状态
 
 
 // --- 本模块的功能函数声明 ---
-static void function_command_handler(const char *command, size_t len);
-static void execute_drying_sequence(void);
-static void start_steam_wrinkle_function(void);
-static void stop_steam_wrinkle_function(void);
-static void steam_level_monitor_task(void *pvParameters); // FreeRTOS 任务函数
+static esp_err_t function_command_handler(const command_args_t *args);
+static void run_command(const char *command);
+static void execute_drying_sequence(const command_args_t *args);
+static void start_steam_wrinkle_function(const command_args_t *args);
+static void stop_steam_wrinkle_function(const command_args_t *args);
+static void enter_failsafe(const command_args_t *args);
+static void steam_level_monitor_tick(void);
+static void steam_set_actuator(actuator_id_t id, bool on);
 static void steam_gulugulu_task(void *pvParameters);
 static void steam_screen_key_task_handle(void *pvParameters);
 
+enum {
+    FUNCTION_VERB_START_DRYING,
+    FUNCTION_VERB_START_STEAM,
+    FUNCTION_VERB_STOP_STEAM,
+    FUNCTION_VERB_STEAM_TICK,
+    FUNCTION_VERB_FAILSAFE,
+};
+
+static const command_verb_t s_function_verbs[] = {
+    { "start_drying", FUNCTION_VERB_START_DRYING },
+    { "start_steam",  FUNCTION_VERB_START_STEAM },
+    { "stop_steam",   FUNCTION_VERB_STOP_STEAM,   COMMAND_PRIORITY_HIGH },
+    { "steam_tick",   FUNCTION_VERB_STEAM_TICK }, // 内部使用，由定时命令触发
+    { "failsafe",     FUNCTION_VERB_FAILSAFE,     COMMAND_PRIORITY_HIGH },
+};
+
+static const command_module_t s_function_module = {
+    .prefix     = CONTROLLER_COMMAND_PREFIX,
+    .handler    = function_command_handler,
+    .verbs      = s_function_verbs,
+    .verb_count = sizeof(s_function_verbs) / sizeof(s_function_verbs[0]),
+};
+
 esp_err_t function_controller_init(void) {
     // ... (初始化函数保持不变) ...
     if (s_is_initialized) return ESP_OK;
     ESP_LOGI(TAG, "正在初始化功能控制器...");
-    esp_err_t ret = command_dispatcher_register(CONTROLLER_COMMAND_PREFIX, function_command_handler);
+    s_steam_lock = xSemaphoreCreateMutex();
+    if (s_steam_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_steam_field = status_field_register("steam", STATUS_FIELD_BOOL);
+    esp_err_t ret = command_dispatcher_register(&s_function_module);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "注册 '%s' 命令处理器失败!", CONTROLLER_COMMAND_PREFIX);
         return ret;
@@ -56,153 +89,203 @@ esp_err_t function_controller_init(void) {
     return ESP_OK;
 }
 
-static void function_command_handler(const char *command, size_t len) {
-    if (!s_is_initialized) return;
-
-    const char *sub_command = command + strlen(CONTROLLER_COMMAND_PREFIX) + 1;
+static esp_err_t function_command_handler(const command_args_t *args) {
+    if (!s_is_initialized) return ESP_ERR_INVALID_STATE;
 
-    if (strncmp(sub_command, "start_drying", strlen("start_drying")) == 0) {
-        execute_drying_sequence();
-    } 
-    else if (strncmp(sub_command, "start_steam", strlen("start_steam")) == 0) {
-        start_steam_wrinkle_function();
-    }
+    switch (args->verb_id) {
+    case FUNCTION_VERB_START_DRYING:
+        execute_drying_sequence(args);
+        break;
+    case FUNCTION_VERB_START_STEAM:
+        start_steam_wrinkle_function(args);
+        break;
     // 新增：处理停止命令
-    else if (strncmp(sub_command, "stop_steam", strlen("stop_steam")) == 0) {
-        stop_steam_wrinkle_function();
-    }
-    else {
-        ESP_LOGW(TAG, "未知的功能命令: %s", sub_command);
+    case FUNCTION_VERB_STOP_STEAM:
+        stop_steam_wrinkle_function(args);
+        break;
+    case FUNCTION_VERB_STEAM_TICK:
+        steam_level_monitor_tick();
+        break;
+    case FUNCTION_VERB_FAILSAFE:
+        enter_failsafe(args);
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    return ESP_OK;
+}
+
+/**
+ * @brief 通过命令分发中心执行一条其它模块的命令
+ */
+static void run_command(const char *command) {
+    command_dispatcher_forward(command, strlen(command));
 }
 
-static void execute_drying_sequence(void) {
+static void execute_drying_sequence(const command_args_t *args) {
     // ... (烘干功能保持不变) ...
     ESP_LOGI(TAG, "===== 开始执行烘干流程 =====");
-    char command_buffer[32];
-    snprintf(command_buffer, sizeof(command_buffer), "fan:75");
-    fan_command_handler(command_buffer, strlen(command_buffer));
-    snprintf(command_buffer, sizeof(command_buffer), "relay:on");
-    relay_command_handler(command_buffer, strlen(command_buffer));
-    snprintf(command_buffer, sizeof(command_buffer), "stepper:open"); 
-    stepper_command_handler(command_buffer, strlen(command_buffer));
+    // 三个执行器作为一个整体启动，任一步失败则整体回滚，只回复一帧汇总状态
+    run_command("batch:fan:75;relay:on;stepper:open");
     ESP_LOGI(TAG, "===== 烘干流程所有启动指令已发出 =====");
-    uart_service_send_line("STATUS:FUNCTION_DRYING_STARTED");
+    command_dispatcher_reply(args, "STATUS:FUNCTION_DRYING_STARTED");
 }
 
 /**
  * @brief 启动蒸汽除皱功能
  * - 检查是否已在运行
  * - 启动风扇
- * - 创建后台任务来监控和控制水位与加热
+ * - 创建定时命令来监控和控制水位与加热
  */
-static void start_steam_wrinkle_function(void) {
-    if (s_steam_monitor_task_handle != NULL) {
+static void start_steam_wrinkle_function(const command_args_t *args) {
+    xSemaphoreTake(s_steam_lock, portMAX_DELAY);
+    if (s_steam_timer != 0) {
+        xSemaphoreGive(s_steam_lock);
         ESP_LOGW(TAG, "蒸汽除皱功能已在运行中，请先停止。");
-        uart_service_send_line("ERROR:STEAM_FUNCTION_ALREADY_RUNNING");
+        command_dispatcher_reply(args, "ERROR:STEAM_FUNCTION_ALREADY_RUNNING");
         return;
     }
 
     ESP_LOGI(TAG, "===== 启动蒸汽除皱功能 =====");
-    char command_buffer[32];
 
     // 步骤 1: 开启风扇 (如果需要的话)
     ESP_LOGI(TAG, "步骤: 启动风扇至50%%...");
-    snprintf(command_buffer, sizeof(command_buffer), "fan:50");
-    fan_command_handler(command_buffer, strlen(command_buffer));
-
-    // 步骤 2: 创建后台监控任务
-    xTaskCreate(steam_level_monitor_task,      // 任务函数
-                "steam_monitor_task",          // 任务名
-                4096,                          // 任务栈大小 (bytes)
-                NULL,                          // 传递给任务的参数
-                5,                             // 任务优先级
-                &s_steam_monitor_task_handle); // 任务句柄
-
-    uart_service_send_line("STATUS:FUNCTION_STEAM_STARTED");
+    actuator_set_pwm(ACTUATOR_FAN, 50);
+
+    // 步骤 2: 创建周期性的水位监控 (立即开始第一次检查)
+    esp_err_t err = command_timer_schedule(NULL, 0, WATER_LEVEL_CHECK_INTERVAL_MS,
+                                           CONTROLLER_COMMAND_PREFIX ":steam_tick", &s_steam_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "创建水位监控定时命令失败: %s", esp_err_to_name(err));
+        s_steam_timer = 0;
+        xSemaphoreGive(s_steam_lock);
+        command_dispatcher_reply(args, "ERROR:STEAM_FUNCTION_START_FAILED");
+        return;
+    }
+    xSemaphoreGive(s_steam_lock);
+
+    status_field_set_bool(s_steam_field, true);
+    command_dispatcher_reply(args, "STATUS:FUNCTION_STEAM_STARTED");
 }
 
 /**
  * @brief 停止蒸汽除皱功能
  * - 停止加热（关闭继电器）
  * - 停止加水（关闭电机和电磁阀）
- * - 安全地删除后台监控任务
+ * - 取消水位监控定时命令
  */
-static void stop_steam_wrinkle_function(void) {
-    if (s_steam_monitor_task_handle == NULL) {
+static void stop_steam_wrinkle_function(const command_args_t *args) {
+    xSemaphoreTake(s_steam_lock, portMAX_DELAY);
+    if (s_steam_timer == 0) {
+        xSemaphoreGive(s_steam_lock);
         ESP_LOGW(TAG, "蒸汽除皱功能未在运行。");
-        uart_service_send_line("ERROR:STEAM_FUNCTION_NOT_RUNNING");
+        command_dispatcher_reply(args, "ERROR:STEAM_FUNCTION_NOT_RUNNING");
         return;
     }
-    
+
     ESP_LOGI(TAG, "===== 正在停止蒸汽除皱功能 =====");
-    char command_buffer[32];
+
+    // 步骤 0: 先停止水位监控，避免之后再次打开加热或水泵
+    command_timer_cancel(s_steam_timer);
+    s_steam_timer = 0;
 
     // 步骤 1: 确保加热器关闭
     ESP_LOGI(TAG, "步骤: 关闭加热器 (relay)...");
-    snprintf(command_buffer, sizeof(command_buffer), "relay:off");
-    relay_command_handler(command_buffer, strlen(command_buffer));
+    steam_set_actuator(ACTUATOR_HEATER, false);
 
     // 步骤 2: 确保水泵停止
-    ESP_LOGI(TAG, "步骤: 关闭蒸汽泵电机...");
-    snprintf(command_buffer, sizeof(command_buffer), "motor:stop");
-    motor_command_handler(command_buffer, strlen(command_buffer));
-    
-    ESP_LOGI(TAG, "步骤: 关闭蒸汽电磁阀...");
-    snprintf(command_buffer, sizeof(command_buffer), "valve:close");
-    valve_command_handler(command_buffer, strlen(command_buffer));
-
-    // 步骤 3: 删除监控任务
-    ESP_LOGI(TAG, "步骤: 删除后台监控任务...");
-    vTaskDelete(s_steam_monitor_task_handle);
-    s_steam_monitor_task_handle = NULL; // 将句柄清空，表示任务已停止
+    ESP_LOGI(TAG, "步骤: 关闭蒸汽泵电机和蒸汽电磁阀...");
+    steam_set_actuator(ACTUATOR_PUMP, false);
+    steam_set_actuator(ACTUATOR_VALVE, false);
+
+    xSemaphoreGive(s_steam_lock);
+    status_field_set_bool(s_steam_field, false);
 
     ESP_LOGI(TAG, "===== 蒸汽除皱功能已停止 =====");
-    uart_service_send_line("STATUS:FUNCTION_STEAM_STOPPED");
+    command_dispatcher_reply(args, "STATUS:FUNCTION_STEAM_STOPPED");
 }
 
 
 /**
- * @brief [FreeRTOS Task] 蒸汽水位监控与控制任务
- *        这是一个闭环控制的核心。
+ * @brief 进入安全状态，例如与屏幕的串口断线时 (高优先级通道执行)
+ * - 先关闭加热器，不等待任何锁
+ * - 停止蒸汽除皱 (取消水位监控，关闭水泵和电磁阀)
+ * - 可选关闭风扇，再执行 CONFIG_FUNCTION_FAILSAFE_COMMANDS 中的命令
+ * 运行中的流程不会自动恢复，需要重新启动。
  */
-static void steam_level_monitor_task(void *pvParameters) {
-    ESP_LOGI(TAG, "后台任务启动：开始监控水位。");
-    char command_buffer[32];
-    bool is_heating = false; // 初始状态为不加热
-    // 任务主循环
-    for (;;) {
-    
-        int level_reached = get_water_level();
-
-        if (level_reached) {    //水位到达情况
-            //停止进水
-            snprintf(command_buffer, sizeof(command_buffer), "motor:stop");
-            motor_command_handler(command_buffer, strlen(command_buffer));
-            //关闭电磁阀
-            snprintf(command_buffer, sizeof(command_buffer), "valve:close");
-            valve_command_handler(command_buffer, strlen(command_buffer));
-            //打开继电器    
-            snprintf(command_buffer, sizeof(command_buffer), "relay:on");
-            relay_command_handler(command_buffer, strlen(command_buffer));
-            is_heating = true; // 更新状态
-            uart_service_send_line("STATUS:STEAM_HEATING_ON");
-        }else {     //--- 水位不足 ---
-            ESP_LOGI(TAG, "水位过低，停止加热并开始加水。");
-                // 1. 停止加热
-            snprintf(command_buffer, sizeof(command_buffer), "relay:off");
-            relay_command_handler(command_buffer, strlen(command_buffer));
-            is_heating = false; // 更新状态
-            uart_service_send_line("STATUS:STEAM_HEATING_OFF");
-            // 2. 开始加水 (持续指令，即使之前已经发过)
-            snprintf(command_buffer, sizeof(command_buffer), "motor:speed:100");
-            motor_command_handler(command_buffer, strlen(command_buffer));
-            snprintf(command_buffer, sizeof(command_buffer), "motor:forward");
-            motor_command_handler(command_buffer, strlen(command_buffer));
-            snprintf(command_buffer, sizeof(command_buffer), "valve:open");
-            valve_command_handler(command_buffer, strlen(command_buffer));
+static void enter_failsafe(const command_args_t *args) {
+    steam_set_actuator(ACTUATOR_HEATER, false);
+
+    xSemaphoreTake(s_steam_lock, portMAX_DELAY);
+    if (s_steam_timer != 0) {
+        command_timer_cancel(s_steam_timer);
+        s_steam_timer = 0;
+    }
+    // 水位监控可能在上面关闭加热器之后、取消之前又打开了它
+    steam_set_actuator(ACTUATOR_HEATER, false);
+    steam_set_actuator(ACTUATOR_PUMP, false);
+    steam_set_actuator(ACTUATOR_VALVE, false);
+    xSemaphoreGive(s_steam_lock);
+    status_field_set_bool(s_steam_field, false);
+
+#if CONFIG_FUNCTION_FAILSAFE_FAN_OFF
+    actuator_set_pwm(ACTUATOR_FAN, 0);
+#endif
+
+    // 额外的安全命令，以 ';' 分隔
+    const char *cmd = CONFIG_FUNCTION_FAILSAFE_COMMANDS;
+    while (*cmd != '\0') {
+        const char *end = strchr(cmd, ';');
+        size_t len = end ? (size_t)(end - cmd) : strlen(cmd);
+        if (len > 0) {
+            command_dispatcher_forward(cmd, len);
         }
-        // 延时，避免过于频繁地检查，给系统其他任务运行的机会
-        vTaskDelay(pdMS_TO_TICKS(WATER_LEVEL_CHECK_INTERVAL_MS));
+        cmd += len + (end ? 1 : 0);
+    }
+
+    ESP_LOGW(TAG, "===== 已进入安全状态 =====");
+    command_dispatcher_reply(args, "STATUS:FUNCTION_FAILSAFE");
+}
+
+/**
+ * @brief 蒸汽水位监控与控制，由定时命令 "function:steam_tick" 每 WATER_LEVEL_CHECK_INTERVAL_MS 调用一次
+ *        这是一个闭环控制的核心。
+ *        加热、水泵、电磁阀和水位的变化由各模块的状态字段上报，这里不再每次发送状态。
+ */
+static void steam_level_monitor_tick(void) {
+    xSemaphoreTake(s_steam_lock, portMAX_DELAY);
+
+    // 已经停止，忽略停止之前就已到期的最后一次
+    if (s_steam_timer == 0) {
+        xSemaphoreGive(s_steam_lock);
+        return;
+    }
+
+    int level_reached = get_water_level();
+
+    if (level_reached) {    //水位到达情况
+        //停止进水、关闭电磁阀、打开继电器
+        steam_set_actuator(ACTUATOR_PUMP, false);
+        steam_set_actuator(ACTUATOR_VALVE, false);
+        steam_set_actuator(ACTUATOR_HEATER, true);
+    }else {     //--- 水位不足 ---
+        ESP_LOGD(TAG, "水位过低，停止加热并开始加水。");
+            // 1. 停止加热
+        steam_set_actuator(ACTUATOR_HEATER, false);
+        // 2. 开始加水 (每次都设置，执行器状态未变时不操作)
+        steam_set_actuator(ACTUATOR_PUMP, true);
+        steam_set_actuator(ACTUATOR_VALVE, true);
+    }
+
+    xSemaphoreGive(s_steam_lock);
+}
+
+/**
+ * @brief 直接控制蒸汽除皱用到的执行器，失败只记录日志，下一次水位检查会重新设置
+ */
+static void steam_set_actuator(actuator_id_t id, bool on) {
+    esp_err_t err = actuator_set(id, on);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "设置执行器 %d -> %s 失败: %s", id, on ? "ON" : "OFF", esp_err_to_name(err));
     }
 }
@@ -10,7 +10,24 @@ static const char *TAG = "LED_CONTROLLER";
 
 static led_strip_handle_t s_led_strip_handle = NULL;  
 
-static void led_command_handler(const char *command, size_t len);  
+static esp_err_t led_command_handler(const command_args_t *args);
+
+enum {
+    LED_VERB_ON,
+    LED_VERB_OFF,
+};
+
+static const command_verb_t s_led_verbs[] = {
+    { "on",  LED_VERB_ON },
+    { "off", LED_VERB_OFF },
+};
+
+static const command_module_t s_led_module = {
+    .prefix     = "led",
+    .handler    = led_command_handler,
+    .verbs      = s_led_verbs,
+    .verb_count = sizeof(s_led_verbs) / sizeof(s_led_verbs[0]),
+};
 
 
 esp_err_t led_controller_init(void) {  
@@ -28,7 +45,7 @@ esp_err_t led_controller_init(void) {
     ESP_LOGI(TAG, "LED硬件初始化完成");  
 
     ESP_LOGI(TAG, "正在向命令分发中心注册 'led' 命令...");  
-    esp_err_t err = command_dispatcher_register("led", led_command_handler);  
+    esp_err_t err = command_dispatcher_register(&s_led_module);  
     if (err != ESP_OK) {  
         ESP_LOGE(TAG, "注册 'led' 命令失败!");  
         return err;  
@@ -37,28 +54,28 @@ esp_err_t led_controller_init(void) {
     return ESP_OK;  
 }  
  
-static void led_command_handler(const char *command, size_t len)  
-{  
-    ESP_LOGI(TAG, "收到分发中心转发来的LED命令: %.*s", len, command);  
+static esp_err_t led_command_handler(const command_args_t *args)
+{
+    ESP_LOGI(TAG, "收到分发中心转发来的LED命令: %s", args->line);
 
-    const char *sub_command = command + strlen("led:"); 
-
-    if (strncmp(sub_command, "on", 2) == 0) {  
-        ESP_LOGI(TAG, "执行开灯操作 (绿色)");  
-        if (s_led_strip_handle) {  
-            led_strip_set_pixel(s_led_strip_handle, 0, 0, 255, 0);  
-            led_strip_refresh(s_led_strip_handle);  
-            uart_service_send_line("STATUS:LED_ON");
-        }  
-    }   
-    else if (strncmp(sub_command, "off", 3) == 0) {  
-        ESP_LOGI(TAG, "执行关灯操作");  
-        if (s_led_strip_handle) {  
-            led_strip_clear(s_led_strip_handle);  
-            uart_service_send_line("STATUS:LED_OFF");
-        }  
-    }  
-    else {  
-        ESP_LOGW(TAG, "未知的LED子命令: %s", sub_command);  
-    }  
-}  
\ No newline at end of file
+    switch (args->verb_id) {
+    case LED_VERB_ON:
+        ESP_LOGI(TAG, "执行开灯操作 (绿色)");
+        if (s_led_strip_handle) {
+            led_strip_set_pixel(s_led_strip_handle, 0, 0, 255, 0);
+            led_strip_refresh(s_led_strip_handle);
+            command_dispatcher_reply(args, "STATUS:LED_ON");
+        }
+        break;
+    case LED_VERB_OFF:
+        ESP_LOGI(TAG, "执行关灯操作");
+        if (s_led_strip_handle) {
+            led_strip_clear(s_led_strip_handle);
+            command_dispatcher_reply(args, "STATUS:LED_OFF");
+        }
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
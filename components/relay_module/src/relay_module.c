@@ -2,8 +2,11 @@
 #include "esp_log.h"  
 #include "driver/gpio.h"  
 #include <string.h>  
+#include <stdio.h>  
 
+#include "actuator.h"
 #include "command_dispatcher.h"  
+#include "status_registry.h"
 #include "uart_service.h"  
 
 // --- 配置宏定义 ---  
@@ -17,11 +20,42 @@
 static const char *TAG = "RELAY_MODULE";  
 static bool s_is_initialized = false;  
 static bool s_current_state = RELAY_INITIAL_STATE; // 继电器的逻辑状态 (true=ON, false=OFF)  
+static status_field_t s_heater_field = -1;         // 状态字段 "heater": 是否在加热
 
 // --- 功能函数声明 ---  
-void relay_command_handler(const char *command, size_t len);  
+static esp_err_t relay_command_handler(const command_args_t *args);
 void relay_set_state_action(bool state);  
-static void send_status_update(void);  
+static void send_status_update(const command_args_t *args);  
+static bool relay_snapshot(const command_args_t *args, char *restore, size_t size);
+static esp_err_t relay_actuator_set(bool on);
+
+enum {
+    RELAY_VERB_ON,
+    RELAY_VERB_OFF,
+    RELAY_VERB_TOGGLE,
+    RELAY_VERB_STATUS,
+};
+
+static const command_verb_t s_relay_verbs[] = {
+    { "on",     RELAY_VERB_ON },
+    { "off",    RELAY_VERB_OFF,    COMMAND_PRIORITY_HIGH },
+    { "toggle", RELAY_VERB_TOGGLE },
+    { "status", RELAY_VERB_STATUS },
+};
+
+static const command_module_t s_relay_module = {
+    .prefix     = RELAY_COMMAND_PREFIX,
+    .handler    = relay_command_handler,
+    .verbs      = s_relay_verbs,
+    .verb_count = sizeof(s_relay_verbs) / sizeof(s_relay_verbs[0]),
+    .snapshot   = relay_snapshot,
+};
+
+static const actuator_ops_t s_relay_actuator = {
+    .id   = ACTUATOR_HEATER,
+    .name = RELAY_COMMAND_PREFIX,
+    .set  = relay_actuator_set,
+};
 
 
 esp_err_t relay_module_init(void)  
@@ -50,7 +84,7 @@ esp_err_t relay_module_init(void)
     gpio_set_drive_capability(RELAY_GPIO_NUM, GPIO_DRIVE_CAP_3);  
 
     // 2. 注册命令处理器  
-    ret = command_dispatcher_register(RELAY_COMMAND_PREFIX, relay_command_handler);  
+    ret = command_dispatcher_register(&s_relay_module);  
     if (ret != ESP_OK) {  
         ESP_LOGE(TAG, "注册 '%s' 命令失败!", RELAY_COMMAND_PREFIX);  
         gpio_reset_pin(RELAY_GPIO_NUM); // 注册失败时重置GPIO  
@@ -58,8 +92,16 @@ esp_err_t relay_module_init(void)
     }  
     
     // 3. 设置初始状态  
+    s_heater_field = status_field_register("heater", STATUS_FIELD_BOOL);
     relay_set_state_action(RELAY_INITIAL_STATE);  
     s_is_initialized = true;  
+
+    // 4. 注册为加热执行器，供内部控制流程直接调用
+    ret = actuator_register(&s_relay_actuator);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "注册加热执行器失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
     ESP_LOGI(TAG, "继电器模块初始化完成。GPIO:%d, ActiveLevel:%s",   
              RELAY_GPIO_NUM, RELAY_ACTIVE_LEVEL ? "HIGH" : "LOW");  
@@ -69,37 +111,36 @@ esp_err_t relay_module_init(void)
 /**  
  * @brief 命令处理器，处理所有 "relay:" 前缀的命令  
  */  
-void relay_command_handler(const char *command, size_t len)  
-{  
-    if (!s_is_initialized) {  
-        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %.*s", (int)len, command);  
-        return;  
-    }  
-
-    const char *sub_command = command + strlen(RELAY_COMMAND_PREFIX) + 1;
+static esp_err_t relay_command_handler(const command_args_t *args)
+{
+    if (!s_is_initialized) {
+        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %s", args->line);
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    if (strncmp(sub_command, "on", strlen("on")) == 0) {  
+    switch (args->verb_id) {
+    case RELAY_VERB_ON:
         relay_set_state_action(false);
-        ESP_LOGI(TAG, "执行继电器开操作");  
-    }   
-    else if (strncmp(sub_command, "off", strlen("off")) == 0) {  
-        relay_set_state_action(true);  
-        ESP_LOGI(TAG, "执行继电器关操作");  
-    }  
-    else if (strncmp(sub_command, "toggle", strlen("toggle")) == 0) {  
-        relay_set_state_action(!s_current_state);  
-    }  
-    else if (strncmp(sub_command, "status", strlen("status")) == 0) {  
-        // 状态在每次动作后自动发送，这里无需额外操作  
-    }  
-    else {  
-        ESP_LOGW(TAG, "未知的继电器子命令: %s", sub_command);  
-        return; // 未知命令不发送状态  
-    }  
-    
-    // 每次有效动作后，都发送一次最新状态  
-    send_status_update();  
-}  
+        ESP_LOGI(TAG, "执行继电器开操作");
+        break;
+    case RELAY_VERB_OFF:
+        relay_set_state_action(true);
+        ESP_LOGI(TAG, "执行继电器关操作");
+        break;
+    case RELAY_VERB_TOGGLE:
+        relay_set_state_action(!s_current_state);
+        break;
+    case RELAY_VERB_STATUS:
+        // 状态在每次动作后自动发送，这里无需额外操作
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED; // 未知命令不发送状态
+    }
+
+    // 每次有效动作后，都发送一次最新状态
+    send_status_update(args);
+    return ESP_OK;
+}
 
 /**  
  * @brief 执行设置继电器状态的动作  
@@ -115,6 +156,7 @@ void relay_set_state_action(bool state)
     
     gpio_set_level(RELAY_GPIO_NUM, gpio_level);  
     s_current_state = state;  
+    status_field_set_bool(s_heater_field, !state); // "relay:on" 对应的逻辑状态为 false
     
     ESP_LOGI(TAG, "设置继电器状态 -> %s. (GPIO%d 输出电平: %d)",   
              state ? "ON" : "OFF", RELAY_GPIO_NUM, gpio_level);  
@@ -124,15 +166,40 @@ void relay_set_state_action(bool state)
 /**  
  * @brief 发送当前状态到UART  
  */  
-static void send_status_update(void)  
+static void send_status_update(const command_args_t *args)  
 {  
     if (s_current_state) {  
-        uart_service_send_line("STATUS:RELAY_ON");  
+        command_dispatcher_reply(args, "STATUS:RELAY_ON");  
     } else {  
-        uart_service_send_line("STATUS:RELAY_OFF");  
+        command_dispatcher_reply(args, "STATUS:RELAY_OFF");  
     }  
 }  
 
+/**  
+ * @brief 批量命令回滚: 记录恢复到当前继电器状态的命令  
+ * @note  "relay:on" 对应的逻辑状态为 false，见 relay_command_handler  
+ */  
+static bool relay_snapshot(const command_args_t *args, char *restore, size_t size)  
+{  
+    snprintf(restore, size, "relay:%s", s_current_state ? "off" : "on");  
+    return true;  
+}  
+
+/**  
+ * @brief 加热执行器: 与 "relay:on" / "relay:off" 相同的动作，状态变化时才上报  
+ * @note  "relay:on" 对应的逻辑状态为 false，见 relay_command_handler  
+ */  
+static esp_err_t relay_actuator_set(bool on)  
+{  
+    bool state = !on;
+    if (state == s_current_state) {
+        return ESP_OK;
+    }
+    relay_set_state_action(state);
+    send_status_update(NULL);
+    return ESP_OK;
+}  
+
 //feng
 void relay_set_state_steam(int8_t state)  
 {  
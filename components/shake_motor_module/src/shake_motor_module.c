@@ -32,10 +32,31 @@ static bool s_current_state = false; // 震动电机状态 (true=ON, false=OFF)
 static uint8_t s_current_speed = 0; // 当前速度百分比 (0-100)
 
 esp_err_t shake_motor_module_init(void);
-void shake_motor_command_handler(const char *command, size_t len);
+static esp_err_t shake_motor_command_handler(const command_args_t *args);
 static esp_err_t shake_motor_set(bool enable);
 static esp_err_t shake_motor_set_speed(uint8_t speed_percentage);
 
+enum {
+    SHAKE_VERB_START,
+    SHAKE_VERB_OFF,
+    SHAKE_VERB_SPEED,
+    SHAKE_VERB_GET_ENCODER,
+};
+
+static const command_verb_t s_shake_verbs[] = {
+    { "start",       SHAKE_VERB_START },
+    { "off",         SHAKE_VERB_OFF },
+    { "speed",       SHAKE_VERB_SPEED },
+    { "get_encoder", SHAKE_VERB_GET_ENCODER },
+};
+
+static const command_module_t s_shake_module = {
+    .prefix     = "shake",
+    .handler    = shake_motor_command_handler,
+    .verbs      = s_shake_verbs,
+    .verb_count = sizeof(s_shake_verbs) / sizeof(s_shake_verbs[0]),
+};
+
 
 static void IRAM_ATTR encoder_isr_handler(void* arg) {
     if (gpio_get_level(ENCODER_A) == gpio_get_level(ENCODER_B)) {
@@ -90,7 +111,7 @@ esp_err_t shake_motor_module_init(void){
         //ESP_LOGI(TAG, "中断服务已安装");
     //}
     //gpio_isr_handler_add(ENCODER_A, encoder_isr_handler, NULL);
-    ESP_ERROR_CHECK(command_dispatcher_register("shake", shake_motor_command_handler));
+    ESP_ERROR_CHECK(command_dispatcher_register(&s_shake_module));
     s_is_initialized = true;
     ESP_LOGI(TAG, "摆动电机模块初始化完成");
     return ESP_OK;
@@ -100,25 +121,32 @@ long get_position(void) {
     return atomic_load(&encoder_pos);
 }
 
-void shake_motor_command_handler(const char *command, size_t len) {
+static esp_err_t shake_motor_command_handler(const command_args_t *args) {
     if (!s_is_initialized) {
         ESP_LOGE(TAG, "模块未初始化");
-        return;
+        return ESP_ERR_INVALID_STATE;
     }
 
-    const char *sub_command = command + strlen("shake:");
+    int32_t speed = 0;
 
-    if (strncmp(sub_command, "start", strlen("start")) == 0) {
+    switch (args->verb_id) {
+    case SHAKE_VERB_START:
         shake_motor_set(true);
         ESP_LOGI(TAG, "摆动电机已启动");
-    } else if (strncmp(sub_command, "off", strlen("off")) == 0) {
+        break;
+    case SHAKE_VERB_OFF:
         shake_motor_set(false);
         ESP_LOGI(TAG, "摆动电机已关闭");
-    } else if (strncmp(sub_command, "speed", strlen("speed")) == 0) {
-        uint8_t speed = atoi(sub_command + strlen("speed"));
-        shake_motor_set_speed(speed);
-        ESP_LOGI(TAG, "摆动电机速度已设置为: %d%%", speed);
-    } else if (strncmp(sub_command, "get_encoder", strlen("get_encoder")) == 0) {
+        break;
+    case SHAKE_VERB_SPEED:
+        if (!command_args_int(args, 0, &speed) || speed < 0) {
+            ESP_LOGW(TAG, "速度参数无效: %s", args->line);
+            return ESP_ERR_INVALID_ARG;
+        }
+        shake_motor_set_speed(speed > 100 ? 100 : (uint8_t)speed);
+        ESP_LOGI(TAG, "摆动电机速度已设置为: %d%%", (int)speed);
+        break;
+    case SHAKE_VERB_GET_ENCODER: {
         //long position = get_position();
         //char position_buffer[40];
         //snprintf(position_buffer, sizeof(position_buffer), "STATUS:ENCODER:%ld", position);
@@ -126,9 +154,12 @@ void shake_motor_command_handler(const char *command, size_t len) {
         int a = gpio_get_level(ENCODER_A);
         int b = gpio_get_level(ENCODER_B);
         ESP_LOGI(TAG, "编码器变化: A=%d, B=%d", a, b);
-    } else {
-        ESP_LOGW(TAG, "未知命令: %.*s", len, command);
+        break;
+    }
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    return ESP_OK;
 }   
 
 
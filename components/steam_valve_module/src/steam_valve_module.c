@@ -2,8 +2,11 @@
 #include "esp_log.h"
 #include "driver/gpio.h"
 #include <string.h>
+#include <stdio.h>
 
+#include "actuator.h"
 #include "command_dispatcher.h"
+#include "status_registry.h"
 #include "uart_service.h"
 
 // --- 配置宏定义 ---
@@ -18,11 +21,40 @@
 static const char *TAG = "STEAM_VALVE_MODULE";
 static bool s_is_initialized = false;
 static bool s_is_open = false; // 电磁阀的逻辑状态 (true=OPEN, false=CLOSE)
+static status_field_t s_valve_field = -1; // 状态字段 "valve"
 
 // --- 内部功能函数声明 ---
-void valve_command_handler(const char *command, size_t len);
+static esp_err_t valve_command_handler(const command_args_t *args);
 static void valve_set_state_action(bool is_open);
-static void send_status_update(void);
+static void send_status_update(const command_args_t *args);
+static bool valve_snapshot(const command_args_t *args, char *restore, size_t size);
+static esp_err_t valve_actuator_set(bool is_open);
+
+enum {
+    VALVE_VERB_OPEN,
+    VALVE_VERB_CLOSE,
+    VALVE_VERB_STATUS,
+};
+
+static const command_verb_t s_valve_verbs[] = {
+    { "open",   VALVE_VERB_OPEN },
+    { "close",  VALVE_VERB_CLOSE,  COMMAND_PRIORITY_HIGH },
+    { "status", VALVE_VERB_STATUS },
+};
+
+static const command_module_t s_valve_module = {
+    .prefix     = VALVE_COMMAND_PREFIX,
+    .handler    = valve_command_handler,
+    .verbs      = s_valve_verbs,
+    .verb_count = sizeof(s_valve_verbs) / sizeof(s_valve_verbs[0]),
+    .snapshot   = valve_snapshot,
+};
+
+static const actuator_ops_t s_valve_actuator = {
+    .id   = ACTUATOR_VALVE,
+    .name = VALVE_COMMAND_PREFIX,
+    .set  = valve_actuator_set,
+};
 
 
 /**
@@ -51,7 +83,7 @@ esp_err_t steam_valve_module_init(void)
     }
 
     // 2. 注册命令处理器
-    ret = command_dispatcher_register(VALVE_COMMAND_PREFIX, valve_command_handler);
+    ret = command_dispatcher_register(&s_valve_module);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "注册 '%s' 命令失败!", VALVE_COMMAND_PREFIX);
         gpio_reset_pin(VALVE_PIN1_GPIO);
@@ -60,8 +92,16 @@ esp_err_t steam_valve_module_init(void)
     }
     
     // 3. 设置初始为关闭状态
+    s_valve_field = status_field_register("valve", STATUS_FIELD_BOOL);
     valve_set_state_action(false);
     s_is_initialized = true;
+
+    // 4. 注册为电磁阀执行器，供内部控制流程直接调用
+    ret = actuator_register(&s_valve_actuator);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "注册电磁阀执行器失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
     ESP_LOGI(TAG, "蒸汽电磁阀模块初始化完成。Pin1:%d, Pin2:%d", VALVE_PIN1_GPIO, VALVE_PIN2_GPIO);
     return ESP_OK;
@@ -70,26 +110,25 @@ esp_err_t steam_valve_module_init(void)
 /**
  * @brief 命令处理器，处理所有 "valve:" 前缀的命令
  */
-void valve_command_handler(const char *command, size_t len)
+static esp_err_t valve_command_handler(const command_args_t *args)
 {
-    if (!s_is_initialized) return;
-
-    const char *sub_command = command + strlen(VALVE_COMMAND_PREFIX) + 1; 
+    if (!s_is_initialized) return ESP_ERR_INVALID_STATE;
 
-    if (strncmp(sub_command, "open", strlen("open")) == 0) {
+    switch (args->verb_id) {
+    case VALVE_VERB_OPEN:
         valve_set_state_action(true);
-    } 
-    else if (strncmp(sub_command, "close", strlen("close")) == 0) {
+        break;
+    case VALVE_VERB_CLOSE:
         valve_set_state_action(false);
-    }
-    else if (strncmp(sub_command, "status", strlen("status")) == 0) {
-    }
-    else {
-        ESP_LOGW(TAG, "未知的电磁阀子命令: %s", sub_command);
-        return;
+        break;
+    case VALVE_VERB_STATUS:
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
     
-    send_status_update();
+    send_status_update(args);
+    return ESP_OK;
 }
 
 /**
@@ -110,21 +149,44 @@ static void valve_set_state_action(bool is_open)
         ESP_LOGI(TAG, "设置电磁阀状态 -> CLOSE (Pin1=0, Pin2=0)");
     }
     s_is_open = is_open;
+    status_field_set_bool(s_valve_field, is_open);
 }
 
 
 /**
  * @brief 发送当前状态到UART
  */
-static void send_status_update(void)
+static void send_status_update(const command_args_t *args)
 {
     if (s_is_open) {
-        uart_service_send_line("STATUS:VALVE_OPEN");
+        command_dispatcher_reply(args, "STATUS:VALVE_OPEN");
     } else {
-        uart_service_send_line("STATUS:VALVE_CLOSED");
+        command_dispatcher_reply(args, "STATUS:VALVE_CLOSED");
     }
 }
 
+/**
+ * @brief 批量命令回滚: 记录恢复到当前电磁阀状态的命令
+ */
+static bool valve_snapshot(const command_args_t *args, char *restore, size_t size)
+{
+    snprintf(restore, size, "valve:%s", s_is_open ? "open" : "close");
+    return true;
+}
+
+/**
+ * @brief 电磁阀执行器: 与 "valve:open" / "valve:close" 相同的动作，状态变化时才上报
+ */
+static esp_err_t valve_actuator_set(bool is_open)
+{
+    if (is_open == s_is_open) {
+        return ESP_OK;
+    }
+    valve_set_state_action(is_open);
+    send_status_update(NULL);
+    return ESP_OK;
+}
+
 //feng
 void set_steam_valve(bool is_open)
 {
@@ -133,5 +195,5 @@ void set_steam_valve(bool is_open)
         return;
     }
     valve_set_state_action(is_open);
-    send_status_update();
+    send_status_update(NULL);
 }
\ No newline at end of file
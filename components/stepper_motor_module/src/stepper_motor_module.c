@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include "command_dispatcher.h"
 #include "uart_service.h"
+#include "sdkconfig.h"
 
 // GPIO引脚定义
 #define STEPPER_IN1_GPIO         9 
@@ -30,12 +31,33 @@ static const uint8_t step_sequence_forward[4][4] = { {1,0,0,1}, {0,1,0,1}, {0,1,
 static const uint8_t step_sequence_reverse[4][4] = { {1,0,1,0}, {0,1,1,0}, {0,1,0,1}, {1,0,0,1} };
 
 
-void stepper_command_handler(const char *command, size_t len);
+static esp_err_t stepper_command_handler(const command_args_t *args);
 static void move_to_absolute_position(int target_steps);
 static void apply_step(const uint8_t step_pattern[4]);
 static void turn_off_coils(void);
-static void send_status_update(void);
-
+static void send_status_update(const command_args_t *args);
+
+enum {
+    STEPPER_VERB_OPEN,
+    STEPPER_VERB_CLOSE,
+    STEPPER_VERB_STATUS,
+};
+
+static const command_verb_t s_stepper_verbs[] = {
+    { "open",   STEPPER_VERB_OPEN },
+    { "close",  STEPPER_VERB_CLOSE },
+    { "status", STEPPER_VERB_STATUS },
+};
+
+static const command_module_t s_stepper_module = {
+    .prefix     = STEPPER_COMMAND_PREFIX,
+    .handler    = stepper_command_handler,
+    .verbs      = s_stepper_verbs,
+    .verb_count = sizeof(s_stepper_verbs) / sizeof(s_stepper_verbs[0]),
+    // 一次开/关需要走 40 步 x 10ms，放到独立队列中执行；积压时只保留最新的动作
+    .queue_depth = CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH,
+    .overflow    = COMMAND_OVERFLOW_DROP_OLDEST,
+};
 
 esp_err_t stepper_motor_module_init(void) {
     if (s_is_initialized) {
@@ -62,7 +84,7 @@ esp_err_t stepper_motor_module_init(void) {
     turn_off_coils();
 
     // 2. 注册命令处理器
-    ret = command_dispatcher_register(STEPPER_COMMAND_PREFIX, stepper_command_handler);
+    ret = command_dispatcher_register(&s_stepper_module);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "注册 '%s' 命令失败!", STEPPER_COMMAND_PREFIX);
         return ret;
@@ -80,28 +102,28 @@ int stepper_motor_get_current_position(void) {
     return s_valve_current_steps;
 }
 
-void stepper_command_handler(const char *command, size_t len) {
+static esp_err_t stepper_command_handler(const command_args_t *args) {
     if (!s_is_initialized) {
-        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %s", command);
-        return;
+        ESP_LOGE(TAG, "模块未初始化，无法处理命令: %s", args->line);
+        return ESP_ERR_INVALID_STATE;
     }
-    const char *sub_command = command + strlen(STEPPER_COMMAND_PREFIX);
-    if (*sub_command == ':') sub_command++;
 
-    if (strncmp(sub_command, "open", strlen("open")) == 0) {
+    switch (args->verb_id) {
+    case STEPPER_VERB_OPEN:
         // move_to_absolute_position(VALVE_MAX_STEPS);
         stepper_motor_direction(OPEN, 40);
-    } 
-    else if (strncmp(sub_command, "close", strlen("close")) == 0) {
+        break;
+    case STEPPER_VERB_CLOSE:
         // move_to_absolute_position(VALVE_MIN_STEPS);
         stepper_motor_direction(CLOSE, 40);
+        break;
+    case STEPPER_VERB_STATUS:
+        send_status_update(args);
+        break;
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    else if (strncmp(sub_command, "status", strlen("status")) == 0) {
-        send_status_update();
-    }
-    else {
-        ESP_LOGW(TAG, "未知的阀门命令: %s. (可用: open, close, status)", sub_command);
-    }
+    return ESP_OK;
 }
 
 static void move_to_absolute_position(int target_steps) {
@@ -113,7 +135,7 @@ static void move_to_absolute_position(int target_steps) {
 
     if (target_steps == s_valve_current_steps) {
         ESP_LOGI(TAG, "已在目标位置，无需移动。");
-        send_status_update();
+        send_status_update(NULL);
         return;
     }
     // 步骤2: 判断方向和计算步数
@@ -133,7 +155,7 @@ static void move_to_absolute_position(int target_steps) {
     // 步骤4: 脱机并报告状态
     turn_off_coils();
     ESP_LOGI(TAG, "移动完成, 当前位置: %d", s_valve_current_steps);
-    send_status_update();
+    send_status_update(NULL);
 }
 
 
@@ -153,7 +175,7 @@ static void turn_off_coils() {
 }
 
 
-static void send_status_update(void) {
+static void send_status_update(const command_args_t *args) {
     char status_str[128];
     char position_desc[32];
 
@@ -169,7 +191,7 @@ static void send_status_update(void) {
              "STATUS:VALVE,Position:%d,State:%s",
              s_valve_current_steps, position_desc);
     
-    uart_service_send_line(status_str);
+    command_dispatcher_reply(args, status_str);
 }
 
 void stepper_motor_direction(stepper_motordirection_t direction, int steps) {
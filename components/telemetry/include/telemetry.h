@@ -0,0 +1,70 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief 发布一条遥测消息，由 main 接到 MQTT
+ *
+ * @param subtopic "telemetry" (CBOR 批次)、"telemetry/lz4" (压缩的批次) 或 "telemetry/schema" (字段表，应保留)
+ * @return 未连接等原因发布失败时返回错误，样本留在缓冲中下次再发
+ */
+typedef esp_err_t (*telemetry_publish_t)(const char *subtopic, const uint8_t *data, size_t len, bool retain);
+
+/**
+ * @brief 初始化遥测
+ *
+ * 作为 status_registry 的观察者记录所有状态字段 (传感器和执行器) 的每次变化，
+ * 样本存入环形缓冲，每 CONFIG_TELEMETRY_INTERVAL_MS 打包成一个 CBOR 批次发布
+ * (格式见 telemetry_batch.h)；缓冲用到 3/4 时提前发布。
+ * 开启 CONFIG_TELEMETRY_STORE 且有对应的数据分区时，批次先写入 flash 队列 (telemetry_store.h)，
+ * 断线期间在 flash 中累积，重新连接后按顺序、按 CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC 限速重放；
+ * 批次序号重启后继续递增，可用于去重。
+ * 同时注册 "telemetry" 命令:
+ *   "telemetry:flush"  立即发布缓冲中的样本
+ *   "telemetry:stats"  回复 "STATUS:TELEMETRY:samples=..,batches=..,bytes=..,bytes_per_sample=..,publishes_per_min=..,..."
+ * 须在 command_dispatcher_init 之后调用。
+ */
+esp_err_t telemetry_init(void);
+
+/**
+ * @brief 设置发布函数；未设置时样本只在缓冲中累积
+ */
+void telemetry_set_publisher(telemetry_publish_t publish);
+
+/**
+ * @brief 下一批重新发布字段表并带上全部字段的快照，并立即恢复重放 (MQTT 重新连接后调用)
+ */
+void telemetry_resync(void);
+
+/**
+ * @brief 立即发布缓冲中的样本 (在遥测任务中进行)
+ */
+void telemetry_flush(void);
+
+/**
+ * @brief 遥测统计
+ */
+typedef struct {
+    uint32_t samples;      // 已发布的样本数
+    uint32_t batches;      // 已发布的批次数
+    uint32_t publishes;    // 发布次数 (批次 + 字段表)
+    uint32_t bytes;        // 已发布的批次字节数 (压缩后)
+    uint32_t raw_bytes;    // 压缩前的批次字节数
+    uint32_t pending;      // 缓冲中等待发布的样本数
+    uint32_t dropped;      // 缓冲满时丢弃的样本数
+    uint32_t failed;       // 发布失败次数
+    uint32_t backlog;      // flash 队列中等待发布的批次数
+    uint32_t lost;         // flash 队列写满时未发布就被覆盖的批次数
+    uint32_t uptime_s;     // 遥测启动以来的秒数，用于换算每分钟发布次数
+} telemetry_stats_t;
+
+/**
+ * @brief 读取遥测统计
+ */
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#endif // TELEMETRY_H
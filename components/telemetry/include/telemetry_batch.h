@@ -0,0 +1,71 @@
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief 遥测批次的编码 (CBOR, RFC 8949)，与 FreeRTOS 无关，主机上也可编译
+ *
+ * 批次是一个以小整数为键的 map:
+ *   0: 批次序号，每发布一批加一 (接收方据此发现丢失的批次)
+ *   1: t0，第一个样本的时间 (启动以来的 ms)；没有样本时为快照时间
+ *   2: 字段数 (与字段表对应，字段表变化时接收方需重新读取)
+ *   3: 样本，扁平数组 [dt, 字段, 值, dt, 字段, 值, ...]，dt 为与上一样本 (第一个为 t0) 的时间差 ms
+ *   4: 自上一批以来因缓冲满而丢弃的样本数 (为 0 时省略)
+ *   5: 快照，全部字段的当前值 (可选)
+ *   6: 快照时间，与 t0 的差 ms (有快照时才有)
+ * 值均为原始整数: BOOL 为 0/1，FLOAT 以 0.1 为单位。
+ *
+ * 字段表也是一个 map: 0: 字段数，1: [[名称, 类型], ...]，类型同 status_field_type_t (0 bool, 1 int, 2 float)。
+ */
+
+typedef struct {
+    uint32_t t_ms;     // 采样时间 (启动以来的 ms)
+    uint8_t  field;    // 字段编号
+    int32_t  value;    // 原始值
+} telemetry_sample_t;
+
+typedef struct {
+    uint32_t       seq;
+    uint32_t       field_count;
+    uint32_t       dropped;
+    const int32_t *snapshot;      // NULL 表示不带快照，否则为 field_count 个值
+    uint32_t       snapshot_ms;   // 快照时间 (启动以来的 ms)
+} telemetry_batch_header_t;
+
+// 一个样本编码后的最大长度: dt (uint32) + 字段 (uint8) + 值 (int32)
+#define TELEMETRY_SAMPLE_ENCODED_MAX (5 + 2 + 5)
+
+/**
+ * @brief 把尽可能多的样本编码成一个批次
+ *
+ * @param samples  按时间排列的样本
+ * @param count    样本数
+ * @param buf      输出缓冲
+ * @param size     缓冲大小
+ * @param out_len  编码后的长度，缓冲连头部都放不下时为 0
+ * @return 编入批次的样本数 (从 samples[0] 开始)，其余样本留给下一批
+ */
+size_t telemetry_batch_encode(const telemetry_batch_header_t *header, const telemetry_sample_t *samples, size_t count,
+                              uint8_t *buf, size_t size, size_t *out_len);
+
+/**
+ * @brief 编码字段表
+ *
+ * @param names  字段名
+ * @param types  字段类型 (status_field_type_t)
+ * @return 编码后的长度，缓冲不够时为 0
+ */
+size_t telemetry_schema_encode(const char *const *names, const uint8_t *types, size_t count, uint8_t *buf, size_t size);
+
+/**
+ * @brief LZ4 块格式压缩 (前面带 4 字节小端的原始长度，与 python lz4.block.decompress 的默认格式相同)
+ *
+ * 只用于较大的批次；输入不超过 64 KiB。
+ * @return 压缩后的长度；结果不比原文短或 dst 放不下时返回 0，此时应发送原文
+ */
+size_t telemetry_lz4_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap);
+
+#endif // TELEMETRY_BATCH_H
@@ -0,0 +1,78 @@
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief 遥测批次的 flash 存储转发队列 (只在遥测任务中调用)
+ *
+ * 专用数据分区按 4 KiB 扇区组成环形的只追加日志:
+ *   扇区头 16 字节: 魔数、扇区序号 (每启用一个新扇区加一)、擦除次数、CRC
+ *   记录:          16 字节头 (长度、类型、id、CRC、状态) + 负载，按 4 字节对齐，不跨扇区
+ * 发送成功后只把记录头的状态字清零 (flash 允许 1 -> 0 的写入)，不擦除；
+ * 写满时擦除最旧的扇区，其中尚未发送的记录计为丢失。扇区按顺序轮流擦除，磨损均匀，
+ * 擦除次数保存在扇区头中。掉电后启动时扫描全部扇区，写了一半的记录因 CRC 不符被跳过。
+ * 不支持 flash 加密 (加密后无法原地清零状态字)。
+ */
+
+typedef struct {
+    uint32_t sectors;        // 分区的扇区数
+    uint32_t pending;        // 等待发送的记录数
+    uint32_t pending_bytes;  // 等待发送的记录占用的 flash 字节数
+    uint32_t appended;       // 本次启动以来写入的记录数
+    uint32_t sent;           // 本次启动以来发送的记录数
+    uint32_t lost;           // 未发送就被新记录覆盖的记录数
+    uint32_t corrupt;        // CRC 不符而跳过的记录数 (掉电时写了一半等)
+    uint32_t erase_max;      // 单个扇区的最大擦除次数
+    uint32_t erase_total;    // 全部扇区的擦除次数之和
+} telemetry_store_stats_t;
+
+/**
+ * @brief 打开分区并从 flash 恢复队列；分区为空或不是本格式时格式化
+ *
+ * @param label 数据分区的名称
+ * @return 找不到分区时返回 ESP_ERR_NOT_FOUND，此时其余函数均返回错误
+ */
+esp_err_t telemetry_store_init(const char *label);
+
+/**
+ * @brief 队列是否可用
+ */
+bool telemetry_store_ready(void);
+
+/**
+ * @brief 下一条记录应使用的 id: 比 flash 中最后一条记录的 id 大一，重启后继续递增
+ */
+uint32_t telemetry_store_next_id(void);
+
+/**
+ * @brief 追加一条记录
+ *
+ * @param id    记录 id，应单调递增 (接收方据此去重)
+ * @param kind  记录类型 (由调用方定义，例如发布的主题)
+ * @return 负载超过一个扇区时返回 ESP_ERR_INVALID_SIZE
+ */
+esp_err_t telemetry_store_append(uint32_t id, uint8_t kind, const uint8_t *data, size_t len);
+
+/**
+ * @brief 读取最旧的未发送记录 (不移出队列)
+ *
+ * 损坏的记录被跳过，超过 size 的记录标记为已发送并计入 lost。
+ * @return 队列为空时返回 ESP_ERR_NOT_FOUND
+ */
+esp_err_t telemetry_store_peek(uint32_t *id, uint8_t *kind, uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief 把 telemetry_store_peek 读出的记录标记为已发送
+ */
+esp_err_t telemetry_store_consume(void);
+
+/**
+ * @brief 读取队列统计
+ */
+void telemetry_store_get_stats(telemetry_store_stats_t *stats);
+
+#endif // TELEMETRY_STORE_H
@@ -0,0 +1,426 @@
+#include "esp_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "command_dispatcher.h"
+#include "status_registry.h"
+#include "telemetry.h"
+#include "telemetry_batch.h"
+#include "telemetry_store.h"
+
+static const char *TAG = "TELEMETRY";
+
+#define RING_SIZE      (CONFIG_TELEMETRY_RING_SIZE)
+#define BATCH_MAX      (CONFIG_TELEMETRY_BATCH_MAX)
+#define INTERVAL_MS    (CONFIG_TELEMETRY_INTERVAL_MS)
+#define SNAPSHOT_EVERY (CONFIG_TELEMETRY_SNAPSHOT_EVERY)
+#define MAX_FIELDS     (CONFIG_STATUS_REGISTRY_MAX_FIELDS)
+#define TASK_STACK     (4096)
+#define TASK_PRIO      (CONFIG_TELEMETRY_TASK_PRIORITY)
+#define BATCH_SAMPLES  (RING_SIZE < BATCH_MAX / 3 ? RING_SIZE : BATCH_MAX / 3)  // 每个样本编码后至少 3 字节
+#define EARLY_FLUSH    (RING_SIZE * 3 / 4)
+#if CONFIG_TELEMETRY_STORE
+#define DRAIN_INTERVAL_MS (1000 / CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC)
+#endif
+
+_Static_assert((RING_SIZE & (RING_SIZE - 1)) == 0, "CONFIG_TELEMETRY_RING_SIZE must be a power of two");
+
+/*
+ * 环形缓冲以单调递增的序号记录样本，下标为序号 % RING_SIZE；
+ * 满时覆盖最旧的样本并计入丢弃数。发布 (或写入 flash 队列) 成功后才移动 tail，失败时样本留到下次。
+ *
+ * 有 flash 队列时每个批次先追加到队列，再由 telemetry_drain 按顺序发布，
+ * 批次序号即队列记录的 id，重启后继续递增，接收方据此去重。
+ */
+static telemetry_sample_t s_ring[RING_SIZE];
+static uint32_t s_ring_head;      // 下一个样本的序号
+static uint32_t s_ring_tail;      // 最旧样本的序号
+static uint32_t s_ring_dropped;   // 尚未在批次中报告的丢弃数
+static portMUX_TYPE s_ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t s_task = NULL;
+static volatile telemetry_publish_t s_publish = NULL;
+static atomic_bool s_resync = true;   // 启动后的第一批也带字段表和快照
+static int64_t s_start_us;
+
+// 以下只在遥测任务中使用
+static int s_schema_fields = -1;      // 最后发布的字段表的字段数
+static uint32_t s_seq;
+static uint32_t s_since_snapshot;
+static bool s_drain_blocked;          // 发布失败后暂停重放，到下一个周期或重新连接时再试
+static uint8_t s_buf[BATCH_MAX];
+#if CONFIG_TELEMETRY_COMPRESS
+static uint8_t s_lz4_buf[BATCH_MAX];
+#endif
+static telemetry_sample_t s_batch[BATCH_SAMPLES];
+
+static atomic_uint s_samples;
+static atomic_uint s_batches;
+static atomic_uint s_publishes;
+static atomic_uint s_bytes;
+static atomic_uint s_raw_bytes;
+static atomic_uint s_dropped;         // 已在批次中报告的丢弃数
+static atomic_uint s_failed;
+
+enum {
+    STORE_KIND_CBOR,
+    STORE_KIND_LZ4,
+};
+
+static const char *const s_kind_topics[] = {
+    [STORE_KIND_CBOR] = "telemetry",
+    [STORE_KIND_LZ4]  = "telemetry/lz4",
+};
+
+// status_registry 观察者，在写入字段的任务中调用
+static void telemetry_on_change(status_field_t field, int32_t value)
+{
+    bool wake;
+    taskENTER_CRITICAL(&s_ring_lock);
+    if (s_ring_head - s_ring_tail == RING_SIZE) {
+        s_ring_tail++;
+        s_ring_dropped++;
+    }
+    telemetry_sample_t *sample = &s_ring[s_ring_head % RING_SIZE];
+    sample->t_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    sample->field = (uint8_t)field;
+    sample->value = value;
+    s_ring_head++;
+    wake = (s_ring_head - s_ring_tail) == EARLY_FLUSH;
+    taskEXIT_CRITICAL(&s_ring_lock);
+
+    if (wake && s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+static esp_err_t telemetry_publish_schema(telemetry_publish_t publish, int fields)
+{
+    const char *names[MAX_FIELDS];
+    uint8_t types[MAX_FIELDS];
+    for (int f = 0; f < fields; f++) {
+        status_field_type_t type = STATUS_FIELD_INT;
+        status_field_get(f, &names[f], &type, NULL);
+        types[f] = (uint8_t)type;
+    }
+    size_t len = telemetry_schema_encode(names, types, fields, s_buf, sizeof(s_buf));
+    if (len == 0) {
+        ESP_LOGE(TAG, "字段表超过批次缓冲 (%d 字节)", BATCH_MAX);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = publish("telemetry/schema", s_buf, len, true);
+    if (err == ESP_OK) {
+        s_schema_fields = fields;
+        atomic_fetch_add(&s_publishes, 1);
+    }
+    return err;
+}
+
+/**
+ * @brief 把缓冲中的样本打包发布，一批放不下时连续发布多批
+ */
+static void telemetry_publish_pending(void)
+{
+    telemetry_publish_t publish = s_publish;
+    if (publish == NULL) {
+        return;
+    }
+    bool resync = atomic_exchange(&s_resync, false);
+    bool store = telemetry_store_ready();
+    int fields = status_field_count();
+    if (resync) {
+        s_schema_fields = -1;
+    }
+    if (fields != s_schema_fields && telemetry_publish_schema(publish, fields) != ESP_OK) {
+        // 有 flash 队列时照常打包，字段表在重新连接后发布
+        atomic_fetch_add(&s_failed, 1);
+        if (!store) {
+            atomic_store(&s_resync, resync);
+            return;
+        }
+    }
+    bool snapshot = resync || (SNAPSHOT_EVERY > 0 && s_since_snapshot + 1 >= SNAPSHOT_EVERY);
+
+    while (true) {
+        uint32_t first, dropped;
+        size_t count;
+        taskENTER_CRITICAL(&s_ring_lock);
+        first = s_ring_tail;
+        count = s_ring_head - s_ring_tail;
+        if (count > BATCH_SAMPLES) {
+            count = BATCH_SAMPLES;
+        }
+        for (size_t i = 0; i < count; i++) {
+            s_batch[i] = s_ring[(first + i) % RING_SIZE];
+        }
+        dropped = s_ring_dropped;
+        taskEXIT_CRITICAL(&s_ring_lock);
+
+        if (count == 0 && !snapshot) {
+            break;
+        }
+        int32_t values[MAX_FIELDS];
+        telemetry_batch_header_t header = {
+            .seq = s_seq,
+            .field_count = (uint32_t)fields,
+            .dropped = dropped,
+            .snapshot = snapshot ? values : NULL,
+            .snapshot_ms = (uint32_t)(esp_timer_get_time() / 1000),
+        };
+        for (int f = 0; snapshot && f < fields; f++) {
+            status_field_get(f, NULL, NULL, &values[f]);
+        }
+        size_t len;
+        size_t n = telemetry_batch_encode(&header, s_batch, count, s_buf, sizeof(s_buf), &len);
+        if (len == 0 || (n == 0 && count > 0)) {
+            ESP_LOGE(TAG, "批次缓冲 (%d 字节) 放不下批次头", BATCH_MAX);
+            break;
+        }
+
+        uint8_t kind = STORE_KIND_CBOR;
+        const uint8_t *data = s_buf;
+        size_t data_len = len;
+#if CONFIG_TELEMETRY_COMPRESS
+        size_t packed = telemetry_lz4_compress(s_buf, len, s_lz4_buf, sizeof(s_lz4_buf));
+        if (packed > 0) {
+            kind = STORE_KIND_LZ4;
+            data = s_lz4_buf;
+            data_len = packed;
+        }
+#endif
+        esp_err_t err = ESP_FAIL;
+        if (store) {
+            err = telemetry_store_append(s_seq, kind, data, data_len);
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "批次 %lu 写入 flash 队列失败 (%s)，直接发布", (unsigned long)s_seq, esp_err_to_name(err));
+            }
+        }
+        if (err != ESP_OK) {
+            err = publish(s_kind_topics[kind], data, data_len, false);
+            if (err == ESP_OK) {
+                atomic_fetch_add(&s_publishes, 1);
+                atomic_fetch_add(&s_bytes, data_len);
+            }
+        }
+        if (err != ESP_OK) {
+            atomic_fetch_add(&s_failed, 1);
+            if (resync) {
+                atomic_store(&s_resync, true);
+            }
+            break;
+        }
+
+        // 发布期间被覆盖的样本已经在本批中发出，不再算作丢弃
+        taskENTER_CRITICAL(&s_ring_lock);
+        uint32_t overlap = s_ring_tail - first;
+        if (overlap > n) {
+            overlap = (uint32_t)n;
+        }
+        s_ring_dropped -= dropped + overlap;
+        if ((int32_t)(first + n - s_ring_tail) > 0) {
+            s_ring_tail = first + n;
+        }
+        taskEXIT_CRITICAL(&s_ring_lock);
+
+        s_seq++;
+        s_since_snapshot = snapshot ? 0 : s_since_snapshot + 1;
+        snapshot = false;
+        resync = false;
+        atomic_fetch_add(&s_samples, n);
+        atomic_fetch_add(&s_batches, 1);
+        atomic_fetch_add(&s_raw_bytes, len);
+        atomic_fetch_add(&s_dropped, dropped);
+
+        if (n == count && count < BATCH_SAMPLES) {
+            break;
+        }
+    }
+}
+
+#if CONFIG_TELEMETRY_STORE
+/**
+ * @brief 按顺序发布 flash 队列中的一个批次
+ *
+ * @return 队列中还有批次等待发布时返回 true
+ */
+static bool telemetry_drain(void)
+{
+    telemetry_publish_t publish = s_publish;
+    if (!telemetry_store_ready() || publish == NULL || s_drain_blocked) {
+        return false;
+    }
+    uint32_t id;
+    uint8_t kind;
+    size_t len;
+    if (telemetry_store_peek(&id, &kind, s_buf, sizeof(s_buf), &len) != ESP_OK) {
+        return false;
+    }
+    const char *subtopic = kind < sizeof(s_kind_topics) / sizeof(s_kind_topics[0]) ? s_kind_topics[kind] : NULL;
+    if (subtopic != NULL) {
+        if (publish(subtopic, s_buf, len, false) != ESP_OK) {
+            atomic_fetch_add(&s_failed, 1);
+            s_drain_blocked = true;
+            return false;
+        }
+        atomic_fetch_add(&s_publishes, 1);
+        atomic_fetch_add(&s_bytes, len);
+    } else {
+        ESP_LOGW(TAG, "跳过未知类型 %u 的记录 %lu", kind, (unsigned long)id);
+    }
+    if (telemetry_store_consume() != ESP_OK) {
+        // 无法标记为已发送时停止重放，避免反复发布同一批次
+        ESP_LOGE(TAG, "标记批次 %lu 为已发送失败", (unsigned long)id);
+        s_drain_blocked = true;
+        return false;
+    }
+    telemetry_store_stats_t stats;
+    telemetry_store_get_stats(&stats);
+    return stats.pending > 0;
+}
+#endif
+
+static void telemetry_task(void *arg)
+{
+    const TickType_t interval = pdMS_TO_TICKS(INTERVAL_MS);
+    TickType_t next = xTaskGetTickCount() + interval;
+    bool notified = false;
+    while (1) {
+        TickType_t now = xTaskGetTickCount();
+        bool due = (int32_t)(next - now) <= 0;
+        if (due) {
+            // 按周期发布；落后太多时 (例如发布阻塞) 从现在重新计时
+            next += interval;
+            if ((int32_t)(next - now) <= 0) {
+                next = now + interval;
+            }
+        }
+        if (due || notified) {
+            s_drain_blocked = false;
+            telemetry_publish_pending();
+        }
+        TickType_t wait = next - now;
+#if CONFIG_TELEMETRY_STORE
+        // 积压的批次 (例如断线期间) 每 DRAIN_INTERVAL_MS 发布一个，重新连接后不会集中冲击服务器
+        if (telemetry_drain() && pdMS_TO_TICKS(DRAIN_INTERVAL_MS) < wait) {
+            wait = pdMS_TO_TICKS(DRAIN_INTERVAL_MS);
+        }
+#endif
+        notified = ulTaskNotifyTake(pdTRUE, wait) > 0;
+    }
+}
+
+// --- "telemetry" 命令 ---
+
+enum {
+    TELEMETRY_VERB_FLUSH,
+    TELEMETRY_VERB_STATS,
+};
+
+static esp_err_t telemetry_command_handler(const command_args_t *args)
+{
+    switch (args->verb_id) {
+    case TELEMETRY_VERB_FLUSH:
+        telemetry_flush();
+        command_dispatcher_reply(args, "STATUS:TELEMETRY:FLUSH");
+        return ESP_OK;
+    case TELEMETRY_VERB_STATS: {
+        telemetry_stats_t stats;
+        telemetry_get_stats(&stats);
+        // 每样本字节数保留两位小数，每分钟发布次数保留一位小数
+        uint32_t bps = stats.samples > 0 ? (uint32_t)((uint64_t)stats.bytes * 100 / stats.samples) : 0;
+        uint32_t ppm = stats.uptime_s > 0 ? (uint32_t)((uint64_t)stats.publishes * 600 / stats.uptime_s) : 0;
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "STATUS:TELEMETRY:samples=%lu,batches=%lu,bytes=%lu,raw=%lu,pending=%lu,dropped=%lu,failed=%lu,"
+                 "backlog=%lu,lost=%lu,bytes_per_sample=%lu.%02lu,publishes_per_min=%lu.%lu",
+                 (unsigned long)stats.samples, (unsigned long)stats.batches, (unsigned long)stats.bytes,
+                 (unsigned long)stats.raw_bytes, (unsigned long)stats.pending, (unsigned long)stats.dropped,
+                 (unsigned long)stats.failed, (unsigned long)stats.backlog, (unsigned long)stats.lost,
+                 (unsigned long)(bps / 100), (unsigned long)(bps % 100), (unsigned long)(ppm / 10),
+                 (unsigned long)(ppm % 10));
+        command_dispatcher_reply(args, line);
+        return ESP_OK;
+    }
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+
+static const command_verb_t s_telemetry_verbs[] = {
+    { "flush", TELEMETRY_VERB_FLUSH },
+    { "stats", TELEMETRY_VERB_STATS },
+};
+
+static const command_module_t s_telemetry_module = {
+    .prefix     = "telemetry",
+    .handler    = telemetry_command_handler,
+    .verbs      = s_telemetry_verbs,
+    .verb_count = sizeof(s_telemetry_verbs) / sizeof(s_telemetry_verbs[0]),
+};
+
+esp_err_t telemetry_init(void)
+{
+    if (s_task == NULL) {
+        s_start_us = esp_timer_get_time();
+#if CONFIG_TELEMETRY_STORE
+        if (telemetry_store_init(CONFIG_TELEMETRY_STORE_PARTITION) == ESP_OK) {
+            s_seq = telemetry_store_next_id();
+        }
+#endif
+        if (xTaskCreate(telemetry_task, "telemetry", TASK_STACK, NULL, TASK_PRIO, &s_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建遥测任务失败");
+            return ESP_ERR_NO_MEM;
+        }
+        status_registry_set_observer(telemetry_on_change);
+        ESP_LOGI(TAG, "遥测已启动: 每 %d ms 发布一批，缓冲 %d 个样本", INTERVAL_MS, RING_SIZE);
+    }
+    return command_dispatcher_register(&s_telemetry_module);
+}
+
+void telemetry_set_publisher(telemetry_publish_t publish)
+{
+    s_publish = publish;
+}
+
+void telemetry_resync(void)
+{
+    atomic_store(&s_resync, true);
+    telemetry_flush();
+}
+
+void telemetry_flush(void)
+{
+    if (s_task != NULL) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void telemetry_get_stats(telemetry_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    uint32_t pending, dropped;
+    taskENTER_CRITICAL(&s_ring_lock);
+    pending = s_ring_head - s_ring_tail;
+    dropped = s_ring_dropped;
+    taskEXIT_CRITICAL(&s_ring_lock);
+    stats->samples = atomic_load(&s_samples);
+    stats->batches = atomic_load(&s_batches);
+    stats->publishes = atomic_load(&s_publishes);
+    stats->bytes = atomic_load(&s_bytes);
+    stats->raw_bytes = atomic_load(&s_raw_bytes);
+    stats->pending = pending;
+    stats->dropped = atomic_load(&s_dropped) + dropped;
+    stats->failed = atomic_load(&s_failed);
+    telemetry_store_stats_t store;
+    telemetry_store_get_stats(&store);
+    stats->backlog = store.pending;
+    stats->lost = store.lost;
+    stats->uptime_s = (uint32_t)((esp_timer_get_time() - s_start_us) / 1000000);
+}
@@ -0,0 +1,244 @@
+#include <string.h>
+#include "telemetry_batch.h"
+
+// --- CBOR ---
+
+enum {
+    CBOR_UINT  = 0,
+    CBOR_NEG   = 1,
+    CBOR_TEXT  = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP   = 5,
+};
+
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   len;
+    bool     overflow;
+} cbor_writer_t;
+
+static size_t cbor_head_size(uint64_t value)
+{
+    return value < 24 ? 1 : value <= 0xFF ? 2 : value <= 0xFFFF ? 3 : value <= 0xFFFFFFFFULL ? 5 : 9;
+}
+
+static size_t cbor_int_size(int64_t value)
+{
+    return cbor_head_size(value < 0 ? (uint64_t)(-1 - value) : (uint64_t)value);
+}
+
+static void cbor_head(cbor_writer_t *w, uint8_t major, uint64_t value)
+{
+    size_t n = cbor_head_size(value);
+    if (w->len + n > w->size) {
+        w->overflow = true;
+        return;
+    }
+    uint8_t *p = w->buf + w->len;
+    w->len += n;
+    if (n == 1) {
+        p[0] = (uint8_t)(major << 5 | value);
+        return;
+    }
+    static const uint8_t info[] = { 0, 0, 24, 25, 0, 26, 0, 0, 0, 27 };
+    p[0] = (uint8_t)(major << 5 | info[n]);
+    for (size_t i = n - 1; i >= 1; i--) {
+        p[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+static void cbor_int(cbor_writer_t *w, int64_t value)
+{
+    if (value < 0) {
+        cbor_head(w, CBOR_NEG, (uint64_t)(-1 - value));
+    } else {
+        cbor_head(w, CBOR_UINT, (uint64_t)value);
+    }
+}
+
+static void cbor_text(cbor_writer_t *w, const char *text)
+{
+    size_t n = strlen(text);
+    cbor_head(w, CBOR_TEXT, n);
+    if (w->overflow || w->len + n > w->size) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, text, n);
+    w->len += n;
+}
+
+size_t telemetry_batch_encode(const telemetry_batch_header_t *header, const telemetry_sample_t *samples, size_t count,
+                              uint8_t *buf, size_t size, size_t *out_len)
+{
+    cbor_writer_t w = { .buf = buf, .size = size };
+    uint32_t t0 = count > 0 ? samples[0].t_ms : header->snapshot_ms;
+    size_t entries = 4 + (header->dropped > 0 ? 1 : 0) + (header->snapshot != NULL ? 2 : 0);
+
+    cbor_head(&w, CBOR_MAP, entries);
+    cbor_int(&w, 0);
+    cbor_int(&w, header->seq);
+    cbor_int(&w, 1);
+    cbor_int(&w, t0);
+    cbor_int(&w, 2);
+    cbor_int(&w, header->field_count);
+    if (header->dropped > 0) {
+        cbor_int(&w, 4);
+        cbor_int(&w, header->dropped);
+    }
+    if (header->snapshot != NULL) {
+        cbor_int(&w, 5);
+        cbor_head(&w, CBOR_ARRAY, header->field_count);
+        for (uint32_t i = 0; i < header->field_count; i++) {
+            cbor_int(&w, header->snapshot[i]);
+        }
+        cbor_int(&w, 6);
+        cbor_int(&w, (uint32_t)(header->snapshot_ms - t0));
+    }
+    // 样本放在最后，按剩余空间决定个数 (数组头按全部样本预留)
+    cbor_int(&w, 3);
+    if (w.overflow) {
+        *out_len = 0;
+        return 0;
+    }
+    size_t budget = size - w.len;
+    size_t array_head = cbor_head_size((uint64_t)count * 3);
+    size_t n = 0;
+    size_t used = array_head;
+    uint32_t prev = t0;
+    for (; n < count; n++) {
+        size_t item = cbor_int_size((uint32_t)(samples[n].t_ms - prev)) + cbor_int_size(samples[n].field) +
+                      cbor_int_size(samples[n].value);
+        if (used + item > budget) {
+            break;
+        }
+        used += item;
+        prev = samples[n].t_ms;
+    }
+    cbor_head(&w, CBOR_ARRAY, (uint64_t)n * 3);
+    prev = t0;
+    for (size_t i = 0; i < n; i++) {
+        cbor_int(&w, (uint32_t)(samples[i].t_ms - prev));
+        cbor_int(&w, samples[i].field);
+        cbor_int(&w, samples[i].value);
+        prev = samples[i].t_ms;
+    }
+    if (w.overflow) {
+        *out_len = 0;
+        return 0;
+    }
+    *out_len = w.len;
+    return n;
+}
+
+size_t telemetry_schema_encode(const char *const *names, const uint8_t *types, size_t count, uint8_t *buf, size_t size)
+{
+    cbor_writer_t w = { .buf = buf, .size = size };
+    cbor_head(&w, CBOR_MAP, 2);
+    cbor_int(&w, 0);
+    cbor_int(&w, count);
+    cbor_int(&w, 1);
+    cbor_head(&w, CBOR_ARRAY, count);
+    for (size_t i = 0; i < count; i++) {
+        cbor_head(&w, CBOR_ARRAY, 2);
+        cbor_text(&w, names[i]);
+        cbor_int(&w, types[i]);
+    }
+    return w.overflow ? 0 : w.len;
+}
+
+// --- LZ4 块格式 ---
+
+#define LZ4_MIN_MATCH    4
+#define LZ4_LAST_LITERAL 5    // 块的最后 5 字节必须是字面量
+#define LZ4_MFLIMIT      12   // 最后一个匹配必须在块结束前至少 12 字节开始
+#define LZ4_HASH_BITS    9
+
+static uint32_t lz4_read32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t lz4_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+// 写一个序列: 字面量 + (match_len 为 0 时是最后一个序列，没有匹配)
+static bool lz4_sequence(uint8_t *dst, size_t cap, size_t *pos, const uint8_t *lit, size_t lit_len,
+                         size_t match_len, size_t offset)
+{
+    size_t p = *pos;
+    size_t ml = match_len > 0 ? match_len - LZ4_MIN_MATCH : 0;
+    size_t need = 1 + lit_len / 255 + 1 + lit_len + (match_len > 0 ? 2 + ml / 255 + 1 : 0);
+    if (p + need > cap) {
+        return false;
+    }
+    uint8_t *token = &dst[p++];
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        size_t rest = lit_len - 15;
+        for (; rest >= 255; rest -= 255) {
+            dst[p++] = 255;
+        }
+        dst[p++] = (uint8_t)rest;
+    }
+    memcpy(&dst[p], lit, lit_len);
+    p += lit_len;
+    if (match_len > 0) {
+        dst[p++] = (uint8_t)offset;
+        dst[p++] = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+        if (ml >= 15) {
+            size_t rest = ml - 15;
+            for (; rest >= 255; rest -= 255) {
+                dst[p++] = 255;
+            }
+            dst[p++] = (uint8_t)rest;
+        }
+    }
+    *pos = p;
+    return true;
+}
+
+size_t telemetry_lz4_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap)
+{
+    if (len > 0xFFFF || cap < 4) {
+        return 0;
+    }
+    uint16_t table[1 << LZ4_HASH_BITS];   // 位置 + 1，0 表示空
+    memset(table, 0, sizeof(table));
+    dst[0] = (uint8_t)len;
+    dst[1] = (uint8_t)(len >> 8);
+    dst[2] = 0;
+    dst[3] = 0;
+    size_t pos = 4;
+    size_t ip = 0, anchor = 0;
+
+    while (len > LZ4_MFLIMIT && ip + LZ4_MFLIMIT < len) {
+        uint32_t seq = lz4_read32(src + ip);
+        uint32_t h = lz4_hash(seq);
+        size_t ref = table[h];
+        table[h] = (uint16_t)(ip + 1);
+        if (ref == 0 || lz4_read32(src + ref - 1) != seq) {
+            ip++;
+            continue;
+        }
+        ref--;
+        size_t match_len = LZ4_MIN_MATCH;
+        while (ip + match_len < len - LZ4_LAST_LITERAL && src[ref + match_len] == src[ip + match_len]) {
+            match_len++;
+        }
+        if (!lz4_sequence(dst, cap, &pos, src + anchor, ip - anchor, match_len, ip - ref)) {
+            return 0;
+        }
+        ip += match_len;
+        anchor = ip;
+    }
+    if (!lz4_sequence(dst, cap, &pos, src + anchor, len - anchor, 0, 0)) {
+        return 0;
+    }
+    return pos < len ? pos : 0;
+}
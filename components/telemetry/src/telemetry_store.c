@@ -0,0 +1,418 @@
+#include "esp_log.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "telemetry_store.h"
+
+static const char *TAG = "TELEMETRY_STORE";
+
+#define SECTOR_SIZE   (4096)
+#define SECTOR_MAGIC  (0x314D4C54)   // "TLM1"
+#define STATE_PENDING (0xFFFFFFFFu)
+#define STATE_SENT    (0x00000000u)
+#define ALIGN4(n)     (((n) + 3u) & ~3u)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;           // 扇区序号，最大的是当前写入的扇区
+    uint32_t erase_count;
+    uint32_t crc;           // 前 12 字节的 CRC
+} sector_header_t;
+
+typedef struct {
+    uint16_t len;           // 0xFFFF 表示此处尚未写入
+    uint8_t  kind;
+    uint8_t  reserved;      // 0xFF
+    uint32_t id;
+    uint32_t crc;           // len、kind、reserved、id 与负载的 CRC
+    uint32_t state;         // STATE_PENDING 未发送，其余为已发送
+} record_header_t;
+
+_Static_assert(sizeof(sector_header_t) == 16, "sector header layout");
+_Static_assert(sizeof(record_header_t) == 16, "record header layout");
+
+#define RECORD_MAX (SECTOR_SIZE - sizeof(sector_header_t) - sizeof(record_header_t))
+
+typedef struct {
+    uint32_t sector;
+    uint32_t off;           // 扇区内偏移
+} store_pos_t;
+
+static const esp_partition_t *s_part = NULL;
+static uint32_t s_sectors;
+static store_pos_t s_write;         // 下一条记录的写入位置
+static store_pos_t s_read;          // 最旧的未发送记录，队列为空时等于 s_write
+static uint32_t s_write_seq;        // 当前写入扇区的序号
+static uint32_t s_next_id;
+
+static atomic_uint s_pending;
+static atomic_uint s_pending_bytes;
+static atomic_uint s_appended;
+static atomic_uint s_sent;
+static atomic_uint s_lost;
+static atomic_uint s_corrupt;
+static atomic_uint s_erase_max;
+static atomic_uint s_erase_total;
+
+static size_t sector_addr(uint32_t sector)
+{
+    return (size_t)sector * SECTOR_SIZE;
+}
+
+static uint32_t sector_header_crc(const sector_header_t *h)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(sector_header_t, crc));
+}
+
+static bool read_sector_header(uint32_t sector, sector_header_t *h)
+{
+    if (esp_partition_read(s_part, sector_addr(sector), h, sizeof(*h)) != ESP_OK) {
+        return false;
+    }
+    return h->magic == SECTOR_MAGIC && h->crc == sector_header_crc(h);
+}
+
+static bool record_blank(const record_header_t *h)
+{
+    return h->len == 0xFFFF && h->id == 0xFFFFFFFFu && h->crc == 0xFFFFFFFFu;
+}
+
+// 读取记录头；off 处没有完整记录 (扇区已写部分的末尾或长度损坏) 时返回 false
+static bool read_record_header(store_pos_t pos, record_header_t *h)
+{
+    if (pos.off + sizeof(*h) > SECTOR_SIZE ||
+        esp_partition_read(s_part, sector_addr(pos.sector) + pos.off, h, sizeof(*h)) != ESP_OK) {
+        return false;
+    }
+    if (record_blank(h)) {
+        return false;
+    }
+    return h->len <= SECTOR_SIZE - pos.off - sizeof(*h);
+}
+
+static uint32_t record_size(const record_header_t *h)
+{
+    return sizeof(*h) + ALIGN4(h->len);
+}
+
+// 校验负载；buf 不为 NULL 时同时读出负载
+static bool record_check(store_pos_t pos, const record_header_t *h, uint8_t *buf)
+{
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)h, offsetof(record_header_t, crc));
+    size_t addr = sector_addr(pos.sector) + pos.off + sizeof(*h);
+    if (buf != NULL) {
+        if (esp_partition_read(s_part, addr, buf, h->len) != ESP_OK) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, buf, h->len);
+    } else {
+        uint8_t chunk[128];
+        for (size_t done = 0; done < h->len; done += sizeof(chunk)) {
+            size_t n = h->len - done < sizeof(chunk) ? h->len - done : sizeof(chunk);
+            if (esp_partition_read(s_part, addr + done, chunk, n) != ESP_OK) {
+                return false;
+            }
+            crc = esp_rom_crc32_le(crc, chunk, n);
+        }
+    }
+    return crc == h->crc;
+}
+
+// 状态字清零，不需要擦除
+static esp_err_t record_mark_sent(store_pos_t pos)
+{
+    const uint32_t sent = STATE_SENT;
+    return esp_partition_write(s_part, sector_addr(pos.sector) + pos.off + offsetof(record_header_t, state), &sent,
+                               sizeof(sent));
+}
+
+// 擦除扇区并写入扇区头，使之成为新的写入扇区
+static esp_err_t sector_open(uint32_t sector, uint32_t seq)
+{
+    sector_header_t old;
+    uint32_t erase_count = read_sector_header(sector, &old) ? old.erase_count + 1 : 1;
+    esp_err_t err = esp_partition_erase_range(s_part, sector_addr(sector), SECTOR_SIZE);
+    if (err != ESP_OK) {
+        return err;
+    }
+    sector_header_t h = { .magic = SECTOR_MAGIC, .seq = seq, .erase_count = erase_count };
+    h.crc = sector_header_crc(&h);
+    err = esp_partition_write(s_part, sector_addr(sector), &h, sizeof(h));
+    if (err != ESP_OK) {
+        return err;
+    }
+    atomic_fetch_add(&s_erase_total, 1);
+    if (erase_count > atomic_load(&s_erase_max)) {
+        atomic_store(&s_erase_max, erase_count);
+    }
+    s_write = (store_pos_t){ .sector = sector, .off = sizeof(sector_header_t) };
+    s_write_seq = seq;
+    return ESP_OK;
+}
+
+// 写入位置移到下一个扇区；该扇区中尚未发送的记录丢失
+static esp_err_t sector_advance(void)
+{
+    uint32_t next = (s_write.sector + 1) % s_sectors;
+    bool empty = atomic_load(&s_pending) == 0;
+    if (!empty && s_read.sector == next) {
+        uint32_t lost = 0, bytes = 0;
+        record_header_t h;
+        for (store_pos_t pos = s_read; read_record_header(pos, &h); pos.off += record_size(&h)) {
+            if (h.state == STATE_PENDING && record_check(pos, &h, NULL)) {
+                lost++;
+                bytes += record_size(&h);
+            }
+        }
+        atomic_fetch_sub(&s_pending, lost);
+        atomic_fetch_sub(&s_pending_bytes, bytes);
+        atomic_fetch_add(&s_lost, lost);
+        ESP_LOGW(TAG, "队列已满，丢弃最旧扇区中 %lu 条未发送的记录", (unsigned long)lost);
+        s_read = (store_pos_t){ .sector = (next + 1) % s_sectors, .off = sizeof(sector_header_t) };
+        empty = atomic_load(&s_pending) == 0;
+    }
+    esp_err_t err = sector_open(next, s_write_seq + 1);
+    if (err == ESP_OK && empty) {
+        s_read = s_write;
+    }
+    return err;
+}
+
+// 启动时按从旧到新的顺序扫描全部扇区，恢复读写位置和 id
+static void store_scan(void)
+{
+    sector_header_t h;
+    bool found = false;
+    uint32_t erase_max = 0, erase_total = 0;
+    for (uint32_t i = 0; i < s_sectors; i++) {
+        if (!read_sector_header(i, &h)) {
+            continue;
+        }
+        erase_total += h.erase_count;
+        if (h.erase_count > erase_max) {
+            erase_max = h.erase_count;
+        }
+        if (!found || (int32_t)(h.seq - s_write_seq) > 0) {
+            s_write_seq = h.seq;
+            s_write.sector = i;
+            found = true;
+        }
+    }
+    atomic_store(&s_erase_max, erase_max);
+    atomic_store(&s_erase_total, erase_total);
+    if (!found) {
+        ESP_LOGI(TAG, "分区为空，格式化 (%lu 个扇区)", (unsigned long)s_sectors);
+        s_next_id = 0;
+        if (sector_open(0, 1) == ESP_OK) {
+            s_read = s_write;
+        } else {
+            s_part = NULL;
+        }
+        return;
+    }
+
+    bool have_read = false;
+    uint32_t pending = 0, bytes = 0, corrupt = 0;
+    for (uint32_t k = 1; k <= s_sectors; k++) {
+        uint32_t sector = (s_write.sector + k) % s_sectors;
+        if (!read_sector_header(sector, &h)) {
+            continue;
+        }
+        store_pos_t pos = { .sector = sector, .off = sizeof(sector_header_t) };
+        record_header_t rec;
+        while (read_record_header(pos, &rec)) {
+            if (!record_check(pos, &rec, NULL)) {
+                corrupt++;
+            } else {
+                s_next_id = rec.id + 1;
+                if (rec.state == STATE_PENDING) {
+                    pending++;
+                    bytes += record_size(&rec);
+                    if (!have_read) {
+                        s_read = pos;
+                        have_read = true;
+                    }
+                }
+            }
+            pos.off += record_size(&rec);
+        }
+        if (sector == s_write.sector) {
+            // 末尾不是空白 (长度损坏) 时本扇区不再写入
+            s_write.off = (pos.off + sizeof(rec) <= SECTOR_SIZE && record_blank(&rec)) ? pos.off : SECTOR_SIZE;
+        }
+    }
+    atomic_store(&s_pending, pending);
+    atomic_store(&s_pending_bytes, bytes);
+    atomic_store(&s_corrupt, corrupt);
+    if (!have_read) {
+        s_read = s_write;
+    }
+}
+
+esp_err_t telemetry_store_init(const char *label)
+{
+    s_part = NULL;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        ESP_LOGW(TAG, "找不到数据分区 \"%s\"，离线时不缓存遥测", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->size < 2 * SECTOR_SIZE || part->size % SECTOR_SIZE != 0) {
+        ESP_LOGE(TAG, "分区 \"%s\" 的大小 %lu 不是至少两个 4 KiB 扇区", label, (unsigned long)part->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    s_part = part;
+    s_sectors = part->size / SECTOR_SIZE;
+    s_next_id = 0;
+    atomic_store(&s_appended, 0);
+    atomic_store(&s_sent, 0);
+    atomic_store(&s_lost, 0);
+    store_scan();
+    if (s_part == NULL) {
+        ESP_LOGE(TAG, "格式化分区 \"%s\" 失败", label);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "分区 \"%s\": %lu 个扇区，%lu 条记录待发送，下一个 id %lu，最大擦除次数 %lu", label,
+             (unsigned long)s_sectors, (unsigned long)atomic_load(&s_pending), (unsigned long)s_next_id,
+             (unsigned long)atomic_load(&s_erase_max));
+    return ESP_OK;
+}
+
+bool telemetry_store_ready(void)
+{
+    return s_part != NULL;
+}
+
+uint32_t telemetry_store_next_id(void)
+{
+    return s_next_id;
+}
+
+esp_err_t telemetry_store_append(uint32_t id, uint8_t kind, const uint8_t *data, size_t len)
+{
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > RECORD_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    record_header_t h = { .len = (uint16_t)len, .kind = kind, .reserved = 0xFF, .id = id, .state = STATE_PENDING };
+    h.crc = esp_rom_crc32_le(esp_rom_crc32_le(0, (const uint8_t *)&h, offsetof(record_header_t, crc)), data, len);
+    if (s_write.off + record_size(&h) > SECTOR_SIZE) {
+        esp_err_t err = sector_advance();
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "擦除扇区失败: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    // 先写记录头再写负载，掉电时负载不完整的记录因 CRC 不符被跳过
+    size_t addr = sector_addr(s_write.sector) + s_write.off;
+    esp_err_t err = esp_partition_write(s_part, addr, &h, sizeof(h));
+    if (err == ESP_OK && len > 0) {
+        err = esp_partition_write(s_part, addr + sizeof(h), data, len);
+    }
+    bool was_empty = atomic_load(&s_pending) == 0;
+    // 写失败的记录也占用空间，之后的记录写在它后面
+    s_write.off += record_size(&h);
+    if (err != ESP_OK) {
+        atomic_fetch_add(&s_corrupt, 1);
+        if (was_empty) {
+            s_read = s_write;
+        }
+        ESP_LOGE(TAG, "写入记录失败: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (was_empty) {
+        s_read = (store_pos_t){ .sector = s_write.sector, .off = (uint32_t)(addr - sector_addr(s_write.sector)) };
+    }
+    s_next_id = id + 1;
+    atomic_fetch_add(&s_pending, 1);
+    atomic_fetch_add(&s_pending_bytes, record_size(&h));
+    atomic_fetch_add(&s_appended, 1);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_store_peek(uint32_t *id, uint8_t *kind, uint8_t *buf, size_t size, size_t *len)
+{
+    if (s_part == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    record_header_t h;
+    while (true) {
+        if (s_read.sector == s_write.sector && s_read.off >= s_write.off) {
+            // 读到了写入位置: 队列为空 (计数只可能因 flash 位翻转而偏大，这里一并修正)
+            atomic_store(&s_pending, 0);
+            atomic_store(&s_pending_bytes, 0);
+            s_read = s_write;
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (!read_record_header(s_read, &h)) {
+            // 扇区的末尾，继续下一个扇区
+            s_read = (store_pos_t){ .sector = (s_read.sector + 1) % s_sectors, .off = sizeof(sector_header_t) };
+            continue;
+        }
+        if (h.state != STATE_PENDING) {
+            s_read.off += record_size(&h);
+            continue;
+        }
+        if (h.len > size) {
+            // 例如升级后批次缓冲变小；标记为已发送，否则每次启动都会卡在这里
+            ESP_LOGW(TAG, "记录 %lu 长 %u 字节，超过缓冲 %u 字节，丢弃", (unsigned long)h.id, h.len, (unsigned)size);
+            record_mark_sent(s_read);
+            atomic_fetch_add(&s_lost, 1);
+            atomic_fetch_sub(&s_pending, 1);
+            atomic_fetch_sub(&s_pending_bytes, record_size(&h));
+            s_read.off += record_size(&h);
+            continue;
+        }
+        if (!record_check(s_read, &h, buf)) {
+            // 掉电时写了一半的记录，扫描时已计入 corrupt，不在待发送数中
+            s_read.off += record_size(&h);
+            continue;
+        }
+        *id = h.id;
+        *kind = h.kind;
+        *len = h.len;
+        return ESP_OK;
+    }
+}
+
+esp_err_t telemetry_store_consume(void)
+{
+    if (s_part == NULL || atomic_load(&s_pending) == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    record_header_t h;
+    if (!read_record_header(s_read, &h) || h.state != STATE_PENDING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = record_mark_sent(s_read);
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_read.off += record_size(&h);
+    atomic_fetch_sub(&s_pending_bytes, record_size(&h));
+    if (atomic_fetch_sub(&s_pending, 1) == 1) {
+        s_read = s_write;
+    }
+    atomic_fetch_add(&s_sent, 1);
+    return ESP_OK;
+}
+
+void telemetry_store_get_stats(telemetry_store_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->sectors = s_part != NULL ? s_sectors : 0;
+    stats->pending = atomic_load(&s_pending);
+    stats->pending_bytes = atomic_load(&s_pending_bytes);
+    stats->appended = atomic_load(&s_appended);
+    stats->sent = atomic_load(&s_sent);
+    stats->lost = atomic_load(&s_lost);
+    stats->corrupt = atomic_load(&s_corrupt);
+    stats->erase_max = atomic_load(&s_erase_max);
+    stats->erase_total = atomic_load(&s_erase_total);
+}
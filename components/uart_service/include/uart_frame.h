@@ -0,0 +1,166 @@
+#ifndef UART_FRAME_H
+#define UART_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief 屏幕串口二进制帧格式 (版本 1)
+ *
+ * 线上格式: 0x00 | COBS(帧) | 0x00
+ * 帧 (COBS 编码前):
+ *   [0]   版本 UART_FRAME_VERSION
+ *   [1]   低 4 位为类型 (uart_frame_type_t)，高 4 位为标志 (UART_FRAME_FLAG_*)
+ *   [2]   序号 (DATA 为发送序号，ACK/NAK 为被确认的序号)
+ *   [3]   操作码 (uart_frame_opcode_t，ACK/NAK 为 0)
+ *   [4..] 负载
+ *   最后 2 字节: CRC16/CCITT-FALSE (多项式 0x1021，初值 0xFFFF)，覆盖版本到负载末尾，低字节在前
+ *
+ * COBS 编码后帧内不含 0x00，所以 ASCII 文本行 (永远不含 0x00) 和二进制帧可以在同一串口上共存：
+ * 接收端看到 0x00 就开始收帧，到下一个 0x00 结束。
+ */
+#define UART_FRAME_VERSION      1
+#define UART_FRAME_DELIMITER    0x00
+#define UART_FRAME_HEADER_LEN   4
+#define UART_FRAME_CRC_LEN      2
+
+// 负载长度为 n 的帧编码后 (含前后两个分隔符) 的最大长度
+#define UART_FRAME_ENCODED_MAX(n) \
+    ((n) + UART_FRAME_HEADER_LEN + UART_FRAME_CRC_LEN + ((n) + UART_FRAME_HEADER_LEN + UART_FRAME_CRC_LEN) / 254 + 1 + 2)
+
+typedef enum {
+    UART_FRAME_TYPE_DATA = 0,   // 需要对方回复 ACK
+    UART_FRAME_TYPE_ACK  = 1,   // 已正确接收 seq
+    UART_FRAME_TYPE_NAK  = 2,   // 收到损坏的帧，请立即重发
+    UART_FRAME_TYPE_HEARTBEAT = 3, // 链路心跳，不需要回复，seq 无意义
+    UART_FRAME_TYPE_BULK = 4,   // 批量传输，seq 为传输编号，操作码见 uart_frame_bulk_op_t，不使用 ACK/NAK 帧
+} uart_frame_type_t;
+
+// 发送方启动后 (或重新切换到二进制模式后) 的第一帧，接收方据此重置重复帧检测
+#define UART_FRAME_FLAG_SYN     0x80
+
+typedef enum {
+    UART_FRAME_OP_COMMAND = 0x01,   // 负载为一条命令文本，如 "fan:75" (屏幕 -> 主控)
+    UART_FRAME_OP_STATUS  = 0x02,   // 负载为一行状态/回复文本，如 "STATUS:FAN_SPEED_SET:75" (主控 -> 屏幕)
+    UART_FRAME_OP_LINK    = 0x10,   // 链路协商，负载见 uart_frame_link_cmd_t，由 uart_service 内部处理
+} uart_frame_opcode_t;
+
+/**
+ * @brief 链路协商 (UART_FRAME_OP_LINK) 负载: [命令 1B][波特率 4B 小端][标志 1B]
+ *
+ * 发起方 PROPOSE 目标波特率和是否启用 RTS/CTS；应答方回复 ACCEPT (同意的参数，可能去掉流控) 或 REJECT。
+ * ACCEPT 帧被确认后双方切换到新参数，发起方以新波特率发送 CONFIRM；
+ * 任何一方在 CONFIG_UART_SERVICE_LINK_CONFIRM_TIMEOUT_MS 内没有完成 CONFIRM 就退回初始波特率。
+ */
+typedef enum {
+    UART_FRAME_LINK_PROPOSE = 1,
+    UART_FRAME_LINK_ACCEPT  = 2,
+    UART_FRAME_LINK_REJECT  = 3,
+    UART_FRAME_LINK_CONFIRM = 4,
+} uart_frame_link_cmd_t;
+
+#define UART_FRAME_LINK_PAYLOAD_LEN 6
+#define UART_FRAME_LINK_FLAG_RTSCTS 0x01
+
+/**
+ * @brief 批量传输 (UART_FRAME_TYPE_BULK) 操作码，多字节字段均为小端
+ *
+ * 发送方 OFFER 一次传输，接收方 ACCEPT 并给出续传起点 (已有的字节数)、窗口 (块数) 和最大块长；
+ * 之后发送方连续发送 DATA，最多有"窗口"个块未被确认 (go-back-N)。接收方按顺序写入后以 ACK
+ * 累计确认；收到不连续的块时回复一次 NAK，发送方从 NAK 的偏移重发。全部确认后发送方 END，
+ * 接收方用 OFFER 中的 CRC32 校验整个数据，以 DONE 回复结果。任一方可随时 ABORT。
+ * 每个块由帧本身的 CRC16 保护，损坏的块被丢弃，由后续块触发的 NAK 或发送方超时重发。
+ *
+ *   OFFER   发送方 -> 接收方  [类型 1B][总长 4B][CRC32 4B][名称，最长 UART_FRAME_BULK_NAME_MAX，不含 '\0']
+ *   ACCEPT  接收方 -> 发送方  [起始偏移 4B][窗口 1B][最大块长 2B]
+ *   REJECT  接收方 -> 发送方  [状态 1B]
+ *   DATA    发送方 -> 接收方  [偏移 4B][数据]
+ *   ACK     接收方 -> 发送方  [已写入的字节数 4B]
+ *   NAK     接收方 -> 发送方  [请从此偏移重发 4B]
+ *   END     发送方 -> 接收方  (无负载)
+ *   DONE    接收方 -> 发送方  [状态 1B]
+ *   ABORT   任一方           [状态 1B]
+ */
+typedef enum {
+    UART_FRAME_BULK_OFFER  = 1,
+    UART_FRAME_BULK_ACCEPT = 2,
+    UART_FRAME_BULK_REJECT = 3,
+    UART_FRAME_BULK_DATA   = 4,
+    UART_FRAME_BULK_ACK    = 5,
+    UART_FRAME_BULK_NAK    = 6,
+    UART_FRAME_BULK_END    = 7,
+    UART_FRAME_BULK_DONE   = 8,
+    UART_FRAME_BULK_ABORT  = 9,
+} uart_frame_bulk_op_t;
+
+// REJECT / DONE / ABORT 的状态
+typedef enum {
+    UART_FRAME_BULK_OK        = 0,
+    UART_FRAME_BULK_NO_SINK   = 1,  // 接收方没有注册接收处理
+    UART_FRAME_BULK_BUSY      = 2,  // 已有传输在进行
+    UART_FRAME_BULK_REFUSED   = 3,  // 接收处理拒绝 (类型/长度不支持、空间不足)
+    UART_FRAME_BULK_IO_ERROR  = 4,  // 读取或写入数据失败
+    UART_FRAME_BULK_BAD_CRC   = 5,  // 整体 CRC32 不符
+    UART_FRAME_BULK_CANCELLED = 6,  // 本地取消
+    UART_FRAME_BULK_TIMEOUT   = 7,  // 对方长时间没有响应
+} uart_frame_bulk_status_t;
+
+#define UART_FRAME_BULK_NAME_MAX        32
+#define UART_FRAME_BULK_OFFER_LEN       9   // 不含名称
+#define UART_FRAME_BULK_ACCEPT_LEN      7
+#define UART_FRAME_BULK_DATA_HEADER_LEN 4
+
+/**
+ * @brief 解码后的帧，payload 指向解码缓冲区内部
+ */
+typedef struct {
+    uint8_t        type;
+    uint8_t        flags;
+    uint8_t        seq;
+    uint8_t        opcode;
+    const uint8_t *payload;
+    size_t         len;
+} uart_frame_t;
+
+/**
+ * @brief CRC16/CCITT-FALSE
+ */
+uint16_t uart_frame_crc16(const uint8_t *data, size_t len);
+
+/**
+ * @brief CRC-32 (IEEE 802.3，与 zlib crc32 相同)，可分段计算: 第一段 crc 传 0，之后传上一段的结果
+ */
+uint32_t uart_frame_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+/**
+ * @brief COBS 编码，dst 至少需要 len + len / 254 + 1 字节
+ * @return 编码后的长度
+ */
+size_t uart_frame_cobs_encode(const uint8_t *src, size_t len, uint8_t *dst);
+
+/**
+ * @brief COBS 解码，允许 dst == src (原地解码)
+ * @return 解码后的长度，数据无效时返回 0
+ */
+size_t uart_frame_cobs_decode(const uint8_t *src, size_t len, uint8_t *dst);
+
+/**
+ * @brief 把帧编码为线上格式 (含前后分隔符)
+ *
+ * @param out      输出缓冲区，至少 UART_FRAME_ENCODED_MAX(frame->len) 字节
+ * @return 编码后的长度，缓冲区不足时返回 0
+ */
+size_t uart_frame_encode(const uart_frame_t *frame, uint8_t *out, size_t out_size);
+
+/**
+ * @brief 原地解码两个分隔符之间的 COBS 数据
+ *
+ * @param buf   分隔符之间的数据 (不含 0x00)，解码后被覆盖
+ * @param frame 输出，payload 指向 buf 内部
+ * @return ESP_OK; ESP_ERR_INVALID_SIZE 长度不足或 COBS 无效; ESP_ERR_INVALID_CRC 校验失败;
+ *         ESP_ERR_INVALID_VERSION 版本不支持
+ */
+esp_err_t uart_frame_decode(uint8_t *buf, size_t len, uart_frame_t *frame);
+
+#endif // UART_FRAME_H
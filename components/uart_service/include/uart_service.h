@@ -5,6 +5,8 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 typedef void (*uart_service_handler_t)(const char *data, size_t len);
 
@@ -27,12 +29,242 @@ void uart_service_register_command_handler(uart_service_handler_t handler);
  */
 void uart_service_register_status_handler(uart_service_handler_t handler);
 
+/**
+ * @brief 对方在线状态变化的回调
+ *
+ * @param up true: 断线后 (或上电后第一次) 收到对方的有效数据; false: 超过
+ *           CONFIG_UART_SERVICE_HEARTBEAT_TIMEOUT_MS 没有收到对方的任何有效数据
+ * @note  up 为 false 时在 esp_timer 任务中调用，必须很快返回 (例如把安全命令交给高优先级通道)；
+ *        up 为 true 时在接收任务中调用。
+ */
+typedef void (*uart_service_link_handler_t)(bool up);
+
+/**
+ * @brief 注册对方在线状态变化的回调
+ *
+ * 屏幕发送过心跳 (文本 "HB" 或 HEARTBEAT 帧) 之后才启用断线判定: 双方空闲超过
+ * CONFIG_UART_SERVICE_HEARTBEAT_PERIOD_MS 时互相发送心跳，其它任何有效的行和帧同样算作心跳，
+ * 断线在最后一次收到数据后 TIMEOUT + 10ms 之内通知。不发心跳的屏幕只会收到一次 up 通知。
+ */
+void uart_service_register_link_handler(uart_service_link_handler_t handler);
+
+/**
+ * @brief 当前消息的接收时间 (esp_timer, us)
+ *
+ * 接收任务从驱动取出这批数据的时间，只在命令/状态处理函数中调用才有意义，
+ * 用于把 UART 组行的耗时计入命令路径延迟 (见 command_source_t.arrival_us)。
+ */
+int64_t uart_service_rx_timestamp_us(void);
+
 /**
  * @brief 通过UART发送一行数据（自动添加换行符）。
  *
+ * 数据拷贝到发送队列后立即返回，由发送任务依次写出，调用者不会因串口发送而阻塞，
+ * 可以在处理函数、定时命令和控制任务中调用 (不能在中断中调用)。
+ * 超过 CONFIG_UART_SERVICE_TX_SLOT_SIZE 的部分被截断；队列满时丢弃该行。
+ * 对方使用二进制帧 (见 uart_frame.h) 时，这一行作为一个 DATA 帧发送并等待 ACK，
+ * 'STATUS:' 开头的行操作码为 STATUS，其余为 COMMAND。
+ *
  * @param data 要发送的字符串。
- * @return 成功发送的字节数，或-1表示失败。
+ * @return 入队的字节数 (含换行符)，或-1表示失败 (未初始化或队列已满)。
  */
 int uart_service_send_line(const char *data);
 
+/**
+ * @brief 发送队列统计
+ */
+typedef struct {
+    uint32_t depth;          // 当前排队的行数
+    uint32_t high_watermark; // 启动以来的最大排队行数
+    uint32_t sent;           // 已写出的行数
+    uint32_t dropped;        // 队列满被丢弃的行数
+    uint32_t truncated;      // 超长被截断的行数
+} uart_service_tx_stats_t;
+
+/**
+ * @brief 读取发送队列统计
+ */
+void uart_service_get_tx_stats(uart_service_tx_stats_t *stats);
+
+/**
+ * @brief 二进制帧统计
+ */
+typedef struct {
+    bool     binary_mode;    // 当前发送是否使用二进制帧
+    uint32_t rx_frames;      // 收到的有效帧 (含 ACK/NAK)
+    uint32_t rx_errors;      // 损坏/超长/不完整的帧
+    uint32_t rx_duplicates;  // 重复的 DATA 帧 (对方重发)
+    uint32_t tx_frames;      // 发送的 DATA 帧 (不含重发)
+    uint32_t tx_retransmits; // 重发次数
+    uint32_t tx_failed;      // 重发用尽仍未确认而丢弃的帧
+    uint32_t nak_sent;       // 发出的 NAK
+} uart_service_frame_stats_t;
+
+/**
+ * @brief 读取二进制帧统计
+ */
+void uart_service_get_frame_stats(uart_service_frame_stats_t *stats);
+
+/**
+ * @brief 发起链路协商，切换到更高的波特率并可选启用 RTS/CTS 硬件流控
+ *
+ * 只有对方使用二进制帧时才能协商。对方同意后双方切换并以新参数确认，
+ * 确认超时或之后每秒错误数超过 CONFIG_UART_SERVICE_LINK_ERROR_THRESHOLD 时双方自动退回
+ * CONFIG_UART_SERVICE_BAUD_RATE。CONFIG_UART_SERVICE_LINK_INITIATE 打开时，对方开始使用二进制帧后自动发起。
+ *
+ * @param baud   230400 / 460800 / 921600 / 1500000 / 2000000，不超过 CONFIG_UART_SERVICE_LINK_MAX_BAUD
+ * @param rtscts 是否启用硬件流控 (需要配置 RTS/CTS 引脚)
+ * @return ESP_OK 已发出请求; ESP_ERR_INVALID_ARG 参数不支持; ESP_ERR_INVALID_STATE 对方未使用二进制帧或正在协商
+ */
+esp_err_t uart_service_link_request(uint32_t baud, bool rtscts);
+
+/**
+ * @brief 链路状态和错误统计 (帧重发次数见 uart_service_frame_stats_t)
+ */
+typedef struct {
+    uint32_t baud;       // 当前波特率
+    bool     rtscts;     // 硬件流控是否启用
+    uint32_t upgrades;   // 成功的协商次数
+    uint32_t fallbacks;  // 退回初始波特率的次数
+    uint32_t rejects;    // 被拒绝或拒绝对方的协商次数
+    uint32_t hw_errors;  // 帧错误/校验错误/溢出等硬件错误
+} uart_service_link_stats_t;
+
+/**
+ * @brief 读取链路状态和错误统计
+ */
+void uart_service_get_link_stats(uart_service_link_stats_t *stats);
+
+/**
+ * @brief 心跳统计
+ */
+typedef struct {
+    bool     peer_up;         // 对方当前是否在线
+    bool     armed;           // 对方发送过心跳，断线判定已启用
+    uint32_t losses;          // 断线次数
+    uint32_t sent;            // 已发送的心跳数 (有其它数据发送时不发心跳)
+    uint32_t received;        // 收到的心跳数
+    uint32_t last_rx_age_ms;  // 距最后一次收到有效数据的时间
+} uart_service_heartbeat_stats_t;
+
+/**
+ * @brief 读取心跳统计
+ */
+void uart_service_get_heartbeat_stats(uart_service_heartbeat_stats_t *stats);
+
+/**
+ * @brief DMA 传输统计 (CONFIG_UART_SERVICE_DMA)
+ */
+typedef struct {
+    bool     enabled;        // 是否使用 UHCI + GDMA 收发
+    uint32_t rx_events;      // DMA 接收事件数 (每次空闲 EOF 或缓冲区满各一次)
+    uint32_t rx_bytes;       // 收到的字节数
+    uint32_t rx_rearm_errors; // 切换接收缓冲区失败的次数
+    uint32_t rx_overruns;    // 接收任务来不及处理而丢弃的事件
+    uint32_t tx_transfers;   // DMA 发送次数
+    uint32_t tx_bytes;       // 发出的字节数
+    uint32_t tx_waits;       // 两个发送缓冲区都在使用、写入者需要等待的次数
+} uart_service_dma_stats_t;
+
+/**
+ * @brief 读取 DMA 传输统计，未启用 DMA 时 enabled 为 false，其余为 0
+ */
+void uart_service_get_dma_stats(uart_service_dma_stats_t *stats);
+
+/**
+ * @brief 批量传输的描述 (见 uart_frame.h 中的 UART_FRAME_TYPE_BULK)
+ */
+typedef struct {
+    uint8_t     kind;    // 数据类型，由应用约定 (界面资源、屏幕固件、配方表 ...)
+    uint32_t    size;    // 总字节数
+    uint32_t    crc32;   // 整个数据的 CRC32 (uart_frame_crc32)，接收方在结束时校验
+    const char *name;    // 名称，可为 NULL，超过 UART_FRAME_BULK_NAME_MAX 的部分被截断
+} uart_service_bulk_info_t;
+
+/**
+ * @brief 批量发送的数据源，回调都在批量传输任务中调用
+ *
+ * read 按偏移随机读取 (go-back-N 重发时同一段会被再次读取)，len 不超过协商的块长；
+ * progress 在确认的字节数增加时调用，最多每 100ms 一次 (最后一次 done == total)；
+ * done 在传输结束时调用一次，之后数据源不再被使用。
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+    void (*progress)(void *ctx, uint32_t done, uint32_t total);
+    void (*done)(void *ctx, esp_err_t result);
+    void *ctx;
+} uart_service_bulk_source_t;
+
+/**
+ * @brief 向对方发起一次批量传输，立即返回，结果由 source->done 通知
+ *
+ * 数据块以 UART_FRAME_TYPE_BULK 帧发送，和命令/状态使用同一串口。批量传输任务的优先级
+ * 低于串口收发任务，每写出一个块 (CONFIG_UART_SERVICE_BULK_CHUNK_SIZE) 都会让出串口，
+ * 所以排队的状态行最多多等一个块的发送时间。对方已有部分数据时从它给出的偏移续传。
+ * 同一时间只有一个传输 (发送或接收)。
+ *
+ * @param info   传输描述，函数返回后不再引用
+ * @param source 数据源，函数返回后不再引用 (ctx 要在 done 之前保持有效)
+ * @return ESP_OK 已开始; ESP_ERR_INVALID_ARG 参数无效; ESP_ERR_INVALID_STATE 未初始化或已有传输
+ * @note  result: ESP_OK 对方已校验; ESP_ERR_TIMEOUT 对方无响应; ESP_ERR_INVALID_CRC 对方校验失败;
+ *        ESP_ERR_NOT_SUPPORTED / ESP_ERR_NOT_ALLOWED / ESP_ERR_INVALID_STATE 对方没有接收处理 / 拒绝 / 忙;
+ *        ESP_ERR_NOT_FINISHED 被取消; 其它为 read 返回的错误
+ */
+esp_err_t uart_service_bulk_send(const uart_service_bulk_info_t *info, const uart_service_bulk_source_t *source);
+
+/**
+ * @brief 批量接收处理，回调都在批量传输任务中调用，可以执行较慢的操作 (擦写 flash 等)
+ *
+ * open   对方提议一次传输。返回 ESP_OK 接受，并给出本地已有的字节数 (续传起点，0 为从头开始)
+ *        及这些字节的 CRC32；返回其它值拒绝。对方最多等待 CONFIG_UART_SERVICE_BULK_TIMEOUT_MS。
+ * write  按顺序写入一个块；返回错误时传输中止
+ * progress 同 uart_service_bulk_source_t
+ * close  传输结束: ESP_OK 数据完整且 CRC32 正确; 其它为失败原因，已写入的数据可用于之后续传
+ */
+typedef struct {
+    esp_err_t (*open)(void *ctx, const uart_service_bulk_info_t *info, uint32_t *resume_offset, uint32_t *resume_crc32);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const uint8_t *data, size_t len);
+    void (*progress)(void *ctx, uint32_t done, uint32_t total);
+    void (*close)(void *ctx, esp_err_t result);
+    void *ctx;
+} uart_service_bulk_sink_t;
+
+/**
+ * @brief 注册批量接收处理，没有注册时拒绝对方的所有传输
+ *
+ * @param sink 接收处理，拷贝保存；NULL 取消注册 (不影响正在进行的传输)
+ */
+void uart_service_register_bulk_sink(const uart_service_bulk_sink_t *sink);
+
+/**
+ * @brief 取消正在进行的传输 (发送或接收)，并通知对方
+ *
+ * @return ESP_OK 已请求取消; ESP_ERR_INVALID_STATE 没有进行中的传输
+ */
+esp_err_t uart_service_bulk_abort(void);
+
+/**
+ * @brief 批量传输统计
+ */
+typedef struct {
+    bool     active;          // 是否有传输在进行
+    bool     sending;         // 当前传输由本端发送
+    uint8_t  kind;            // 当前 (或最后一次) 传输的类型
+    uint32_t size;            // 当前 (或最后一次) 传输的总字节数
+    uint32_t done;            // 已确认 (发送) / 已写入 (接收) 的字节数
+    uint32_t resumed_from;    // 续传起点
+    uint32_t bytes_per_s;     // 本次传输的平均速率 (不含续传前的部分)
+    uint32_t completed;       // 成功完成的传输
+    uint32_t failed;          // 失败或被取消的传输
+    uint32_t chunks_sent;     // 发出的数据块 (含重发)
+    uint32_t chunks_resent;   // 重发的数据块
+    uint32_t chunks_received; // 按顺序收下的数据块
+    uint32_t chunks_dropped;  // 重复、不连续或没有空闲缓冲而丢弃的数据块
+} uart_service_bulk_stats_t;
+
+/**
+ * @brief 读取批量传输统计
+ */
+void uart_service_get_bulk_stats(uart_service_bulk_stats_t *stats);
+
 #endif // UART_SERVICE_H
\ No newline at end of file
@@ -0,0 +1,871 @@
+#include "uart_bulk.h"
+#include "uart_service.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+
+static const char *TAG = "UART_BULK";
+
+#define BULK_CHUNK_SIZE       (CONFIG_UART_SERVICE_BULK_CHUNK_SIZE)
+#define BULK_WINDOW           (CONFIG_UART_SERVICE_BULK_WINDOW)
+#define BULK_ACK_TIMEOUT_MS   (CONFIG_UART_SERVICE_BULK_ACK_TIMEOUT_MS)
+#define BULK_RETRIES          (CONFIG_UART_SERVICE_BULK_RETRIES)
+#define BULK_TIMEOUT_MS       (CONFIG_UART_SERVICE_BULK_TIMEOUT_MS)
+#define BULK_TASK_PRIORITY    (CONFIG_UART_SERVICE_BULK_TASK_PRIORITY)
+#define BULK_TASK_STACK_SIZE  4096      // 接收处理在此任务中擦写 flash
+#define BULK_EVENT_QUEUE_LEN  (BULK_WINDOW + 8)   // 窗口内的数据块加上控制消息
+#define BULK_PROGRESS_MS      100       // 进度回调的最小间隔
+#define BULK_CONTROL_MAX      UART_FRAME_ENCODED_MAX(UART_FRAME_BULK_OFFER_LEN + UART_FRAME_BULK_NAME_MAX)
+#define BULK_NO_OFFSET        UINT32_MAX
+
+// 本地请求，与帧的操作码 (uart_frame_bulk_op_t) 共用事件的 op 字段
+#define BULK_LOCAL_SEND       0x80
+#define BULK_LOCAL_ABORT      0x81
+
+/**
+ * @brief 交给批量传输任务的事件
+ *
+ * 所有状态由批量传输任务推进，接收任务只做不能等的事:
+ *   接收方向: 按顺序到达的块拷贝到空闲的接收槽位后以 DATA 事件交出，不连续时立即回复 NAK。
+ *             批量传输任务写入后才回复 ACK，ACK 之前的数据一定已交给接收处理，续传起点可靠。
+ *             发送方在途的块不超过窗口，而槽位数等于窗口，所以按顺序到达的块总有空闲槽位。
+ *   发送方向: 对方的 ACCEPT/ACK/NAK/DONE 等原样转交。
+ */
+typedef struct {
+    uint8_t  op;       // uart_frame_bulk_op_t 或 BULK_LOCAL_*
+    uint8_t  id;       // 传输编号 (帧的 seq)
+    uint8_t  slot;     // DATA: 接收槽位
+    uint8_t  status;   // REJECT / DONE / ABORT: uart_frame_bulk_status_t
+    uint8_t  window;   // ACCEPT
+    uint16_t len;      // DATA: 数据长度; ACCEPT: 最大块长
+    uint32_t offset;   // DATA / ACCEPT / ACK / NAK
+} uart_bulk_event_t;
+
+// OFFER 带名称，放不进事件，经长度为 1 的邮箱交给批量传输任务
+typedef struct {
+    uint8_t  id;
+    uint8_t  kind;
+    uint32_t size;
+    uint32_t crc32;
+    char     name[UART_FRAME_BULK_NAME_MAX + 1];
+} uart_bulk_offer_t;
+
+static uart_bulk_write_t s_write = NULL;
+static QueueHandle_t s_events = NULL;
+static QueueHandle_t s_offer_box = NULL;
+static atomic_bool s_busy;                  // 有传输在进行，由 uart_service_bulk_send 或收到的 OFFER 领取
+
+// --- 接收方向 ---
+// 以下由 s_rx_lock 保护，接收任务据此决定收下、丢弃还是 NAK 一个块
+static portMUX_TYPE s_rx_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_rx_active = false;
+static uint8_t s_rx_id;
+static uint32_t s_rx_size;
+static uint32_t s_rx_expected;              // 下一个按顺序的偏移 (已收下，不一定已写入)
+static uint32_t s_rx_nak_offset;            // 最后一次 NAK 的偏移
+static uint32_t s_rx_nak_trigger;           // 引起该 NAK 的块的偏移
+static uint8_t s_rx_free[BULK_WINDOW];      // 空闲槽位
+static uint8_t s_rx_free_count;
+
+static uint8_t *s_rx_slots = NULL;          // BULK_WINDOW 个块，第一次接收时分配，之后保留 (接收任务可能还在拷贝)
+static atomic_uint s_rx_written;            // 已写入的字节数，接收任务回复重复块时使用
+// 以下只由批量传输任务使用
+static uart_service_bulk_sink_t s_sink;
+static bool s_sink_set = false;
+static bool s_rx_open = false;
+static uint32_t s_rx_crc;                   // 已写入部分的 CRC32
+static uint32_t s_rx_expected_crc;
+static uint8_t s_rx_last_id;                // 最后一次结束的传输，DONE 丢失时据此重发
+static uint8_t s_rx_last_status;
+static bool s_rx_last_valid = false;
+
+// --- 发送方向，只由批量传输任务使用 (uart_service_bulk_send 在领取 s_busy 后写入) ---
+static uart_service_bulk_info_t s_tx_info;
+static char s_tx_name[UART_FRAME_BULK_NAME_MAX + 1];
+static uart_service_bulk_source_t s_tx_source;
+static uint8_t s_tx_id;
+
+// --- 进度和统计 ---
+static int64_t s_start_us;
+static int64_t s_end_us;                    // 0 = 进行中
+static int64_t s_progress_us;
+static atomic_bool s_stat_sending;
+static atomic_uint s_stat_kind;
+static atomic_uint s_stat_size;
+static atomic_uint s_stat_done;
+static atomic_uint s_stat_resumed_from;
+static atomic_uint s_stat_completed;
+static atomic_uint s_stat_failed;
+static atomic_uint s_stat_chunks_sent;
+static atomic_uint s_stat_chunks_resent;
+static atomic_uint s_stat_chunks_received;
+static atomic_uint s_stat_chunks_dropped;
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static esp_err_t uart_bulk_status_to_err(uint8_t status)
+{
+    switch (status) {
+    case UART_FRAME_BULK_OK:        return ESP_OK;
+    case UART_FRAME_BULK_NO_SINK:   return ESP_ERR_NOT_SUPPORTED;
+    case UART_FRAME_BULK_BUSY:      return ESP_ERR_INVALID_STATE;
+    case UART_FRAME_BULK_REFUSED:   return ESP_ERR_NOT_ALLOWED;
+    case UART_FRAME_BULK_BAD_CRC:   return ESP_ERR_INVALID_CRC;
+    case UART_FRAME_BULK_CANCELLED: return ESP_ERR_NOT_FINISHED;
+    case UART_FRAME_BULK_TIMEOUT:   return ESP_ERR_TIMEOUT;
+    default:                        return ESP_FAIL;
+    }
+}
+
+// 两个任务都可以调用 (uart_write 整个调用互斥)
+static void uart_bulk_send_frame(uint8_t op, uint8_t id, const uint8_t *payload, size_t len, uint8_t *out, size_t out_size)
+{
+    uart_frame_t frame = {
+        .type    = UART_FRAME_TYPE_BULK,
+        .seq     = id,
+        .opcode  = op,
+        .payload = payload,
+        .len     = len,
+    };
+    size_t n = uart_frame_encode(&frame, out, out_size);
+    if (n > 0) {
+        s_write(out, n);
+    }
+}
+
+static void uart_bulk_send_control(uint8_t op, uint8_t id, const uint8_t *payload, size_t len)
+{
+    uint8_t out[BULK_CONTROL_MAX];
+    uart_bulk_send_frame(op, id, payload, len, out, sizeof(out));
+}
+
+static void uart_bulk_send_offset(uint8_t op, uint8_t id, uint32_t offset)
+{
+    uint8_t payload[4];
+    put_le32(payload, offset);
+    uart_bulk_send_control(op, id, payload, sizeof(payload));
+}
+
+static void uart_bulk_send_status(uint8_t op, uint8_t id, uart_frame_bulk_status_t status)
+{
+    uint8_t payload[1] = { status };
+    uart_bulk_send_control(op, id, payload, sizeof(payload));
+}
+
+// 开始一次传输的统计
+static void uart_bulk_stats_begin(bool sending, uint8_t kind, uint32_t size, uint32_t offset)
+{
+    atomic_store(&s_stat_sending, sending);
+    atomic_store(&s_stat_kind, kind);
+    atomic_store(&s_stat_size, size);
+    atomic_store(&s_stat_done, offset);
+    atomic_store(&s_stat_resumed_from, offset);
+    s_start_us = esp_timer_get_time();
+    s_end_us = 0;
+    s_progress_us = 0;
+}
+
+// 记录进度，按 BULK_PROGRESS_MS 节流后调用回调
+static void uart_bulk_progress(uint32_t done, void (*progress)(void *, uint32_t, uint32_t), void *ctx)
+{
+    atomic_store(&s_stat_done, done);
+    const uint32_t total = atomic_load(&s_stat_size);
+    const int64_t now = esp_timer_get_time();
+    if (progress != NULL && (done == total || now - s_progress_us >= BULK_PROGRESS_MS * 1000)) {
+        s_progress_us = now;
+        progress(ctx, done, total);
+    }
+}
+
+static uint8_t *uart_bulk_slot(uint8_t slot)
+{
+    return s_rx_slots + (size_t)slot * BULK_CHUNK_SIZE;
+}
+
+static void uart_bulk_release_slot(uint8_t slot)
+{
+    taskENTER_CRITICAL(&s_rx_lock);
+    s_rx_free[s_rx_free_count++] = slot;
+    taskEXIT_CRITICAL(&s_rx_lock);
+}
+
+// [接收任务] 对方发来的数据块
+static void uart_bulk_rx_data(const uart_frame_t *frame)
+{
+    if (frame->len <= UART_FRAME_BULK_DATA_HEADER_LEN) {
+        return;
+    }
+    const uint32_t offset = get_le32(frame->payload);
+    const size_t len = frame->len - UART_FRAME_BULK_DATA_HEADER_LEN;
+    int slot = -1;
+    uint32_t nak = BULK_NO_OFFSET;
+    bool duplicate = false;
+
+    taskENTER_CRITICAL(&s_rx_lock);
+    if (!s_rx_active || frame->seq != s_rx_id) {
+        // OFFER 还在处理中，或者传输已经结束
+    } else if (offset == s_rx_expected) {
+        if (len <= BULK_CHUNK_SIZE && offset + len <= s_rx_size && s_rx_free_count > 0) {
+            slot = s_rx_free[--s_rx_free_count];
+            s_rx_expected += len;
+        }
+    } else if (offset < s_rx_expected) {
+        duplicate = true;
+    } else if (s_rx_nak_offset != s_rx_expected || offset <= s_rx_nak_trigger) {
+        // 中间丢了块: 每个缺口只 NAK 一次，直到发送方重发一轮后又出现缺口
+        nak = s_rx_expected;
+        s_rx_nak_offset = s_rx_expected;
+        s_rx_nak_trigger = offset;
+    }
+    taskEXIT_CRITICAL(&s_rx_lock);
+
+    if (slot < 0) {
+        atomic_fetch_add(&s_stat_chunks_dropped, 1);
+        if (nak != BULK_NO_OFFSET) {
+            uart_bulk_send_offset(UART_FRAME_BULK_NAK, frame->seq, nak);
+        } else if (duplicate) {
+            // 对方没收到 ACK 而重发，告诉它已经写到哪里
+            uart_bulk_send_offset(UART_FRAME_BULK_ACK, frame->seq, atomic_load(&s_rx_written));
+        }
+        return;
+    }
+
+    memcpy(uart_bulk_slot(slot), frame->payload + UART_FRAME_BULK_DATA_HEADER_LEN, len);
+    uart_bulk_event_t ev = {
+        .op = UART_FRAME_BULK_DATA, .id = frame->seq, .slot = slot, .len = len, .offset = offset,
+    };
+    if (xQueueSend(s_events, &ev, 0) != pdTRUE) {
+        // 撤销，等对方重发
+        taskENTER_CRITICAL(&s_rx_lock);
+        if (s_rx_active && s_rx_id == frame->seq && s_rx_expected == offset + len) {
+            s_rx_expected = offset;
+        }
+        s_rx_free[s_rx_free_count++] = slot;
+        taskEXIT_CRITICAL(&s_rx_lock);
+        atomic_fetch_add(&s_stat_chunks_dropped, 1);
+        return;
+    }
+    atomic_fetch_add(&s_stat_chunks_received, 1);
+}
+
+void uart_bulk_on_frame(const uart_frame_t *frame)
+{
+    const uint8_t *p = frame->payload;
+    uart_bulk_event_t ev = { .op = frame->opcode, .id = frame->seq };
+
+    switch (frame->opcode) {
+    case UART_FRAME_BULK_DATA:
+        uart_bulk_rx_data(frame);
+        return;
+    case UART_FRAME_BULK_OFFER: {
+        if (frame->len < UART_FRAME_BULK_OFFER_LEN) {
+            return;
+        }
+        uart_bulk_offer_t offer = {
+            .id    = frame->seq,
+            .kind  = p[0],
+            .size  = get_le32(p + 1),
+            .crc32 = get_le32(p + 5),
+        };
+        size_t name_len = frame->len - UART_FRAME_BULK_OFFER_LEN;
+        if (name_len > UART_FRAME_BULK_NAME_MAX) {
+            name_len = UART_FRAME_BULK_NAME_MAX;
+        }
+        memcpy(offer.name, p + UART_FRAME_BULK_OFFER_LEN, name_len);
+        offer.name[name_len] = '\0';
+        xQueueOverwrite(s_offer_box, &offer);
+        break;
+    }
+    case UART_FRAME_BULK_ACCEPT:
+        if (frame->len < UART_FRAME_BULK_ACCEPT_LEN) {
+            return;
+        }
+        ev.offset = get_le32(p);
+        ev.window = p[4];
+        ev.len = p[5] | (uint16_t)p[6] << 8;
+        break;
+    case UART_FRAME_BULK_ACK:
+    case UART_FRAME_BULK_NAK:
+        if (frame->len < 4) {
+            return;
+        }
+        ev.offset = get_le32(p);
+        break;
+    case UART_FRAME_BULK_REJECT:
+    case UART_FRAME_BULK_DONE:
+    case UART_FRAME_BULK_ABORT:
+        ev.status = frame->len > 0 ? p[0] : UART_FRAME_BULK_CANCELLED;
+        break;
+    case UART_FRAME_BULK_END:
+        break;
+    default:
+        ESP_LOGW(TAG, "Unknown bulk opcode 0x%02x", frame->opcode);
+        return;
+    }
+    if (xQueueSend(s_events, &ev, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Event queue full, bulk opcode 0x%02x dropped", frame->opcode);
+    }
+}
+
+// [批量传输任务] 结束接收并通知接收处理，需要告知对方时由调用者发送 ABORT/DONE
+static void uart_bulk_rx_close(esp_err_t result)
+{
+    taskENTER_CRITICAL(&s_rx_lock);
+    s_rx_active = false;
+    taskEXIT_CRITICAL(&s_rx_lock);
+    s_rx_open = false;
+    s_end_us = esp_timer_get_time();
+    if (s_sink.close != NULL) {
+        s_sink.close(s_sink.ctx, result);
+    }
+    if (result == ESP_OK) {
+        atomic_fetch_add(&s_stat_completed, 1);
+        ESP_LOGI(TAG, "Received %lu bytes", (unsigned long)s_rx_size);
+    } else {
+        atomic_fetch_add(&s_stat_failed, 1);
+        ESP_LOGW(TAG, "Receive failed at %lu/%lu: %s", (unsigned long)atomic_load(&s_rx_written),
+                 (unsigned long)s_rx_size, esp_err_to_name(result));
+    }
+    atomic_store(&s_busy, false);
+}
+
+static void uart_bulk_rx_reject(uint8_t id, uart_frame_bulk_status_t status)
+{
+    ESP_LOGW(TAG, "Rejecting transfer %u: status %d", id, status);
+    uart_bulk_send_status(UART_FRAME_BULK_REJECT, id, status);
+}
+
+static void uart_bulk_send_accept(uint8_t id, uint32_t offset)
+{
+    uint8_t payload[UART_FRAME_BULK_ACCEPT_LEN];
+    put_le32(payload, offset);
+    payload[4] = BULK_WINDOW;
+    payload[5] = BULK_CHUNK_SIZE & 0xFF;
+    payload[6] = BULK_CHUNK_SIZE >> 8;
+    uart_bulk_send_control(UART_FRAME_BULK_ACCEPT, id, payload, sizeof(payload));
+}
+
+// [批量传输任务] 对方提议一次传输
+static void uart_bulk_rx_offer(void)
+{
+    uart_bulk_offer_t offer;
+    if (xQueueReceive(s_offer_box, &offer, 0) != pdTRUE) {
+        return;
+    }
+    if (s_rx_open && offer.id == s_rx_id) {
+        // 对方没收到 ACCEPT 而重发 (还没有发数据)
+        uart_bulk_send_accept(offer.id, atomic_load(&s_rx_written));
+        return;
+    }
+    if (s_rx_open) {
+        // 对方放弃了上一次传输 (例如重启)，已写入的部分可在新的传输中续传
+        uart_bulk_rx_close(ESP_ERR_NOT_FINISHED);
+    }
+    if (!s_sink_set) {
+        uart_bulk_rx_reject(offer.id, UART_FRAME_BULK_NO_SINK);
+        return;
+    }
+    if (atomic_exchange(&s_busy, true)) {
+        uart_bulk_rx_reject(offer.id, UART_FRAME_BULK_BUSY);
+        return;
+    }
+    if (s_rx_slots == NULL) {
+        s_rx_slots = malloc((size_t)BULK_WINDOW * BULK_CHUNK_SIZE);
+        if (s_rx_slots == NULL) {
+            atomic_store(&s_busy, false);
+            uart_bulk_rx_reject(offer.id, UART_FRAME_BULK_REFUSED);
+            return;
+        }
+        for (int i = 0; i < BULK_WINDOW; i++) {
+            uart_bulk_release_slot(i);
+        }
+    }
+
+    const uart_service_bulk_info_t info = {
+        .kind = offer.kind, .size = offer.size, .crc32 = offer.crc32, .name = offer.name,
+    };
+    uint32_t offset = 0;
+    uint32_t crc = 0;
+    esp_err_t err = s_sink.open != NULL ? s_sink.open(s_sink.ctx, &info, &offset, &crc) : ESP_OK;
+    if (err != ESP_OK) {
+        atomic_store(&s_busy, false);
+        uart_bulk_rx_reject(offer.id, UART_FRAME_BULK_REFUSED);
+        return;
+    }
+    if (offset > offer.size) {
+        offset = 0;
+        crc = 0;
+    }
+
+    s_rx_open = true;
+    s_rx_crc = crc;
+    s_rx_expected_crc = offer.crc32;
+    atomic_store(&s_rx_written, offset);
+    uart_bulk_stats_begin(false, offer.kind, offer.size, offset);
+    taskENTER_CRITICAL(&s_rx_lock);
+    s_rx_id = offer.id;
+    s_rx_size = offer.size;
+    s_rx_expected = offset;
+    s_rx_nak_offset = BULK_NO_OFFSET;
+    s_rx_nak_trigger = 0;
+    s_rx_active = true;
+    taskEXIT_CRITICAL(&s_rx_lock);
+    ESP_LOGI(TAG, "Receiving \"%s\" (kind %u, %lu bytes) from offset %lu", offer.name, offer.kind,
+             (unsigned long)offer.size, (unsigned long)offset);
+    uart_bulk_send_accept(offer.id, offset);
+}
+
+// [批量传输任务] 写入一个按顺序收下的块
+static void uart_bulk_rx_write(const uart_bulk_event_t *ev)
+{
+    if (!s_rx_open || ev->id != s_rx_id) {
+        uart_bulk_release_slot(ev->slot);
+        return;
+    }
+    const uint8_t *data = uart_bulk_slot(ev->slot);
+    esp_err_t err = s_sink.write != NULL ? s_sink.write(s_sink.ctx, ev->offset, data, ev->len) : ESP_OK;
+    if (err == ESP_OK) {
+        s_rx_crc = uart_frame_crc32(s_rx_crc, data, ev->len);
+    }
+    uart_bulk_release_slot(ev->slot);
+    if (err != ESP_OK) {
+        uart_bulk_send_status(UART_FRAME_BULK_ABORT, ev->id, UART_FRAME_BULK_IO_ERROR);
+        uart_bulk_rx_close(err);
+        return;
+    }
+    const uint32_t written = ev->offset + ev->len;
+    atomic_store(&s_rx_written, written);
+    uart_bulk_send_offset(UART_FRAME_BULK_ACK, ev->id, written);
+    uart_bulk_progress(written, s_sink.progress, s_sink.ctx);
+}
+
+// [批量传输任务] 发送方已收到全部 ACK，校验整体 CRC32 后回复 DONE
+static void uart_bulk_rx_end(const uart_bulk_event_t *ev)
+{
+    if (!s_rx_open || ev->id != s_rx_id) {
+        if (s_rx_last_valid && ev->id == s_rx_last_id) {
+            // DONE 丢失，对方重发了 END
+            uart_bulk_send_status(UART_FRAME_BULK_DONE, ev->id, s_rx_last_status);
+        }
+        return;
+    }
+    const uint32_t written = atomic_load(&s_rx_written);
+    if (written != s_rx_size) {
+        uart_bulk_send_offset(UART_FRAME_BULK_NAK, ev->id, written);
+        return;
+    }
+    const bool ok = s_rx_crc == s_rx_expected_crc;
+    s_rx_last_id = ev->id;
+    s_rx_last_status = ok ? UART_FRAME_BULK_OK : UART_FRAME_BULK_BAD_CRC;
+    s_rx_last_valid = true;
+    uart_bulk_rx_close(ok ? ESP_OK : ESP_ERR_INVALID_CRC);
+    uart_bulk_send_status(UART_FRAME_BULK_DONE, ev->id, s_rx_last_status);
+}
+
+// [批量传输任务] 不属于当前传输的事件
+static void uart_bulk_discard(const uart_bulk_event_t *ev)
+{
+    switch (ev->op) {
+    case UART_FRAME_BULK_OFFER: {
+        uart_bulk_offer_t offer;
+        if (xQueueReceive(s_offer_box, &offer, 0) == pdTRUE) {
+            uart_bulk_rx_reject(offer.id, UART_FRAME_BULK_BUSY);
+        }
+        break;
+    }
+    case UART_FRAME_BULK_DATA:
+        uart_bulk_release_slot(ev->slot);
+        break;
+    default:
+        break;
+    }
+}
+
+// [批量传输任务] 接收方向的事件 (没有在发送时)
+static void uart_bulk_rx_event(const uart_bulk_event_t *ev)
+{
+    switch (ev->op) {
+    case UART_FRAME_BULK_OFFER:
+        uart_bulk_rx_offer();
+        break;
+    case UART_FRAME_BULK_DATA:
+        uart_bulk_rx_write(ev);
+        break;
+    case UART_FRAME_BULK_END:
+        uart_bulk_rx_end(ev);
+        break;
+    case UART_FRAME_BULK_ABORT:
+        if (s_rx_open && ev->id == s_rx_id) {
+            uart_bulk_rx_close(uart_bulk_status_to_err(ev->status));
+        }
+        break;
+    case BULK_LOCAL_ABORT:
+        if (s_rx_open) {
+            uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_rx_id, UART_FRAME_BULK_CANCELLED);
+            uart_bulk_rx_close(ESP_ERR_NOT_FINISHED);
+        }
+        break;
+    default:
+        uart_bulk_discard(ev);
+        break;
+    }
+}
+
+/**
+ * @brief [批量传输任务] 等待发送方向的事件 (当前传输的帧或本地取消)，其它事件就地处理
+ *
+ * @return true: ev 有效; false: 超时
+ */
+static bool uart_bulk_tx_wait(uart_bulk_event_t *ev, TickType_t timeout)
+{
+    const TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed = 0;
+    while (xQueueReceive(s_events, ev, timeout - elapsed) == pdTRUE) {
+        if (ev->op == BULK_LOCAL_ABORT || (ev->id == s_tx_id && ev->op != UART_FRAME_BULK_OFFER &&
+                                           ev->op != UART_FRAME_BULK_DATA)) {
+            return true;
+        }
+        uart_bulk_discard(ev);
+        elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 发送状态，由 uart_bulk_tx_handle 根据对方的确认推进
+ *
+ * base 之前的数据对方已写入；next 是下一个要发送的偏移；high 是发出过的最大偏移，
+ * 低于它的块再发一次即为重发。
+ */
+typedef struct {
+    uint32_t   base;
+    uint32_t   next;
+    uint32_t   high;
+    uint32_t   window;        // 字节
+    size_t     chunk;
+    int        timeouts;      // 连续没有进展的超时次数
+    TickType_t last_activity; // 最后一次写出数据块或收到进展的时间
+} uart_bulk_tx_state_t;
+
+// [批量传输任务] 处理一个发送方向的事件。返回 ESP_OK 继续，其它值为传输结束的原因
+static esp_err_t uart_bulk_tx_handle(uart_bulk_tx_state_t *st, const uart_bulk_event_t *ev)
+{
+    switch (ev->op) {
+    case UART_FRAME_BULK_ACK:
+        if (ev->offset > st->base && ev->offset <= st->high) {
+            st->base = ev->offset;
+            if (st->next < st->base) {
+                st->next = st->base;
+            }
+            st->timeouts = 0;
+            st->last_activity = xTaskGetTickCount();
+            uart_bulk_progress(st->base, s_tx_source.progress, s_tx_source.ctx);
+        }
+        return ESP_OK;
+    case UART_FRAME_BULK_NAK:
+        if (ev->offset >= st->base && ev->offset < st->next) {
+            st->next = ev->offset;
+        }
+        return ESP_OK;
+    case UART_FRAME_BULK_ABORT:
+        ESP_LOGW(TAG, "Transfer %u aborted by peer: status %d", s_tx_id, ev->status);
+        return ev->status == UART_FRAME_BULK_OK ? ESP_FAIL : uart_bulk_status_to_err(ev->status);
+    case BULK_LOCAL_ABORT:
+        uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_tx_id, UART_FRAME_BULK_CANCELLED);
+        return ESP_ERR_NOT_FINISHED;
+    default:
+        return ESP_OK;
+    }
+}
+
+// [批量传输任务] OFFER 并等待 ACCEPT，最多 BULK_TIMEOUT_MS
+static esp_err_t uart_bulk_tx_offer(uart_bulk_tx_state_t *st)
+{
+    uint8_t payload[UART_FRAME_BULK_OFFER_LEN + UART_FRAME_BULK_NAME_MAX];
+    const size_t name_len = strlen(s_tx_name);
+    payload[0] = s_tx_info.kind;
+    put_le32(payload + 1, s_tx_info.size);
+    put_le32(payload + 5, s_tx_info.crc32);
+    memcpy(payload + UART_FRAME_BULK_OFFER_LEN, s_tx_name, name_len);
+
+    const TickType_t start = xTaskGetTickCount();
+    while (xTaskGetTickCount() - start < pdMS_TO_TICKS(BULK_TIMEOUT_MS)) {
+        uart_bulk_send_control(UART_FRAME_BULK_OFFER, s_tx_id, payload, UART_FRAME_BULK_OFFER_LEN + name_len);
+        uart_bulk_event_t ev;
+        const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(BULK_ACK_TIMEOUT_MS);
+        TickType_t now;
+        while ((int32_t)(deadline - (now = xTaskGetTickCount())) > 0 && uart_bulk_tx_wait(&ev, deadline - now)) {
+            switch (ev.op) {
+            case UART_FRAME_BULK_ACCEPT:
+                if (ev.offset > s_tx_info.size || ev.window == 0 || ev.len == 0) {
+                    return ESP_ERR_INVALID_RESPONSE;
+                }
+                st->chunk = ev.len < BULK_CHUNK_SIZE ? ev.len : BULK_CHUNK_SIZE;
+                st->window = (uint32_t)ev.window * st->chunk;
+                st->base = st->next = st->high = ev.offset;
+                return ESP_OK;
+            case UART_FRAME_BULK_REJECT:
+                ESP_LOGW(TAG, "Transfer %u rejected: status %d", s_tx_id, ev.status);
+                return ev.status == UART_FRAME_BULK_OK ? ESP_FAIL : uart_bulk_status_to_err(ev.status);
+            case UART_FRAME_BULK_ABORT:
+            case BULK_LOCAL_ABORT: {
+                uart_bulk_tx_state_t unused = { 0 };
+                return uart_bulk_tx_handle(&unused, &ev);
+            }
+            default:
+                break;
+            }
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+// [批量传输任务] 发送窗口内的数据块直到全部被确认
+static esp_err_t uart_bulk_tx_data(uart_bulk_tx_state_t *st, uint8_t *buf, uint8_t *frame, size_t frame_size)
+{
+    uart_bulk_event_t ev;
+    esp_err_t err;
+
+    st->last_activity = xTaskGetTickCount();
+    while (st->base < s_tx_info.size) {
+        while (st->next < s_tx_info.size && st->next - st->base < st->window) {
+            const size_t len = s_tx_info.size - st->next < st->chunk ? s_tx_info.size - st->next : st->chunk;
+            err = s_tx_source.read(s_tx_source.ctx, st->next, buf + UART_FRAME_BULK_DATA_HEADER_LEN, len);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "Source read at %lu failed: %s", (unsigned long)st->next, esp_err_to_name(err));
+                uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_tx_id, UART_FRAME_BULK_IO_ERROR);
+                return err;
+            }
+            put_le32(buf, st->next);
+            uart_bulk_send_frame(UART_FRAME_BULK_DATA, s_tx_id, buf, UART_FRAME_BULK_DATA_HEADER_LEN + len, frame, frame_size);
+            atomic_fetch_add(&s_stat_chunks_sent, 1);
+            if (st->next < st->high) {
+                atomic_fetch_add(&s_stat_chunks_resent, 1);
+            }
+            st->next += len;
+            if (st->next > st->high) {
+                st->high = st->next;
+            }
+            st->last_activity = xTaskGetTickCount();
+            // 写出这一块期间到达的确认立即处理，窗口尽早前移
+            while (xQueueReceive(s_events, &ev, 0) == pdTRUE) {
+                if (ev.op != BULK_LOCAL_ABORT && (ev.id != s_tx_id || ev.op == UART_FRAME_BULK_OFFER ||
+                                                  ev.op == UART_FRAME_BULK_DATA)) {
+                    uart_bulk_discard(&ev);
+                } else if ((err = uart_bulk_tx_handle(st, &ev)) != ESP_OK) {
+                    return err;
+                }
+            }
+        }
+        if (st->base >= s_tx_info.size) {
+            break;
+        }
+
+        const TickType_t deadline = st->last_activity + pdMS_TO_TICKS(BULK_ACK_TIMEOUT_MS);
+        const TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) > 0 && uart_bulk_tx_wait(&ev, deadline - now)) {
+            if ((err = uart_bulk_tx_handle(st, &ev)) != ESP_OK) {
+                return err;
+            }
+            continue;
+        }
+        if ((int32_t)(deadline - xTaskGetTickCount()) > 0) {
+            continue;
+        }
+        // 超时没有进展: 从最早未确认的块重发
+        if (++st->timeouts > BULK_RETRIES) {
+            uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_tx_id, UART_FRAME_BULK_TIMEOUT);
+            return ESP_ERR_TIMEOUT;
+        }
+        ESP_LOGD(TAG, "No ACK for %d ms, resending from %lu", BULK_ACK_TIMEOUT_MS, (unsigned long)st->base);
+        st->next = st->base;
+        st->last_activity = xTaskGetTickCount();
+    }
+    return ESP_OK;
+}
+
+// [批量传输任务] 一次完整的发送
+static esp_err_t uart_bulk_tx_run(void)
+{
+    uart_bulk_tx_state_t st = { 0 };
+    s_tx_id = s_tx_id == 0xFF ? 1 : s_tx_id + 1;
+
+    esp_err_t err = uart_bulk_tx_offer(&st);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "Sending \"%s\" (kind %u, %lu bytes) from offset %lu, window %lu x %u", s_tx_name, s_tx_info.kind,
+             (unsigned long)s_tx_info.size, (unsigned long)st.base, (unsigned long)(st.window / st.chunk), (unsigned)st.chunk);
+    uart_bulk_stats_begin(true, s_tx_info.kind, s_tx_info.size, st.base);
+
+    const size_t frame_size = UART_FRAME_ENCODED_MAX(UART_FRAME_BULK_DATA_HEADER_LEN + st.chunk);
+    uint8_t *buf = malloc(UART_FRAME_BULK_DATA_HEADER_LEN + st.chunk + frame_size);
+    if (buf == NULL) {
+        uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_tx_id, UART_FRAME_BULK_IO_ERROR);
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t *frame = buf + UART_FRAME_BULK_DATA_HEADER_LEN + st.chunk;
+
+    for (int attempt = 0; attempt <= BULK_RETRIES;) {
+        err = uart_bulk_tx_data(&st, buf, frame, frame_size);
+        if (err != ESP_OK) {
+            break;
+        }
+        // 全部确认，等对方校验整体 CRC32
+        uart_bulk_send_control(UART_FRAME_BULK_END, s_tx_id, NULL, 0);
+        err = ESP_ERR_TIMEOUT;
+        uart_bulk_event_t ev;
+        if (uart_bulk_tx_wait(&ev, pdMS_TO_TICKS(BULK_ACK_TIMEOUT_MS))) {
+            if (ev.op == UART_FRAME_BULK_DONE) {
+                err = uart_bulk_status_to_err(ev.status);
+                break;
+            }
+            if (ev.op == UART_FRAME_BULK_NAK && ev.offset < s_tx_info.size) {
+                // 对方缺数据 (不应发生)，回到数据阶段
+                st.base = st.next = ev.offset;
+                attempt++;
+                continue;
+            }
+            if ((err = uart_bulk_tx_handle(&st, &ev)) != ESP_OK) {
+                break;
+            }
+            continue;   // 迟到的 ACK 等，重新等待 (END 会再发一次)
+        }
+        attempt++;
+    }
+    free(buf);
+    return err;
+}
+
+static void uart_bulk_task(void *arg)
+{
+    uart_bulk_event_t ev;
+    while (1) {
+        // 接收中长时间没有数据: 对方可能已断开，释放传输 (已写入的部分可续传)
+        if (xQueueReceive(s_events, &ev, s_rx_open ? pdMS_TO_TICKS(BULK_TIMEOUT_MS) : portMAX_DELAY) != pdTRUE) {
+            if (s_rx_open) {
+                uart_bulk_send_status(UART_FRAME_BULK_ABORT, s_rx_id, UART_FRAME_BULK_TIMEOUT);
+                uart_bulk_rx_close(ESP_ERR_TIMEOUT);
+            }
+            continue;
+        }
+        if (ev.op != BULK_LOCAL_SEND) {
+            uart_bulk_rx_event(&ev);
+            continue;
+        }
+
+        esp_err_t err = uart_bulk_tx_run();
+        s_end_us = esp_timer_get_time();
+        if (err == ESP_OK) {
+            atomic_fetch_add(&s_stat_completed, 1);
+            ESP_LOGI(TAG, "Sent %lu bytes", (unsigned long)s_tx_info.size);
+        } else {
+            atomic_fetch_add(&s_stat_failed, 1);
+            ESP_LOGW(TAG, "Send failed at %lu/%lu: %s", (unsigned long)atomic_load(&s_stat_done),
+                     (unsigned long)s_tx_info.size, esp_err_to_name(err));
+        }
+        const uart_service_bulk_source_t source = s_tx_source;
+        atomic_store(&s_busy, false);
+        if (source.done != NULL) {
+            source.done(source.ctx, err);
+        }
+    }
+}
+
+esp_err_t uart_bulk_init(uart_bulk_write_t write)
+{
+    s_write = write;
+    s_events = xQueueCreate(BULK_EVENT_QUEUE_LEN, sizeof(uart_bulk_event_t));
+    s_offer_box = xQueueCreate(1, sizeof(uart_bulk_offer_t));
+    if (s_events == NULL || s_offer_box == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(uart_bulk_task, "uart_bulk_task", BULK_TASK_STACK_SIZE, NULL, BULK_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_service_bulk_send(const uart_service_bulk_info_t *info, const uart_service_bulk_source_t *source)
+{
+    if (info == NULL || source == NULL || source->read == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_events == NULL || atomic_exchange(&s_busy, true)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_tx_info = *info;
+    s_tx_name[0] = '\0';
+    if (info->name != NULL) {
+        strncpy(s_tx_name, info->name, UART_FRAME_BULK_NAME_MAX);
+        s_tx_name[UART_FRAME_BULK_NAME_MAX] = '\0';
+    }
+    s_tx_info.name = s_tx_name;
+    s_tx_source = *source;
+
+    uart_bulk_event_t ev = { .op = BULK_LOCAL_SEND };
+    if (xQueueSend(s_events, &ev, 0) != pdTRUE) {
+        atomic_store(&s_busy, false);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+void uart_service_register_bulk_sink(const uart_service_bulk_sink_t *sink)
+{
+    if (sink != NULL) {
+        s_sink = *sink;
+    }
+    s_sink_set = sink != NULL;
+}
+
+esp_err_t uart_service_bulk_abort(void)
+{
+    if (s_events == NULL || !atomic_load(&s_busy)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart_bulk_event_t ev = { .op = BULK_LOCAL_ABORT };
+    return xQueueSend(s_events, &ev, 0) == pdTRUE ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+void uart_service_get_bulk_stats(uart_service_bulk_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->active = atomic_load(&s_busy);
+    stats->sending = atomic_load(&s_stat_sending);
+    stats->kind = atomic_load(&s_stat_kind);
+    stats->size = atomic_load(&s_stat_size);
+    stats->done = atomic_load(&s_stat_done);
+    stats->resumed_from = atomic_load(&s_stat_resumed_from);
+    const int64_t elapsed_us = (s_end_us != 0 ? s_end_us : esp_timer_get_time()) - s_start_us;
+    stats->bytes_per_s = elapsed_us > 0 && stats->done > stats->resumed_from
+                         ? (uint32_t)((uint64_t)(stats->done - stats->resumed_from) * 1000000 / elapsed_us) : 0;
+    stats->completed = atomic_load(&s_stat_completed);
+    stats->failed = atomic_load(&s_stat_failed);
+    stats->chunks_sent = atomic_load(&s_stat_chunks_sent);
+    stats->chunks_resent = atomic_load(&s_stat_chunks_resent);
+    stats->chunks_received = atomic_load(&s_stat_chunks_received);
+    stats->chunks_dropped = atomic_load(&s_stat_chunks_dropped);
+}
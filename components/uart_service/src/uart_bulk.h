@@ -0,0 +1,28 @@
+#ifndef UART_BULK_H
+#define UART_BULK_H
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "uart_frame.h"
+
+/*
+ * uart_service 的批量传输 (见 uart_frame.h 中的 UART_FRAME_TYPE_BULK)，只供 uart_service.c 使用。
+ * 公共接口 uart_service_bulk_* 也在 uart_bulk.c 中实现。
+ */
+
+/**
+ * @brief 写出一段数据，整个调用互斥 (uart_service 的 uart_write，同时记录发送时间)
+ */
+typedef int (*uart_bulk_write_t)(const void *data, size_t len);
+
+/**
+ * @brief 创建批量传输任务
+ */
+esp_err_t uart_bulk_init(uart_bulk_write_t write);
+
+/**
+ * @brief [接收任务] 处理一个 UART_FRAME_TYPE_BULK 帧，返回后 payload 不再被引用
+ */
+void uart_bulk_on_frame(const uart_frame_t *frame);
+
+#endif // UART_BULK_H
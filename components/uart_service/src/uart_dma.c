@@ -0,0 +1,218 @@
+#include "uart_dma.h"
+#include "driver/uart.h"
+#include "driver/uhci.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_check.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "UART_DMA";
+
+#define UART_DMA_RX_BUF_SIZE   (CONFIG_UART_SERVICE_DMA_RX_BUF_SIZE)
+#define UART_DMA_TX_BUF_SIZE   (CONFIG_UART_SERVICE_DMA_TX_BUF_SIZE)
+#define UART_DMA_BUFFERS       2
+#define UART_DMA_RX_QUEUE_LEN  16        // ISR -> 接收任务的事件队列深度
+#define UART_DMA_TX_TIMEOUT_MS 100       // 等待空闲发送缓冲区的最长时间
+#define UART_DMA_BURST_SIZE    32
+
+// 中断回调交给接收任务的一段数据
+typedef struct {
+    uint8_t *data;
+    uint16_t len;
+    bool     done;   // 本次接收结束 (空闲 EOF 或缓冲区满)，需要切换缓冲区
+} uart_dma_rx_event_t;
+
+static uhci_controller_handle_t s_uhci = NULL;
+static int s_uart_port;
+
+/*
+ * 接收: 两个缓冲区轮流交给 DMA。一次接收结束时接收任务先把另一个缓冲区交给 DMA，
+ * 再处理刚结束的这个，所以处理数据期间 DMA 不会停，数据也不需要再拷贝一次。
+ */
+static uint8_t *s_rx_buf[UART_DMA_BUFFERS];
+static uint8_t s_rx_active;          // 正在接收的缓冲区，只由接收任务修改
+static size_t s_rx_filled;           // 当前缓冲区已收到的字节数，只由接收任务修改
+static bool s_rx_armed;              // 当前缓冲区已交给 DMA，只由接收任务修改
+static QueueHandle_t s_rx_events = NULL;
+static atomic_bool s_rx_done_lost;   // 结束事件因队列满丢失，接收任务需要自行切换缓冲区
+
+/*
+ * 发送: 两个缓冲区轮流使用，驱动按提交顺序完成，s_tx_free 计数空闲的缓冲区。
+ * 拿到一个计数时最早提交的那个缓冲区一定已经发完，正好是 s_tx_next。
+ */
+static uint8_t *s_tx_buf[UART_DMA_BUFFERS];
+static uint8_t s_tx_next;            // 受 s_tx_lock 保护
+static SemaphoreHandle_t s_tx_free = NULL;
+static SemaphoreHandle_t s_tx_lock = NULL;
+
+static atomic_uint s_rx_event_count;
+static atomic_uint s_rx_bytes;
+static atomic_uint s_rx_rearm_errors;
+static atomic_uint s_rx_overruns;
+static atomic_uint s_tx_transfers;
+static atomic_uint s_tx_bytes;
+static atomic_uint s_tx_waits;
+
+static bool IRAM_ATTR uart_dma_on_rx(uhci_controller_handle_t ctrl, const uhci_rx_event_data_t *edata, void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    uart_dma_rx_event_t event = {
+        .data = edata->data,
+        .len  = (uint16_t)edata->recv_size,
+        .done = edata->flags.totally_received,
+    };
+    if (xQueueSendFromISR(s_rx_events, &event, &woken) != pdTRUE) {
+        atomic_fetch_add(&s_rx_overruns, 1);
+        if (event.done) {
+            atomic_store(&s_rx_done_lost, true);
+        }
+    }
+    return woken == pdTRUE;
+}
+
+static bool IRAM_ATTR uart_dma_on_tx_done(uhci_controller_handle_t ctrl, const uhci_tx_done_event_data_t *edata, void *user_ctx)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(s_tx_free, &woken);
+    return woken == pdTRUE;
+}
+
+// [接收任务] 把当前缓冲区交给 DMA
+static void uart_dma_arm_rx(void)
+{
+    s_rx_filled = 0;
+    s_rx_armed = uhci_receive(s_uhci, s_rx_buf[s_rx_active], UART_DMA_RX_BUF_SIZE) == ESP_OK;
+    if (!s_rx_armed) {
+        atomic_fetch_add(&s_rx_rearm_errors, 1);
+    }
+}
+
+esp_err_t uart_dma_init(int uart_port)
+{
+    s_uart_port = uart_port;
+    for (int i = 0; i < UART_DMA_BUFFERS; i++) {
+        s_rx_buf[i] = heap_caps_calloc(1, UART_DMA_RX_BUF_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        s_tx_buf[i] = heap_caps_calloc(1, UART_DMA_TX_BUF_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (s_rx_buf[i] == NULL || s_tx_buf[i] == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    s_rx_events = xQueueCreate(UART_DMA_RX_QUEUE_LEN, sizeof(uart_dma_rx_event_t));
+    s_tx_free = xSemaphoreCreateCounting(UART_DMA_BUFFERS, UART_DMA_BUFFERS);
+    s_tx_lock = xSemaphoreCreateMutex();
+    if (s_rx_events == NULL || s_tx_free == NULL || s_tx_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uhci_controller_config_t uhci_config = {
+        .uart_port = uart_port,
+        .tx_trans_queue_depth = UART_DMA_BUFFERS,
+        .max_transmit_size = UART_DMA_TX_BUF_SIZE,
+        .max_receive_internal_mem = UART_DMA_RX_BUF_SIZE,
+        .dma_burst_size = UART_DMA_BURST_SIZE,
+        .rx_eof_flags.idle_eof = 1,
+    };
+    ESP_RETURN_ON_ERROR(uhci_new_controller(&uhci_config, &s_uhci), TAG, "uhci controller failed");
+    const uhci_event_callbacks_t callbacks = {
+        .on_rx_trans_event = uart_dma_on_rx,
+        .on_tx_trans_done = uart_dma_on_tx_done,
+    };
+    ESP_RETURN_ON_ERROR(uhci_register_event_callbacks(s_uhci, &callbacks, NULL), TAG, "uhci callbacks failed");
+
+    s_rx_active = 0;
+    uart_dma_arm_rx();
+    ESP_RETURN_ON_FALSE(s_rx_armed, ESP_FAIL, TAG, "uhci receive failed");
+    ESP_LOGI(TAG, "UART%d using UHCI + GDMA (rx 2 x %d B, tx 2 x %d B)", uart_port,
+             UART_DMA_RX_BUF_SIZE, UART_DMA_TX_BUF_SIZE);
+    return ESP_OK;
+}
+
+const uint8_t *uart_dma_receive(size_t *len, bool *idle, TickType_t wait)
+{
+    if (atomic_exchange(&s_rx_done_lost, false)) {
+        s_rx_active ^= 1;
+        s_rx_armed = false;
+    }
+    if (!s_rx_armed) {
+        // 上次切换失败或结束事件丢失，DMA 没有在接收，先重新开始
+        uart_dma_arm_rx();
+    }
+
+    uart_dma_rx_event_t event;
+    if (xQueueReceive(s_rx_events, &event, wait) != pdTRUE) {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&s_rx_event_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_rx_bytes, event.len, memory_order_relaxed);
+
+    s_rx_filled += event.len;
+    *len = event.len;
+    *idle = event.done && s_rx_filled < UART_DMA_RX_BUF_SIZE;
+    if (event.done) {
+        // 先让 DMA 接着收到另一个缓冲区，调用者随后处理的仍是刚结束的这个
+        s_rx_active ^= 1;
+        uart_dma_arm_rx();
+    }
+    return event.data;
+}
+
+int uart_dma_write(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t written = 0;
+
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    while (written < len) {
+        if (xSemaphoreTake(s_tx_free, 0) != pdTRUE) {
+            atomic_fetch_add_explicit(&s_tx_waits, 1, memory_order_relaxed);
+            if (xSemaphoreTake(s_tx_free, pdMS_TO_TICKS(UART_DMA_TX_TIMEOUT_MS)) != pdTRUE) {
+                ESP_LOGW(TAG, "DMA transmit stalled, %u bytes dropped", (unsigned)(len - written));
+                break;
+            }
+        }
+        size_t n = len - written < UART_DMA_TX_BUF_SIZE ? len - written : UART_DMA_TX_BUF_SIZE;
+        uint8_t *buf = s_tx_buf[s_tx_next];
+        memcpy(buf, p + written, n);
+        if (uhci_transmit(s_uhci, buf, n) != ESP_OK) {
+            xSemaphoreGive(s_tx_free);
+            ESP_LOGW(TAG, "uhci transmit failed, %u bytes dropped", (unsigned)(len - written));
+            break;
+        }
+        s_tx_next ^= 1;
+        written += n;
+        atomic_fetch_add_explicit(&s_tx_transfers, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s_tx_bytes, n, memory_order_relaxed);
+    }
+    xSemaphoreGive(s_tx_lock);
+    return (int)written;
+}
+
+void uart_dma_wait_tx_done(TickType_t wait)
+{
+    uhci_wait_all_tx_transaction_done(s_uhci, (int)pdTICKS_TO_MS(wait));
+    // DMA 完成时最后一批数据还在 UART FIFO 中，按当前波特率等它移出
+    uint32_t baud = 0;
+    uart_get_baudrate(s_uart_port, &baud);
+    if (baud > 0) {
+        vTaskDelay(pdMS_TO_TICKS(UART_HW_FIFO_LEN(s_uart_port) * 10 * 1000 / baud + 1));
+    }
+}
+
+void uart_dma_get_stats(uart_service_dma_stats_t *stats)
+{
+    stats->enabled = true;
+    stats->rx_events = atomic_load(&s_rx_event_count);
+    stats->rx_bytes = atomic_load(&s_rx_bytes);
+    stats->rx_rearm_errors = atomic_load(&s_rx_rearm_errors);
+    stats->rx_overruns = atomic_load(&s_rx_overruns);
+    stats->tx_transfers = atomic_load(&s_tx_transfers);
+    stats->tx_bytes = atomic_load(&s_tx_bytes);
+    stats->tx_waits = atomic_load(&s_tx_waits);
+}
@@ -0,0 +1,52 @@
+#ifndef UART_DMA_H
+#define UART_DMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "uart_service.h"
+
+/*
+ * uart_service 的 UHCI + GDMA 传输 (CONFIG_UART_SERVICE_DMA)，只供 uart_service.c 使用。
+ * 调用前 UART 已由 uart_param_config / uart_set_pin 配置好，但不安装 UART 驱动。
+ */
+
+/**
+ * @brief 创建 UHCI 控制器、分配收发缓冲区并开始接收
+ */
+esp_err_t uart_dma_init(int uart_port);
+
+/**
+ * @brief [接收任务] 等待下一段收到的数据
+ *
+ * 返回的数据直接指向 DMA 接收缓冲区，在下一次调用 uart_dma_receive 之前有效。
+ *
+ * @param len  输出数据长度
+ * @param idle 输出本段是否以发送端空闲结束 (对应驱动的 RX 超时)
+ * @param wait 最长等待时间
+ * @return 数据指针；超时返回 NULL
+ */
+const uint8_t *uart_dma_receive(size_t *len, bool *idle, TickType_t wait);
+
+/**
+ * @brief 写出数据，可在任意任务中调用
+ *
+ * 数据拷贝到空闲的发送缓冲区后立即返回，两个缓冲区都在发送时等待其中一个完成。
+ *
+ * @return 写出的字节数
+ */
+int uart_dma_write(const void *data, size_t len);
+
+/**
+ * @brief 等待已写出的数据全部离开 UART (切换波特率之前)
+ */
+void uart_dma_wait_tx_done(TickType_t wait);
+
+/**
+ * @brief 读取 DMA 统计
+ */
+void uart_dma_get_stats(uart_service_dma_stats_t *stats);
+
+#endif // UART_DMA_H
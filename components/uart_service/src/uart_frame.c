@@ -0,0 +1,126 @@
+#include "uart_frame.h"
+#include <string.h>
+
+uint16_t uart_frame_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// 半字节查表，16 项表格兼顾速度和 ROM 占用
+static const uint32_t s_crc32_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t uart_frame_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ s_crc32_table[crc & 0x0F];
+        crc = (crc >> 4) ^ s_crc32_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+size_t uart_frame_cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t code_pos = 0;   // 当前分组长度字节的位置
+    size_t out = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (src[i] != 0) {
+            dst[out++] = src[i];
+            code++;
+        }
+        if (src[i] == 0 || code == 0xFF) {
+            dst[code_pos] = code;
+            code = 1;
+            code_pos = out++;
+            // 正好以满 254 字节的分组结尾时不再需要额外的分组
+            if (src[i] != 0 && i + 1 == len) {
+                return out - 1;
+            }
+        }
+    }
+    dst[code_pos] = code;
+    return out;
+}
+
+size_t uart_frame_cobs_decode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            dst[out++] = src[in++];
+        }
+        if (code != 0xFF && in < len) {
+            dst[out++] = 0;
+        }
+    }
+    return out;
+}
+
+size_t uart_frame_encode(const uart_frame_t *frame, uint8_t *out, size_t out_size)
+{
+    const size_t raw_len = UART_FRAME_HEADER_LEN + frame->len + UART_FRAME_CRC_LEN;
+    if (out_size < UART_FRAME_ENCODED_MAX(frame->len)) {
+        return 0;
+    }
+
+    // 原始帧先放在输出缓冲区的末尾，再从头部开始编码；编码结果最多比原始帧多 raw_len / 254 + 1 字节，
+    // 而末尾预留了这些空间加上前分隔符，所以编码写入永远不会追上尚未读取的原始数据
+    uint8_t *raw = out + out_size - raw_len;
+    raw[0] = UART_FRAME_VERSION;
+    raw[1] = (frame->type & 0x0F) | (frame->flags & 0xF0);
+    raw[2] = frame->seq;
+    raw[3] = frame->opcode;
+    if (frame->len > 0) {
+        memmove(raw + UART_FRAME_HEADER_LEN, frame->payload, frame->len);
+    }
+    uint16_t crc = uart_frame_crc16(raw, raw_len - UART_FRAME_CRC_LEN);
+    raw[raw_len - 2] = crc & 0xFF;
+    raw[raw_len - 1] = crc >> 8;
+
+    out[0] = UART_FRAME_DELIMITER;
+    size_t n = uart_frame_cobs_encode(raw, raw_len, out + 1);
+    out[1 + n] = UART_FRAME_DELIMITER;
+    return n + 2;
+}
+
+esp_err_t uart_frame_decode(uint8_t *buf, size_t len, uart_frame_t *frame)
+{
+    size_t n = uart_frame_cobs_decode(buf, len, buf);
+    if (n < UART_FRAME_HEADER_LEN + UART_FRAME_CRC_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint16_t crc = buf[n - 2] | (uint16_t)buf[n - 1] << 8;
+    if (crc != uart_frame_crc16(buf, n - UART_FRAME_CRC_LEN)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (buf[0] != UART_FRAME_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    frame->type = buf[1] & 0x0F;
+    frame->flags = buf[1] & 0xF0;
+    frame->seq = buf[2];
+    frame->opcode = buf[3];
+    frame->payload = buf + UART_FRAME_HEADER_LEN;
+    frame->len = n - UART_FRAME_HEADER_LEN - UART_FRAME_CRC_LEN;
+    return ESP_OK;
+}
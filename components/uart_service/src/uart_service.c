@@ -1,12 +1,21 @@
 
 #include "uart_service.h"  
+#include "uart_frame.h"
 #include "driver/uart.h"  
+#include "esp_timer.h"
 #include "esp_log.h"  
 #include "freertos/FreeRTOS.h"  
 #include "freertos/task.h"  
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include <string.h>  
+#include <stdatomic.h>
 #include "esp_check.h"
 #include "sdkconfig.h"
+#include "uart_bulk.h"
+#if CONFIG_UART_SERVICE_DMA
+#include "uart_dma.h"
+#endif
 
 static const char *TAG = "UART_SERVICE";  
 
@@ -16,49 +25,869 @@ static const char *TAG = "UART_SERVICE";
 #define UART_BAUD_RATE (CONFIG_UART_SERVICE_BAUD_RATE)  
 #define UART_BUF_SIZE  (1024)  
 #define UART_TASK_STACK_SIZE 3072 
+#define UART_EVENT_QUEUE_LEN  20        // UART 驱动事件队列深度
+#define UART_LINE_TERMINATOR  '\n'
+#define UART_READ_CHUNK       128       // 每次从驱动环形缓冲区取出的字节数
+#define UART_LINE_MAX         (CONFIG_UART_SERVICE_LINE_MAX)
+#define UART_TX_QUEUE_LEN     (CONFIG_UART_SERVICE_TX_QUEUE_LEN)
+#define UART_TX_SLOT_SIZE     (CONFIG_UART_SERVICE_TX_SLOT_SIZE)
+#define UART_TX_TASK_STACK_SIZE 2048
+#define UART_TX_TASK_PRIORITY 10
+#define UART_BULK_FRAME_LEN   (UART_FRAME_BULK_DATA_HEADER_LEN + CONFIG_UART_SERVICE_BULK_CHUNK_SIZE)
+// 同时容纳一行文本、一个编码后的帧或一个编码后的批量数据块
+#define UART_RX_BUF_SIZE      UART_FRAME_ENCODED_MAX(UART_LINE_MAX > UART_BULK_FRAME_LEN ? UART_LINE_MAX : UART_BULK_FRAME_LEN)
+#define UART_FRAME_ACK_TIMEOUT_MS (CONFIG_UART_SERVICE_FRAME_ACK_TIMEOUT_MS)
+#define UART_FRAME_RETRIES    (CONFIG_UART_SERVICE_FRAME_RETRIES)
+#define UART_ACK_QUEUE_LEN    4
+#define UART_RTS_PIN          (CONFIG_UART_SERVICE_RTS_PIN)
+#define UART_CTS_PIN          (CONFIG_UART_SERVICE_CTS_PIN)
+#define UART_RTS_THRESHOLD    100       // RX FIFO 中有这么多字节时拉高 RTS (FIFO 128 字节)
+#define UART_LINK_POLL_MS     50        // 接收任务检查链路状态的间隔
+#define UART_LINK_ERROR_WINDOW_MS 1000  // 错误率统计窗口
+#define UART_LINK_RETRY_MS    60000     // 协商失败或回退后，发起方再次尝试的间隔
+#define UART_HEARTBEAT_PERIOD_MS  (CONFIG_UART_SERVICE_HEARTBEAT_PERIOD_MS)
+#define UART_HEARTBEAT_TIMEOUT_MS (CONFIG_UART_SERVICE_HEARTBEAT_TIMEOUT_MS)
+#define UART_HEARTBEAT_CHECK_MS   10    // 超时检查间隔，断线在 TIMEOUT + CHECK 之内被发现
+#define UART_HEARTBEAT_LINE       "HB"
+// 接收任务最长阻塞时间: 同时负责链路协商检查和发送心跳
+#if UART_HEARTBEAT_PERIOD_MS > 0 && UART_HEARTBEAT_PERIOD_MS < UART_LINK_POLL_MS
+#define UART_RX_POLL_MS       UART_HEARTBEAT_PERIOD_MS
+#else
+#define UART_RX_POLL_MS       UART_LINK_POLL_MS
+#endif
+
+_Static_assert((UART_TX_QUEUE_LEN & (UART_TX_QUEUE_LEN - 1)) == 0, "UART_SERVICE_TX_QUEUE_LEN must be a power of two");
 
 static uart_service_handler_t s_command_handler = NULL; 
 static uart_service_handler_t s_status_handler = NULL;  
 static const char* STATUS_PREFIX = "STATUS:";
 static size_t STATUS_PREFIX_LEN = 7; 
 
-//接收和处理 UART 数据  
+#if !CONFIG_UART_SERVICE_DMA
+static QueueHandle_t s_uart_event_queue = NULL;
+#endif
+
+/**
+ * @brief 发送队列的一个槽位
+ *
+ * 发送队列是有界的多生产者单消费者无锁环形队列 (每个槽位带序号)：
+ * 生产者用 CAS 领取写入位置，把数据直接拷贝到槽位后发布序号；
+ * 只有发送任务读取，在槽位内补上换行后一次写出，写完再把槽位还给生产者。
+ * seq == 位置      : 空闲，可由领取到该位置的生产者写入
+ * seq == 位置 + 1  : 已写入，等待发送
+ */
+typedef struct {
+    atomic_uint seq;
+    uint16_t    len;
+    uint8_t     opcode;                      // 0 表示文本行；非 0 为内部消息，总是以该操作码的帧发送
+    char        data[UART_TX_SLOT_SIZE + 1]; // +1 给发送任务追加的 '\n'
+} uart_tx_slot_t;
+
+static uart_tx_slot_t s_tx_slots[UART_TX_QUEUE_LEN];
+static atomic_uint s_tx_enqueue_pos;
+static unsigned int s_tx_dequeue_pos;          // 只由发送任务修改
+static atomic_uint s_tx_dequeued;              // 已取出的条数，用于计算队列深度
+static TaskHandle_t s_tx_task_handle = NULL;
+
+static atomic_uint s_tx_sent;
+static atomic_uint s_tx_dropped;
+static atomic_uint s_tx_truncated;
+static atomic_uint s_tx_high_watermark;
+
+// --- 二进制帧模式 ---
+// 发送方向跟随对方：收到有效的二进制帧后回复也用二进制帧，收到文本行后切回文本
+static atomic_bool s_tx_binary = CONFIG_UART_SERVICE_START_BINARY;
+static atomic_bool s_tx_syn = true;                // 下一个 DATA 帧带 SYN 标志
+static uint8_t s_tx_seq;                           // 只由发送任务使用
+static uint8_t s_tx_frame[UART_FRAME_ENCODED_MAX(UART_TX_SLOT_SIZE)];
+static QueueHandle_t s_ack_queue = NULL;           // 接收任务 -> 发送任务: 收到的 ACK/NAK
+
+static bool s_rx_seq_valid = false;                // 只由接收任务使用
+static uint8_t s_rx_last_seq;
+static int64_t s_rx_event_us;                      // 只由接收任务使用: 当前这批数据的取出时间
+
+typedef struct {
+    uint8_t type;
+    uint8_t seq;
+} uart_ack_t;
+
+static atomic_uint s_frame_rx;
+static atomic_uint s_frame_rx_errors;
+static atomic_uint s_frame_rx_duplicates;
+static atomic_uint s_frame_tx;
+static atomic_uint s_frame_tx_retransmits;
+static atomic_uint s_frame_tx_failed;
+static atomic_uint s_frame_nak_sent;
+
+// --- 链路协商 (见 uart_frame.h 中的 UART_FRAME_OP_LINK) ---
+typedef enum {
+    UART_LINK_IDLE = 0,     // 初始波特率，无流控
+    UART_LINK_PROPOSED,     // 发起方: 已发送 PROPOSE，等待 ACCEPT
+    UART_LINK_ACCEPTING,    // 应答方: ACCEPT 已入队，对方确认后切换
+    UART_LINK_CONFIRMING,   // 已切换到新参数，等待 CONFIRM 完成
+    UART_LINK_ACTIVE,       // 新参数已生效
+} uart_link_state_t;
+
+static const uint32_t s_link_bauds[] = { 230400, 460800, 921600, 1500000, 2000000 };
+
+// 状态由接收任务和发送任务共同推进，切换波特率要等发送完成，所以用互斥锁而不是自旋锁
+static SemaphoreHandle_t s_link_lock = NULL;
+static uart_link_state_t s_link_state = UART_LINK_IDLE;
+static uint32_t s_link_baud = UART_BAUD_RATE;
+static bool s_link_rtscts = false;
+static uint32_t s_link_pending_baud;
+static bool s_link_pending_rtscts;
+static TickType_t s_link_deadline;
+static bool s_link_attempt_armed = false;   // 发起方: 到 s_link_next_attempt 时发起协商
+static TickType_t s_link_next_attempt;
+static TickType_t s_link_window_start;
+static uint32_t s_link_window_errors;
+
+static atomic_uint s_link_upgrades;
+static atomic_uint s_link_fallbacks;
+static atomic_uint s_link_rejects;
+static atomic_uint s_uart_hw_errors;
+
+// --- 链路心跳 ---
+// 时间均为 esp_timer 毫秒数的低 32 位，用无符号减法比较
+static atomic_uint s_hb_last_rx_ms;         // 最后一次收到有效的行或帧
+static atomic_uint s_hb_last_tx_ms;         // 最后一次写出数据
+static atomic_bool s_peer_up = false;       // 对方在线；上电后收到第一条有效消息之前为 false
+static atomic_bool s_peer_hb = false;       // 对方发送过心跳: 之后才判定断线和回送心跳，断线后清除
+static esp_timer_handle_t s_hb_timer = NULL;
+static uart_service_link_handler_t s_link_handler = NULL;
+
+static atomic_uint s_hb_sent;
+static atomic_uint s_hb_received;
+static atomic_uint s_peer_losses;
+
+static int uart_tx_enqueue(const char *data, size_t len, uint8_t opcode);
+static void uart_link_on_message(const uint8_t *payload, size_t len);
+static void uart_link_on_sent(const uint8_t *payload, size_t len, bool acked);
+static void uart_link_arm(TickType_t delay);
+
+/**
+ * @brief 行组装器
+ *
+ * 驱动的 RX 环形缓冲区中可能同时有多行，也可能只有半行。
+ * 收到的字节追加到 buf，每遇到一个 '\n' 就交出一整行；
+ * 超过 UART_LINE_MAX 的行整行丢弃 (直到下一个 '\n')。
+ * 遇到 0x00 则开始收二进制帧，直到下一个 0x00 (帧内可以有 '\n')。
+ */
+typedef struct {
+    char   buf[UART_RX_BUF_SIZE];
+    size_t len;
+    bool   overflow; // 当前行/帧已超长，丢弃到结尾
+    bool   in_frame; // 正在接收二进制帧
+} uart_line_assembler_t;
+
+static uart_line_assembler_t s_line;
+
+static uint32_t uart_now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// 写出数据，整个调用互斥，不同任务写出的数据不会交错
+static int uart_write(const void *data, size_t len)
+{
+#if CONFIG_UART_SERVICE_DMA
+    return uart_dma_write(data, len);
+#else
+    return uart_write_bytes(UART_PORT, data, len);
+#endif
+}
+
+// 记录写出了数据 (任何数据都能让对方确认我们在线)
+static void uart_note_tx(void)
+{
+    atomic_store(&s_hb_last_tx_ms, uart_now_ms());
+}
+
+// 批量传输写出一帧
+static int uart_bulk_write(const void *data, size_t len)
+{
+    int n = uart_write(data, len);
+    uart_note_tx();
+    return n;
+}
+
+// [接收任务] 收到一条有效的行或帧
+static void uart_peer_alive(void)
+{
+    atomic_store(&s_hb_last_rx_ms, uart_now_ms());
+    if (!atomic_exchange(&s_peer_up, true)) {
+        ESP_LOGI(TAG, "Peer link up");
+        if (s_link_handler) {
+            s_link_handler(true);
+        }
+    }
+}
+
+/**
+ * @brief esp_timer 回调: 每 UART_HEARTBEAT_CHECK_MS 检查一次，超时未收到对方任何有效数据即判定断线
+ *
+ * 只对发送过心跳的对方启用: 只在用户操作时才发数据的屏幕固件不会因为空闲被判定断线。
+ *
+ * 在 esp_timer 任务中直接通知处理函数，不经过可能阻塞在停等重发上的发送/接收任务，
+ * 所以从最后一次收到数据到通知的时间不超过 TIMEOUT + CHECK。
+ */
+static void uart_heartbeat_check(void *arg)
+{
+    if (!atomic_load(&s_peer_up) || !atomic_load(&s_peer_hb)) {
+        return;
+    }
+    if (uart_now_ms() - atomic_load(&s_hb_last_rx_ms) < UART_HEARTBEAT_TIMEOUT_MS) {
+        return;
+    }
+    if (atomic_exchange(&s_peer_up, false)) {
+        atomic_store(&s_peer_hb, false);
+        atomic_fetch_add(&s_peer_losses, 1);
+        ESP_LOGW(TAG, "Peer link lost: nothing received for %d ms", UART_HEARTBEAT_TIMEOUT_MS);
+        if (s_link_handler) {
+            s_link_handler(false);
+        }
+    }
+}
+
+// 把一条消息交给对应的处理函数
+static void uart_deliver(const char *line, size_t len, bool is_status)
+{
+    if (is_status) {
+        if (s_status_handler) {
+            s_status_handler(line, len);
+        } else {
+            ESP_LOGD(TAG, "Received status update, but no status handler is registered.");
+        }
+    } else {
+        if (s_command_handler) {
+            s_command_handler(line, len);
+        } else {
+            ESP_LOGD(TAG, "Received command, but no command handler is registered.");
+        }
+    }
+}
+
+// 把一整行交给对应的处理函数 ('STATUS:' 开头为状态，其余为命令)
+static void uart_deliver_line(char *line, size_t len)
+{
+    // 兼容以 "\r\n" 结尾的发送端
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    if (len == 0) {
+        return;
+    }
+    line[len] = '\0';
+
+    atomic_store(&s_tx_binary, false);
+    uart_peer_alive();
+    if (strcmp(line, UART_HEARTBEAT_LINE) == 0) {
+        atomic_store(&s_peer_hb, true);
+        atomic_fetch_add(&s_hb_received, 1);
+        return;
+    }
+    uart_deliver(line, len, strncmp(line, STATUS_PREFIX, STATUS_PREFIX_LEN) == 0);
+}
+
+// 接收任务直接发送 ACK/NAK (uart_write 整个调用互斥，不会和发送任务的数据交错)
+static void uart_send_control_frame(uart_frame_type_t type, uint8_t seq)
+{
+    uint8_t out[UART_FRAME_ENCODED_MAX(0)];
+    uart_frame_t frame = { .type = type, .seq = seq };
+    size_t n = uart_frame_encode(&frame, out, sizeof(out));
+    uart_write(out, n);
+    uart_note_tx();
+}
+
+// 处理一个完整的二进制帧 (两个 0x00 之间的数据)
+static void uart_frame_finish(uart_line_assembler_t *as)
+{
+    uart_frame_t frame;
+    esp_err_t err = as->overflow ? ESP_ERR_INVALID_SIZE
+                                 : uart_frame_decode((uint8_t *)as->buf, as->len, &frame);
+    as->len = 0;
+    as->overflow = false;
+    as->in_frame = false;
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Bad frame: %s", esp_err_to_name(err));
+        atomic_fetch_add(&s_frame_rx_errors, 1);
+        // 文本模式下的对方不认识 NAK，等它超时重发
+        if (atomic_load(&s_tx_binary)) {
+            atomic_fetch_add(&s_frame_nak_sent, 1);
+            uart_send_control_frame(UART_FRAME_TYPE_NAK, s_rx_last_seq);
+        }
+        return;
+    }
+    atomic_fetch_add(&s_frame_rx, 1);
+    uart_peer_alive();
+
+    if (frame.type == UART_FRAME_TYPE_HEARTBEAT) {
+        atomic_store(&s_peer_hb, true);
+        atomic_fetch_add(&s_hb_received, 1);
+        return;
+    }
+    if (frame.type == UART_FRAME_TYPE_ACK || frame.type == UART_FRAME_TYPE_NAK) {
+        uart_ack_t ack = { .type = frame.type, .seq = frame.seq };
+        xQueueSend(s_ack_queue, &ack, 0);
+        return;
+    }
+    if (frame.type == UART_FRAME_TYPE_BULK) {
+        uart_bulk_on_frame(&frame);
+        return;
+    }
+    if (frame.type != UART_FRAME_TYPE_DATA) {
+        return;
+    }
+
+    // 先确认，发送方不必等处理函数执行完
+    uart_send_control_frame(UART_FRAME_TYPE_ACK, frame.seq);
+    if (!atomic_exchange(&s_tx_binary, true)) {
+        atomic_store(&s_tx_syn, true);
+        uart_link_arm(0);
+    }
+
+    const bool duplicate = s_rx_seq_valid && frame.seq == s_rx_last_seq;
+    if ((frame.flags & UART_FRAME_FLAG_SYN) && !duplicate) {
+        // 对方重启，重新开始序号 (SYN 帧的重发仍按重复处理)
+        s_rx_seq_valid = false;
+    }
+    if (duplicate) {
+        // 对方没收到上次的 ACK 而重发，已经处理过
+        atomic_fetch_add(&s_frame_rx_duplicates, 1);
+        return;
+    }
+    s_rx_seq_valid = true;
+    s_rx_last_seq = frame.seq;
+
+    // 负载之后是 CRC，可以覆盖为 '\0'
+    char *text = (char *)frame.payload;
+    text[frame.len] = '\0';
+    switch (frame.opcode) {
+    case UART_FRAME_OP_COMMAND:
+        uart_deliver(text, frame.len, false);
+        break;
+    case UART_FRAME_OP_STATUS:
+        uart_deliver(text, frame.len, true);
+        break;
+    case UART_FRAME_OP_LINK:
+        uart_link_on_message(frame.payload, frame.len);
+        break;
+    default:
+        ESP_LOGW(TAG, "Unknown frame opcode 0x%02x", frame.opcode);
+        break;
+    }
+}
+
+// 结束当前行 (遇到换行或空闲超时)
+static void uart_line_finish(uart_line_assembler_t *as)
+{
+    if (as->overflow) {
+        ESP_LOGW(TAG, "Line longer than %d bytes discarded", UART_LINE_MAX - 1);
+    } else {
+        uart_deliver_line(as->buf, as->len);
+    }
+    as->len = 0;
+    as->overflow = false;
+}
+
+// 把一段收到的数据追加到行组装器，每个完整的行或帧调用一次处理函数
+static void uart_line_feed(uart_line_assembler_t *as, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        const uint8_t *eol = memchr(data, as->in_frame ? UART_FRAME_DELIMITER : UART_LINE_TERMINATOR, len);
+        size_t n = eol ? (size_t)(eol - data) : len;
+
+        if (!as->in_frame) {
+            const uint8_t *delim = memchr(data, UART_FRAME_DELIMITER, n);
+            if (delim != NULL) {
+                // 帧开始，之前没有换行结尾的文本视为噪声
+                size_t skip = (size_t)(delim - data) + 1;
+                as->len = 0;
+                as->overflow = false;
+                as->in_frame = true;
+                data += skip;
+                len -= skip;
+                continue;
+            }
+        } else if (eol != NULL && n == 0 && as->len == 0) {
+            // 连续的分隔符 (上一帧的结尾紧接着下一帧的开头)
+            data++;
+            len--;
+            continue;
+        }
+
+        if (!as->overflow) {
+            if (as->len + n < (as->in_frame ? sizeof(as->buf) : UART_LINE_MAX)) {
+                memcpy(as->buf + as->len, data, n);
+                as->len += n;
+            } else {
+                as->overflow = true;
+            }
+        }
+        if (eol == NULL) {
+            return;
+        }
+        if (as->in_frame) {
+            uart_frame_finish(as);
+        } else {
+            uart_line_finish(as);
+        }
+        data += n + 1;
+        len -= n + 1;
+    }
+}
+
+#if !CONFIG_UART_SERVICE_DMA
+// 取出驱动缓冲区中所有已收到的数据
+static void uart_drain_rx(uint8_t *chunk)
+{
+    size_t buffered = 0;
+    s_rx_event_us = esp_timer_get_time();
+    uart_get_buffered_data_len(UART_PORT, &buffered);
+    while (buffered > 0) {
+        int len = uart_read_bytes(UART_PORT, chunk, buffered < UART_READ_CHUNK ? buffered : UART_READ_CHUNK, 0);
+        if (len <= 0) {
+            break;
+        }
+        uart_line_feed(&s_line, chunk, len);
+        buffered -= (size_t)len < buffered ? (size_t)len : buffered;
+    }
+}
+#endif
+
+static bool uart_link_rtscts_available(void)
+{
+    return UART_RTS_PIN >= 0 && UART_CTS_PIN >= 0;
+}
+
+static bool uart_link_baud_supported(uint32_t baud)
+{
+    if (baud == UART_BAUD_RATE) {
+        return true;
+    }
+    if (baud > CONFIG_UART_SERVICE_LINK_MAX_BAUD) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(s_link_bauds) / sizeof(s_link_bauds[0]); i++) {
+        if (s_link_bauds[i] == baud) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 等待已写出的数据 (包括刚发出的 ACK) 发送完毕后切换波特率和流控。调用者持有 s_link_lock
+static void uart_link_apply(uint32_t baud, bool rtscts)
+{
+#if CONFIG_UART_SERVICE_DMA
+    uart_dma_wait_tx_done(pdMS_TO_TICKS(100));
+#else
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+#endif
+    uart_set_baudrate(UART_PORT, baud);
+    uart_set_hw_flow_ctrl(UART_PORT, rtscts ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE, UART_RTS_THRESHOLD);
+    s_link_baud = baud;
+    s_link_rtscts = rtscts;
+    ESP_LOGI(TAG, "Link set to %lu baud, RTS/CTS %s", (unsigned long)baud, rtscts ? "on" : "off");
+}
+
+// 退回初始参数。调用者持有 s_link_lock
+static void uart_link_fallback(const char *reason)
+{
+    ESP_LOGW(TAG, "Link fallback to %d baud: %s", UART_BAUD_RATE, reason);
+    if (s_link_baud != UART_BAUD_RATE || s_link_rtscts) {
+        uart_link_apply(UART_BAUD_RATE, false);
+    }
+    s_link_state = UART_LINK_IDLE;
+    atomic_fetch_add(&s_link_fallbacks, 1);
+    uart_link_arm(pdMS_TO_TICKS(UART_LINK_RETRY_MS));
+}
+
+// 发起方在 delay 之后 (由接收任务的 uart_link_poll) 发起协商
+static void uart_link_arm(TickType_t delay)
+{
+#if CONFIG_UART_SERVICE_LINK_INITIATE
+    s_link_next_attempt = xTaskGetTickCount() + delay;
+    s_link_attempt_armed = true;
+#endif
+}
+
+static void uart_link_send(uart_frame_link_cmd_t cmd, uint32_t baud, bool rtscts)
+{
+    char payload[UART_FRAME_LINK_PAYLOAD_LEN] = {
+        cmd, baud & 0xFF, (baud >> 8) & 0xFF, (baud >> 16) & 0xFF, (baud >> 24) & 0xFF,
+        rtscts ? UART_FRAME_LINK_FLAG_RTSCTS : 0,
+    };
+    uart_tx_enqueue(payload, sizeof(payload), UART_FRAME_OP_LINK);
+}
+
+// 发起一次协商。调用者持有 s_link_lock
+static void uart_link_propose(uint32_t baud, bool rtscts)
+{
+    s_link_state = UART_LINK_PROPOSED;
+    s_link_pending_baud = baud;
+    s_link_pending_rtscts = rtscts;
+    s_link_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_UART_SERVICE_LINK_CONFIRM_TIMEOUT_MS);
+    ESP_LOGI(TAG, "Proposing %lu baud, RTS/CTS %s", (unsigned long)baud, rtscts ? "on" : "off");
+    uart_link_send(UART_FRAME_LINK_PROPOSE, baud, rtscts);
+}
+
+// [接收任务] 收到对方的链路协商消息 (该帧的 ACK 已经发出)
+static void uart_link_on_message(const uint8_t *payload, size_t len)
+{
+    if (len < UART_FRAME_LINK_PAYLOAD_LEN) {
+        return;
+    }
+    const uint8_t cmd = payload[0];
+    const uint32_t baud = payload[1] | (uint32_t)payload[2] << 8 | (uint32_t)payload[3] << 16 | (uint32_t)payload[4] << 24;
+    const bool rtscts = (payload[5] & UART_FRAME_LINK_FLAG_RTSCTS) && uart_link_rtscts_available();
+
+    xSemaphoreTake(s_link_lock, portMAX_DELAY);
+    switch (cmd) {
+    case UART_FRAME_LINK_PROPOSE:
+        if (CONFIG_UART_SERVICE_LINK_MAX_BAUD > 0 && uart_link_baud_supported(baud)) {
+            s_link_state = UART_LINK_ACCEPTING;
+            s_link_pending_baud = baud;
+            s_link_pending_rtscts = rtscts;
+            uart_link_send(UART_FRAME_LINK_ACCEPT, baud, rtscts);
+        } else {
+            ESP_LOGW(TAG, "Rejecting link proposal: %lu baud", (unsigned long)baud);
+            atomic_fetch_add(&s_link_rejects, 1);
+            uart_link_send(UART_FRAME_LINK_REJECT, s_link_baud, s_link_rtscts);
+        }
+        break;
+    case UART_FRAME_LINK_ACCEPT:
+        if (s_link_state == UART_LINK_PROPOSED) {
+            uart_link_apply(baud, rtscts && s_link_pending_rtscts);
+            s_link_state = UART_LINK_CONFIRMING;
+            s_link_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_UART_SERVICE_LINK_CONFIRM_TIMEOUT_MS);
+            uart_link_send(UART_FRAME_LINK_CONFIRM, baud, s_link_rtscts);
+        }
+        break;
+    case UART_FRAME_LINK_REJECT:
+        if (s_link_state == UART_LINK_PROPOSED) {
+            s_link_state = UART_LINK_IDLE;
+            atomic_fetch_add(&s_link_rejects, 1);
+            uart_link_arm(pdMS_TO_TICKS(UART_LINK_RETRY_MS));
+        }
+        break;
+    case UART_FRAME_LINK_CONFIRM:
+        if (s_link_state == UART_LINK_CONFIRMING) {
+            s_link_state = UART_LINK_ACTIVE;
+            atomic_fetch_add(&s_link_upgrades, 1);
+            ESP_LOGI(TAG, "Link upgrade confirmed");
+        }
+        break;
+    default:
+        break;
+    }
+    xSemaphoreGive(s_link_lock);
+}
+
+// [发送任务] 一条链路协商消息发送完毕 (acked 表示对方已确认)
+static void uart_link_on_sent(const uint8_t *payload, size_t len, bool acked)
+{
+    if (len < UART_FRAME_LINK_PAYLOAD_LEN) {
+        return;
+    }
+
+    xSemaphoreTake(s_link_lock, portMAX_DELAY);
+    switch (payload[0]) {
+    case UART_FRAME_LINK_PROPOSE:
+        if (!acked && s_link_state == UART_LINK_PROPOSED) {
+            // 对方不支持二进制帧或已断开
+            s_link_state = UART_LINK_IDLE;
+            uart_link_arm(pdMS_TO_TICKS(UART_LINK_RETRY_MS));
+        }
+        break;
+    case UART_FRAME_LINK_ACCEPT:
+        if (s_link_state == UART_LINK_ACCEPTING) {
+            if (acked) {
+                uart_link_apply(s_link_pending_baud, s_link_pending_rtscts);
+                s_link_state = UART_LINK_CONFIRMING;
+                s_link_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_UART_SERVICE_LINK_CONFIRM_TIMEOUT_MS);
+            } else {
+                s_link_state = (s_link_baud == UART_BAUD_RATE && !s_link_rtscts) ? UART_LINK_IDLE : UART_LINK_ACTIVE;
+            }
+        }
+        break;
+    case UART_FRAME_LINK_CONFIRM:
+        if (s_link_state == UART_LINK_CONFIRMING) {
+            if (acked) {
+                s_link_state = UART_LINK_ACTIVE;
+                atomic_fetch_add(&s_link_upgrades, 1);
+                ESP_LOGI(TAG, "Link upgrade confirmed");
+            } else {
+                uart_link_fallback("confirm not acknowledged");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    xSemaphoreGive(s_link_lock);
+}
+
+// [接收任务] 对方发送过心跳后，空闲超过一个心跳周期时发送心跳，格式跟随对方
+static void uart_heartbeat_poll(void)
+{
+#if UART_HEARTBEAT_PERIOD_MS > 0
+    if (!atomic_load(&s_peer_hb) || uart_now_ms() - atomic_load(&s_hb_last_tx_ms) < UART_HEARTBEAT_PERIOD_MS) {
+        return;
+    }
+    if (atomic_load(&s_tx_binary)) {
+        uart_send_control_frame(UART_FRAME_TYPE_HEARTBEAT, 0);
+    } else {
+        uart_write(UART_HEARTBEAT_LINE "\n", sizeof(UART_HEARTBEAT_LINE));
+        uart_note_tx();
+    }
+    atomic_fetch_add(&s_hb_sent, 1);
+#endif
+}
+
+// [接收任务] 周期性检查: 协商超时、错误率回退、发起协商
+static void uart_link_poll(void)
+{
+    const TickType_t now = xTaskGetTickCount();
+
+    xSemaphoreTake(s_link_lock, portMAX_DELAY);
+
+#if UART_HEARTBEAT_PERIOD_MS > 0
+    // 对方重启后以初始波特率通信，这边也要退回才能重新建立连接
+    if (!atomic_load(&s_peer_up) && (s_link_baud != UART_BAUD_RATE || s_link_rtscts)) {
+        uart_link_fallback("peer lost");
+    }
+#endif
+
+    if ((s_link_state == UART_LINK_PROPOSED || s_link_state == UART_LINK_CONFIRMING) &&
+        (int32_t)(now - s_link_deadline) >= 0) {
+        if (s_link_state == UART_LINK_CONFIRMING) {
+            uart_link_fallback("confirm timeout");
+        } else {
+            s_link_state = UART_LINK_IDLE;
+            uart_link_arm(pdMS_TO_TICKS(UART_LINK_RETRY_MS));
+        }
+    }
+
+    if (now - s_link_window_start >= pdMS_TO_TICKS(UART_LINK_ERROR_WINDOW_MS)) {
+        uint32_t errors = atomic_load(&s_uart_hw_errors) + atomic_load(&s_frame_rx_errors) + atomic_load(&s_frame_tx_failed);
+        uint32_t delta = errors - s_link_window_errors;
+        s_link_window_errors = errors;
+        s_link_window_start = now;
+        if ((s_link_state == UART_LINK_ACTIVE || s_link_state == UART_LINK_CONFIRMING) &&
+            delta >= CONFIG_UART_SERVICE_LINK_ERROR_THRESHOLD) {
+            uart_link_fallback("error rate");
+        }
+    }
+
+    if (s_link_attempt_armed && s_link_state == UART_LINK_IDLE && atomic_load(&s_tx_binary) &&
+        (int32_t)(now - s_link_next_attempt) >= 0) {
+        s_link_attempt_armed = false;
+        uart_link_propose(CONFIG_UART_SERVICE_LINK_MAX_BAUD, uart_link_rtscts_available());
+    }
+
+    xSemaphoreGive(s_link_lock);
+}
+
+// 发送端停止发送 (RX 超时) 时处理还没有结束的行或帧
+static void uart_rx_idle(void)
+{
+    if (s_line.in_frame) {
+        // 帧总是连续发送，发送端停下时还没收完说明结尾的 0x00 丢了，丢弃并回到文本模式
+        if (s_line.len > 0) {
+            atomic_fetch_add(&s_frame_rx_errors, 1);
+        }
+        s_line.len = 0;
+        s_line.overflow = false;
+        s_line.in_frame = false;
+    }
+#if CONFIG_UART_SERVICE_IDLE_ENDS_LINE
+    // 没有换行的残留数据也作为一行
+    if (s_line.len > 0) {
+        uart_line_finish(&s_line);
+    }
+#endif
+}
+
+#if CONFIG_UART_SERVICE_DMA
+// 接收和处理 UART 数据: 阻塞等待 DMA 接收事件 (发送端空闲或缓冲区满)，数据直接在 DMA 缓冲区中处理
+static void uart_service_task(void *pvParameters)
+{
+    ESP_LOGI(TAG, "UART service task started (DMA)");
+
+    while (1) {
+        size_t len = 0;
+        bool idle = false;
+        const uint8_t *data = uart_dma_receive(&len, &idle, pdMS_TO_TICKS(UART_RX_POLL_MS));
+        if (data != NULL) {
+            s_rx_event_us = esp_timer_get_time();
+            uart_line_feed(&s_line, data, len);
+            if (idle) {
+                uart_rx_idle();
+            }
+        }
+        uart_link_poll();
+        uart_heartbeat_poll();
+    }
+}
+#else
+//接收和处理 UART 数据: 阻塞等待驱动事件，换行 (pattern detect) 或 RX 空闲超时时立即处理
 static void uart_service_task(void *pvParameters)  
 {  
-    uint8_t* data = (uint8_t*) malloc(UART_BUF_SIZE);  
-    if (data == NULL) {  
-        ESP_LOGE(TAG, "Failed to allocate memory for UART buffer");  
-        vTaskDelete(NULL);  
-        return;  
-    }  
+    uint8_t chunk[UART_READ_CHUNK];
+    uart_event_t event;
 
     ESP_LOGI(TAG, "UART service task started");  
 
     while (1) {  
-        int len = uart_read_bytes(UART_PORT, data, (UART_BUF_SIZE - 1), pdMS_TO_TICKS(20));  
-        if (len > 0) {  
-            data[len] = '\0';  
-            
-            if (strncmp((const char *)data, STATUS_PREFIX, STATUS_PREFIX_LEN) == 0) {
-                if (s_status_handler) {
-                    s_status_handler((const char *)data, len);
-                } else {
-                    ESP_LOGD(TAG, "Received status update, but no status handler is registered.");
-                }
-            } else {
-                if (s_command_handler) {
-                    s_command_handler((const char *)data, len);
-                } else {
-                    ESP_LOGD(TAG, "Received command, but no command handler is registered.");
-                }
+        if (xQueueReceive(s_uart_event_queue, &event, pdMS_TO_TICKS(UART_RX_POLL_MS)) != pdTRUE) {
+            uart_link_poll();
+            uart_heartbeat_poll();
+            continue;
+        }
+
+        switch (event.type) {
+        case UART_PATTERN_DET:
+            // 行由 uart_line_feed 自己切分，驱动记录的换行位置不需要，只需出队
+            while (uart_pattern_pop_pos(UART_PORT) >= 0) {
             }
-        }  
-        vTaskDelay(pdMS_TO_TICKS(1));  // 避免任务过于频繁执行
+            uart_drain_rx(chunk);
+            break;
+        case UART_DATA:
+            uart_drain_rx(chunk);
+            if (event.timeout_flag) {
+                uart_rx_idle();
+            }
+            break;
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            atomic_fetch_add(&s_uart_hw_errors, 1);
+            ESP_LOGW(TAG, "UART RX overflow (event %d), input flushed", event.type);
+            uart_flush_input(UART_PORT);
+            xQueueReset(s_uart_event_queue);
+            uart_pattern_queue_reset(UART_PORT, UART_EVENT_QUEUE_LEN);
+            s_line.len = 0;
+            s_line.overflow = false;
+            s_line.in_frame = false;
+            break;
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+        case UART_BREAK:
+            atomic_fetch_add(&s_uart_hw_errors, 1);
+            ESP_LOGW(TAG, "UART RX error (event %d)", event.type);
+            break;
+        default:
+            break;
+        }
+        uart_link_poll();
+        uart_heartbeat_poll();
     }  
-    free(data);  
-    vTaskDelete(NULL);  
 }  
+#endif
+
+
+/**
+ * @brief 以二进制帧发送一行，等待 ACK，超时或收到 NAK 时重发，最多重发 UART_FRAME_RETRIES 次
+ *        (停等协议，一次只有一帧在途)
+ */
+static bool uart_tx_send_frame(const char *data, size_t len, uint8_t opcode)
+{
+    if (opcode == 0) {
+        opcode = strncmp(data, STATUS_PREFIX, STATUS_PREFIX_LEN) == 0 ? UART_FRAME_OP_STATUS : UART_FRAME_OP_COMMAND;
+    }
+    uart_frame_t frame = {
+        .type    = UART_FRAME_TYPE_DATA,
+        .flags   = atomic_load(&s_tx_syn) ? UART_FRAME_FLAG_SYN : 0,
+        .seq     = ++s_tx_seq,
+        .opcode  = opcode,
+        .payload = (const uint8_t *)data,
+        .len     = len,
+    };
+    const size_t n = uart_frame_encode(&frame, s_tx_frame, sizeof(s_tx_frame));
+    atomic_fetch_add(&s_frame_tx, 1);
+
+    for (int attempt = 0; attempt <= UART_FRAME_RETRIES; attempt++) {
+        if (attempt > 0) {
+            atomic_fetch_add(&s_frame_tx_retransmits, 1);
+        }
+        uart_write(s_tx_frame, n);
+        uart_note_tx();
+
+        const TickType_t start = xTaskGetTickCount();
+        const TickType_t timeout = pdMS_TO_TICKS(UART_FRAME_ACK_TIMEOUT_MS);
+        TickType_t elapsed;
+        uart_ack_t ack;
+        while ((elapsed = xTaskGetTickCount() - start) < timeout &&
+               xQueueReceive(s_ack_queue, &ack, timeout - elapsed) == pdTRUE) {
+            if (ack.type == UART_FRAME_TYPE_NAK) {
+                break;      // 立即重发
+            }
+            if (ack.seq == frame.seq) {
+                atomic_store(&s_tx_syn, false);
+                return true;
+            }
+            // 之前某帧迟到的 ACK，继续等
+        }
+    }
+
+    atomic_fetch_add(&s_frame_tx_failed, 1);
+    ESP_LOGW(TAG, "Frame seq %u not acknowledged after %d retries, dropped", frame.seq, UART_FRAME_RETRIES);
+    return false;
+}
+
+// 发送任务: 按入队顺序写出每一行，不会被生产者阻塞
+static void uart_tx_task(void *pvParameters)
+{
+    while (1) {
+        uart_tx_slot_t *slot = &s_tx_slots[s_tx_dequeue_pos & (UART_TX_QUEUE_LEN - 1)];
+        unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
 
+        if (seq != s_tx_dequeue_pos + 1) {
+            // 队列为空，或下一个位置已被领取但还没写完，等生产者发布后的通知
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        if (slot->opcode == UART_FRAME_OP_LINK) {
+            bool acked = uart_tx_send_frame(slot->data, slot->len, slot->opcode);
+            uart_link_on_sent((const uint8_t *)slot->data, slot->len, acked);
+        } else if (slot->opcode != 0 || atomic_load(&s_tx_binary)) {
+            uart_tx_send_frame(slot->data, slot->len, slot->opcode);
+        } else {
+            slot->data[slot->len] = UART_LINE_TERMINATOR;
+            const int len = slot->len + 1;
+            const int bytes_sent = uart_write(slot->data, len);
+            uart_note_tx();
+            if (bytes_sent != len) {
+                ESP_LOGW(TAG, "Error sending data. Expected %d, sent %d.", len, bytes_sent);
+            }
+        }
+        atomic_fetch_add_explicit(&s_tx_sent, 1, memory_order_relaxed);
+
+        // 把槽位还给下一轮的生产者
+        atomic_store_explicit(&slot->seq, s_tx_dequeue_pos + UART_TX_QUEUE_LEN, memory_order_release);
+        s_tx_dequeue_pos++;
+        atomic_store_explicit(&s_tx_dequeued, s_tx_dequeue_pos, memory_order_release);
+    }
+}
+
+// 当前排队的行数；先读出队位置，保证结果不会下溢
+static unsigned int uart_tx_depth(void)
+{
+    unsigned int dequeued = atomic_load_explicit(&s_tx_dequeued, memory_order_acquire);
+    return atomic_load_explicit(&s_tx_enqueue_pos, memory_order_acquire) - dequeued;
+}
+
+static void uart_tx_update_high_watermark(unsigned int depth)
+{
+    unsigned int hwm = atomic_load_explicit(&s_tx_high_watermark, memory_order_relaxed);
+    while (depth > hwm &&
+           !atomic_compare_exchange_weak_explicit(&s_tx_high_watermark, &hwm, depth,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
 
 esp_err_t uart_service_init(void)  
 {  
@@ -72,11 +901,46 @@ esp_err_t uart_service_init(void)
     };  
 
     ESP_LOGI(TAG, "Initializing UART on port %d", UART_PORT);  
-    ESP_RETURN_ON_ERROR(uart_driver_install(UART_PORT, UART_BUF_SIZE * 2, 0, 0, NULL, 0), TAG, "driver install failed");  
+#if CONFIG_UART_SERVICE_DMA
+    // UHCI 直接使用 UART 外设，不安装 UART 驱动
+    ESP_RETURN_ON_ERROR(uart_param_config(UART_PORT, &uart_config), TAG, "param config failed");
+    ESP_RETURN_ON_ERROR(uart_set_pin(UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_RTS_PIN, UART_CTS_PIN), TAG, "set pin failed");
+    ESP_RETURN_ON_ERROR(uart_dma_init(UART_PORT), TAG, "dma init failed");
+#else
+    ESP_RETURN_ON_ERROR(uart_driver_install(UART_PORT, UART_BUF_SIZE * 2, 0, UART_EVENT_QUEUE_LEN, &s_uart_event_queue, 0), TAG, "driver install failed");  
     ESP_RETURN_ON_ERROR(uart_param_config(UART_PORT, &uart_config), TAG, "param config failed");  
-    ESP_RETURN_ON_ERROR(uart_set_pin(UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE), TAG, "set pin failed");  
+    // RTS/CTS 引脚只连接，流控在链路协商同意后才启用
+    ESP_RETURN_ON_ERROR(uart_set_pin(UART_PORT, UART_TX_PIN, UART_RX_PIN, UART_RTS_PIN, UART_CTS_PIN), TAG, "set pin failed");  
+    // 每收到一个 '\n' 立即产生 UART_PATTERN_DET 事件，不必等待 RX 超时
+    ESP_RETURN_ON_ERROR(uart_enable_pattern_det_baud_intr(UART_PORT, UART_LINE_TERMINATOR, 1, 9, 0, 0), TAG, "pattern detect failed");  
+    ESP_RETURN_ON_ERROR(uart_pattern_queue_reset(UART_PORT, UART_EVENT_QUEUE_LEN), TAG, "pattern queue failed");  
+    // 没有换行的发送端: 空闲 CONFIG_UART_SERVICE_RX_TIMEOUT_SYMBOLS 个字符时间后产生 UART_DATA 事件
+    ESP_RETURN_ON_ERROR(uart_set_rx_timeout(UART_PORT, CONFIG_UART_SERVICE_RX_TIMEOUT_SYMBOLS), TAG, "rx timeout failed");  
+#endif
 
+    s_ack_queue = xQueueCreate(UART_ACK_QUEUE_LEN, sizeof(uart_ack_t));
+    s_link_lock = xSemaphoreCreateMutex();
+    if (s_ack_queue == NULL || s_link_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (unsigned int i = 0; i < UART_TX_QUEUE_LEN; i++) {
+        atomic_init(&s_tx_slots[i].seq, i);
+    }
+    if (xTaskCreate(uart_tx_task, "uart_tx_task", UART_TX_TASK_STACK_SIZE, NULL, UART_TX_TASK_PRIORITY, &s_tx_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create UART TX task");
+        return ESP_ERR_NO_MEM;
+    }
     xTaskCreate(uart_service_task, "uart_service_task", UART_TASK_STACK_SIZE, NULL, 10, NULL);  
+    ESP_RETURN_ON_ERROR(uart_bulk_init(uart_bulk_write), TAG, "bulk init failed");
+
+#if UART_HEARTBEAT_PERIOD_MS > 0
+    const esp_timer_create_args_t hb_timer_args = {
+        .callback = uart_heartbeat_check,
+        .name = "uart_hb",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&hb_timer_args, &s_hb_timer), TAG, "heartbeat timer failed");
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(s_hb_timer, UART_HEARTBEAT_CHECK_MS * 1000), TAG, "heartbeat timer failed");
+#endif
 
     return ESP_OK;  
 }  
@@ -87,24 +951,153 @@ void uart_service_register_command_handler(uart_service_handler_t handler)
     s_command_handler = handler;  
 }  
 
+int64_t uart_service_rx_timestamp_us(void)
+{
+    return s_rx_event_us;
+}
+
 void uart_service_register_status_handler(uart_service_handler_t handler)
 {
     s_status_handler = handler;
 }
 
+void uart_service_register_link_handler(uart_service_link_handler_t handler)
+{
+    s_link_handler = handler;
+}
+
 int uart_service_send_line(const char *data)  
 {  
     if (data == NULL) {  
         return -1;  
     }  
 
-    char line_buffer[UART_BUF_SIZE];  
-    int len = snprintf(line_buffer, sizeof(line_buffer), "%s\n", data);  
+    size_t len = strlen(data);
+    if (len > UART_TX_SLOT_SIZE) {
+        atomic_fetch_add_explicit(&s_tx_truncated, 1, memory_order_relaxed);
+        len = UART_TX_SLOT_SIZE;
+    }
+    return uart_tx_enqueue(data, len, 0);
+}
+
+// 放入发送队列，len 不超过 UART_TX_SLOT_SIZE
+static int uart_tx_enqueue(const char *data, size_t len, uint8_t opcode)
+{
+    if (s_tx_task_handle == NULL) {
+        return -1;
+    }
+
+    // 领取一个写入位置；队列满时立即丢弃，不等待
+    uart_tx_slot_t *slot;
+    unsigned int pos = atomic_load_explicit(&s_tx_enqueue_pos, memory_order_relaxed);
+    while (1) {
+        slot = &s_tx_slots[pos & (UART_TX_QUEUE_LEN - 1)];
+        unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&s_tx_enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&s_tx_dropped, 1, memory_order_relaxed);
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&s_tx_enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->opcode = opcode;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    uart_tx_update_high_watermark(uart_tx_depth());
+    xTaskNotifyGive(s_tx_task_handle);
+    return (int)len + 1;
+}
 
-    const int bytes_sent = uart_write_bytes(UART_PORT, line_buffer, len);  
-    
-    if (bytes_sent != len) {  
-        ESP_LOGW(TAG, "Error sending data. Expected %d, sent %d.", len, bytes_sent);  
+void uart_service_get_tx_stats(uart_service_tx_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
     }
-    return bytes_sent;  
-}
\ No newline at end of file
+    stats->depth = uart_tx_depth();
+    stats->high_watermark = atomic_load(&s_tx_high_watermark);
+    stats->sent = atomic_load(&s_tx_sent);
+    stats->dropped = atomic_load(&s_tx_dropped);
+    stats->truncated = atomic_load(&s_tx_truncated);
+}
+
+void uart_service_get_frame_stats(uart_service_frame_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->binary_mode = atomic_load(&s_tx_binary);
+    stats->rx_frames = atomic_load(&s_frame_rx);
+    stats->rx_errors = atomic_load(&s_frame_rx_errors);
+    stats->rx_duplicates = atomic_load(&s_frame_rx_duplicates);
+    stats->tx_frames = atomic_load(&s_frame_tx);
+    stats->tx_retransmits = atomic_load(&s_frame_tx_retransmits);
+    stats->tx_failed = atomic_load(&s_frame_tx_failed);
+    stats->nak_sent = atomic_load(&s_frame_nak_sent);
+}
+
+esp_err_t uart_service_link_request(uint32_t baud, bool rtscts)
+{
+    if (!uart_link_baud_supported(baud) || (rtscts && !uart_link_rtscts_available())) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_link_lock == NULL || !atomic_load(&s_tx_binary)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_link_lock, portMAX_DELAY);
+    if (s_link_state == UART_LINK_IDLE || s_link_state == UART_LINK_ACTIVE) {
+        uart_link_propose(baud, rtscts);
+    } else {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreGive(s_link_lock);
+    return ret;
+}
+
+void uart_service_get_link_stats(uart_service_link_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->baud = s_link_baud;
+    stats->rtscts = s_link_rtscts;
+    stats->upgrades = atomic_load(&s_link_upgrades);
+    stats->fallbacks = atomic_load(&s_link_fallbacks);
+    stats->rejects = atomic_load(&s_link_rejects);
+    stats->hw_errors = atomic_load(&s_uart_hw_errors);
+}
+
+void uart_service_get_heartbeat_stats(uart_service_heartbeat_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+    stats->peer_up = atomic_load(&s_peer_up);
+    stats->armed = atomic_load(&s_peer_hb);
+    stats->losses = atomic_load(&s_peer_losses);
+    stats->sent = atomic_load(&s_hb_sent);
+    stats->received = atomic_load(&s_hb_received);
+    stats->last_rx_age_ms = uart_now_ms() - atomic_load(&s_hb_last_rx_ms);
+}
+
+void uart_service_get_dma_stats(uart_service_dma_stats_t *stats)
+{
+    if (stats == NULL) {
+        return;
+    }
+#if CONFIG_UART_SERVICE_DMA
+    uart_dma_get_stats(stats);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
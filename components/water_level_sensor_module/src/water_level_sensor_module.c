@@ -8,18 +8,34 @@
 #include "driver/gpio.h"
 
 #include "command_dispatcher.h"
+#include "status_registry.h"
 #include "uart_service.h"
 
 #define water_level_gpio_num         GPIO_NUM_1   
 
 // --- 模块内部定义 ---
 static const char *TAG = "WATER_LEVEL_ADC";
-static const char *COMMAND_PREFIX = "waterlevel";
 static bool s_is_initialized = false;
+static status_field_t s_water_field = -1; // 状态字段 "water": 水位是否到达，每次读取时更新
 
 
 // --- 函数声明 ---
-void water_level_command_handler(const char *command, size_t len);
+static esp_err_t water_level_command_handler(const command_args_t *args);
+
+enum {
+    WATER_LEVEL_VERB_CHECK,
+};
+
+static const command_verb_t s_water_level_verbs[] = {
+    { "check", WATER_LEVEL_VERB_CHECK },
+};
+
+static const command_module_t s_water_level_module = {
+    .prefix     = "waterlevel",
+    .handler    = water_level_command_handler,
+    .verbs      = s_water_level_verbs,
+    .verb_count = sizeof(s_water_level_verbs) / sizeof(s_water_level_verbs[0]),
+};
 
 esp_err_t water_level_sensor_module_init(void) {
     if (s_is_initialized) {
@@ -37,7 +53,8 @@ esp_err_t water_level_sensor_module_init(void) {
     };
     gpio_config(&io_conf);
 
-    ESP_ERROR_CHECK(command_dispatcher_register(COMMAND_PREFIX, water_level_command_handler));
+    ESP_ERROR_CHECK(command_dispatcher_register(&s_water_level_module));
+    s_water_field = status_field_register("water", STATUS_FIELD_BOOL);
 
     s_is_initialized = true;
     return ESP_OK;
@@ -49,6 +66,7 @@ int get_water_level() {
         return -1;
     }
     int level = gpio_get_level(water_level_gpio_num);
+    status_field_set_bool(s_water_field, level == 1);
     if (level == 1) {
         // ESP_LOGI(TAG, "GPIO1 为高电平");
         return 1;
@@ -58,19 +76,15 @@ int get_water_level() {
     }
 }
 
-void water_level_command_handler(const char *command, size_t len) {
-    const char *sub_command = command + strlen(COMMAND_PREFIX);
-    if (*sub_command == ':') sub_command++;
-
-    if (strncmp(sub_command, "check", strlen("check")) == 0) {
+static esp_err_t water_level_command_handler(const command_args_t *args) {
+    if (args->verb_id == WATER_LEVEL_VERB_CHECK) {
         int water_level = get_water_level();
         
         char status_str[128];
         // 上报状态
         snprintf(status_str, sizeof(status_str), "STATUS:water_level_:%s", water_level ? "ON" : "OFF");
-        uart_service_send_line(status_str);
-    } else {
-        ESP_LOGW(TAG, "未知子命令: %s", sub_command);
+        command_dispatcher_reply(args, status_str);
+        return ESP_OK;
     }
-}
-
+    return ESP_ERR_NOT_SUPPORTED;
+}
\ No newline at end of file
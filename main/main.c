@@ -22,8 +22,10 @@ WiFi断开原因码对照表：
 */
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "led_strip.h"
@@ -42,6 +44,10 @@ WiFi断开原因码对照表：
 #include "uart_service.h"
 #include "led_controller.h"
 #include "command_dispatcher.h" 
+#include "status_registry.h"
+#include "command_json.h"
+#include "telemetry.h"
+#include "connection_manager.h"
 #include "fan_controller.h"
 #include "dht22_sensor.h"
 #include "ds18b20_manager.h" 
@@ -56,118 +62,49 @@ WiFi断开原因码对照表：
 #define WIFI_SSID "helloiip"
 #define WIFI_PASS "20210928MYH"
 #define MQTT_BROKER_URI "mqtt://broker.emqx.io:1883"
-#define WIFI_MAX_RECONNECT 10
+#define MQTT_REPLY_BUF_SIZE   2048   // 待发布的命令回复 (应答主题 + 内容)，满了丢弃新回复
+#define MQTT_REPLY_TASK_STACK 4096
 
 static const char *TAG = "MiHuaTang";   
 static esp_mqtt_client_handle_t mqtt_client = NULL;
 static bool mqtt_connected = false;
-static int wifi_reconnect_count = 0;
-static TaskHandle_t s_data_upload_task_handle = NULL;
+static int64_t s_mqtt_rx_us = 0;   // 当前 MQTT 消息的接收时间，只在 MQTT 事件任务中使用
+static command_json_assembler_t s_mqtt_assembler;   // 分片消息的拼接缓冲，同上
+static command_json_t s_mqtt_msg;                   // 当前消息解析出的命令，同上
+static char s_mqtt_cmd_topic[48];                   // "device/<sn>/cmd/"，连接时生成，同上
+static size_t s_mqtt_cmd_topic_len;
+static bool s_mqtt_topic_route;                     // 当前消息发到了 cmd/ 主题 (分片时只有第一片带主题)，同上
+static RingbufHandle_t s_mqtt_reply_buf = NULL;     // 命令回复: 回复通道写入，mqtt_reply_task 发布
+static atomic_uint s_mqtt_reply_dropped;            // 缓冲满被丢弃的回复数
 char device_sn[32] = {0};
 
 // 函数声明
-static void mqtt_app_start(void);
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
 static void send_log_to_broker(const char *log);
+static void publish_dispatch_stats(void);
+static void mqtt_handle_command(const command_json_t *msg);
+static void mqtt_handle_topic_command(esp_mqtt_event_handle_t event);
 static void log_task(void *pvParameters);
+static void mqtt_reply_task(void *pvParameters);
 void get_device_sn();
-static void wifi_init_sta(void);
+static void network_start(void);
 
-// WiFi事件处理
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                             int32_t event_id, void* event_data)
+// 启动WiFi/MQTT连接管理 (断线重连、退避都在连接管理任务中完成)
+static void network_start(void)
 {
-    if (event_base == WIFI_EVENT) {
-        if (event_id == WIFI_EVENT_STA_START) {
-            ESP_LOGI(TAG, "WiFi station started");
-            esp_wifi_connect();
-        } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
-            wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
-            ESP_LOGE(TAG, "WiFi disconnected, reason: %d", event->reason);
-
-            mqtt_connected = false;
-
-            if (wifi_reconnect_count < WIFI_MAX_RECONNECT) {
-                wifi_reconnect_count++;
-                ESP_LOGW(TAG, "WiFi重连中... 当前次数: %d", wifi_reconnect_count);
-                vTaskDelay(pdMS_TO_TICKS(5000));  // 等待5秒后重连
-                esp_wifi_connect();
-            } else {
-                ESP_LOGE(TAG, "WiFi重连已达上限(%d次),不再重试", WIFI_MAX_RECONNECT);
-            }
-        }
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        wifi_reconnect_count = 0;
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        mqtt_app_start();
-    }
-}
-
-// 改进的WiFi初始化
-static void wifi_init_sta(void)
-{
-    ESP_LOGI(TAG, "Initializing WiFi...");
-    
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
-    assert(sta_netif);
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
-
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-            .pmf_cfg = {
-                .capable = true,
-                .required = false
-            },
-        },
+    const connection_manager_config_t config = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .broker_uri = MQTT_BROKER_URI,
+        .client_id = device_sn,
+        .mqtt_event_handler = mqtt_event_handler,
     };
-    
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    
-    ESP_LOGI(TAG, "Starting WiFi...");
-    ESP_ERROR_CHECK(esp_wifi_start());
-    
-    ESP_LOGI(TAG, "WiFi initialization finished, SSID: %s", WIFI_SSID);
-}
-
-// 启动MQTT客户端
-static void mqtt_app_start(void)
-{
-    if (mqtt_client != NULL) {
-        esp_mqtt_client_destroy(mqtt_client);
-    }
-
-    const esp_mqtt_client_config_t mqtt_cfg = {
-        .broker.address.uri = MQTT_BROKER_URI,
-        .credentials.client_id = device_sn,
-    };
-
-    mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
-    if (mqtt_client == NULL) {
-        ESP_LOGE(TAG, "MQTT客户端初始化失败");
-        return;
-    }
-
-    esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
-    esp_err_t err = esp_mqtt_client_start(mqtt_client);
+    esp_err_t err = connection_manager_start(&config);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "MQTT客户端启动失败: %s", esp_err_to_name(err));
-        esp_mqtt_client_destroy(mqtt_client);
-        mqtt_client = NULL;
+        ESP_LOGE(TAG, "连接管理启动失败: %s", esp_err_to_name(err));
+        return;
     }
+    mqtt_client = connection_manager_mqtt_client();
 }
 
 // MQTT事件处理
@@ -179,10 +116,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
     case MQTT_EVENT_CONNECTED:
         mqtt_connected = true;
         ESP_LOGI(TAG, "MQTT已连接");
+        telemetry_resync();
         {
             char topic[64];
             snprintf(topic, sizeof(topic), "device/%s/message", device_sn);
             esp_mqtt_client_subscribe(mqtt_client, topic, 0);
+            // 按主题路由的命令: device/<sn>/cmd/<prefix>[/<id>]
+            s_mqtt_cmd_topic_len = snprintf(s_mqtt_cmd_topic, sizeof(s_mqtt_cmd_topic), "device/%s/cmd/", device_sn);
+            snprintf(topic, sizeof(topic), "%s#", s_mqtt_cmd_topic);
+            esp_mqtt_client_subscribe(mqtt_client, topic, 0);
         }
         break;
     case MQTT_EVENT_DISCONNECTED:
@@ -201,46 +143,40 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         }
         break;
     case MQTT_EVENT_DATA: {
-        char *payload = strndup(event->data, event->data_len);
-        if (payload == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate memory for payload");
-            break; 
+        // 分片消息拼接完整后才解析，未分片的消息直接在事件缓冲上解析
+        if (event->current_data_offset == 0) {
+            s_mqtt_rx_us = esp_timer_get_time();
+            s_mqtt_topic_route = event->topic_len > (int)s_mqtt_cmd_topic_len &&
+                                 memcmp(event->topic, s_mqtt_cmd_topic, s_mqtt_cmd_topic_len) == 0;
+        }
+        if (s_mqtt_topic_route) {
+            mqtt_handle_topic_command(event);
+            break;
         }
+        const char *payload;
+        size_t payload_len;
+        esp_err_t err = command_json_assemble(&s_mqtt_assembler, event->data, event->data_len,
+                                              event->current_data_offset, event->total_data_len,
+                                              &payload, &payload_len);
+        if (err == ESP_ERR_NOT_FINISHED) {
+            break;
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "丢弃MQTT消息 (%d 字节): %s", event->total_data_len, esp_err_to_name(err));
+            break;
+        }
+
+        ESP_LOGI(TAG, "收到MQTT消息: %.*s", (int)payload_len, payload);
 
-        ESP_LOGI(TAG, "收到MQTT消息: %s", payload);
-
-        cJSON *json = cJSON_Parse(payload);
-        if (json) {
-            const cJSON *cmd = cJSON_GetObjectItem(json, "command");
-            if (cmd && cJSON_IsString(cmd) && (cmd->valuestring != NULL)) {
-                if (strcmp(cmd->valuestring, "on") == 0) {
-                    const char* led_cmd = "led:on";
-                    command_dispatcher_forward(led_cmd, strlen(led_cmd));
-                    ESP_LOGI(TAG, "通过命令分发系统发送LED开启命令");
-                } else if (strcmp(cmd->valuestring, "off") == 0) {
-                    const char* led_cmd = "led:off";
-                    command_dispatcher_forward(led_cmd, strlen(led_cmd));
-                    ESP_LOGI(TAG, "通过命令分发系统发送LED关闭命令");
-                } else if (strcmp(cmd->valuestring, "status") == 0) {
-                    char status_payload[256];
-                    snprintf(status_payload, sizeof(status_payload),
-                        "{\"device_sn\":\"%s\",\"device_name\":\"%s\",\"device_type\":\"%s\",\"timestamp\":%lld}",
-                        device_sn, DEVICE_NAME, DEVICE_TYPE, esp_timer_get_time() / 1000);
-                    char status_topic[64];
-                    snprintf(status_topic, sizeof(status_topic), "device/%s/status", device_sn);
-                    esp_mqtt_client_publish(mqtt_client, status_topic, status_payload, 0, 1, 0);
-                } else {
-                    ESP_LOGW(TAG, "未知命令: %s", cmd->valuestring);
-                }
-            } else {
-                ESP_LOGW(TAG, "MQTT消息格式错误，缺少 'command' 字段");
-            }
-            cJSON_Delete(json);
+        err = command_json_parse(payload, payload_len, &s_mqtt_msg);
+        if (err == ESP_ERR_NOT_FOUND) {
+            ESP_LOGW(TAG, "MQTT消息格式错误，缺少 'command' 字段");
+        } else if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to parse JSON (%s): %.*s", esp_err_to_name(err), (int)payload_len, payload);
         } else {
-             ESP_LOGW(TAG, "Failed to parse JSON: %s", payload);
+            mqtt_handle_command(&s_mqtt_msg);
         }
-        free(payload);
-        break; // <-- THIS BREAK IS NOW CORRECTLY PLACED
+        break;
     }
     case MQTT_EVENT_SUBSCRIBED:
     case MQTT_EVENT_UNSUBSCRIBED:
@@ -254,6 +190,153 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
 }
 
 
+/**
+ * @brief 以 MQTT 来源转发命令，回复发布到应答主题
+ *
+ * 消息带 "id" 字段 (或 cmd/ 主题带 id) 时应答主题为 device/<sn>/resp/<id>，否则为 device/<sn>/resp
+ */
+static void mqtt_forward_command(const char *id, const char *command)
+{
+    char reply_topic[COMMAND_REPLY_TO_LEN];
+    if (id[0] != '\0') {
+        snprintf(reply_topic, sizeof(reply_topic), "device/%s/resp/%s", device_sn, id);
+    } else {
+        snprintf(reply_topic, sizeof(reply_topic), "device/%s/resp", device_sn);
+    }
+
+    const command_source_t source = {
+        .origin = COMMAND_ORIGIN_MQTT,
+        .reply_to = reply_topic,
+        .arrival_us = s_mqtt_rx_us,
+    };
+    command_dispatcher_forward_from(&source, command, strlen(command));
+}
+
+// 执行一条已解析的 MQTT 命令消息
+static void mqtt_handle_command(const command_json_t *msg)
+{
+    const char *cmd = msg->command;
+    if (strcmp(cmd, "on") == 0) {
+        mqtt_forward_command(msg->id, "led:on");
+        ESP_LOGI(TAG, "通过命令分发系统发送LED开启命令");
+    } else if (strcmp(cmd, "off") == 0) {
+        mqtt_forward_command(msg->id, "led:off");
+        ESP_LOGI(TAG, "通过命令分发系统发送LED关闭命令");
+    } else if (strchr(cmd, ':') != NULL) {
+        // 与串口相同格式的命令，例如 "fan:75"、"batch:fan:75;relay:on"
+        mqtt_forward_command(msg->id, cmd);
+    } else if (strcmp(cmd, "diag") == 0) {
+        publish_dispatch_stats();
+    } else if (strcmp(cmd, "status") == 0) {
+        char status_payload[256];
+        snprintf(status_payload, sizeof(status_payload),
+            "{\"device_sn\":\"%s\",\"device_name\":\"%s\",\"device_type\":\"%s\",\"timestamp\":%lld}",
+            device_sn, DEVICE_NAME, DEVICE_TYPE, esp_timer_get_time() / 1000);
+        char status_topic[64];
+        snprintf(status_topic, sizeof(status_topic), "device/%s/status", device_sn);
+        esp_mqtt_client_publish(mqtt_client, status_topic, status_payload, 0, 1, 0);
+    } else {
+        ESP_LOGW(TAG, "未知命令: %s", cmd);
+    }
+}
+
+// 按主题路由的命令: 负载直接是命令文本，不经 JSON 解析和分片拼接
+static void mqtt_handle_topic_command(esp_mqtt_event_handle_t event)
+{
+    if (event->current_data_offset != 0) {
+        return;   // 分片消息已在第一片时拒绝
+    }
+    const char *route = event->topic + s_mqtt_cmd_topic_len;
+    size_t route_len = event->topic_len - s_mqtt_cmd_topic_len;
+    esp_err_t err = event->data_len < event->total_data_len
+                        ? ESP_ERR_INVALID_SIZE   // 超过 MQTT 缓冲的消息不可能是合法命令
+                        : command_json_parse_topic(route, route_len, event->data, event->data_len, &s_mqtt_msg);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "丢弃MQTT命令 %.*s (%d 字节): %s", (int)route_len, route, event->total_data_len,
+                 esp_err_to_name(err));
+        // 主题中带 id 时请求者在等应答
+        const char *slash = memchr(route, '/', route_len);
+        size_t id_len = slash != NULL ? route_len - (size_t)(slash + 1 - route) : 0;
+        if (id_len > 0 && id_len < COMMAND_JSON_ID_LEN && memchr(slash + 1, '/', id_len) == NULL) {
+            char reply_topic[COMMAND_REPLY_TO_LEN];
+            char line[48];
+            snprintf(reply_topic, sizeof(reply_topic), "device/%s/resp/%.*s", device_sn, (int)id_len, slash + 1);
+            snprintf(line, sizeof(line), "ERROR:%s", esp_err_to_name(err));
+            command_dispatcher_send(COMMAND_ORIGIN_MQTT, reply_topic, line);
+        }
+        return;
+    }
+    mqtt_forward_command(s_mqtt_msg.id, s_mqtt_msg.command);
+}
+
+/**
+ * @brief MQTT 来源的回复通道
+ *
+ * 在高优先级任务、模块工作任务和 esp_timer 任务 (定时命令) 中调用，不能等待 MQTT 客户端的锁
+ * 和网络写入：只把 "应答主题\0内容\0" 复制进环形缓冲，由 mqtt_reply_task 发布，缓冲满时丢弃并计数
+ */
+static void mqtt_reply_sink(const char *reply_to, const char *line)
+{
+    if (!mqtt_connected || s_mqtt_reply_buf == NULL || reply_to[0] == '\0') {
+        return;
+    }
+    size_t topic_len = strlen(reply_to) + 1;
+    size_t line_len = strlen(line) + 1;
+    void *item = NULL;
+    if (xRingbufferSendAcquire(s_mqtt_reply_buf, &item, topic_len + line_len, 0) != pdTRUE) {
+        atomic_fetch_add(&s_mqtt_reply_dropped, 1);
+        return;
+    }
+    memcpy(item, reply_to, topic_len);
+    memcpy((char *)item + topic_len, line, line_len);
+    xRingbufferSendComplete(s_mqtt_reply_buf, item);
+}
+
+// 按顺序发布命令回复，发布时的等待 (API 锁、网络写入) 只阻塞本任务
+static void mqtt_reply_task(void *pvParameters)
+{
+    while (1) {
+        size_t size;
+        char *item = xRingbufferReceive(s_mqtt_reply_buf, &size, portMAX_DELAY);
+        if (item == NULL) {
+            continue;
+        }
+        if (mqtt_connected && mqtt_client != NULL) {
+            const char *line = item + strlen(item) + 1;
+            esp_mqtt_client_publish(mqtt_client, item, line, 0, 1, 0);
+        }
+        vRingbufferReturnItem(s_mqtt_reply_buf, item);
+    }
+}
+
+static esp_err_t mqtt_reply_init(void)
+{
+    s_mqtt_reply_buf = xRingbufferCreate(MQTT_REPLY_BUF_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (s_mqtt_reply_buf == NULL ||
+        xTaskCreate(mqtt_reply_task, "mqtt_reply", MQTT_REPLY_TASK_STACK, NULL, 5, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "创建MQTT回复任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// 遥测批次发布到 device/<sn>/<subtopic>，未连接时返回错误，批次留在遥测缓冲或 flash 队列中
+// QoS 1: 发出后连接断开的批次由 MQTT 客户端重发，接收方按批次序号去重
+static esp_err_t mqtt_telemetry_publish(const char *subtopic, const uint8_t *data, size_t len, bool retain)
+{
+    if (!mqtt_connected || mqtt_client == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    char topic[64];
+    snprintf(topic, sizeof(topic), "device/%s/%s", device_sn, subtopic);
+    return esp_mqtt_client_publish(mqtt_client, topic, (const char *)data, (int)len, 1, retain) < 0 ? ESP_FAIL : ESP_OK;
+}
+
+static void uart_reply_sink(const char *reply_to, const char *line)
+{
+    uart_service_send_line(line);
+}
+
 static void send_log_to_broker(const char *log)
 {
     if (mqtt_connected && mqtt_client) {
@@ -264,6 +347,207 @@ static void send_log_to_broker(const char *log)
     }
 }
 
+// --- 诊断 (device/<sn>/diag)：各子系统一个 JSON 段 ---
+
+static void diag_add_uart(cJSON *root)
+{
+    uart_service_tx_stats_t tx;
+    uart_service_get_tx_stats(&tx);
+    cJSON *uart_tx = cJSON_AddObjectToObject(root, "uart_tx");
+    if (uart_tx != NULL) {
+        cJSON_AddNumberToObject(uart_tx, "depth", tx.depth);
+        cJSON_AddNumberToObject(uart_tx, "high_watermark", tx.high_watermark);
+        cJSON_AddNumberToObject(uart_tx, "sent", tx.sent);
+        cJSON_AddNumberToObject(uart_tx, "dropped", tx.dropped);
+        cJSON_AddNumberToObject(uart_tx, "truncated", tx.truncated);
+    }
+    uart_service_frame_stats_t frames;
+    uart_service_get_frame_stats(&frames);
+    cJSON *uart_frame = cJSON_AddObjectToObject(root, "uart_frame");
+    if (uart_frame != NULL) {
+        cJSON_AddBoolToObject(uart_frame, "binary", frames.binary_mode);
+        cJSON_AddNumberToObject(uart_frame, "rx", frames.rx_frames);
+        cJSON_AddNumberToObject(uart_frame, "rx_errors", frames.rx_errors);
+        cJSON_AddNumberToObject(uart_frame, "rx_duplicates", frames.rx_duplicates);
+        cJSON_AddNumberToObject(uart_frame, "tx", frames.tx_frames);
+        cJSON_AddNumberToObject(uart_frame, "tx_retransmits", frames.tx_retransmits);
+        cJSON_AddNumberToObject(uart_frame, "tx_failed", frames.tx_failed);
+        cJSON_AddNumberToObject(uart_frame, "nak_sent", frames.nak_sent);
+    }
+    uart_service_link_stats_t link;
+    uart_service_get_link_stats(&link);
+    cJSON *uart_link = cJSON_AddObjectToObject(root, "uart_link");
+    if (uart_link != NULL) {
+        cJSON_AddNumberToObject(uart_link, "baud", link.baud);
+        cJSON_AddBoolToObject(uart_link, "rtscts", link.rtscts);
+        cJSON_AddNumberToObject(uart_link, "upgrades", link.upgrades);
+        cJSON_AddNumberToObject(uart_link, "fallbacks", link.fallbacks);
+        cJSON_AddNumberToObject(uart_link, "rejects", link.rejects);
+        cJSON_AddNumberToObject(uart_link, "hw_errors", link.hw_errors);
+    }
+    uart_service_heartbeat_stats_t heartbeat;
+    uart_service_get_heartbeat_stats(&heartbeat);
+    cJSON *uart_hb = cJSON_AddObjectToObject(root, "uart_heartbeat");
+    if (uart_hb != NULL) {
+        cJSON_AddBoolToObject(uart_hb, "peer_up", heartbeat.peer_up);
+        cJSON_AddBoolToObject(uart_hb, "armed", heartbeat.armed);
+        cJSON_AddNumberToObject(uart_hb, "losses", heartbeat.losses);
+        cJSON_AddNumberToObject(uart_hb, "sent", heartbeat.sent);
+        cJSON_AddNumberToObject(uart_hb, "received", heartbeat.received);
+        cJSON_AddNumberToObject(uart_hb, "last_rx_age_ms", heartbeat.last_rx_age_ms);
+    }
+    uart_service_dma_stats_t dma;
+    uart_service_get_dma_stats(&dma);
+    if (dma.enabled) {
+        cJSON *uart_dma = cJSON_AddObjectToObject(root, "uart_dma");
+        if (uart_dma != NULL) {
+            cJSON_AddNumberToObject(uart_dma, "rx_events", dma.rx_events);
+            cJSON_AddNumberToObject(uart_dma, "rx_bytes", dma.rx_bytes);
+            cJSON_AddNumberToObject(uart_dma, "rx_rearm_errors", dma.rx_rearm_errors);
+            cJSON_AddNumberToObject(uart_dma, "rx_overruns", dma.rx_overruns);
+            cJSON_AddNumberToObject(uart_dma, "tx_transfers", dma.tx_transfers);
+            cJSON_AddNumberToObject(uart_dma, "tx_bytes", dma.tx_bytes);
+            cJSON_AddNumberToObject(uart_dma, "tx_waits", dma.tx_waits);
+        }
+    }
+    uart_service_bulk_stats_t bulk;
+    uart_service_get_bulk_stats(&bulk);
+    cJSON *uart_bulk = cJSON_AddObjectToObject(root, "uart_bulk");
+    if (uart_bulk != NULL) {
+        cJSON_AddBoolToObject(uart_bulk, "active", bulk.active);
+        cJSON_AddBoolToObject(uart_bulk, "sending", bulk.sending);
+        cJSON_AddNumberToObject(uart_bulk, "size", bulk.size);
+        cJSON_AddNumberToObject(uart_bulk, "done", bulk.done);
+        cJSON_AddNumberToObject(uart_bulk, "bytes_per_s", bulk.bytes_per_s);
+        cJSON_AddNumberToObject(uart_bulk, "completed", bulk.completed);
+        cJSON_AddNumberToObject(uart_bulk, "failed", bulk.failed);
+        cJSON_AddNumberToObject(uart_bulk, "chunks_sent", bulk.chunks_sent);
+        cJSON_AddNumberToObject(uart_bulk, "chunks_resent", bulk.chunks_resent);
+        cJSON_AddNumberToObject(uart_bulk, "chunks_received", bulk.chunks_received);
+        cJSON_AddNumberToObject(uart_bulk, "chunks_dropped", bulk.chunks_dropped);
+    }
+}
+
+static void diag_add_telemetry(cJSON *root)
+{
+    telemetry_stats_t telemetry;
+    telemetry_get_stats(&telemetry);
+    cJSON *telemetry_obj = cJSON_AddObjectToObject(root, "telemetry");
+    if (telemetry_obj != NULL) {
+        cJSON_AddNumberToObject(telemetry_obj, "samples", telemetry.samples);
+        cJSON_AddNumberToObject(telemetry_obj, "batches", telemetry.batches);
+        cJSON_AddNumberToObject(telemetry_obj, "bytes", telemetry.bytes);
+        cJSON_AddNumberToObject(telemetry_obj, "raw_bytes", telemetry.raw_bytes);
+        cJSON_AddNumberToObject(telemetry_obj, "pending", telemetry.pending);
+        cJSON_AddNumberToObject(telemetry_obj, "dropped", telemetry.dropped);
+        cJSON_AddNumberToObject(telemetry_obj, "failed", telemetry.failed);
+        cJSON_AddNumberToObject(telemetry_obj, "backlog", telemetry.backlog);
+        cJSON_AddNumberToObject(telemetry_obj, "lost", telemetry.lost);
+        if (telemetry.samples > 0) {
+            cJSON_AddNumberToObject(telemetry_obj, "bytes_per_sample", (double)telemetry.bytes / telemetry.samples);
+        }
+        if (telemetry.uptime_s > 0) {
+            cJSON_AddNumberToObject(telemetry_obj, "publishes_per_min", telemetry.publishes * 60.0 / telemetry.uptime_s);
+        }
+    }
+}
+
+static void diag_add_net(cJSON *root)
+{
+    connection_manager_stats_t net;
+    connection_manager_get_stats(&net);
+    cJSON *net_obj = cJSON_AddObjectToObject(root, "net");
+    if (net_obj != NULL) {
+        cJSON_AddStringToObject(net_obj, "state", connection_manager_state_name(net.state));
+        cJSON_AddNumberToObject(net_obj, "wifi_ms", net.last_wifi_ms);
+        cJSON_AddNumberToObject(net_obj, "mqtt_ms", net.last_mqtt_ms);
+        cJSON_AddNumberToObject(net_obj, "total_ms", net.last_total_ms);
+        cJSON_AddNumberToObject(net_obj, "max_total_ms", net.max_total_ms);
+        cJSON_AddNumberToObject(net_obj, "avg_total_ms", net.avg_total_ms);
+        cJSON_AddNumberToObject(net_obj, "wifi_connects", net.wifi_connects);
+        cJSON_AddNumberToObject(net_obj, "wifi_failures", net.wifi_failures);
+        cJSON_AddNumberToObject(net_obj, "fast_connects", net.fast_connects);
+        cJSON_AddNumberToObject(net_obj, "fast_misses", net.fast_misses);
+        cJSON_AddNumberToObject(net_obj, "mqtt_connects", net.mqtt_connects);
+        cJSON_AddNumberToObject(net_obj, "mqtt_failures", net.mqtt_failures);
+        cJSON_AddNumberToObject(net_obj, "last_reason", net.last_reason);
+        cJSON_AddNumberToObject(net_obj, "connected_s", net.connected_s);
+        cJSON_AddNumberToObject(net_obj, "reply_dropped", atomic_load(&s_mqtt_reply_dropped));
+    }
+}
+
+static void diag_add_status(cJSON *root)
+{
+    status_registry_stats_t status;
+    status_registry_get_stats(&status);
+    cJSON *status_obj = cJSON_AddObjectToObject(root, "status");
+    if (status_obj != NULL) {
+        cJSON_AddNumberToObject(status_obj, "fields", status.fields);
+        cJSON_AddNumberToObject(status_obj, "subscribers", status.subscribers);
+        cJSON_AddNumberToObject(status_obj, "updates", status.updates);
+        cJSON_AddNumberToObject(status_obj, "frames", status.frames);
+        cJSON_AddNumberToObject(status_obj, "values", status.values);
+    }
+}
+
+static void diag_add_prefixes(cJSON *root)
+{
+    cJSON *prefixes = cJSON_AddArrayToObject(root, "prefixes");
+    // 逐条读取，前缀数量不受数组大小限制
+    command_prefix_stats_t stats;
+    for (size_t i = 0; prefixes != NULL && command_dispatcher_get_prefix_stats_at(i, &stats); i++) {
+        cJSON *item = cJSON_CreateObject();
+        if (item == NULL) {
+            break;
+        }
+        cJSON_AddStringToObject(item, "prefix", stats.prefix);
+        cJSON_AddNumberToObject(item, "count", stats.count);
+        cJSON_AddNumberToObject(item, "errors", stats.errors);
+        cJSON_AddNumberToObject(item, "unsupported", stats.unsupported);
+        cJSON_AddNumberToObject(item, "min_us", stats.min_us);
+        cJSON_AddNumberToObject(item, "avg_us", stats.avg_us);
+        cJSON_AddNumberToObject(item, "p99_us", stats.p99_us);
+        cJSON_AddNumberToObject(item, "max_us", stats.max_us);
+        cJSON_AddNumberToObject(item, "wait_avg_us", stats.wait_avg_us);
+        cJSON_AddNumberToObject(item, "wait_max_us", stats.wait_max_us);
+        cJSON_AddNumberToObject(item, "dropped", stats.dropped);
+        cJSON_AddNumberToObject(item, "coalesced", stats.coalesced);
+        cJSON_AddNumberToObject(item, "throttled", stats.throttled);
+        cJSON_AddItemToArray(prefixes, item);
+    }
+}
+
+// 发布命令分发器和各子系统的统计，用于在现场定位慢的处理函数；
+// 只在收到 MQTT 命令 {"command":"diag"} 时发布，不再周期发布
+static void publish_dispatch_stats(void)
+{
+    if (!mqtt_connected || mqtt_client == NULL) {
+        return;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (root == NULL) {
+        return;
+    }
+    cJSON_AddNumberToObject(root, "unmatched", command_dispatcher_get_unmatched_count());
+    cJSON_AddNumberToObject(root, "throttled_uart", command_dispatcher_get_throttled_count(COMMAND_ORIGIN_UART));
+    cJSON_AddNumberToObject(root, "throttled_mqtt", command_dispatcher_get_throttled_count(COMMAND_ORIGIN_MQTT));
+    diag_add_uart(root);
+    diag_add_telemetry(root);
+    diag_add_net(root);
+    diag_add_status(root);
+    diag_add_prefixes(root);
+
+    char *payload = cJSON_PrintUnformatted(root);
+    if (payload != NULL) {
+        char diag_topic[64];
+        snprintf(diag_topic, sizeof(diag_topic), "device/%s/diag", device_sn);
+        esp_mqtt_client_publish(mqtt_client, diag_topic, payload, 0, 0, 0);
+        cJSON_free(payload);
+    }
+    cJSON_Delete(root);
+}
+
 static void log_task(void *pvParameters)
 {
     const char* featureSeason = "Spring";
@@ -295,41 +579,30 @@ void get_device_sn()
 
 
 
-static void handle_uart_message(const char *data, size_t len)
+/**
+ * @brief 屏幕串口断线时进入安全状态，恢复后把订阅的状态全部重发一次
+ * @note  断线通知在 esp_timer 任务中，只把命令交给分发器的高优先级通道
+ */
+static void handle_uart_link(bool up)
 {
-    ESP_LOGI(TAG, "UART消息入口收到原始数据: '%.*s', 准备转发给分发中心...", len, data);
-    command_dispatcher_forward(data, len);
+    // 在 esp_timer 回调中调用：重新同步只唤醒状态发布任务，安全状态交给高优先级任务，都不阻塞
+    if (up) {
+        status_registry_resync(COMMAND_ORIGIN_UART);
+        uart_service_send_line("STATUS:LINK_UP");
+        return;
+    }
+    static const char failsafe[] = "function:failsafe";
+    command_dispatcher_forward(failsafe, sizeof(failsafe) - 1);
 }
 
-static void s_data_upload_task(void *pvParameters)
+static void handle_uart_message(const char *data, size_t len)
 {
-    int water_level;
-    char command_buffer[32];
-    char status_str[128];
-    while (1) {
-        // water_level = get_water_level();
-        // if (water_level == 0) {
-        //     snprintf(status_str, sizeof(status_str), "STATUS:water_level_OFF");
-        // } else if (water_level == 1) {
-        //     snprintf(status_str, sizeof(status_str), "STATUS:water_level_ON");
-        // } else {
-        //     snprintf(status_str, sizeof(status_str), "STATUS:water_level_ERROR");
-        // }
-        // uart_service_send_line(status_str);
-        // vTaskDelay(pdMS_TO_TICKS(100));
-        // relay_set_state_steam(1);
-        // vTaskDelay(pdMS_TO_TICKS(1000));
-        // relay_set_state_steam(0);
-        // vTaskDelay(pdMS_TO_TICKS(1000));
-        // set_steam_motor(MOTOR_DIR_FORWARD, 100);
-        // vTaskDelay(pdMS_TO_TICKS(1000));
-        // set_steam_motor(MOTOR_DIR_REVERSE, 100);
-        // vTaskDelay(pdMS_TO_TICKS(1000));
-        // set_steam_valve(true);
-        // vTaskDelay(pdMS_TO_TICKS(1000));
-        // set_steam_valve(false);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
+    const command_source_t source = {
+        .origin = COMMAND_ORIGIN_UART,
+        .arrival_us = uart_service_rx_timestamp_us(),
+    };
+    ESP_LOGI(TAG, "UART消息入口收到原始数据: '%.*s', 准备转发给分发中心...", len, data);
+    command_dispatcher_forward_from(&source, data, len);
 }
 
 void app_main(void)
@@ -345,6 +618,15 @@ void app_main(void)
     ESP_LOGI(TAG, "Initializing local communication services...");
     ESP_ERROR_CHECK(uart_service_init());  
     uart_service_register_command_handler(handle_uart_message);
+    uart_service_register_link_handler(handle_uart_link);
+    // 屏幕的命令回复到串口；设备内部流程的状态变化也显示在屏幕上
+    command_dispatcher_set_reply_sink(COMMAND_ORIGIN_UART, uart_reply_sink);
+    command_dispatcher_set_reply_sink(COMMAND_ORIGIN_LOCAL, uart_reply_sink);
+    ESP_ERROR_CHECK(mqtt_reply_init());
+    command_dispatcher_set_reply_sink(COMMAND_ORIGIN_MQTT, mqtt_reply_sink);
+    // 在各模块注册状态字段之前启动，字段的第一次变化也能记录
+    ESP_ERROR_CHECK(telemetry_init());
+    telemetry_set_publisher(mqtt_telemetry_publish);
     ESP_ERROR_CHECK(led_controller_init());
     ESP_ERROR_CHECK(fan_controller_init());
     ESP_ERROR_CHECK(dht22_sensor_init());
@@ -361,16 +643,7 @@ void app_main(void)
 
     get_device_sn();
     ESP_LOGI(TAG, "设备SN: %s", device_sn);
-    if (xTaskCreate(s_data_upload_task, 
-        "data_upload_task", 
-        4096,
-        NULL, 
-        5, 
-        &s_data_upload_task_handle) != pdPASS) {
-    ESP_LOGE(TAG, "数据上传任务创建失败！");
-    }
-    
-    // wifi_init_sta();
+    // network_start();
 
     // 取消注释以启用日志上传任务
     xTaskCreate(log_task, "log_task", 4096, NULL, 5, NULL);
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+"""Replay benchmark for the host build of uart_service + command_dispatcher.
+
+Starts build/host_sim (see Makefile), connects to its pseudo-terminal the same
+way the screen is wired to the UART, and replays the command traces in
+corpus/*.txt (one command per line, "#" comments, "$T<n>" = handle of the
+n-th at:/every: timer created in the current pass).
+
+Every command is followed by a "ping:<n>" barrier; the command's
+latency is the time from sending it until the barrier's reply arrives, i.e.
+until the UART task has assembled the line, the dispatcher has parsed it and
+any synchronous handler (relay, fan, valve, ...) has run and replied. Commands
+of queued modules (stepper, ...) are accepted within that time and finish in
+their worker task.
+
+Reported: commands/s, latency p50/p90/p99/max overall and per prefix, replies
+and throttle notices seen, and heap usage (host:heap) before and after.
+
+  make -C tools/host_sim
+  python3 tools/host_sim/bench.py                       # text lines
+  python3 tools/host_sim/bench.py --binary --repeat 50  # COBS/CRC frames
+  python3 tools/host_sim/bench.py --max-p99-us 5000 --max-heap-growth 0
+
+Exits non-zero when a barrier reply is lost or a --max-* limit is exceeded,
+so the same command can gate CI. The device rate limits are disabled
+(host_sim --no-rate-limit) unless --rate-limit is given, otherwise replaying
+faster than CONFIG_COMMAND_DISPATCHER_UART_RATE just measures the throttle.
+"""
+
+import argparse
+import fcntl
+import glob
+import os
+import re
+import select
+import subprocess
+import sys
+import termios
+import time
+import tty
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, ".."))
+from uart_bench import AsciiLink, BinaryLink, percentile  # noqa: E402
+
+
+class PtyPort:
+    """The subset of pyserial's Serial that AsciiLink/BinaryLink use."""
+
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+
+    @property
+    def in_waiting(self):
+        buf = bytearray(4)
+        fcntl.ioctl(self.fd, termios.FIONREAD, buf)
+        return int.from_bytes(buf, sys.byteorder)
+
+    def read(self, n):
+        ready, _, _ = select.select([self.fd], [], [], 0.001)
+        return os.read(self.fd, n) if ready else b""
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def close(self):
+        os.close(self.fd)
+
+
+def load_corpus(paths):
+    commands = []
+    for path in paths:
+        with open(path, encoding="utf-8") as f:
+            for line in f:
+                line = line.strip()
+                if line and not line.startswith("#"):
+                    commands.append(line)
+    return commands
+
+
+class Replayer:
+    def __init__(self, link, timeout):
+        self.link = link
+        self.timeout = timeout
+        self.barrier = 0
+        self.replies = 0
+        self.throttled = 0
+        self.errors = 0
+        self.timers = []                    # handles of at:/every: created in this pass, for $T<n>
+
+    def expand(self, cmd):
+        """Replace $T<n> with the handle of the n-th timer created in this pass."""
+        def handle(m):
+            n = int(m.group(1))
+            return str(self.timers[n - 1]) if n <= len(self.timers) else "0"
+        return re.sub(r"\$T(\d+)", handle, cmd)
+
+    def wait_for(self, match):
+        """Read lines until match(line) is true; returns the line or None on timeout."""
+        deadline = time.perf_counter() + self.timeout
+        while True:
+            left = deadline - time.perf_counter()
+            line = self.link.recv(max(0.0, left)) if left > 0 else None
+            if line is None:
+                return None
+            if match(line):
+                return line
+            if line.startswith("STATUS:PROBE:"):
+                continue                    # late barrier of a command already counted as lost
+            self.replies += 1
+            created = re.fullmatch(r"STATUS:TIMER:(\d+)", line)
+            if created:
+                self.timers.append(int(created.group(1)))
+            if line.startswith("STATUS:THROTTLED:"):
+                self.throttled += 1
+            elif line.startswith("ERROR"):
+                self.errors += 1
+
+    def sync(self):
+        """Send a barrier and wait for it; returns False when it was lost."""
+        self.barrier += 1
+        tag = f"STATUS:PROBE:{self.barrier}:"
+        self.link.send(f"ping:{self.barrier}")
+        return self.wait_for(lambda line: line.startswith(tag)) is not None
+
+    def heap(self):
+        self.link.send("host:heap")
+        line = self.wait_for(lambda line: line.startswith("STATUS:HOST:HEAP:"))
+        if line is None:
+            return None
+        return {k: int(v) for k, v in (item.split("=") for item in line.split(":", 3)[3].split(","))}
+
+
+def print_latencies(title, values):
+    print(f"  {title:<12} {len(values):>6} {percentile(values, 50):9.0f} {percentile(values, 90):9.0f} "
+          f"{percentile(values, 99):9.0f} {max(values):9.0f}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--binary-path", default=os.path.join(HERE, "build", "host_sim"), help="host_sim executable")
+    ap.add_argument("--corpus", nargs="*", help="trace files (default: corpus/*.txt)")
+    ap.add_argument("--repeat", type=int, default=20, help="replay the corpus N times")
+    ap.add_argument("--binary", action="store_true", help="use COBS/CRC frames instead of text lines")
+    ap.add_argument("--timeout", type=float, default=1.0, help="barrier reply timeout (s)")
+    ap.add_argument("--rate-limit", action="store_true", help="keep the device's UART rate limits")
+    ap.add_argument("--max-p99-us", type=float, help="fail when the overall p99 latency exceeds this")
+    ap.add_argument("--max-heap-growth", type=int, help="fail when heap in use grows by more than N bytes")
+    args = ap.parse_args()
+
+    corpus = args.corpus or sorted(glob.glob(os.path.join(HERE, "corpus", "*.txt")))
+    commands = load_corpus(corpus)
+    if not commands:
+        ap.error("empty corpus")
+
+    env = dict(os.environ)
+    env.setdefault("HOST_LOG_LEVEL", "1")   # the failsafe warnings before connecting are expected
+    cmdline = [args.binary_path] + ([] if args.rate_limit else ["--no-rate-limit"])
+    proc = subprocess.Popen(cmdline, stdout=subprocess.PIPE, text=True, env=env)
+    try:
+        banner = proc.stdout.readline().split()
+        if len(banner) != 2 or banner[0] != "PTY":
+            print(f"unexpected output from {args.binary_path}: {banner}", file=sys.stderr)
+            return 2
+        port = PtyPort(banner[1])
+        link = BinaryLink(port) if args.binary else AsciiLink(port)
+        rp = Replayer(link, args.timeout)
+        if not rp.sync():
+            print("host_sim did not answer", file=sys.stderr)
+            return 2
+        rp.replies = rp.throttled = rp.errors = 0
+        heap_before = rp.heap()
+
+        latencies = []
+        by_prefix = {}
+        lost = 0
+        t_start = time.perf_counter()
+        for _ in range(args.repeat):
+            rp.timers = []
+            for cmd in commands:
+                t0 = time.perf_counter()
+                link.send(rp.expand(cmd))
+                if not rp.sync():
+                    lost += 1
+                    continue
+                us = (time.perf_counter() - t0) * 1e6
+                latencies.append(us)
+                by_prefix.setdefault(cmd.split(":", 1)[0], []).append(us)
+        elapsed = time.perf_counter() - t_start
+        heap_after = rp.heap()
+        port.close()
+    finally:
+        proc.kill()
+        proc.wait()
+
+    total = len(commands) * args.repeat
+    print(f"[host_sim/{link.name}] {len(commands)} commands x {args.repeat} = {total}, "
+          f"{total / elapsed:.0f} cmd/s, lost={lost}, replies={rp.replies}, "
+          f"throttled={rp.throttled}, errors={rp.errors}")
+    if latencies:
+        print(f"  {'prefix':<12} {'n':>6} {'p50':>9} {'p90':>9} {'p99':>9} {'max':>9}   (us, send -> barrier)")
+        print_latencies("all", latencies)
+        for prefix in sorted(by_prefix):
+            print_latencies(prefix, by_prefix[prefix])
+
+    failed = lost > 0
+    if heap_before and heap_after:
+        growth = heap_after["in_use"] - heap_before["in_use"]
+        print(f"  heap: in_use {heap_before['in_use']} -> {heap_after['in_use']} B ({growth:+d}), "
+              f"peak {heap_after['peak']} B, {heap_after['allocs'] - heap_before['allocs']} allocs during replay")
+        if args.max_heap_growth is not None and growth > args.max_heap_growth:
+            print(f"FAIL: heap grew by {growth} B (limit {args.max_heap_growth})")
+            failed = True
+    else:
+        print("  heap: host:heap not answered")
+        failed = True
+    if args.max_p99_us is not None and latencies and percentile(latencies, 99) > args.max_p99_us:
+        print(f"FAIL: p99 {percentile(latencies, 99):.0f} us (limit {args.max_p99_us:.0f})")
+        failed = True
+    if lost:
+        print(f"FAIL: {lost} barrier replies lost")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,129 @@
+/*
+ * 连接管理 (connection_manager) 的断线 / 重连测试
+ *
+ * 在仿真的 AP 和 MQTT 服务器 (port/src/net.c) 上运行真实的 connection_manager 任务，依次检查:
+ *   启动        连上 WiFi 和 MQTT
+ *   服务器断开  服务器关闭一段时间再恢复，客户端重新连上 (关闭了自动重连，必须停止再启动客户端)
+ *   AP 断开     AP 关闭一段时间再恢复，WiFi 和 MQTT 都重新连上
+ *   net:reconnect  主动断开后立即重新连上
+ * 每一步给出从恢复到重新连上的时间，任一步超时退出码非零。
+ *
+ *   make -C tools/host_sim conn-test
+ */
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "host_port.h"
+#include "command_dispatcher.h"
+#include "connection_manager.h"
+
+#define OUTAGE_MS    1500
+#define CONNECT_MS   10000   // 每一步必须在这段时间内完成 (退避从 500 ms 起)
+
+static const command_module_t *s_net_module;
+static int s_failures;
+
+// 只需要接住 "net" 模块，回复打印出来
+esp_err_t command_dispatcher_register(const command_module_t *module)
+{
+    s_net_module = module;
+    return ESP_OK;
+}
+
+void command_dispatcher_reply(const command_args_t *args, const char *line)
+{
+    printf("  reply: %s\n", line);
+}
+
+static bool wait_until(bool (*done)(connection_state_t, uint32_t), connection_state_t state, uint32_t arg,
+                       uint32_t *waited_ms)
+{
+    int64_t start = esp_timer_get_time();
+    bool ok;
+    while (!(ok = done(state, arg)) && esp_timer_get_time() - start < (int64_t)CONNECT_MS * 1000) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    *waited_ms = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    return ok;
+}
+
+static bool in_state(connection_state_t state, uint32_t unused)
+{
+    return connection_manager_get_state() == state;
+}
+
+// 第 n 次 MQTT 连接已完成
+static bool connected_times(connection_state_t unused, uint32_t n)
+{
+    connection_manager_stats_t stats;
+    connection_manager_get_stats(&stats);
+    return stats.state == CONN_STATE_CONNECTED && stats.mqtt_connects >= n;
+}
+
+static void check(bool ok, const char *step, uint32_t ms)
+{
+    connection_manager_stats_t stats;
+    connection_manager_get_stats(&stats);
+    net_host_stats_t net;
+    net_host_get_stats(&net);
+    printf("%-16s %s  %5lu ms  state=%s wifi=%lu mqtt=%lu mqtt_fail=%lu starts=%lu stops=%lu reconnect_calls=%lu\n",
+           step, ok ? "ok  " : "FAIL", (unsigned long)ms, connection_manager_state_name(stats.state),
+           (unsigned long)stats.wifi_connects, (unsigned long)stats.mqtt_connects,
+           (unsigned long)stats.mqtt_failures, (unsigned long)net.mqtt_starts, (unsigned long)net.mqtt_stops,
+           (unsigned long)net.mqtt_reconnect_calls);
+    s_failures += ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    const connection_manager_config_t config = {
+        .ssid = "host_ap",
+        .password = "password",
+        .broker_uri = "mqtt://host",
+        .client_id = "host_sim",
+    };
+    uint32_t ms = 0;
+    bool ok;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (connection_manager_start(&config) != ESP_OK) {
+        printf("connection_manager_start failed\n");
+        return 1;
+    }
+    ok = wait_until(connected_times, 0, 1, &ms);
+    check(ok, "start", ms);
+
+    net_host_set_broker(false);
+    ok = wait_until(in_state, CONN_STATE_MQTT_BACKOFF, 0, &ms);
+    check(ok, "broker down", ms);
+    vTaskDelay(pdMS_TO_TICKS(OUTAGE_MS));
+    net_host_set_broker(true);
+    ok = wait_until(connected_times, 0, 2, &ms);
+    check(ok, "broker up", ms);
+
+    net_host_set_ap(false);
+    ok = wait_until(in_state, CONN_STATE_WIFI_BACKOFF, 0, &ms);
+    check(ok, "ap down", ms);
+    vTaskDelay(pdMS_TO_TICKS(OUTAGE_MS));
+    net_host_set_ap(true);
+    ok = wait_until(connected_times, 0, 3, &ms);
+    check(ok, "ap up", ms);
+
+    // 与屏幕或 MQTT 发来的 "net:reconnect" 相同
+    command_args_t args = { .verb_id = 1 };
+    for (size_t i = 0; i < s_net_module->verb_count; i++) {
+        if (strcmp(s_net_module->verbs[i].name, "reconnect") == 0) {
+            args.verb_id = s_net_module->verbs[i].id;
+        }
+    }
+    s_net_module->handler(&args);
+    ok = wait_until(connected_times, 0, 4, &ms);
+    check(ok, "net:reconnect", ms);
+
+    connection_manager_stats_t stats;
+    connection_manager_get_stats(&stats);
+    check(stats.mqtt_connects == 4 && stats.wifi_connects == 3, "totals", 0);
+    printf("%s\n", s_failures == 0 ? "PASS" : "FAIL");
+    return s_failures == 0 ? 0 : 1;
+}
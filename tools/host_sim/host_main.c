@@ -0,0 +1,274 @@
+/*
+ * 主机仿真入口: 在 Linux 上运行 uart_service + command_dispatcher + 各模块的命令处理
+ *
+ * 屏幕串口由伪终端代替，启动后在标准输出打印一行 "PTY <从设备路径>"，
+ * 打开该路径即可像串口一样收发命令 (tools/host_sim/bench.py、uart_bench.py、probe_bench.py 均可)。
+ * 接线与 main.c 相同，只是没有 NVS / WiFi / MQTT，也不初始化依赖外设时序的
+ * dht22、ds18b20、led (RMT)、compressor (Modbus)。
+ *
+ * 仿真额外注册 "host" 命令:
+ *   host:heap               -> STATUS:HOST:HEAP:in_use=..,peak=..,allocs=..
+ *   host:gpio:<pin>         -> STATUS:HOST:GPIO:<pin>:<电平>
+ *   host:gpio:<pin>:<电平>  设定输入引脚电平 (例如水位开关) 后同上回复
+ *   host:bulk               -> STATUS:HOST:BULK:active=..,done=..,size=..,bps=..,... (批量传输统计)
+ *   host:bulk_send:<字节数> 向屏幕批量发送一段固定规律的数据 (第 i 字节为 (i * 7 + i / 256) & 0xFF)，
+ *                           结束时回复 STATUS:HOST:BULK_SENT:<结果>
+ *   host:bulk_abort         取消进行中的批量传输
+ * 屏幕发来的批量传输保存在内存中，结束时回复 STATUS:HOST:BULK_RECEIVED:<结果>:<字节数>:<CRC32>；
+ * 同名、同长度、同 CRC32 的传输从上次写到的位置续传 (tools/uart_bulk.py --sim)。
+ *
+ * 选项:
+ *   --no-rate-limit  串口命令不计入速率限制，测量最大吞吐时使用
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "host_port.h"
+#include "sdkconfig.h"
+
+#include "uart_service.h"
+#include "uart_frame.h"
+#include "command_dispatcher.h"
+#include "status_registry.h"
+#include "fan_controller.h"
+#include "dc_motor_control.h"
+#include "relay_module.h"
+#include "steam_valve_module.h"
+#include "stepper_motor_module.h"
+#include "water_level_sensor_module.h"
+#include "function_controller.h"
+#include "shake_motor_module.h"
+
+static const char *TAG = "HOST_SIM";
+static bool s_no_rate_limit = false;
+
+enum {
+    HOST_VERB_HEAP,
+    HOST_VERB_GPIO,
+    HOST_VERB_BULK,
+    HOST_VERB_BULK_SEND,
+    HOST_VERB_BULK_ABORT,
+};
+
+// --- 批量传输: 内存中的接收缓冲和规律数据源 ---
+typedef struct {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t crc32;
+    uint32_t written;
+    char     name[UART_FRAME_BULK_NAME_MAX + 1];
+} host_bulk_store_t;
+
+static host_bulk_store_t s_bulk_store;
+
+static uint8_t host_bulk_pattern(uint32_t i)
+{
+    return (uint8_t)(i * 7 + i / 256);
+}
+
+static esp_err_t host_bulk_open(void *ctx, const uart_service_bulk_info_t *info, uint32_t *resume_offset, uint32_t *resume_crc32)
+{
+    host_bulk_store_t *st = ctx;
+    if (st->data != NULL && st->size == info->size && st->crc32 == info->crc32 && strcmp(st->name, info->name) == 0) {
+        *resume_offset = st->written;
+        *resume_crc32 = uart_frame_crc32(0, st->data, st->written);
+        return ESP_OK;
+    }
+    free(st->data);
+    st->data = malloc(info->size > 0 ? info->size : 1);
+    if (st->data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    st->size = info->size;
+    st->crc32 = info->crc32;
+    st->written = 0;
+    snprintf(st->name, sizeof(st->name), "%s", info->name);
+    return ESP_OK;
+}
+
+static esp_err_t host_bulk_write(void *ctx, uint32_t offset, const uint8_t *data, size_t len)
+{
+    host_bulk_store_t *st = ctx;
+    memcpy(st->data + offset, data, len);
+    st->written = offset + len;
+    return ESP_OK;
+}
+
+static void host_bulk_close(void *ctx, esp_err_t result)
+{
+    host_bulk_store_t *st = ctx;
+    char line[96];
+    snprintf(line, sizeof(line), "STATUS:HOST:BULK_RECEIVED:%s:%lu:%08lx", esp_err_to_name(result),
+             (unsigned long)st->written, (unsigned long)uart_frame_crc32(0, st->data, st->written));
+    uart_service_send_line(line);
+    if (result == ESP_OK) {
+        // 完整收到后不再续传，下次同名传输从头开始
+        free(st->data);
+        st->data = NULL;
+    }
+}
+
+static esp_err_t host_bulk_read(void *ctx, uint32_t offset, uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = host_bulk_pattern(offset + i);
+    }
+    return ESP_OK;
+}
+
+static void host_bulk_sent(void *ctx, esp_err_t result)
+{
+    char line[64];
+    snprintf(line, sizeof(line), "STATUS:HOST:BULK_SENT:%s", esp_err_to_name(result));
+    uart_service_send_line(line);
+}
+
+static esp_err_t host_bulk_send(uint32_t size)
+{
+    uint32_t crc = 0;
+    uint8_t buf[256];
+    for (uint32_t offset = 0; offset < size; offset += sizeof(buf)) {
+        size_t n = size - offset < sizeof(buf) ? size - offset : sizeof(buf);
+        host_bulk_read(NULL, offset, buf, n);
+        crc = uart_frame_crc32(crc, buf, n);
+    }
+    const uart_service_bulk_info_t info = { .kind = 0, .size = size, .crc32 = crc, .name = "host_pattern" };
+    const uart_service_bulk_source_t source = { .read = host_bulk_read, .done = host_bulk_sent };
+    return uart_service_bulk_send(&info, &source);
+}
+
+static esp_err_t host_command_handler(const command_args_t *args)
+{
+    char line[192];
+    switch (args->verb_id) {
+    case HOST_VERB_HEAP: {
+        heap_host_stats_t stats;
+        heap_host_get_stats(&stats);
+        snprintf(line, sizeof(line), "STATUS:HOST:HEAP:in_use=%zu,peak=%zu,allocs=%lu",
+                 stats.in_use, stats.peak, (unsigned long)stats.allocs);
+        break;
+    }
+    case HOST_VERB_GPIO: {
+        int32_t pin, level;
+        if (!command_args_int(args, 0, &pin) || pin < 0 || pin >= GPIO_NUM_MAX) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (command_args_int(args, 1, &level)) {
+            gpio_host_set_input(pin, level);
+        }
+        snprintf(line, sizeof(line), "STATUS:HOST:GPIO:%ld:%d", (long)pin, gpio_get_level(pin));
+        break;
+    }
+    case HOST_VERB_BULK: {
+        uart_service_bulk_stats_t stats;
+        uart_service_get_bulk_stats(&stats);
+        snprintf(line, sizeof(line), "STATUS:HOST:BULK:active=%d,done=%lu,size=%lu,bps=%lu,completed=%lu,failed=%lu,"
+                 "sent=%lu,resent=%lu,received=%lu,dropped=%lu", stats.active, (unsigned long)stats.done,
+                 (unsigned long)stats.size, (unsigned long)stats.bytes_per_s, (unsigned long)stats.completed,
+                 (unsigned long)stats.failed, (unsigned long)stats.chunks_sent, (unsigned long)stats.chunks_resent,
+                 (unsigned long)stats.chunks_received, (unsigned long)stats.chunks_dropped);
+        break;
+    }
+    case HOST_VERB_BULK_SEND: {
+        int32_t size;
+        if (!command_args_int(args, 0, &size) || size < 0) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        return host_bulk_send((uint32_t)size);
+    }
+    case HOST_VERB_BULK_ABORT:
+        return uart_service_bulk_abort();
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    command_dispatcher_reply(args, line);
+    return ESP_OK;
+}
+
+static const command_verb_t s_host_verbs[] = {
+    { "heap", HOST_VERB_HEAP, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+    { "gpio", HOST_VERB_GPIO, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+    { "bulk", HOST_VERB_BULK, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+    { "bulk_send", HOST_VERB_BULK_SEND, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+    { "bulk_abort", HOST_VERB_BULK_ABORT, COMMAND_PRIORITY_NORMAL, COMMAND_VERB_FLAG_NO_THROTTLE },
+};
+
+static const command_module_t s_host_module = {
+    .prefix     = "host",
+    .handler    = host_command_handler,
+    .verbs      = s_host_verbs,
+    .verb_count = sizeof(s_host_verbs) / sizeof(s_host_verbs[0]),
+};
+
+static void uart_reply_sink(const char *reply_to, const char *line)
+{
+    uart_service_send_line(line);
+}
+
+// 与 main.c 相同: 屏幕断线时进入安全状态
+static void handle_uart_link(bool up)
+{
+    if (up) {
+        status_registry_resync(COMMAND_ORIGIN_UART);
+        uart_service_send_line("STATUS:LINK_UP");
+        return;
+    }
+    static const char failsafe[] = "function:failsafe";
+    command_dispatcher_forward(failsafe, sizeof(failsafe) - 1);
+}
+
+static void handle_uart_message(const char *data, size_t len)
+{
+    const command_source_t source = {
+        .origin = COMMAND_ORIGIN_UART,
+        .no_rate_limit = s_no_rate_limit,
+        .arrival_us = uart_service_rx_timestamp_us(),
+    };
+    command_dispatcher_forward_from(&source, data, len);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-rate-limit") == 0) {
+            s_no_rate_limit = true;
+        } else {
+            fprintf(stderr, "usage: %s [--no-rate-limit]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    ESP_ERROR_CHECK(command_dispatcher_init());
+    ESP_ERROR_CHECK(uart_service_init());
+    uart_service_register_command_handler(handle_uart_message);
+    uart_service_register_link_handler(handle_uart_link);
+    const uart_service_bulk_sink_t bulk_sink = {
+        .open = host_bulk_open, .write = host_bulk_write, .close = host_bulk_close, .ctx = &s_bulk_store,
+    };
+    uart_service_register_bulk_sink(&bulk_sink);
+    command_dispatcher_set_reply_sink(COMMAND_ORIGIN_UART, uart_reply_sink);
+    command_dispatcher_set_reply_sink(COMMAND_ORIGIN_LOCAL, uart_reply_sink);
+    ESP_ERROR_CHECK(fan_controller_init());
+    ESP_ERROR_CHECK(dc_motor_module_init());
+    ESP_ERROR_CHECK(relay_module_init());
+    ESP_ERROR_CHECK(steam_valve_module_init());
+    ESP_ERROR_CHECK(stepper_motor_module_init());
+    ESP_ERROR_CHECK(water_level_sensor_module_init());
+    ESP_ERROR_CHECK(function_controller_init());
+    ESP_ERROR_CHECK(shake_motor_module_init());
+    ESP_ERROR_CHECK(command_dispatcher_register(&s_host_module));
+
+    ESP_LOGI(TAG, "rate limit %s", s_no_rate_limit ? "off" : "on");
+    printf("PTY %s\n", uart_host_pty_name(CONFIG_UART_SERVICE_PORT_NUM));
+    fflush(stdout);
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    return 0;
+}
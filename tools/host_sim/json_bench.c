@@ -0,0 +1,312 @@
+/*
+ * MQTT 命令消息解析的微基准: command_json (单遍扫描、不分配) 与原先的 cJSON 路径对比
+ *
+ * 每条消息都走完 MQTT_EVENT_DATA 里的全部工作: 取出 command / args / id，拼出命令和应答主题。
+ *   cjson   strndup + cJSON_Parse + cJSON_GetObjectItem + cJSON_Delete + free (原先 main.c 的做法)
+ *   stream  command_json_assemble + command_json_parse
+ *   topic   同一命令按主题路由 (device/<sn>/cmd/<prefix>/<id>，负载为命令文本): command_json_parse_topic
+ * 输出每条消息的平均耗时 (us) 和堆分配次数 (由 port/src/heap.c 包装 malloc 统计)。
+ * 开始前先检查两条路径对每条消息的结果与预期相同，以及分片拼接和丢片的处理。
+ *
+ *   make -C tools/host_sim json-bench
+ *   build/json_bench --iterations 100000 --fragment 16
+ *
+ * --fragment N 把每条消息切成 N 字节的分片送入 stream 路径 (cjson 路径不支持分片，照旧整条解析)。
+ * 编译时找到 cJSON 源码 (CJSON_DIR，默认取 ESP-IDF 自带的) 才会测量 cjson 路径。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_err.h"
+#include "host_port.h"
+#include "command_dispatcher.h"
+#include "command_json.h"
+#ifdef HAVE_CJSON
+#include "cJSON.h"
+#endif
+
+typedef struct {
+    const char *json;
+    const char *command;   // 预期拼出的命令
+    const char *id;        // 预期的 id，没有为空串
+    const char *route;     // 同一命令按主题路由时 cmd/ 之后的部分
+    const char *payload;   // 及其负载
+} bench_msg_t;
+
+static const bench_msg_t s_msgs[] = {
+    { "{\"command\":\"on\"}", "on", "", "on", "" },
+    { "{\"command\":\"fan:75\",\"id\":\"a1b2c3\"}", "fan:75", "a1b2c3", "fan/a1b2c3", "75" },
+    { "{\"command\":\"fan\",\"args\":[75],\"id\":17}", "fan:75", "17", "fan/17", "75\r\n" },
+    { "{\"id\":\"7f3c9a2e-01\",\"ts\":1760690000123,\"source\":{\"app\":\"care-pro\",\"ver\":\"2.3.1\","
+      "\"user\":\"u_1029\",\"geo\":[31.23,121.47]},\"command\":\"batch:fan:60;relay:on;steam_valve:open\","
+      "\"tags\":[\"schedule\",\"evening\"],\"retain\":false}",
+      "batch:fan:60;relay:on;steam_valve:open", "7f3c9a2e-01",
+      "batch/7f3c9a2e-01", "fan:60;relay:on;steam_valve:open" },
+    { "{ \"Command\" : \"stepper\", \"args\" : [\"move\", 200, true], \"id\" : \"q\\u0031\" }\n",
+      "stepper:move:200:true", "q1", "stepper/q1", "move:200:true" },
+};
+#define MSG_COUNT (sizeof(s_msgs) / sizeof(s_msgs[0]))
+
+static const char *s_sn = "A1B2C3D4E5F6";
+static command_json_assembler_t s_assembler;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 与 main.c 相同的应答主题
+static void reply_topic(char *topic, size_t size, const char *id)
+{
+    if (id[0] != '\0') {
+        snprintf(topic, size, "device/%s/resp/%s", s_sn, id);
+    } else {
+        snprintf(topic, size, "device/%s/resp", s_sn);
+    }
+}
+
+/**
+ * @brief stream 路径: 按 fragment 字节切片送入拼接缓冲，完整后解析
+ */
+static esp_err_t stream_handle(const char *data, size_t len, size_t fragment, command_json_t *out, char *topic,
+                               size_t topic_size)
+{
+    const char *msg = NULL;
+    size_t msg_len = 0;
+    esp_err_t err = ESP_ERR_NOT_FINISHED;
+    size_t step = fragment > 0 ? fragment : len;
+    for (size_t offset = 0; offset < len; offset += step) {
+        size_t n = len - offset < step ? len - offset : step;
+        err = command_json_assemble(&s_assembler, data + offset, n, offset, len, &msg, &msg_len);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = command_json_parse(msg, msg_len, out);
+    if (err == ESP_OK) {
+        reply_topic(topic, topic_size, out->id);
+    }
+    return err;
+}
+
+/**
+ * @brief topic 路径: 前缀和 id 来自主题，负载直接是命令文本
+ */
+static esp_err_t topic_handle(const char *route, const char *payload, command_json_t *out, char *topic,
+                              size_t topic_size)
+{
+    esp_err_t err = command_json_parse_topic(route, strlen(route), payload, strlen(payload), out);
+    if (err == ESP_OK) {
+        reply_topic(topic, topic_size, out->id);
+    }
+    return err;
+}
+
+#ifdef HAVE_CJSON
+/**
+ * @brief cjson 路径: 原先 mqtt_event_handler 的做法，加上同样的 args 拼接
+ */
+static esp_err_t cjson_handle(const char *data, size_t len, command_json_t *out, char *topic, size_t topic_size)
+{
+    esp_err_t err = ESP_OK;
+    char *payload = strndup(data, len);
+    if (payload == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    cJSON *json = cJSON_Parse(payload);
+    if (json == NULL) {
+        free(payload);
+        return ESP_ERR_INVALID_ARG;
+    }
+    const cJSON *cmd = cJSON_GetObjectItem(json, "command");
+    if (!cJSON_IsString(cmd) || cmd->valuestring == NULL) {
+        err = ESP_ERR_NOT_FOUND;
+        goto out;
+    }
+    size_t used = snprintf(out->command, sizeof(out->command), "%s", cmd->valuestring);
+    const cJSON *args = cJSON_GetObjectItem(json, "args");
+    const cJSON *arg = cJSON_IsArray(args) ? args->child : args;
+    for (; arg != NULL && used < sizeof(out->command); arg = cJSON_IsArray(args) ? arg->next : NULL) {
+        char *text = cJSON_IsString(arg) ? NULL : cJSON_PrintUnformatted(arg);
+        used += snprintf(out->command + used, sizeof(out->command) - used, ":%s", text ? text : arg->valuestring);
+        cJSON_free(text);
+    }
+    const cJSON *id = cJSON_GetObjectItem(json, "id");
+    if (cJSON_IsString(id) && id->valuestring != NULL) {
+        snprintf(out->id, sizeof(out->id), "%s", id->valuestring);
+    } else if (cJSON_IsNumber(id)) {
+        snprintf(out->id, sizeof(out->id), "%d", id->valueint);
+    } else {
+        out->id[0] = '\0';
+    }
+    reply_topic(topic, topic_size, out->id);
+out:
+    cJSON_Delete(json);
+    free(payload);
+    return err;
+}
+#endif
+
+static int check(const char *path, size_t i, esp_err_t err, const command_json_t *out)
+{
+    if (err != ESP_OK || strcmp(out->command, s_msgs[i].command) != 0 || strcmp(out->id, s_msgs[i].id) != 0) {
+        fprintf(stderr, "%s: message %zu: err=0x%x command=\"%s\" id=\"%s\", expected \"%s\" / \"%s\"\n", path, i,
+                err, out->command, out->id, s_msgs[i].command, s_msgs[i].id);
+        return 1;
+    }
+    return 0;
+}
+
+static int self_test(size_t fragment)
+{
+    command_json_t out;
+    char topic[COMMAND_REPLY_TO_LEN];
+    int failed = 0;
+    for (size_t i = 0; i < MSG_COUNT; i++) {
+        size_t len = strlen(s_msgs[i].json);
+        failed |= check("stream", i, stream_handle(s_msgs[i].json, len, 0, &out, topic, sizeof(topic)), &out);
+        failed |= check("stream/7", i, stream_handle(s_msgs[i].json, len, 7, &out, topic, sizeof(topic)), &out);
+        if (fragment > 0) {
+            failed |= check("stream/N", i, stream_handle(s_msgs[i].json, len, fragment, &out, topic, sizeof(topic)),
+                            &out);
+        }
+        failed |= check("topic", i, topic_handle(s_msgs[i].route, s_msgs[i].payload, &out, topic, sizeof(topic)), &out);
+#ifdef HAVE_CJSON
+        failed |= check("cjson", i, cjson_handle(s_msgs[i].json, len, &out, topic, sizeof(topic)), &out);
+#endif
+    }
+
+    // 丢掉中间一片: 该消息在最后一片时报告 INVALID_STATE，下一条消息不受影响
+    const char *msg = s_msgs[3].json, *ptr;
+    size_t len = strlen(msg), ptr_len;
+    esp_err_t err = command_json_assemble(&s_assembler, msg, 10, 0, len, &ptr, &ptr_len);
+    err = err == ESP_ERR_NOT_FINISHED ? command_json_assemble(&s_assembler, msg + 20, len - 20, 20, len, &ptr, &ptr_len)
+                                      : err;
+    if (err != ESP_ERR_INVALID_STATE) {
+        fprintf(stderr, "lost fragment: err=0x%x, expected ESP_ERR_INVALID_STATE\n", err);
+        failed = 1;
+    }
+    failed |= check("stream/after-loss", 1, stream_handle(s_msgs[1].json, strlen(s_msgs[1].json), 5, &out, topic,
+                                                          sizeof(topic)), &out);
+
+    static const struct {
+        const char *json;
+        esp_err_t   err;
+    } bad[] = {
+        { "{\"id\":1}", ESP_ERR_NOT_FOUND },
+        { "{\"command\":42}", ESP_ERR_NOT_FOUND },
+        { "{\"command\":\"fan\"", ESP_ERR_INVALID_ARG },
+        { "{\"command\":\"fan\",}", ESP_ERR_INVALID_ARG },
+        { "[\"command\",\"fan\"]", ESP_ERR_INVALID_ARG },
+        { "{\"command\":\"fan\",\"args\":[[1]]}", ESP_ERR_INVALID_ARG },
+        { "{\"command\":\"fan\",\"x\":[1,{\"a\":}]}", ESP_ERR_INVALID_ARG },
+        { "{\"command\":\"fan\",\"x\":01}", ESP_ERR_INVALID_ARG },
+        { "{\"command\":\"fan\",\"id\":\"0123456789012345678901234567890123456789\"}", ESP_ERR_INVALID_SIZE },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        err = command_json_parse(bad[i].json, strlen(bad[i].json), &out);
+        if (err != bad[i].err) {
+            fprintf(stderr, "%s: err=0x%x, expected 0x%x\n", bad[i].json, err, bad[i].err);
+            failed = 1;
+        }
+    }
+
+    static const struct {
+        const char *route;
+        const char *payload;
+        esp_err_t   err;
+    } bad_topic[] = {
+        { "", "75", ESP_ERR_INVALID_ARG },
+        { "fan/", "75", ESP_ERR_INVALID_ARG },
+        { "/a1", "75", ESP_ERR_INVALID_ARG },
+        { "fan:speed/a1", "75", ESP_ERR_INVALID_ARG },
+        { "fan/a1/b2", "75", ESP_ERR_INVALID_ARG },
+        { "fan/a1", "75\nrelay:on", ESP_ERR_INVALID_ARG },
+        { "fan/0123456789012345678901234567890123456789", "75", ESP_ERR_INVALID_SIZE },
+    };
+    for (size_t i = 0; i < sizeof(bad_topic) / sizeof(bad_topic[0]); i++) {
+        err = command_json_parse_topic(bad_topic[i].route, strlen(bad_topic[i].route), bad_topic[i].payload,
+                                       strlen(bad_topic[i].payload), &out);
+        if (err != bad_topic[i].err) {
+            fprintf(stderr, "topic %s \"%s\": err=0x%x, expected 0x%x\n", bad_topic[i].route, bad_topic[i].payload,
+                    err, bad_topic[i].err);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+typedef esp_err_t (*bench_fn_t)(size_t i, size_t fragment, command_json_t *out, char *topic, size_t topic_size);
+
+static esp_err_t bench_stream(size_t i, size_t fragment, command_json_t *out, char *topic, size_t topic_size)
+{
+    return stream_handle(s_msgs[i].json, strlen(s_msgs[i].json), fragment, out, topic, topic_size);
+}
+
+static esp_err_t bench_topic(size_t i, size_t fragment, command_json_t *out, char *topic, size_t topic_size)
+{
+    return topic_handle(s_msgs[i].route, s_msgs[i].payload, out, topic, topic_size);
+}
+
+#ifdef HAVE_CJSON
+static esp_err_t bench_cjson(size_t i, size_t fragment, command_json_t *out, char *topic, size_t topic_size)
+{
+    return cjson_handle(s_msgs[i].json, strlen(s_msgs[i].json), out, topic, topic_size);
+}
+#endif
+
+static void run(const char *name, bench_fn_t fn, long iterations, size_t fragment)
+{
+    command_json_t out;
+    char topic[COMMAND_REPLY_TO_LEN];
+    heap_host_stats_t before, after;
+    heap_host_get_stats(&before);
+    int64_t start = now_ns();
+    for (long n = 0; n < iterations; n++) {
+        for (size_t i = 0; i < MSG_COUNT; i++) {
+            fn(i, fragment, &out, topic, sizeof(topic));
+        }
+    }
+    int64_t elapsed = now_ns() - start;
+    heap_host_get_stats(&after);
+    double msgs = (double)iterations * MSG_COUNT;
+    printf("  %-8s %10.3f %12.2f %14zu\n", name, elapsed / 1000.0 / msgs, (after.allocs - before.allocs) / msgs,
+           after.peak > before.in_use ? after.peak - before.in_use : 0);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 100000;
+    size_t fragment = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--fragment") == 0 && i + 1 < argc) {
+            fragment = (size_t)atol(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--fragment BYTES]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // 先让 stdio 分配好缓冲，不计入测量
+    printf("[json_bench] %zu messages x %ld iterations%s\n", MSG_COUNT, iterations,
+           fragment > 0 ? ", stream path fed in fragments" : "");
+    fflush(stdout);
+    if (self_test(fragment) != 0) {
+        printf("FAIL: self test\n");
+        return 1;
+    }
+    printf("  %-8s %10s %12s %14s\n", "path", "us/msg", "allocs/msg", "peak heap (B)");
+    run(fragment > 0 ? "stream/N" : "stream", bench_stream, iterations, fragment);
+    run("topic", bench_topic, iterations, 0);
+#ifdef HAVE_CJSON
+    run("cjson", bench_cjson, iterations, 0);
+#else
+    printf("  cjson    (not built: cJSON.c not found in CJSON_DIR)\n");
+#endif
+    return 0;
+}
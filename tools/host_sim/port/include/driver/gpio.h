@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+/* 主机仿真: GPIO 只记录电平，输入引脚的电平由 gpio_host_set_input (host_port.h) 设定 */
+typedef int gpio_num_t;
+#define GPIO_NUM_NC (-1)
+#define GPIO_NUM_MAX 49
+#define GPIO_NUM_0   0
+#define GPIO_NUM_1   1
+#define GPIO_NUM_2   2
+#define GPIO_NUM_3   3
+#define GPIO_NUM_4   4
+#define GPIO_NUM_5   5
+#define GPIO_NUM_6   6
+#define GPIO_NUM_7   7
+#define GPIO_NUM_8   8
+#define GPIO_NUM_9   9
+#define GPIO_NUM_10  10
+#define GPIO_NUM_11  11
+#define GPIO_NUM_12  12
+#define GPIO_NUM_13  13
+#define GPIO_NUM_14  14
+#define GPIO_NUM_15  15
+#define GPIO_NUM_16  16
+#define GPIO_NUM_17  17
+#define GPIO_NUM_18  18
+#define GPIO_NUM_19  19
+#define GPIO_NUM_20  20
+#define GPIO_NUM_21  21
+#define GPIO_NUM_35  35
+#define GPIO_NUM_36  36
+#define GPIO_NUM_37  37
+#define GPIO_NUM_38  38
+#define GPIO_NUM_39  39
+#define GPIO_NUM_40  40
+#define GPIO_NUM_41  41
+#define GPIO_NUM_42  42
+#define GPIO_NUM_45  45
+#define GPIO_NUM_46  46
+#define GPIO_NUM_47  47
+#define GPIO_NUM_48  48
+
+typedef enum {
+    GPIO_MODE_DISABLE = 0,
+    GPIO_MODE_INPUT,
+    GPIO_MODE_OUTPUT,
+    GPIO_MODE_INPUT_OUTPUT,
+} gpio_mode_t;
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+} gpio_int_type_t;
+typedef enum { GPIO_PULLUP_DISABLE = 0, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE = 0, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum { GPIO_DRIVE_CAP_0, GPIO_DRIVE_CAP_1, GPIO_DRIVE_CAP_2, GPIO_DRIVE_CAP_3 } gpio_drive_cap_t;
+typedef void (*gpio_isr_t)(void *arg);
+
+typedef struct {
+    uint64_t        pin_bit_mask;
+    gpio_mode_t     mode;
+    gpio_pullup_t   pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_reset_pin(gpio_num_t gpio);
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_set_drive_capability(gpio_num_t gpio, gpio_drive_cap_t strength);
+esp_err_t gpio_install_isr_service(int intr_alloc_flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr_handler, void *args);
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+/*
+ * 主机仿真: UART 驱动由伪终端实现。uart_driver_install 创建一个 pty，
+ * 主机上的程序打开 uart_host_pty_name() 返回的从设备即相当于接上了屏幕。
+ * 收到的数据产生 UART_DATA / UART_PATTERN_DET 事件，没有后续数据 2ms 后
+ * 产生带 timeout_flag 的 UART_DATA 事件 (相当于 RX 超时)。波特率只记录不生效。
+ */
+
+typedef int uart_port_t;
+
+#define UART_PIN_NO_CHANGE    (-1)
+#define UART_HW_FIFO_LEN(n)   128
+#define UART_NUM_MAX          3
+
+typedef enum { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5, UART_STOP_BITS_2 } uart_stop_bits_t;
+typedef enum {
+    UART_HW_FLOWCTRL_DISABLE = 0,
+    UART_HW_FLOWCTRL_RTS,
+    UART_HW_FLOWCTRL_CTS,
+    UART_HW_FLOWCTRL_CTS_RTS,
+} uart_hw_flowcontrol_t;
+typedef enum { UART_SCLK_DEFAULT = 0 } uart_sclk_t;
+
+typedef struct {
+    int                   baud_rate;
+    uart_word_length_t    data_bits;
+    uart_parity_t         parity;
+    uart_stop_bits_t      stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t               rx_flow_ctrl_thresh;
+    uart_sclk_t           source_clk;
+} uart_config_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX,
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t            size;
+    bool              timeout_flag;
+} uart_event_t;
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags);
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config);
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts);
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t port, char pattern_chr, uint8_t chr_num,
+                                            int chr_tout, int post_idle, int pre_idle);
+esp_err_t uart_pattern_queue_reset(uart_port_t port, int queue_length);
+int uart_pattern_pop_pos(uart_port_t port);
+esp_err_t uart_set_rx_timeout(uart_port_t port, uint8_t tout_thresh);
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t *size);
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks_to_wait);
+int uart_write_bytes(uart_port_t port, const void *src, size_t size);
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait);
+esp_err_t uart_flush_input(uart_port_t port);
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baudrate);
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t *baudrate);
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t port, uart_hw_flowcontrol_t flow_ctrl, uint8_t rx_thresh);
+
+/* 仿真专用: 端口对应的伪终端从设备路径，未安装时返回 NULL */
+const char *uart_host_pty_name(uart_port_t port);
@@ -0,0 +1,2 @@
+#pragma once
+/* 主机仿真: 水位模块只包含而不使用 ADC 接口 */
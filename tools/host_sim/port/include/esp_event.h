@@ -0,0 +1,14 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+/* 主机仿真: 默认事件循环只支持注册，事件由 port/src/net.c 的仿真任务投递 */
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+typedef void *esp_event_handler_instance_t;
+
+#define ESP_EVENT_ANY_ID (-1)
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void *arg, esp_event_handler_instance_t *instance);
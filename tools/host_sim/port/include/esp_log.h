@@ -0,0 +1,17 @@
+#pragma once
+#include <stdio.h>
+
+/* 日志级别由环境变量 HOST_LOG_LEVEL 决定 (0=无 1=E 2=W 3=I 4=D)，默认只输出错误和警告 */
+int host_log_level(void);
+
+#define HOST_LOG(level, letter, tag, fmt, ...) do {                                \
+        if (host_log_level() >= (level)) {                                         \
+            fprintf(stderr, letter " (%s) " fmt "\n", tag, ##__VA_ARGS__);          \
+        }                                                                          \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(1, "E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(2, "W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(3, "I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(4, "D", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG(5, "V", tag, fmt, ##__VA_ARGS__)
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+/* 主机仿真: 只有 STA 获得 IP 的事件 */
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+typedef struct {
+    esp_netif_ip_info_t ip_info;
+} ip_event_got_ip_t;
+
+extern esp_event_base_t const IP_EVENT;
+
+enum {
+    IP_EVENT_STA_GOT_IP,
+};
+
+#define IPSTR "%d.%d.%d.%d"
+#define IP2STR(a) (int)((a)->addr & 0xff), (int)(((a)->addr >> 8) & 0xff), \
+                  (int)(((a)->addr >> 16) & 0xff), (int)(((a)->addr >> 24) & 0xff)
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_sta(void);
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+/* 主机仿真: 与 ROM 中的 crc32_le 相同 (初值和结果取反，即常见的 CRC-32) */
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
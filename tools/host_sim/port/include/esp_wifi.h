@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+
+/* 主机仿真: 一个 AP (host_port.h 的 net_host_*)，只包含 connection_manager 用到的 STA 接口 */
+extern esp_event_base_t const WIFI_EVENT;
+
+enum {
+    WIFI_EVENT_STA_START,
+    WIFI_EVENT_STA_CONNECTED,
+    WIFI_EVENT_STA_DISCONNECTED,
+};
+
+typedef struct {
+    uint8_t  ssid[32];
+    uint8_t  ssid_len;
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    int      authmode;
+    uint16_t aid;
+} wifi_event_sta_connected_t;
+
+typedef struct {
+    uint8_t  ssid[32];
+    uint8_t  ssid_len;
+    uint8_t  bssid[6];
+    uint16_t reason;
+    int8_t   rssi;
+} wifi_event_sta_disconnected_t;
+
+typedef enum {
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WPA2_PSK = 3,
+} wifi_auth_mode_t;
+
+typedef enum {
+    WIFI_FAST_SCAN = 0,
+    WIFI_ALL_CHANNEL_SCAN,
+} wifi_scan_method_t;
+
+typedef enum {
+    WIFI_CONNECT_AP_BY_SIGNAL = 0,
+    WIFI_CONNECT_AP_BY_SECURITY,
+} wifi_sort_method_t;
+
+typedef struct {
+    bool capable;
+    bool required;
+} wifi_pmf_config_t;
+
+typedef struct {
+    int8_t           rssi;
+    wifi_auth_mode_t authmode;
+} wifi_scan_threshold_t;
+
+typedef struct {
+    uint8_t               ssid[32];
+    uint8_t               password[64];
+    wifi_scan_method_t    scan_method;
+    bool                  bssid_set;
+    uint8_t               bssid[6];
+    uint8_t               channel;
+    uint16_t              listen_interval;
+    wifi_sort_method_t    sort_method;
+    wifi_scan_threshold_t threshold;
+    wifi_pmf_config_t     pmf_cfg;
+} wifi_sta_config_t;
+
+typedef union {
+    wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct {
+    int unused;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { 0 }
+
+typedef enum {
+    WIFI_IF_STA = 0,
+} wifi_interface_t;
+
+typedef enum {
+    WIFI_MODE_STA = 1,
+} wifi_mode_t;
+
+typedef enum {
+    WIFI_STORAGE_FLASH,
+    WIFI_STORAGE_RAM,
+} wifi_storage_t;
+
+// 设备上由 esp_wifi.h 经 esp_mac.h 提供
+#define MAC2STR(a) (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+#define MACSTR "%02x:%02x:%02x:%02x:%02x:%02x"
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage);
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_start(void);
+esp_err_t esp_wifi_connect(void);
+esp_err_t esp_wifi_disconnect(void);
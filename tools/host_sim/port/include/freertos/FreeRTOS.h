@@ -0,0 +1,45 @@
+/*
+ * 主机仿真: FreeRTOS 的 POSIX 线程实现 (只包含组件用到的部分)
+ *
+ * 任务是 pthread，不按优先级抢占；tick 与设备相同为 10ms。
+ * 临界区是一把全局递归锁，ISR 版本的接口与普通版本相同。
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_attr.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE   1
+#define pdFALSE  0
+#define pdPASS   1
+#define pdFAIL   0
+#define portMAX_DELAY        ((TickType_t)0xffffffffu)
+#define configTICK_RATE_HZ   100
+#define portTICK_PERIOD_MS   (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(t)     ((uint32_t)(((uint64_t)(t) * 1000) / configTICK_RATE_HZ))
+#define configMAX_PRIORITIES    25
+#define configMAX_TASK_NAME_LEN 16
+#define portNUM_PROCESSORS      2
+#define tskNO_AFFINITY          0x7fffffff
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define taskENTER_CRITICAL(mux)     host_critical_enter()
+#define taskEXIT_CRITICAL(mux)      host_critical_exit()
+#define portENTER_CRITICAL(mux)     host_critical_enter()
+#define portEXIT_CRITICAL(mux)      host_critical_exit()
+#define portENTER_CRITICAL_ISR(mux) host_critical_enter()
+#define portEXIT_CRITICAL_ISR(mux)  host_critical_exit()
+#define portYIELD_FROM_ISR(x)       (void)(x)
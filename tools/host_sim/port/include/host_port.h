@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/gpio.h"
+
+/* 主机仿真专用的接口，设备构建中不存在 */
+
+typedef struct {
+    size_t   in_use;   // 当前已分配的字节数
+    size_t   peak;     // 启动以来的最大值
+    uint32_t allocs;   // 启动以来的分配次数
+} heap_host_stats_t;
+
+/**
+ * @brief 读取进程的堆使用统计
+ */
+void heap_host_get_stats(heap_host_stats_t *stats);
+
+/**
+ * @brief 设定输入引脚的电平 (水位开关等)
+ */
+void gpio_host_set_input(gpio_num_t gpio, int level);
+
+typedef struct {
+    uint32_t writes;       // 写入次数
+    uint32_t erases;       // 擦除的扇区数
+    uint32_t erase_max;    // 单个扇区的最大擦除次数
+    uint32_t erase_min;    // 单个扇区的最小擦除次数
+} partition_host_stats_t;
+
+/**
+ * @brief 创建一个内存中的数据分区 (内容为全 0xFF)，之后可用 esp_partition_find_first 找到
+ */
+void partition_host_create(const char *label, uint32_t size);
+
+/**
+ * @brief 模拟掉电: 再成功写入 writes 次后，下一次写入只写一半，之后的写入和擦除全部失败，
+ *        直到 partition_host_power_on()；writes 为负数时取消
+ */
+void partition_host_power_cut_after(const char *label, int writes);
+void partition_host_power_on(const char *label);
+
+/**
+ * @brief 读取分区的写入、擦除统计
+ */
+void partition_host_get_stats(const char *label, partition_host_stats_t *stats);
+
+typedef struct {
+    uint32_t wifi_attempts;        // esp_wifi_connect 调用次数
+    uint32_t wifi_associations;    // 连上 AP 的次数
+    uint32_t mqtt_starts;          // esp_mqtt_client_start 成功次数
+    uint32_t mqtt_stops;           // esp_mqtt_client_stop 成功次数
+    uint32_t mqtt_reconnect_calls; // esp_mqtt_client_reconnect 调用次数
+    uint32_t mqtt_connections;     // 连上服务器的次数
+    uint32_t nvs_writes;
+} net_host_stats_t;
+
+/**
+ * @brief 打开 / 关闭仿真的 AP；关闭时已连上的 STA 收到断开事件 (原因 200)，MQTT 连接随之断开
+ */
+void net_host_set_ap(bool up);
+
+/**
+ * @brief 打开 / 关闭仿真的 MQTT 服务器；关闭时已连上的客户端收到 MQTT_EVENT_DISCONNECTED
+ */
+void net_host_set_broker(bool up);
+
+/**
+ * @brief 读取仿真网络的调用和连接统计
+ */
+void net_host_get_stats(net_host_stats_t *stats);
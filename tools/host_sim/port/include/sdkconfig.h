@@ -0,0 +1,70 @@
+/*
+ * 主机仿真的 sdkconfig: 取各组件 Kconfig 的默认值，与设备默认配置的行为一致。
+ * 改动某项时同时注明原因，避免仿真结果与设备偏离。
+ */
+#pragma once
+#define CONFIG_UART_SERVICE_PORT_NUM 1
+#define CONFIG_UART_SERVICE_BAUD_RATE 115200
+#define CONFIG_UART_SERVICE_TX_PIN 17
+#define CONFIG_UART_SERVICE_RX_PIN 18
+#define CONFIG_FREERTOS_HZ 100
+#define CONFIG_COMMAND_DISPATCHER_QUEUE_DEPTH 4
+#define CONFIG_COMMAND_DISPATCHER_WORKER_STACK_SIZE 4096
+#define CONFIG_COMMAND_DISPATCHER_WORKER_PRIORITY 5
+#define CONFIG_COMMAND_DISPATCHER_BLOCK_TIMEOUT_MS 50
+#define CONFIG_COMMAND_DISPATCHER_PRIORITY_TASK_PRIORITY 15
+#define CONFIG_COMMAND_DISPATCHER_PRIORITY_QUEUE_DEPTH 8
+#define CONFIG_COMMAND_DISPATCHER_PRIORITY_LOCK_TIMEOUT_MS 50
+#define CONFIG_COMMAND_DISPATCHER_BATCH_MAX_LEN 256
+#define CONFIG_COMMAND_DISPATCHER_BATCH_MAX_COMMANDS 8
+#define CONFIG_COMMAND_DISPATCHER_BATCH_STEP_TIMEOUT_MS 3000
+#define CONFIG_COMMAND_DISPATCHER_UART_RATE 50
+#define CONFIG_COMMAND_DISPATCHER_UART_BURST 20
+#define CONFIG_COMMAND_DISPATCHER_MQTT_RATE 10
+#define CONFIG_COMMAND_DISPATCHER_MQTT_BURST 10
+#define CONFIG_COMMAND_DISPATCHER_PREFIX_RATE 20
+#define CONFIG_COMMAND_DISPATCHER_PREFIX_BURST 10
+#define CONFIG_COMMAND_DISPATCHER_THROTTLE_NOTICE_MS 1000
+#define CONFIG_COMMAND_DISPATCHER_JSON_MSG_MAX 1024
+#define CONFIG_COMMAND_TIMER_MAX 16
+#define CONFIG_COMMAND_TIMER_TICK_MS 10
+#define CONFIG_UART_SERVICE_LINE_MAX 256
+#define CONFIG_UART_SERVICE_RX_TIMEOUT_SYMBOLS 10
+#define CONFIG_UART_SERVICE_IDLE_ENDS_LINE 1
+#define CONFIG_UART_SERVICE_TX_QUEUE_LEN 16
+#define CONFIG_UART_SERVICE_TX_SLOT_SIZE 256
+#define CONFIG_UART_SERVICE_START_BINARY 0
+#define CONFIG_UART_SERVICE_FRAME_ACK_TIMEOUT_MS 50
+#define CONFIG_UART_SERVICE_FRAME_RETRIES 3
+#define CONFIG_UART_SERVICE_RTS_PIN -1
+#define CONFIG_UART_SERVICE_CTS_PIN -1
+#define CONFIG_UART_SERVICE_LINK_MAX_BAUD 921600
+#define CONFIG_UART_SERVICE_LINK_CONFIRM_TIMEOUT_MS 300
+#define CONFIG_UART_SERVICE_LINK_ERROR_THRESHOLD 5
+#define CONFIG_STATUS_REGISTRY_MAX_FIELDS 32
+#define CONFIG_STATUS_REGISTRY_MAX_SUBSCRIBERS 4
+#define CONFIG_STATUS_REGISTRY_MIN_INTERVAL_MS 20
+#define CONFIG_UART_SERVICE_HEARTBEAT_PERIOD_MS 50
+#define CONFIG_UART_SERVICE_HEARTBEAT_TIMEOUT_MS 150
+#define CONFIG_FUNCTION_FAILSAFE_COMMANDS "compressor:stop"
+#define CONFIG_UART_SERVICE_LINK_INITIATE 0
+#define CONFIG_UART_SERVICE_BULK_CHUNK_SIZE 512
+#define CONFIG_UART_SERVICE_BULK_WINDOW 8
+#define CONFIG_UART_SERVICE_BULK_ACK_TIMEOUT_MS 200
+#define CONFIG_UART_SERVICE_BULK_RETRIES 5
+#define CONFIG_UART_SERVICE_BULK_TIMEOUT_MS 5000
+#define CONFIG_UART_SERVICE_BULK_TASK_PRIORITY 3
+#define CONFIG_TELEMETRY_INTERVAL_MS 10000
+#define CONFIG_TELEMETRY_RING_SIZE 256
+#define CONFIG_TELEMETRY_BATCH_MAX 1024
+#define CONFIG_TELEMETRY_SNAPSHOT_EVERY 6
+#define CONFIG_TELEMETRY_TASK_PRIORITY 2
+#define CONFIG_TELEMETRY_STORE 1
+#define CONFIG_TELEMETRY_STORE_PARTITION "telemetry"
+#define CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC 5
+#define CONFIG_CONN_MANAGER_BACKOFF_MIN_MS 500
+#define CONFIG_CONN_MANAGER_BACKOFF_MAX_MS 60000
+#define CONFIG_CONN_MANAGER_WIFI_TIMEOUT_MS 15000
+#define CONFIG_CONN_MANAGER_MQTT_TIMEOUT_MS 20000
+#define CONFIG_CONN_MANAGER_TASK_PRIORITY 5
+#define CONFIG_CONN_MANAGER_BSSID_CACHE 1
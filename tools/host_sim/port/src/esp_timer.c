@@ -0,0 +1,191 @@
+/*
+ * 主机仿真: esp_timer
+ *
+ * 与设备上的 ESP_TIMER_TASK 一样，所有回调在同一个线程中按到期时间依次执行。
+ * 回调执行时不持有定时器锁，回调里可以启动或停止定时器。
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+
+struct esp_timer {
+    esp_timer_cb_t    callback;
+    void             *arg;
+    const char       *name;
+    int64_t           due_us;
+    uint64_t          period_us;   // 0 = 单次
+    bool              active;
+    struct esp_timer *next;
+};
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond;
+static struct esp_timer *s_timers = NULL;
+static pthread_once_t s_once = PTHREAD_ONCE_INIT;
+static struct timespec s_boot;
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - s_boot.tv_sec) * 1000000 + (now.tv_nsec - s_boot.tv_nsec) / 1000;
+}
+
+static void *esp_timer_thread(void *param)
+{
+    (void)param;
+    pthread_setname_np(pthread_self(), "esp_timer");
+    pthread_mutex_lock(&s_lock);
+    while (1) {
+        struct esp_timer *next = NULL;
+        for (struct esp_timer *t = s_timers; t != NULL; t = t->next) {
+            if (t->active && (next == NULL || t->due_us < next->due_us)) {
+                next = t;
+            }
+        }
+        if (next == NULL) {
+            pthread_cond_wait(&s_cond, &s_lock);
+            continue;
+        }
+        int64_t now = esp_timer_get_time();
+        if (next->due_us > now) {
+            int64_t due = next->due_us;
+            struct timespec ts = s_boot;
+            ts.tv_sec += (time_t)(due / 1000000);
+            ts.tv_nsec += (long)(due % 1000000) * 1000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&s_cond, &s_lock, &ts);
+            continue;   // 等待期间定时器可能被改动，重新挑选
+        }
+        if (next->period_us > 0) {
+            next->due_us += (int64_t)next->period_us;
+            if (next->due_us < now) {
+                next->due_us = now + (int64_t)next->period_us;   // 跳过错过的周期
+            }
+        } else {
+            next->active = false;
+        }
+        esp_timer_cb_t cb = next->callback;
+        void *arg = next->arg;
+        pthread_mutex_unlock(&s_lock);
+        cb(arg);
+        pthread_mutex_lock(&s_lock);
+    }
+    return NULL;
+}
+
+static void esp_timer_init_once(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_boot);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_t thread;
+    pthread_create(&thread, NULL, esp_timer_thread, NULL);
+    pthread_detach(thread);
+}
+
+// 进程启动时即确定时间零点，esp_timer_get_time 不必每次检查
+__attribute__((constructor)) static void esp_timer_boot(void)
+{
+    pthread_once(&s_once, esp_timer_init_once);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (args == NULL || args->callback == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = args->callback;
+    t->arg = args->arg;
+    t->name = args->name;
+    pthread_mutex_lock(&s_lock);
+    t->next = s_timers;
+    s_timers = t;
+    pthread_mutex_unlock(&s_lock);
+    *out = t;
+    return ESP_OK;
+}
+
+static esp_err_t esp_timer_arm(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->due_us = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->period_us = period_us;
+    timer->active = true;
+    pthread_cond_signal(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us)
+{
+    return esp_timer_arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return esp_timer_arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    esp_err_t err = timer->active ? ESP_OK : ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    pthread_cond_signal(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    if (timer->active) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (struct esp_timer **p = &s_timers; *p != NULL; p = &(*p)->next) {
+        if (*p == timer) {
+            *p = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    pthread_mutex_lock(&s_lock);
+    bool active = timer != NULL && timer->active;
+    pthread_mutex_unlock(&s_lock);
+    return active;
+}
@@ -0,0 +1,467 @@
+/*
+ * 主机仿真: FreeRTOS 任务、队列、信号量和任务通知的 pthread 实现
+ *
+ * 所有阻塞等待都用 CLOCK_MONOTONIC 上的条件变量，超时按 tick (10ms) 换算，
+ * 与设备上 pdMS_TO_TICKS 的取整一致。优先级只记录不生效。
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+static const char *TAG = "HOST_RTOS";
+
+struct host_task {
+    pthread_t       thread;
+    TaskFunction_t  fn;
+    void           *arg;
+    char            name[configMAX_TASK_NAME_LEN];
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    uint32_t        notify_value;
+    bool            notify_pending;
+};
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    uint8_t        *items;
+    size_t          item_size;
+    size_t          length;
+    size_t          head;
+    size_t          count;
+};
+
+static __thread struct host_task *s_current = NULL;
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static struct timespec s_boot;
+static pthread_once_t s_boot_once = PTHREAD_ONCE_INIT;
+
+static void host_boot_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_boot);
+}
+
+void host_critical_enter(void)
+{
+    pthread_mutex_lock(&s_critical);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&s_critical);
+}
+
+static void host_cond_init(pthread_cond_t *cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// 把 tick 超时换算为绝对时间
+static struct timespec host_deadline(TickType_t wait)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)wait * (1000000000ull / configTICK_RATE_HZ);
+    ts.tv_sec += (time_t)(ns / 1000000000ull);
+    ts.tv_nsec += (long)(ns % 1000000000ull);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// 在 cond 上等待到 deadline，返回 false 表示超时。wait 为 portMAX_DELAY 时不超时
+static bool host_cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t wait, const struct timespec *deadline)
+{
+    if (wait == portMAX_DELAY) {
+        pthread_cond_wait(cond, lock);
+        return true;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+/* ---------------- 任务 ---------------- */
+
+static struct host_task *host_task_alloc(const char *name)
+{
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return NULL;
+    }
+    strncpy(task->name, name ? name : "", sizeof(task->name) - 1);
+    pthread_mutex_init(&task->lock, NULL);
+    host_cond_init(&task->cond);
+    return task;
+}
+
+static void *host_task_entry(void *param)
+{
+    struct host_task *task = param;
+    s_current = task;
+    pthread_setname_np(pthread_self(), task->name);
+    task->fn(task->arg);
+    ESP_LOGE(TAG, "task %s returned", task->name);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t prio, TaskHandle_t *out)
+{
+    (void)stack;
+    (void)prio;
+    pthread_once(&s_boot_once, host_boot_init);
+    struct host_task *task = host_task_alloc(name);
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (out != NULL) {
+        *out = task;   // 与 FreeRTOS 相同，新任务开始运行前句柄已可用
+    }
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&task->thread, &attr, host_task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        if (out != NULL) {
+            *out = NULL;
+        }
+        free(task);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    (void)core;
+    return xTaskCreate(fn, name, stack, arg, prio, out);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == s_current) {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (s_current == NULL) {
+        // 不是由 xTaskCreate 创建的线程 (主线程、定时器线程) 第一次调用时补一个句柄
+        s_current = host_task_alloc("host");
+        s_current->thread = pthread_self();
+    }
+    return s_current;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    pthread_once(&s_boot_once, host_boot_init);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t ms = (int64_t)(now.tv_sec - s_boot.tv_sec) * 1000 + (now.tv_nsec - s_boot.tv_nsec) / 1000000;
+    return (TickType_t)(ms / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    // 与设备相同，睡到第 ticks 个 tick 边界，而不是精确的 ticks * 10ms
+    uint64_t target_ms = (uint64_t)(xTaskGetTickCount() + (ticks > 0 ? ticks : 1)) * portTICK_PERIOD_MS;
+    struct timespec ts = s_boot;
+    ts.tv_sec += (time_t)(target_ms / 1000);
+    ts.tv_nsec += (long)(target_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/* ---------------- 任务通知 ---------------- */
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline = host_deadline(wait);
+    pthread_mutex_lock(&task->lock);
+    while (task->notify_value == 0 && wait != 0) {
+        if (!host_cond_wait(&task->cond, &task->lock, wait, &deadline)) {
+            break;
+        }
+    }
+    uint32_t value = task->notify_value;
+    if (value != 0) {
+        task->notify_value = clear_on_exit ? 0 : value - 1;
+    }
+    task->notify_pending = false;
+    pthread_mutex_unlock(&task->lock);
+    return value;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t ret = pdPASS;
+    pthread_mutex_lock(&task->lock);
+    switch (action) {
+    case eSetBits:
+        task->notify_value |= value;
+        break;
+    case eIncrement:
+        task->notify_value++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notify_value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notify_pending) {
+            ret = pdFAIL;
+        } else {
+            task->notify_value = value;
+        }
+        break;
+    case eNoAction:
+    default:
+        break;
+    }
+    task->notify_pending = true;
+    pthread_cond_broadcast(&task->cond);
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotify(task, 0, eIncrement);
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait)
+{
+    struct host_task *task = xTaskGetCurrentTaskHandle();
+    struct timespec deadline = host_deadline(wait);
+    pthread_mutex_lock(&task->lock);
+    if (!task->notify_pending) {
+        task->notify_value &= ~clear_on_entry;
+    }
+    while (!task->notify_pending && wait != 0) {
+        if (!host_cond_wait(&task->cond, &task->lock, wait, &deadline)) {
+            break;
+        }
+    }
+    BaseType_t ret = task->notify_pending ? pdTRUE : pdFALSE;
+    if (value != NULL) {
+        *value = task->notify_value;
+    }
+    if (ret == pdTRUE) {
+        task->notify_value &= ~clear_on_exit;
+        task->notify_pending = false;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return ret;
+}
+
+/* ---------------- 队列和信号量 ---------------- */
+
+static struct host_queue *host_queue_new(size_t length, size_t item_size, size_t initial)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return NULL;
+    }
+    if (item_size > 0) {
+        q->items = calloc(length, item_size);
+        if (q->items == NULL) {
+            free(q);
+            return NULL;
+        }
+    }
+    q->item_size = item_size;
+    q->length = length;
+    q->count = initial;
+    pthread_mutex_init(&q->lock, NULL);
+    host_cond_init(&q->not_empty);
+    host_cond_init(&q->not_full);
+    return q;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    return host_queue_new(length, item_size, 0);
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (q == NULL) {
+        return;
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+    free(q->items);
+    free(q);
+}
+
+static BaseType_t host_queue_put(QueueHandle_t q, const void *item, TickType_t wait, bool front)
+{
+    struct timespec deadline = host_deadline(wait);
+    pthread_mutex_lock(&q->lock);
+    while (q->count >= q->length) {
+        if (wait == 0 || !host_cond_wait(&q->not_full, &q->lock, wait, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    if (q->item_size > 0) {
+        size_t slot;
+        if (front) {
+            q->head = (q->head + q->length - 1) % q->length;
+            slot = q->head;
+        } else {
+            slot = (q->head + q->count) % q->length;
+        }
+        memcpy(q->items + slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return host_queue_put(q, item, wait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return host_queue_put(q, item, wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return host_queue_put(q, item, wait, true);
+}
+
+// 长度为 1 的邮箱: 已有数据时直接覆盖
+BaseType_t xQueueOverwrite(QueueHandle_t q, const void *item)
+{
+    pthread_mutex_lock(&q->lock);
+    memcpy(q->items, item, q->item_size);
+    q->head = 0;
+    q->count = 1;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+    return host_queue_put(q, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    struct timespec deadline = host_deadline(wait);
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0) {
+        if (wait == 0 || !host_cond_wait(&q->not_empty, &q->lock, wait, &deadline)) {
+            pthread_mutex_unlock(&q->lock);
+            return pdFALSE;
+        }
+    }
+    if (q->item_size > 0) {
+        memcpy(item, q->items + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->length;
+    }
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t count = (UBaseType_t)q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->count = 0;
+    pthread_cond_broadcast(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+/*
+ * 信号量是元素大小为 0 的队列: count 为可用数量。
+ * 互斥量不记录持有者也不做优先级继承，组件里没有递归加锁。
+ */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return host_queue_new(1, 0, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return host_queue_new(1, 0, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return host_queue_new(max, 0, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    return xQueueReceive(sem, NULL, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return host_queue_put(sem, NULL, 0, false);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    return xQueueSendFromISR(sem, NULL, woken);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    vQueueDelete(sem);
+}
@@ -0,0 +1,104 @@
+/*
+ * 主机仿真: GPIO 和 LEDC 只记录电平和占空比，供 host:gpio 命令查询
+ */
+#include <stdatomic.h>
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "host_port.h"
+
+static atomic_int s_levels[GPIO_NUM_MAX];
+static atomic_uint s_duty[LEDC_CHANNEL_MAX];
+
+static bool gpio_host_valid(gpio_num_t gpio)
+{
+    return gpio >= 0 && gpio < GPIO_NUM_MAX;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return config != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio)
+{
+    if (!gpio_host_valid(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&s_levels[gpio], 0);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode)
+{
+    return gpio_host_valid(gpio) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (!gpio_host_valid(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&s_levels[gpio], level ? 1 : 0);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    return gpio_host_valid(gpio) ? atomic_load(&s_levels[gpio]) : 0;
+}
+
+esp_err_t gpio_set_drive_capability(gpio_num_t gpio, gpio_drive_cap_t strength)
+{
+    return gpio_host_valid(gpio) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr_handler, void *args)
+{
+    // 没有边沿中断: 水位等输入由 gpio_host_set_input 直接改电平，模块按轮询读取
+    return gpio_host_valid(gpio) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void gpio_host_set_input(gpio_num_t gpio, int level)
+{
+    if (gpio_host_valid(gpio)) {
+        atomic_store(&s_levels[gpio], level ? 1 : 0);
+    }
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *config)
+{
+    return config != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *config)
+{
+    if (config == NULL || config->channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&s_duty[config->channel], config->duty);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&s_duty[channel], duty);
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    return channel < LEDC_CHANNEL_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t mode, ledc_channel_t channel)
+{
+    return channel < LEDC_CHANNEL_MAX ? atomic_load(&s_duty[channel]) : 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * 主机仿真: 堆使用统计
+ *
+ * 链接时用 -Wl,--wrap 包装 malloc/calloc/realloc/free，按 malloc_usable_size
+ * 统计当前占用、峰值和分配次数，对应设备上 heap_caps 的统计。
+ * 统计的是整个进程 (包括 libc 和线程库自身)，比较的是同一构建前后的变化。
+ */
+#include <malloc.h>
+#include <stdatomic.h>
+#include "host_port.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static atomic_size_t s_in_use;
+static atomic_size_t s_peak;
+static atomic_uint s_allocs;
+
+static void heap_host_add(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    size_t in_use = atomic_fetch_add(&s_in_use, malloc_usable_size(ptr)) + malloc_usable_size(ptr);
+    size_t peak = atomic_load(&s_peak);
+    while (in_use > peak && !atomic_compare_exchange_weak(&s_peak, &peak, in_use)) {
+    }
+    atomic_fetch_add(&s_allocs, 1);
+}
+
+static void heap_host_sub(void *ptr)
+{
+    if (ptr != NULL) {
+        atomic_fetch_sub(&s_in_use, malloc_usable_size(ptr));
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    heap_host_add(ptr);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    void *ptr = __real_calloc(n, size);
+    heap_host_add(ptr);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    heap_host_sub(ptr);
+    void *out = __real_realloc(ptr, size);
+    if (out != NULL) {
+        heap_host_add(out);
+    } else if (size != 0) {
+        heap_host_add(ptr);   // 失败时原内存仍然有效
+    }
+    return out;
+}
+
+void __wrap_free(void *ptr)
+{
+    heap_host_sub(ptr);
+    __real_free(ptr);
+}
+
+void heap_host_get_stats(heap_host_stats_t *stats)
+{
+    stats->in_use = atomic_load(&s_in_use);
+    stats->peak = atomic_load(&s_peak);
+    stats->allocs = atomic_load(&s_allocs);
+}
@@ -0,0 +1,474 @@
+/*
+ * 主机仿真: 一个 WiFi AP、一个 MQTT 服务器和内存中的 NVS
+ *
+ * 只模拟 connection_manager 用到的连接 / 断开流程，不收发数据。
+ * AP 和服务器可以由 net_host_set_ap / net_host_set_broker 随时关闭、恢复，
+ * 连接尝试在仿真任务中经过一小段延迟后按当时的状态成功或失败，事件在仿真任务中回调，
+ * 相当于设备上的系统事件循环和 MQTT 任务。
+ *
+ * MQTT 客户端按 esp-mqtt 关闭自动重连 (network.disable_auto_reconnect) 时的行为:
+ * 连接失败或断开后停在断开状态，esp_mqtt_client_reconnect 不起作用 (返回 ESP_FAIL)，
+ * 只有 esp_mqtt_client_stop 之后再 esp_mqtt_client_start 才会重新连接。
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host_port.h"
+
+#define WIFI_CONNECT_MS    50     // 从 esp_wifi_connect 到连上 (或找不到 AP)
+#define MQTT_CONNECT_MS    30     // 从启动客户端到连上服务器 (或连接失败)
+#define MQTT_RETRY_MS      1000   // 打开自动重连时的重试间隔
+#define MAX_HANDLERS       4
+#define MAX_NVS_KEYS       4
+#define NVS_BLOB_MAX       64
+#define ACTION_QUEUE_LEN   32
+#define REASON_ASSOC_LEAVE 8
+#define REASON_BEACON_TIMEOUT 200
+#define REASON_NO_AP_FOUND 201
+
+static const char *TAG = "NET_SIM";
+
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+static const uint8_t s_ap_bssid[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+static const uint8_t s_ap_channel = 6;
+
+typedef enum {
+    ACT_WIFI_START,
+    ACT_WIFI_CONNECT,
+    ACT_WIFI_LOST,
+    ACT_MQTT_CONNECT,
+    ACT_MQTT_LOST,
+} action_type_t;
+
+typedef struct {
+    action_type_t type;
+    uint32_t      gen;     // 发出动作时的连接代数，不一致说明期间已断开或重新开始，动作作废
+    uint16_t      reason;
+    int64_t       due_us;
+} action_t;
+
+typedef struct {
+    esp_event_base_t    base;
+    int32_t             id;
+    esp_event_handler_t handler;
+    void               *arg;
+} handler_t;
+
+struct esp_mqtt_client {
+    bool      auto_reconnect;
+    bool      running;    // 已 start 且尚未 stop
+    bool      connected;
+    uint32_t  gen;
+    handler_t handlers[MAX_HANDLERS];
+    int       handler_count;
+};
+
+typedef struct {
+    char    key[16];
+    uint8_t data[NVS_BLOB_MAX];
+    size_t  len;
+} nvs_entry_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static QueueHandle_t s_actions = NULL;
+static handler_t s_handlers[MAX_HANDLERS];
+static int s_handler_count;
+static struct esp_mqtt_client s_client;
+static bool s_ap_up = true;
+static bool s_broker_up = true;
+static bool s_associated;
+static uint32_t s_wifi_gen;
+static wifi_config_t s_wifi_config;
+static net_host_stats_t s_stats;
+static nvs_entry_t s_nvs[MAX_NVS_KEYS];
+static uint32_t s_random = 0x2545f491;
+
+static void post_action(action_type_t type, uint32_t gen, uint16_t reason, uint32_t delay_ms)
+{
+    const action_t action = {
+        .type = type,
+        .gen = gen,
+        .reason = reason,
+        .due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000,
+    };
+    // 调用者可能持有 s_lock，不能等待仿真任务
+    if (xQueueSend(s_actions, &action, 0) != pdTRUE) {
+        ESP_LOGE(TAG, "仿真动作队列已满，丢弃动作 %d", type);
+    }
+}
+
+static void dispatch(esp_event_base_t base, int32_t id, void *data)
+{
+    for (int i = 0; i < s_handler_count; i++) {
+        if (s_handlers[i].base == base && (s_handlers[i].id == ESP_EVENT_ANY_ID || s_handlers[i].id == id)) {
+            s_handlers[i].handler(s_handlers[i].arg, base, id, data);
+        }
+    }
+}
+
+static void dispatch_mqtt(esp_mqtt_event_id_t id)
+{
+    esp_mqtt_event_t event = { .event_id = id, .client = &s_client };
+    for (int i = 0; i < s_client.handler_count; i++) {
+        s_client.handlers[i].handler(s_client.handlers[i].arg, "MQTT_EVENTS", id, &event);
+    }
+}
+
+// 调用时持有 s_lock：已连上的客户端断开，打开自动重连时稍后重试
+static void mqtt_drop_locked(void)
+{
+    if (s_client.connected) {
+        s_client.connected = false;
+        post_action(ACT_MQTT_LOST, s_client.gen, 0, 0);
+    }
+}
+
+static void run_action(const action_t *action)
+{
+    pthread_mutex_lock(&s_lock);
+    switch (action->type) {
+    case ACT_WIFI_START:
+        pthread_mutex_unlock(&s_lock);
+        dispatch(WIFI_EVENT, WIFI_EVENT_STA_START, NULL);
+        return;
+    case ACT_WIFI_CONNECT: {
+        if (action->gen != s_wifi_gen) {
+            break;
+        }
+        bool bssid_ok = !s_wifi_config.sta.bssid_set ||
+                        (memcmp(s_wifi_config.sta.bssid, s_ap_bssid, sizeof(s_ap_bssid)) == 0 &&
+                         s_wifi_config.sta.channel == s_ap_channel);
+        if (!s_ap_up || !bssid_ok) {
+            s_wifi_gen++;
+            pthread_mutex_unlock(&s_lock);
+            wifi_event_sta_disconnected_t e = { .reason = REASON_NO_AP_FOUND };
+            dispatch(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &e);
+            return;
+        }
+        s_associated = true;
+        s_stats.wifi_associations++;
+        pthread_mutex_unlock(&s_lock);
+        wifi_event_sta_connected_t connected = { .channel = s_ap_channel };
+        memcpy(connected.bssid, s_ap_bssid, sizeof(connected.bssid));
+        dispatch(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &connected);
+        ip_event_got_ip_t got_ip = { .ip_info.ip.addr = 0x0201a8c0 };
+        dispatch(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip);
+        return;
+    }
+    case ACT_WIFI_LOST: {
+        pthread_mutex_unlock(&s_lock);
+        wifi_event_sta_disconnected_t e = { .reason = action->reason };
+        dispatch(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &e);
+        return;
+    }
+    case ACT_MQTT_CONNECT:
+        if (!s_client.running || action->gen != s_client.gen || s_client.connected) {
+            break;
+        }
+        if (s_associated && s_broker_up) {
+            s_client.connected = true;
+            s_stats.mqtt_connections++;
+            pthread_mutex_unlock(&s_lock);
+            dispatch_mqtt(MQTT_EVENT_CONNECTED);
+            return;
+        }
+        if (s_client.auto_reconnect) {
+            post_action(ACT_MQTT_CONNECT, s_client.gen, 0, MQTT_RETRY_MS);
+        }
+        pthread_mutex_unlock(&s_lock);
+        dispatch_mqtt(MQTT_EVENT_ERROR);
+        dispatch_mqtt(MQTT_EVENT_DISCONNECTED);
+        return;
+    case ACT_MQTT_LOST:
+        if (!s_client.running || action->gen != s_client.gen) {
+            break;
+        }
+        if (s_client.auto_reconnect) {
+            post_action(ACT_MQTT_CONNECT, s_client.gen, 0, MQTT_RETRY_MS);
+        }
+        pthread_mutex_unlock(&s_lock);
+        dispatch_mqtt(MQTT_EVENT_DISCONNECTED);
+        return;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+static void net_sim_task(void *arg)
+{
+    action_t action;
+    while (xQueueReceive(s_actions, &action, portMAX_DELAY) == pdTRUE) {
+        int64_t wait_us = action.due_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            vTaskDelay(pdMS_TO_TICKS((wait_us + 999) / 1000));
+        }
+        run_action(&action);
+    }
+}
+
+// --- 仿真控制 ---
+
+void net_host_set_ap(bool up)
+{
+    pthread_mutex_lock(&s_lock);
+    s_ap_up = up;
+    if (!up && s_associated) {
+        s_associated = false;
+        s_wifi_gen++;
+        mqtt_drop_locked();
+        post_action(ACT_WIFI_LOST, s_wifi_gen, REASON_BEACON_TIMEOUT, 0);
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void net_host_set_broker(bool up)
+{
+    pthread_mutex_lock(&s_lock);
+    s_broker_up = up;
+    if (!up) {
+        mqtt_drop_locked();
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void net_host_get_stats(net_host_stats_t *stats)
+{
+    pthread_mutex_lock(&s_lock);
+    *stats = s_stats;
+    pthread_mutex_unlock(&s_lock);
+}
+
+// --- 事件循环 / netif ---
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    if (s_actions != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_actions = xQueueCreate(ACTION_QUEUE_LEN, sizeof(action_t));
+    if (s_actions == NULL || xTaskCreate(net_sim_task, "net_sim", 4096, NULL, 20, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void *arg, esp_event_handler_instance_t *instance)
+{
+    if (s_handler_count >= MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_handlers[s_handler_count++] = (handler_t){ .base = base, .id = id, .handler = handler, .arg = arg };
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    static int s_netif;
+    return (esp_netif_t *)&s_netif;
+}
+
+// --- WiFi ---
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    pthread_mutex_lock(&s_lock);
+    s_wifi_config = *conf;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    post_action(ACT_WIFI_START, 0, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.wifi_attempts++;
+    post_action(ACT_WIFI_CONNECT, s_wifi_gen, 0, WIFI_CONNECT_MS);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+// 与设备相同: 已连上或正在连接时都会产生一次断开事件
+esp_err_t esp_wifi_disconnect(void)
+{
+    pthread_mutex_lock(&s_lock);
+    s_associated = false;
+    s_wifi_gen++;
+    mqtt_drop_locked();
+    post_action(ACT_WIFI_LOST, s_wifi_gen, REASON_ASSOC_LEAVE, 0);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+// --- MQTT 客户端 ---
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    memset(&s_client, 0, sizeof(s_client));
+    s_client.auto_reconnect = !config->network.disable_auto_reconnect;
+    return &s_client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, int32_t event, esp_event_handler_t handler,
+                                         void *arg)
+{
+    if (client->handler_count >= MAX_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    client->handlers[client->handler_count++] = (handler_t){ .id = event, .handler = handler, .arg = arg };
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    if (client->running) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_FAIL;   // 与 esp-mqtt 相同: 已启动的客户端不能再次启动
+    }
+    client->running = true;
+    client->gen++;
+    s_stats.mqtt_starts++;
+    post_action(ACT_MQTT_CONNECT, client->gen, 0, MQTT_CONNECT_MS);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_stop(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    if (!client->running) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_FAIL;
+    }
+    client->running = false;
+    client->connected = false;
+    client->gen++;
+    s_stats.mqtt_stops++;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_reconnect(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    s_stats.mqtt_reconnect_calls++;
+    esp_err_t err = ESP_FAIL;
+    if (client->auto_reconnect && client->running && !client->connected) {
+        post_action(ACT_MQTT_CONNECT, client->gen, 0, MQTT_CONNECT_MS);
+        err = ESP_OK;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t esp_mqtt_client_disconnect(esp_mqtt_client_handle_t client)
+{
+    pthread_mutex_lock(&s_lock);
+    mqtt_drop_locked();
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+// --- NVS / 随机数 ---
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    *out = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < MAX_NVS_KEYS; i++) {
+        if (s_nvs[i].len > 0 && strcmp(s_nvs[i].key, key) == 0) {
+            size_t n = *length < s_nvs[i].len ? *length : s_nvs[i].len;
+            memcpy(out, s_nvs[i].data, n);
+            *length = s_nvs[i].len;
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    if (length == 0 || length > NVS_BLOB_MAX || strlen(key) >= sizeof(s_nvs[0].key)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < MAX_NVS_KEYS; i++) {
+        if (s_nvs[i].len == 0 || strcmp(s_nvs[i].key, key) == 0) {
+            strcpy(s_nvs[i].key, key);
+            memcpy(s_nvs[i].data, value, length);
+            s_nvs[i].len = length;
+            s_stats.nvs_writes++;
+            err = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+uint32_t esp_random(void)
+{
+    pthread_mutex_lock(&s_lock);
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    uint32_t r = s_random;
+    pthread_mutex_unlock(&s_lock);
+    return r;
+}
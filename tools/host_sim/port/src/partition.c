@@ -0,0 +1,182 @@
+/*
+ * 主机仿真: 内存中的 flash 数据分区
+ *
+ * 与 NOR flash 相同，写入只能把位从 1 改成 0 (结果为原内容与新数据按位与)，
+ * 擦除以 4 KiB 扇区为单位恢复为 0xFF。记录每个扇区的擦除次数，并可模拟写到一半时掉电。
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "esp_partition.h"
+#include "host_port.h"
+
+#define SECTOR_SIZE    4096
+#define MAX_PARTITIONS 4
+
+typedef struct {
+    esp_partition_t part;
+    uint8_t        *data;
+    uint32_t       *erase_counts;
+    int             cut_after;    // 剩余的正常写入次数，负数表示不模拟掉电
+    bool            powered_off;
+    uint32_t        writes;
+    uint32_t        erases;
+} host_partition_t;
+
+static host_partition_t s_parts[MAX_PARTITIONS];
+static int s_part_count;
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static host_partition_t *find(const char *label)
+{
+    for (int i = 0; i < s_part_count; i++) {
+        if (strcmp(s_parts[i].part.label, label) == 0) {
+            return &s_parts[i];
+        }
+    }
+    return NULL;
+}
+
+static host_partition_t *from_part(const esp_partition_t *part)
+{
+    return (host_partition_t *)((char *)part - offsetof(host_partition_t, part));
+}
+
+void partition_host_create(const char *label, uint32_t size)
+{
+    pthread_mutex_lock(&s_lock);
+    host_partition_t *p = find(label);
+    if (p == NULL && s_part_count < MAX_PARTITIONS) {
+        p = &s_parts[s_part_count++];
+        uint32_t address = 0x110000;
+        for (int i = 0; i < s_part_count - 1; i++) {
+            address += s_parts[i].part.size;
+        }
+        p->part = (esp_partition_t){
+            .type = ESP_PARTITION_TYPE_DATA, .subtype = 0x40, .address = address, .size = size,
+            .erase_size = SECTOR_SIZE,
+        };
+        strncpy(p->part.label, label, sizeof(p->part.label) - 1);
+        p->data = malloc(size);
+        p->erase_counts = calloc(size / SECTOR_SIZE, sizeof(uint32_t));
+        memset(p->data, 0xFF, size);
+        p->cut_after = -1;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void partition_host_power_cut_after(const char *label, int writes)
+{
+    pthread_mutex_lock(&s_lock);
+    host_partition_t *p = find(label);
+    if (p != NULL) {
+        p->cut_after = writes;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void partition_host_power_on(const char *label)
+{
+    pthread_mutex_lock(&s_lock);
+    host_partition_t *p = find(label);
+    if (p != NULL) {
+        p->powered_off = false;
+        p->cut_after = -1;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+void partition_host_get_stats(const char *label, partition_host_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&s_lock);
+    host_partition_t *p = find(label);
+    if (p != NULL) {
+        stats->writes = p->writes;
+        stats->erases = p->erases;
+        stats->erase_min = UINT32_MAX;
+        for (uint32_t i = 0; i < p->part.size / SECTOR_SIZE; i++) {
+            if (p->erase_counts[i] > stats->erase_max) {
+                stats->erase_max = p->erase_counts[i];
+            }
+            if (p->erase_counts[i] < stats->erase_min) {
+                stats->erase_min = p->erase_counts[i];
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    pthread_mutex_lock(&s_lock);
+    host_partition_t *p = label != NULL ? find(label) : (s_part_count > 0 ? &s_parts[0] : NULL);
+    if (p != NULL && (p->part.type != type || (subtype != ESP_PARTITION_SUBTYPE_ANY && p->part.subtype != subtype))) {
+        p = NULL;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return p != NULL ? &p->part : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    host_partition_t *p = from_part(partition);
+    if (src_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    pthread_mutex_lock(&s_lock);
+    memcpy(dst, p->data + src_offset, size);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    host_partition_t *p = from_part(partition);
+    if (dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    if (p->powered_off) {
+        err = ESP_FAIL;
+    } else {
+        if (p->cut_after == 0) {
+            // 掉电: 只写入前一半
+            size = size / 2;
+            p->powered_off = true;
+            err = ESP_FAIL;
+        } else if (p->cut_after > 0) {
+            p->cut_after--;
+        }
+        const uint8_t *s = src;
+        for (size_t i = 0; i < size; i++) {
+            p->data[dst_offset + i] &= s[i];
+        }
+        p->writes++;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_partition_t *p = from_part(partition);
+    if (offset % SECTOR_SIZE != 0 || size % SECTOR_SIZE != 0 || offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&s_lock);
+    if (p->powered_off) {
+        err = ESP_FAIL;
+    } else {
+        memset(p->data + offset, 0xFF, size);
+        for (size_t s = offset / SECTOR_SIZE; s < (offset + size) / SECTOR_SIZE; s++) {
+            p->erase_counts[s]++;
+            p->erases++;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
@@ -0,0 +1,343 @@
+/*
+ * 主机仿真: 基于伪终端的 UART 驱动
+ *
+ * uart_driver_install 创建一个 pty，主机上的程序打开从设备即相当于接上了屏幕。
+ * 接收线程读取主设备的数据放进接收缓冲区，并按设备驱动的方式产生事件:
+ *   收到的数据含有检测字符 -> UART_PATTERN_DET，否则 UART_DATA
+ *   之后 UART_HOST_IDLE_US 内没有新数据 -> 带 timeout_flag 的 UART_DATA (RX 超时)
+ *   接收缓冲区放不下 -> UART_BUFFER_FULL，多出的数据丢弃
+ * 发送直接写主设备；对方长时间不读取时数据丢弃，与没有流控的线路相同。
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+#include "driver/uart.h"
+#include "esp_log.h"
+
+static const char *TAG = "HOST_UART";
+
+#define UART_HOST_IDLE_US       2000   // RX 超时: 相当于 115200 下约 20 个字符时间
+#define UART_HOST_POLL_MS       100
+#define UART_HOST_TX_STALL_MS   50     // 对方不读取时发送最多等待的时间
+
+typedef struct {
+    bool            installed;
+    int             master_fd;
+    int             slave_fd;          // 保持打开，对方关闭从设备时主设备不会读到 EIO
+    char            pty_name[64];
+    QueueHandle_t   events;
+    pthread_t       reader;
+    pthread_mutex_t lock;
+    pthread_cond_t  data_ready;
+    uint8_t        *rx_buf;
+    size_t          rx_size;
+    size_t          rx_head;
+    size_t          rx_count;
+    int             pattern_chr;       // -1 = 未启用
+    uint32_t        baud;
+} uart_host_port_t;
+
+static uart_host_port_t s_ports[UART_NUM_MAX];
+
+static uart_host_port_t *uart_host_get(uart_port_t port)
+{
+    if (port < 0 || port >= UART_NUM_MAX || !s_ports[port].installed) {
+        return NULL;
+    }
+    return &s_ports[port];
+}
+
+static void uart_host_post(uart_host_port_t *p, uart_event_type_t type, size_t size, bool timeout)
+{
+    uart_event_t event = { .type = type, .size = size, .timeout_flag = timeout };
+    // 事件队列满时与设备驱动一样丢弃事件，数据仍留在接收缓冲区中
+    xQueueSend(p->events, &event, 0);
+}
+
+// 把收到的数据放入接收缓冲区，返回放入的字节数
+static size_t uart_host_push(uart_host_port_t *p, const uint8_t *data, size_t len)
+{
+    pthread_mutex_lock(&p->lock);
+    size_t room = p->rx_size - p->rx_count;
+    size_t n = len < room ? len : room;
+    for (size_t i = 0; i < n; i++) {
+        p->rx_buf[(p->rx_head + p->rx_count + i) % p->rx_size] = data[i];
+    }
+    p->rx_count += n;
+    pthread_cond_broadcast(&p->data_ready);
+    pthread_mutex_unlock(&p->lock);
+    return n;
+}
+
+static void *uart_host_reader(void *param)
+{
+    uart_host_port_t *p = param;
+    uint8_t chunk[UART_HW_FIFO_LEN(0)];
+    bool pending_idle = false;   // 上次 RX 超时之后收到过数据
+
+    pthread_setname_np(pthread_self(), "uart_pty");
+    while (1) {
+        struct pollfd pfd = { .fd = p->master_fd, .events = POLLIN };
+        int timeout_ms = pending_idle ? (UART_HOST_IDLE_US + 999) / 1000 : UART_HOST_POLL_MS;
+        int rc = poll(&pfd, 1, timeout_ms);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ESP_LOGE(TAG, "poll failed: %s", strerror(errno));
+            return NULL;
+        }
+        if (rc == 0) {
+            if (pending_idle) {
+                pending_idle = false;
+                size_t buffered = 0;
+                uart_get_buffered_data_len((uart_port_t)(p - s_ports), &buffered);
+                uart_host_post(p, UART_DATA, buffered, true);
+            }
+            continue;
+        }
+        // 一次最多读一个 FIFO 的量，与设备上每满一个 FIFO 产生一次事件相同
+        ssize_t n = read(p->master_fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            struct timespec ts = { 0, 10 * 1000000L };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        pending_idle = true;
+        size_t stored = uart_host_push(p, chunk, (size_t)n);
+        if (stored < (size_t)n) {
+            uart_host_post(p, UART_BUFFER_FULL, 0, false);
+            continue;
+        }
+        bool pattern = p->pattern_chr >= 0 && memchr(chunk, p->pattern_chr, (size_t)n) != NULL;
+        uart_host_post(p, pattern ? UART_PATTERN_DET : UART_DATA, (size_t)n, false);
+    }
+    return NULL;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    (void)tx_buffer_size;
+    (void)intr_alloc_flags;
+    if (port < 0 || port >= UART_NUM_MAX || rx_buffer_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uart_host_port_t *p = &s_ports[port];
+    if (p->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    p->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (p->master_fd < 0 || grantpt(p->master_fd) != 0 || unlockpt(p->master_fd) != 0 ||
+        ptsname_r(p->master_fd, p->pty_name, sizeof(p->pty_name)) != 0) {
+        ESP_LOGE(TAG, "pty: %s", strerror(errno));
+        return ESP_FAIL;
+    }
+    p->slave_fd = open(p->pty_name, O_RDWR | O_NOCTTY);
+    if (p->slave_fd < 0) {
+        ESP_LOGE(TAG, "open %s: %s", p->pty_name, strerror(errno));
+        return ESP_FAIL;
+    }
+    // 原始模式: 不回显、不转换换行，否则发出的数据会被从设备回显成收到的数据
+    struct termios tio;
+    tcgetattr(p->slave_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(p->slave_fd, TCSANOW, &tio);
+    fcntl(p->master_fd, F_SETFL, fcntl(p->master_fd, F_GETFL) | O_NONBLOCK);
+
+    p->rx_buf = malloc((size_t)rx_buffer_size);
+    p->events = xQueueCreate((UBaseType_t)queue_size, sizeof(uart_event_t));
+    if (p->rx_buf == NULL || p->events == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->rx_size = (size_t)rx_buffer_size;
+    p->rx_head = 0;
+    p->rx_count = 0;
+    p->pattern_chr = -1;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&p->data_ready, &attr);
+    pthread_condattr_destroy(&attr);
+    p->installed = true;
+    if (pthread_create(&p->reader, NULL, uart_host_reader, p) != 0) {
+        p->installed = false;
+        return ESP_FAIL;
+    }
+    pthread_detach(p->reader);
+    if (uart_queue != NULL) {
+        *uart_queue = p->events;
+    }
+    ESP_LOGI(TAG, "UART%d on %s", port, p->pty_name);
+    return ESP_OK;
+}
+
+const char *uart_host_pty_name(uart_port_t port)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    return p != NULL ? p->pty_name : NULL;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config)
+{
+    if (port < 0 || port >= UART_NUM_MAX || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ports[port].baud = (uint32_t)config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t port, char pattern_chr, uint8_t chr_num,
+                                            int chr_tout, int post_idle, int pre_idle)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    if (p == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->pattern_chr = (unsigned char)pattern_chr;
+    return ESP_OK;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t port, int queue_length)
+{
+    return uart_host_get(port) != NULL ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int uart_pattern_pop_pos(uart_port_t port)
+{
+    // 不记录检测字符的位置，调用者只是把位置队列清空
+    return -1;
+}
+
+esp_err_t uart_set_rx_timeout(uart_port_t port, uint8_t tout_thresh)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t *size)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    if (p == NULL || size == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&p->lock);
+    *size = p->rx_count;
+    pthread_mutex_unlock(&p->lock);
+    return ESP_OK;
+}
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    if (p == NULL || buf == NULL) {
+        return -1;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t ns = (uint64_t)deadline.tv_nsec + (uint64_t)pdTICKS_TO_MS(ticks_to_wait) * 1000000ull;
+    deadline.tv_sec += (time_t)(ns / 1000000000ull);
+    deadline.tv_nsec = (long)(ns % 1000000000ull);
+
+    uint8_t *out = buf;
+    size_t copied = 0;
+    pthread_mutex_lock(&p->lock);
+    while (copied < length) {
+        if (p->rx_count == 0) {
+            if (ticks_to_wait == 0 ||
+                pthread_cond_timedwait(&p->data_ready, &p->lock, &deadline) == ETIMEDOUT) {
+                break;
+            }
+            continue;
+        }
+        out[copied++] = p->rx_buf[p->rx_head];
+        p->rx_head = (p->rx_head + 1) % p->rx_size;
+        p->rx_count--;
+    }
+    pthread_mutex_unlock(&p->lock);
+    return (int)copied;
+}
+
+int uart_write_bytes(uart_port_t port, const void *src, size_t size)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    if (p == NULL || src == NULL) {
+        return -1;
+    }
+    const uint8_t *data = src;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(p->master_fd, data + written, size - written);
+        if (n > 0) {
+            written += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        struct pollfd pfd = { .fd = p->master_fd, .events = POLLOUT };
+        if (poll(&pfd, 1, UART_HOST_TX_STALL_MS) <= 0) {
+            ESP_LOGW(TAG, "UART%d: peer not reading, %u bytes dropped", port, (unsigned)(size - written));
+            break;
+        }
+    }
+    // 返回值与设备驱动相同: 数据已交给驱动
+    return (int)size;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t port)
+{
+    uart_host_port_t *p = uart_host_get(port);
+    if (p == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&p->lock);
+    p->rx_head = 0;
+    p->rx_count = 0;
+    pthread_mutex_unlock(&p->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baudrate)
+{
+    if (port < 0 || port >= UART_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 伪终端没有波特率，只记录，链路协商照常进行
+    s_ports[port].baud = baudrate;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t *baudrate)
+{
+    if (port < 0 || port >= UART_NUM_MAX || baudrate == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *baudrate = s_ports[port].baud;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_hw_flow_ctrl(uart_port_t port, uart_hw_flowcontrol_t flow_ctrl, uint8_t rx_thresh)
+{
+    return ESP_OK;
+}
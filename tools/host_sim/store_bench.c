@@ -0,0 +1,301 @@
+/*
+ * 遥测 flash 队列 (telemetry_store) 的断线 / 重启仿真
+ *
+ * 按模拟时间运行若干天: 每 CONFIG_TELEMETRY_INTERVAL_MS 产生一个批次追加到队列，
+ * 连接时按遥测任务的做法每 1000 / CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC ms 发布一个，
+ * 发布失败后暂停到下一个周期或重新连接。网络交替连通 / 断开 (指数分布的时长，另有一次长时间断线)，
+ * 设备不定期重启，其中一部分在写 flash 的中途掉电。接收方按批次 id 去重并检查:
+ *   顺序      去重后的 id 必须递增
+ *   内容      负载由 id 决定，逐字节比较
+ *   丢失      写入成功却从未送达的批次 (只允许在队列写满时出现)
+ * 同时给出重新连接后的最大发布速率、长时间断线后清空积压的时间、扇区擦除次数，
+ * 以及只有内存缓冲时 (原先的做法，缓冲约 BUFFER_S 秒) 的送达率作对比。
+ *
+ *   make -C tools/host_sim store-bench
+ *   build/store_bench --days 7 --partition-kb 512 --long-outage-h 4 --seed 1
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include "sdkconfig.h"
+#include "host_port.h"
+#include "telemetry_store.h"
+
+#define LABEL          "telemetry"
+#define INTERVAL_MS    (CONFIG_TELEMETRY_INTERVAL_MS)
+#define DRAIN_MS       (1000 / CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC)
+#define TICK_MS        (DRAIN_MS < 100 ? DRAIN_MS : 100)
+#define BUFFER_S       (100)          // 原先的内存缓冲: 256 个样本，约 100 秒的变化
+#define FLASH_CYCLES   (100000.0)     // NOR flash 扇区的额定擦除次数
+
+static uint32_t s_rng = 1;
+
+static uint32_t sim_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+// 均值为 mean_ms 的指数分布
+static uint64_t sim_exp(double mean_ms)
+{
+    double u = (sim_rand() + 1.0) / 4294967297.0;
+    return (uint64_t)(-log(u) * mean_ms) + 1;
+}
+
+// 批次负载: 长度和内容都由 id 决定，接收方可以逐字节核对
+static size_t batch_payload(uint32_t id, uint8_t *buf)
+{
+    uint32_t x = id * 2654435761u + 1;
+    size_t len = 100 + (x >> 8) % 200;
+    for (size_t i = 0; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        buf[i] = (uint8_t)x;
+    }
+    return len;
+}
+
+typedef struct {
+    uint8_t *seen;             // 按 id 记录是否已送达
+    uint32_t seen_size;
+    uint32_t unique;
+    uint32_t duplicates;
+    uint32_t out_of_order;
+    uint32_t corrupt;
+    int64_t  last_id;
+} receiver_t;
+
+static void receiver_deliver(receiver_t *rx, uint32_t id, const uint8_t *data, size_t len)
+{
+    uint8_t expect[512];
+    size_t expect_len = batch_payload(id, expect);
+    if (len != expect_len || memcmp(data, expect, len) != 0) {
+        rx->corrupt++;
+        return;
+    }
+    if (id >= rx->seen_size) {
+        uint32_t size = rx->seen_size * 2 > id + 1 ? rx->seen_size * 2 : id + 1024;
+        rx->seen = realloc(rx->seen, size);
+        memset(rx->seen + rx->seen_size, 0, size - rx->seen_size);
+        rx->seen_size = size;
+    }
+    if (rx->seen[id]) {
+        rx->duplicates++;
+        return;
+    }
+    rx->seen[id] = 1;
+    rx->unique++;
+    if ((int64_t)id < rx->last_id) {
+        rx->out_of_order++;
+    }
+    rx->last_id = id;
+}
+
+int main(int argc, char **argv)
+{
+    double days = 7, long_outage_h = 4, mean_up_min = 120, mean_down_min = 3, mean_reboot_h = 24;
+    uint32_t partition_kb = 512;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+            days = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--partition-kb") == 0 && i + 1 < argc) {
+            partition_kb = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--long-outage-h") == 0 && i + 1 < argc) {
+            long_outage_h = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mean-up-min") == 0 && i + 1 < argc) {
+            mean_up_min = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mean-down-min") == 0 && i + 1 < argc) {
+            mean_down_min = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mean-reboot-h") == 0 && i + 1 < argc) {
+            mean_reboot_h = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            s_rng = (uint32_t)atol(argv[++i]) | 1;
+        } else {
+            fprintf(stderr, "usage: %s [--days N] [--partition-kb KB] [--long-outage-h H] [--mean-up-min M] "
+                    "[--mean-down-min M] [--mean-reboot-h H] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    partition_host_create(LABEL, partition_kb * 1024);
+    if (telemetry_store_init(LABEL) != ESP_OK) {
+        return 1;
+    }
+    uint32_t next_id = telemetry_store_next_id();
+
+    const uint64_t end_ms = (uint64_t)(days * 86400000.0);
+    const uint64_t long_start = end_ms / 3, long_end = long_start + (uint64_t)(long_outage_h * 3600000.0);
+    receiver_t rx = { .last_id = -1 };
+    uint8_t *appended = calloc(end_ms / INTERVAL_MS + 16, 1);   // 写入成功的批次
+    uint8_t buf[CONFIG_TELEMETRY_BATCH_MAX];
+
+    bool online = true, was_online = true, blocked = false, flush = false;
+    uint64_t next_toggle = sim_exp(mean_up_min * 60000.0);
+    uint64_t next_reboot = sim_exp(mean_reboot_h * 3600000.0);
+    uint64_t next_batch = INTERVAL_MS, next_drain = 0;
+    bool power_cut = false, flash_failed = false;
+    uint64_t cut_armed = 0;
+    uint32_t produced = 0, append_failed = 0, reboots = 0, power_cuts = 0, publishes = 0, lost = 0;
+    uint32_t legacy_delivered = 0, offline_batches = 0, max_backlog = 0;
+    uint32_t second_count = 0, max_per_second = 0;
+    uint64_t second_start = 0, long_drained_ms = 0;
+    uint64_t drained_after = 0;   // 长时间断线结束时刻，清空积压后清零
+
+    for (uint64_t t = 0; t < end_ms; t += TICK_MS) {
+        if (t - second_start >= 1000) {
+            second_start = t;
+            second_count = 0;
+        }
+        // 网络状态
+        if (t >= next_toggle) {
+            online = !online;
+            next_toggle = t + sim_exp((online ? mean_up_min : mean_down_min) * 60000.0);
+        }
+        bool connected = online && !(t >= long_start && t < long_end);
+        if (connected && !was_online) {
+            flush = true;     // MQTT_EVENT_CONNECTED -> telemetry_resync()
+            if (t >= long_end && long_drained_ms == 0 && drained_after == 0) {
+                drained_after = t;
+            }
+        }
+        was_online = connected;
+
+        // 重启: 一半在接下来几次 flash 写入之一的中途掉电，flash 写失败后立即重启
+        if (t >= next_reboot && !power_cut) {
+            if (sim_rand() % 2) {
+                partition_host_power_cut_after(LABEL, (int)(sim_rand() % 3));
+                power_cut = true;
+                cut_armed = t;
+            } else {
+                next_reboot = 0;
+            }
+        }
+        if (next_reboot == 0 || (power_cut && (flash_failed || t - cut_armed > 60000))) {
+            telemetry_store_stats_t st;
+            telemetry_store_get_stats(&st);
+            lost += st.lost;
+            reboots++;
+            power_cuts += flash_failed;
+            partition_host_power_on(LABEL);
+            telemetry_store_init(LABEL);
+            next_id = telemetry_store_next_id();
+            blocked = false;
+            power_cut = false;
+            flash_failed = false;
+            next_reboot = t + sim_exp(mean_reboot_h * 3600000.0);
+        }
+
+        // 遥测任务: 每个周期写入一个批次
+        if (t >= next_batch || flush) {
+            if (t >= next_batch) {
+                next_batch += INTERVAL_MS;
+                uint32_t id = next_id++;
+                size_t len = batch_payload(id, buf);
+                if (telemetry_store_append(id, 0, buf, len) == ESP_OK) {
+                    appended[id] = 1;
+                } else {
+                    append_failed++;
+                    flash_failed = true;
+                }
+                produced++;
+                if (connected) {
+                    legacy_delivered++;
+                    if (offline_batches > 0) {
+                        uint32_t kept = BUFFER_S * 1000 / INTERVAL_MS;
+                        legacy_delivered += offline_batches < kept ? offline_batches : kept;
+                        offline_batches = 0;
+                    }
+                } else {
+                    offline_batches++;
+                }
+            }
+            blocked = false;
+            flush = false;
+            next_drain = t;
+        }
+
+        // 重放
+        if (!blocked && t >= next_drain) {
+            uint32_t id;
+            uint8_t kind;
+            size_t len;
+            if (telemetry_store_peek(&id, &kind, buf, sizeof(buf), &len) == ESP_OK) {
+                if (!connected) {
+                    blocked = true;
+                } else {
+                    receiver_deliver(&rx, id, buf, len);
+                    publishes++;
+                    if (++second_count > max_per_second) {
+                        max_per_second = second_count;
+                    }
+                    if (telemetry_store_consume() != ESP_OK) {
+                        blocked = true;
+                        flash_failed = true;
+                    }
+                    next_drain = t + DRAIN_MS;
+                }
+            } else if (drained_after != 0) {
+                long_drained_ms = t - drained_after;
+                drained_after = 0;
+            }
+        }
+        telemetry_store_stats_t st;
+        telemetry_store_get_stats(&st);
+        if (st.pending > max_backlog) {
+            max_backlog = st.pending;
+        }
+    }
+
+    uint32_t expected = 0, missing = 0;
+    for (uint32_t id = 0; id < next_id; id++) {
+        if (appended[id]) {
+            expected++;
+            if (id >= rx.seen_size || !rx.seen[id]) {
+                missing++;
+            }
+        }
+    }
+    telemetry_store_stats_t st;
+    telemetry_store_get_stats(&st);
+    lost += st.lost;
+    partition_host_stats_t ps;
+    partition_host_get_stats(LABEL, &ps);
+    double erases_per_day = ps.erase_max / days;
+
+    printf("[store_bench] %.1f days, interval %d ms, drain %d/s, partition %lu KiB (%lu sectors), "
+           "outages mean %.0f min every %.0f min + one of %.1f h, reboots %lu (%lu mid-write)\n",
+           days, INTERVAL_MS, CONFIG_TELEMETRY_STORE_DRAIN_PER_SEC, (unsigned long)partition_kb,
+           (unsigned long)st.sectors, mean_down_min, mean_up_min, long_outage_h, (unsigned long)reboots,
+           (unsigned long)power_cuts);
+    printf("  batches produced     %lu (append failed at power cut: %lu)\n", (unsigned long)produced,
+           (unsigned long)append_failed);
+    printf("  delivered (unique)   %lu / %lu written = %.2f%%, still queued %lu\n", (unsigned long)rx.unique,
+           (unsigned long)expected, 100.0 * rx.unique / (expected ? expected : 1), (unsigned long)st.pending);
+    printf("  missing              %lu (overwritten while the queue was full: %lu)\n",
+           (unsigned long)(missing - st.pending), (unsigned long)lost);
+    printf("  duplicates           %lu (dedup by id)\n", (unsigned long)rx.duplicates);
+    printf("  out of order         %lu\n", (unsigned long)rx.out_of_order);
+    printf("  corrupt payloads     %lu\n", (unsigned long)rx.corrupt);
+    printf("  max backlog          %lu batches (%.1f h of data)\n", (unsigned long)max_backlog,
+           max_backlog * (INTERVAL_MS / 3600000.0));
+    printf("  max publishes/s      %lu, long outage drained in %.1f min\n", (unsigned long)max_per_second,
+           long_drained_ms / 60000.0);
+    printf("  flash                %lu writes, %lu sector erases, per sector min %lu max %lu "
+           "(%.1f/day -> %.0f years to %.0fk cycles)\n",
+           (unsigned long)ps.writes, (unsigned long)ps.erases, (unsigned long)ps.erase_min,
+           (unsigned long)ps.erase_max, erases_per_day, FLASH_CYCLES / (erases_per_day > 0 ? erases_per_day : 1) / 365,
+           FLASH_CYCLES / 1000);
+    printf("  RAM buffer only      %lu / %lu = %.2f%% delivered\n", (unsigned long)legacy_delivered,
+           (unsigned long)produced, 100.0 * legacy_delivered / (produced ? produced : 1));
+
+    bool ok = rx.out_of_order == 0 && rx.corrupt == 0 && missing - st.pending == lost;
+    free(appended);
+    free(rx.seen);
+    return ok ? 0 : 1;
+}
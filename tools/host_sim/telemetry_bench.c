@@ -0,0 +1,320 @@
+/*
+ * 遥测批次与原先逐条发布的对比: 每样本字节数和每分钟发布次数
+ *
+ * 生成一段模拟的运行记录 (与设备上注册的状态字段相同: 加热、风扇、水泵、阀、水位、蒸汽、
+ * DHT22 温湿度、两路 DS18B20)，只记录值的变化 (与 status_registry 相同)，然后分别计算:
+ *   legacy     MQTT 订阅 "status:sub:*" 后，每个变化 (20 ms 内的合并) 发布一条
+ *              "STATUS:D:<序号>:<字段>=<值>,..." 到 device/<sn>/resp (QoS 1)
+ *   cbor       telemetry 组件的做法: 每个周期一个 CBOR 批次发布到 device/<sn>/telemetry (QoS 1)，
+ *              缓冲用到 3/4 提前发布，单批超过上限时拆分，按 CONFIG_TELEMETRY_SNAPSHOT_EVERY 带快照
+ *   cbor+lz4   同上，批次压缩后更短时发布压缩结果
+ * 字节数分三列: 负载、加上 MQTT 报文头和主题、再按每次发布一个 TCP 段加 40 字节 IP/TCP 头。
+ *
+ *   make -C tools/host_sim telemetry-bench
+ *   build/telemetry_bench --minutes 60 --interval-ms 10000 --dump batches.txt --samples samples.csv
+ *
+ * --dump 按 mosquitto_sub -F '%t %x' 的格式 (主题 十六进制负载) 写出 cbor+lz4 方式的全部发布，
+ * --samples 写出原始样本 (t_ms,字段,值)，用于检查 tools/telemetry_decode.py 的还原结果。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "telemetry_batch.h"
+
+#define SN           "SNAABBCCDDEEFF"
+#define RING_SIZE    (CONFIG_TELEMETRY_RING_SIZE)
+#define BATCH_MAX    (CONFIG_TELEMETRY_BATCH_MAX)
+#define EARLY_FLUSH  (RING_SIZE * 3 / 4)
+#define COALESCE_MS  (CONFIG_STATUS_REGISTRY_MIN_INTERVAL_MS)
+#define TCP_IP_BYTES 40
+
+enum { T_BOOL = 0, T_INT = 1, T_FLOAT = 2 };
+
+typedef struct {
+    const char *name;
+    uint8_t     type;
+    uint32_t    period_ms;   // 采样周期
+    int32_t     min, max;    // 取值范围 (原始值)
+    int32_t     step;        // 每次最大变化 (随机游走)；BOOL/INT 以 change_pct 的概率跳变
+    int         change_pct;
+    int32_t     value;
+} sim_field_t;
+
+static sim_field_t s_fields[] = {
+    { "heater",   T_BOOL,  1000,   0,   1,  0,  3, 0 },
+    { "fan",      T_INT,   1000,   0, 100,  0,  2, 0 },
+    { "pump",     T_INT,   1000,   0, 100,  0,  1, 0 },
+    { "valve",    T_BOOL,  1000,   0,   1,  0,  1, 0 },
+    { "water",    T_BOOL,  2000,   0,   1,  0,  1, 1 },
+    { "steam",    T_BOOL,  1000,   0,   1,  0,  1, 0 },
+    { "temp",     T_FLOAT, 2000, 150, 650,  3,  0, 250 },
+    { "humidity", T_FLOAT, 2000, 200, 990,  4,  0, 550 },
+    { "t_inlet",  T_FLOAT, 1000, 150, 950,  2,  0, 300 },
+    { "t_outlet", T_FLOAT, 1000, 150, 950,  2,  0, 300 },
+};
+#define FIELD_COUNT ((int)(sizeof(s_fields) / sizeof(s_fields[0])))
+
+static uint32_t s_rng = 0x12345678;
+
+static uint32_t sim_rand(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+/**
+ * @brief 生成样本 (只记录变化)，返回样本数
+ */
+static size_t sim_generate(uint32_t minutes, telemetry_sample_t **out)
+{
+    size_t cap = 1024, count = 0;
+    telemetry_sample_t *samples = malloc(cap * sizeof(*samples));
+    // 启动时各模块发布一次初始值
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        samples[count++] = (telemetry_sample_t){ .t_ms = 0, .field = (uint8_t)f, .value = s_fields[f].value };
+    }
+    for (uint32_t t = 100; t < minutes * 60000; t += 100) {
+        for (int f = 0; f < FIELD_COUNT; f++) {
+            sim_field_t *sf = &s_fields[f];
+            // 各字段错开一点，避免所有周期对齐在同一毫秒
+            if ((t + f * 100) % sf->period_ms != 0) {
+                continue;
+            }
+            int32_t v = sf->value;
+            if (sf->type == T_FLOAT) {
+                v += (int32_t)(sim_rand() % (2 * sf->step + 1)) - sf->step;
+            } else if ((int)(sim_rand() % 100) < sf->change_pct) {
+                v = sf->type == T_BOOL ? !v : (int32_t)(sim_rand() % 21) * 5;
+            }
+            v = v < sf->min ? sf->min : v > sf->max ? sf->max : v;
+            if (v == sf->value) {
+                continue;
+            }
+            sf->value = v;
+            if (count == cap) {
+                cap *= 2;
+                samples = realloc(samples, cap * sizeof(*samples));
+            }
+            samples[count++] = (telemetry_sample_t){ .t_ms = t + f * 3, .field = (uint8_t)f, .value = v };
+        }
+    }
+    *out = samples;
+    return count;
+}
+
+// MQTT PUBLISH 报文长度: 固定头 1 + 剩余长度 1..4 + 主题长度 2 + 主题 + 报文标识 (QoS > 0 时 2) + 负载
+static size_t mqtt_publish_size(const char *topic, size_t payload, int qos)
+{
+    size_t remaining = 2 + strlen(topic) + (qos > 0 ? 2 : 0) + payload;
+    size_t rl = remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+    return 1 + rl + remaining;
+}
+
+typedef struct {
+    const char *name;
+    size_t publishes;
+    size_t payload;
+    size_t mqtt;
+} bench_result_t;
+
+static void result_add(bench_result_t *r, const char *topic, size_t payload, int qos)
+{
+    r->publishes++;
+    r->payload += payload;
+    r->mqtt += mqtt_publish_size(topic, payload, qos);
+}
+
+static int format_value(char *buf, size_t size, uint8_t type, int32_t value)
+{
+    if (type == T_FLOAT) {
+        long abs_value = labs((long)value);
+        return snprintf(buf, size, "%s%ld.%ld", value < 0 ? "-" : "", abs_value / 10, abs_value % 10);
+    }
+    return snprintf(buf, size, "%ld", (long)value);
+}
+
+static bench_result_t run_legacy(const telemetry_sample_t *samples, size_t count)
+{
+    bench_result_t r = { .name = "legacy" };
+    const char *topic = "device/" SN "/resp";
+    uint16_t seq = 0;
+    size_t i = 0;
+    while (i < count) {
+        // 发布任务在一次唤醒后等待 COALESCE_MS，期间的变化合并进同一帧 (同一字段只发最新值)
+        char frame[200];
+        int32_t latest[FIELD_COUNT];
+        uint32_t mask = 0;
+        uint32_t window_end = samples[i].t_ms + COALESCE_MS;
+        for (; i < count && samples[i].t_ms < window_end; i++) {
+            latest[samples[i].field] = samples[i].value;
+            mask |= 1u << samples[i].field;
+        }
+        size_t len = (size_t)snprintf(frame, sizeof(frame), "STATUS:D:%u:", (unsigned)seq++);
+        size_t header = len;
+        for (int f = 0; f < FIELD_COUNT; f++) {
+            if (mask & (1u << f)) {
+                len += (size_t)snprintf(frame + len, sizeof(frame) - len, "%s%d=", len > header ? "," : "", f);
+                len += (size_t)format_value(frame + len, sizeof(frame) - len, s_fields[f].type, latest[f]);
+            }
+        }
+        result_add(&r, topic, len, 1);
+    }
+    return r;
+}
+
+/**
+ * @brief 按 telemetry.c 的发布逻辑打包 (周期 / 提前发布 / 拆分 / 快照)
+ */
+static bench_result_t run_batches(const char *name, const telemetry_sample_t *samples, size_t count,
+                                  uint32_t interval_ms, uint32_t end_ms, bool compress, FILE *dump)
+{
+    bench_result_t r = { .name = name };
+    static uint8_t buf[BATCH_MAX], packed[BATCH_MAX];
+    const char *schema_names[FIELD_COUNT];
+    uint8_t schema_types[FIELD_COUNT];
+    int32_t snapshot[FIELD_COUNT];
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        schema_names[f] = s_fields[f].name;
+        schema_types[f] = s_fields[f].type;
+        snapshot[f] = 0;
+    }
+
+    // 字段表在连接后发布一次
+    size_t schema_len = telemetry_schema_encode(schema_names, schema_types, FIELD_COUNT, buf, sizeof(buf));
+    result_add(&r, "device/" SN "/telemetry/schema", schema_len, 1);
+    if (dump != NULL) {
+        fprintf(dump, "device/" SN "/telemetry/schema ");
+        for (size_t k = 0; k < schema_len; k++) {
+            fprintf(dump, "%02x", buf[k]);
+        }
+        fprintf(dump, "\n");
+    }
+
+    uint32_t seq = 0, since_snapshot = 0;
+    bool need_snapshot = true;
+    size_t next = 0, tail = 0;   // next: 下一个进入缓冲的样本，tail: 最旧的未发布样本
+    uint32_t next_publish = interval_ms;
+    while (true) {
+        // 样本进入缓冲，直到周期到了或者缓冲用到 3/4 (提前发布不改变周期)
+        uint32_t now = next_publish;
+        bool early = false;
+        while (next < count && samples[next].t_ms < next_publish) {
+            snapshot[samples[next].field] = samples[next].value;
+            next++;
+            if (next - tail >= EARLY_FLUSH) {
+                now = samples[next - 1].t_ms;
+                early = true;
+                break;
+            }
+        }
+        if (!early) {
+            next_publish += interval_ms;
+        }
+        bool snapshot_due = need_snapshot || (CONFIG_TELEMETRY_SNAPSHOT_EVERY > 0 &&
+                                              since_snapshot + 1 >= CONFIG_TELEMETRY_SNAPSHOT_EVERY);
+        while (tail < next || snapshot_due) {
+            telemetry_batch_header_t header = {
+                .seq = seq,
+                .field_count = FIELD_COUNT,
+                .snapshot = snapshot_due ? snapshot : NULL,
+                .snapshot_ms = now,
+            };
+            size_t len;
+            size_t n = telemetry_batch_encode(&header, samples + tail, next - tail, buf, sizeof(buf), &len);
+            const uint8_t *data = buf;
+            size_t data_len = len;
+            const char *topic = "device/" SN "/telemetry";
+            size_t c = compress ? telemetry_lz4_compress(buf, len, packed, sizeof(packed)) : 0;
+            if (c > 0) {
+                data = packed;
+                data_len = c;
+                topic = "device/" SN "/telemetry/lz4";
+            }
+            result_add(&r, topic, data_len, 1);
+            if (dump != NULL) {
+                fprintf(dump, "%s ", topic);
+                for (size_t k = 0; k < data_len; k++) {
+                    fprintf(dump, "%02x", data[k]);
+                }
+                fprintf(dump, "\n");
+            }
+            seq++;
+            tail += n;
+            since_snapshot = snapshot_due ? 0 : since_snapshot + 1;
+            snapshot_due = need_snapshot = false;
+        }
+        if (!early && now >= end_ms) {
+            break;
+        }
+    }
+    return r;
+}
+
+static void print_result(const bench_result_t *r, size_t samples, double minutes)
+{
+    printf("  %-20s %10.1f %10.2f %10.2f %10.2f\n", r->name, r->publishes / minutes, (double)r->payload / samples,
+           (double)r->mqtt / samples, (double)(r->mqtt + r->publishes * TCP_IP_BYTES) / samples);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t minutes = 60;
+    uint32_t intervals[4] = { CONFIG_TELEMETRY_INTERVAL_MS, 60000 };
+    int interval_count = 2;
+    const char *dump_path = NULL, *samples_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+            minutes = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            intervals[0] = (uint32_t)atol(argv[++i]);
+            interval_count = 1;
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dump_path = argv[++i];
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--minutes N] [--interval-ms MS] [--dump FILE] [--samples FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (minutes == 0) {
+        return 2;
+    }
+
+    telemetry_sample_t *samples;
+    size_t count = sim_generate(minutes, &samples);
+    if (samples_path != NULL) {
+        FILE *f = fopen(samples_path, "w");
+        for (size_t i = 0; f != NULL && i < count; i++) {
+            fprintf(f, "%lu,%u,%ld\n", (unsigned long)samples[i].t_ms, samples[i].field, (long)samples[i].value);
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+
+    printf("[telemetry_bench] %u min, %d fields, %zu samples (%.1f/min), batch max %d B, ring %d\n", minutes,
+           FIELD_COUNT, count, count / (double)minutes, BATCH_MAX, RING_SIZE);
+    printf("  %-20s %10s %10s %10s %10s\n", "path", "pub/min", "B/sample", "+MQTT", "+TCP/IP");
+    bench_result_t legacy = run_legacy(samples, count);
+    print_result(&legacy, count, minutes);
+    for (int k = 0; k < interval_count; k++) {
+        char name[2][32];
+        snprintf(name[0], sizeof(name[0]), "cbor/%lus", (unsigned long)(intervals[k] / 1000));
+        snprintf(name[1], sizeof(name[1]), "cbor+lz4/%lus", (unsigned long)(intervals[k] / 1000));
+        bench_result_t cbor = run_batches(name[0], samples, count, intervals[k], minutes * 60000, false, NULL);
+        FILE *dump = (k == 0 && dump_path != NULL) ? fopen(dump_path, "w") : NULL;
+        bench_result_t lz4 = run_batches(name[1], samples, count, intervals[k], minutes * 60000, true, dump);
+        if (dump != NULL) {
+            fclose(dump);
+        }
+        print_result(&cbor, count, minutes);
+        print_result(&lz4, count, minutes);
+    }
+    free(samples);
+    return 0;
+}
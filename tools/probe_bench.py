@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""Command path latency probe: where does the time of one command go?
+
+Sends thousands of ping/probe commands to the main board and splits every
+round trip into the stages timestamped on the device (see
+components/command_dispatcher/include/command_probe.h):
+
+  in     transport received -> dispatcher   (UART line assembly / MQTT JSON or topic parse)
+  parse  dispatcher -> execution lane       (prefix lookup, argument split, rate limit)
+  queue  lane -> handler start              (queueing and task switch)
+  run    handler start -> handler end
+  total  transport received -> handler end
+  reply  formatting the reply + handing it to the UART ring / MQTT publish,
+         measured on the previous probe of the same lane (a frame cannot
+         carry its own send time)
+  wire   host round trip - total            (reply path incl. reply, link, host)
+
+Lanes: "sync" = ping:<id> (runs in the receiving task), "queue" = probe:<id>
+(module worker task), "high" = probe:high:<id> (high-priority task). A high
+probe flushes queued ones, so lanes are measured one after another.
+
+  pip install pyserial            # UART, reuses the framing of uart_bench.py
+  pip install paho-mqtt           # MQTT
+  python tools/probe_bench.py --port /dev/ttyUSB0 --count 2000
+  python tools/probe_bench.py --port /dev/ttyUSB0 --binary --lanes sync,high
+  python tools/probe_bench.py --mqtt broker.local --sn <device_sn> --count 1000
+  python tools/probe_bench.py --mqtt broker.local --sn <device_sn> --topic-route
+
+Probes are never rate limited, so --rate 0 (back to back) is fine.
+"""
+
+import argparse
+import json
+import os
+import queue
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from uart_bench import AsciiLink, BinaryLink, percentile  # noqa: E402
+
+LANE_COMMANDS = {
+    "sync": "ping:{}",
+    "queue": "probe:{}",
+    "high": "probe:high:{}",
+}
+STAGES = ["in", "parse", "queue", "run", "total", "reply", "wire", "rtt"]
+
+
+class MqttLink:
+    """Publishes {"command": ..., "id": ...} and waits on device/<sn>/resp/<id>.
+
+    With topic_route the command goes to device/<sn>/cmd/<prefix>/<id> with
+    the rest of the command as plain-text payload (no JSON on the device).
+    """
+
+    name = "mqtt"
+
+    def __init__(self, host, port, sn, topic_route=False):
+        import paho.mqtt.client as mqtt
+
+        self.sn = sn
+        self.topic_route = topic_route
+        if topic_route:
+            self.name = "mqtt-topic"
+        self.replies = queue.Queue()
+        self.client = mqtt.Client()
+        self.client.on_message = lambda c, u, msg: self.replies.put(msg.payload.decode(errors="replace"))
+        self.client.connect(host, port)
+        self.client.subscribe(f"device/{sn}/resp/#", qos=0)
+        self.client.loop_start()
+        time.sleep(0.5)
+
+    def send(self, cmd: str):
+        probe_id = cmd.rsplit(":", 1)[-1]
+        if self.topic_route:
+            prefix, _, rest = cmd.partition(":")
+            self.client.publish(f"device/{self.sn}/cmd/{prefix}/p{probe_id}", rest, qos=0)
+            return
+        payload = json.dumps({"command": cmd, "id": f"p{probe_id}"})
+        self.client.publish(f"device/{self.sn}/message", payload, qos=0)
+
+    def recv(self, timeout: float):
+        try:
+            return self.replies.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def close(self):
+        self.client.loop_stop()
+        self.client.disconnect()
+
+
+def parse_probe(line):
+    """STATUS:PROBE:<id>:<lane>:in=..,parse=..,... -> (id, lane, {stage: us})"""
+    parts = line.split(":", 4)
+    if len(parts) != 5 or parts[0] != "STATUS" or parts[1] != "PROBE":
+        return None
+    stages = {}
+    for item in parts[4].split(","):
+        key, _, value = item.partition("=")
+        stages[key] = int(value)
+    return int(parts[2]), parts[3], stages
+
+
+def run_lane(link, lane, count, timeout, rate, first_id):
+    samples = {stage: [] for stage in STAGES}
+    lost = stale = 0
+    interval = 1.0 / rate if rate > 0 else 0.0
+    for i in range(count):
+        probe_id = first_id + i
+        t0 = time.perf_counter()
+        link.send(LANE_COMMANDS[lane].format(probe_id))
+        while True:
+            reply = link.recv(timeout)
+            if reply is None:
+                lost += 1
+                break
+            probe = parse_probe(reply)
+            if probe is None:
+                continue                # unrelated status line
+            if probe[0] != probe_id:
+                stale += 1              # late reply of a probe already counted as lost
+                continue
+            rtt_us = (time.perf_counter() - t0) * 1e6
+            stages = probe[2]
+            for stage in STAGES[:6]:
+                samples[stage].append(stages.get(stage, 0))
+            samples["wire"].append(max(0.0, rtt_us - stages.get("total", 0)))
+            samples["rtt"].append(rtt_us)
+            break
+        if interval:
+            time.sleep(max(0.0, interval - (time.perf_counter() - t0)))
+
+    print(f"[{link.name}/{lane}] {count} probes, {len(samples['rtt'])} answered, lost={lost} stale={stale}")
+    print(f"  {'stage':<6} {'p50':>9} {'p90':>9} {'p99':>9} {'p99.9':>9} {'max':>9}   (us)")
+    for stage in STAGES:
+        values = samples[stage]
+        if not values:
+            continue
+        print(f"  {stage:<6} {percentile(values, 50):9.0f} {percentile(values, 90):9.0f} "
+              f"{percentile(values, 99):9.0f} {percentile(values, 99.9):9.0f} {max(values):9.0f}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", help="serial port wired to the screen UART")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--binary", action="store_true", help="use COBS/CRC frames instead of text lines")
+    ap.add_argument("--mqtt", metavar="HOST", help="MQTT broker instead of UART")
+    ap.add_argument("--mqtt-port", type=int, default=1883)
+    ap.add_argument("--sn", help="device serial number (MQTT topics device/<sn>/...)")
+    ap.add_argument("--topic-route", action="store_true",
+                    help="MQTT: publish to device/<sn>/cmd/<prefix>/<id> instead of JSON on device/<sn>/message")
+    ap.add_argument("--lanes", default="sync,queue,high", help="comma separated: sync, queue, high")
+    ap.add_argument("--count", type=int, default=2000, help="probes per lane")
+    ap.add_argument("--timeout", type=float, default=0.5, help="reply timeout (s)")
+    ap.add_argument("--rate", type=float, default=0, help="pace probes to N/s (0 = back to back)")
+    args = ap.parse_args()
+
+    lanes = [lane.strip() for lane in args.lanes.split(",") if lane.strip()]
+    for lane in lanes:
+        if lane not in LANE_COMMANDS:
+            ap.error(f"unknown lane '{lane}'")
+
+    if args.mqtt:
+        if not args.sn:
+            ap.error("--sn is required with --mqtt")
+        link = MqttLink(args.mqtt, args.mqtt_port, args.sn, args.topic_route)
+        try:
+            for n, lane in enumerate(lanes):
+                run_lane(link, lane, args.count, args.timeout, args.rate, n * args.count)
+        finally:
+            link.close()
+        return 0
+
+    if not args.port:
+        ap.error("--port or --mqtt is required")
+
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=0) as ser:
+        ser.reset_input_buffer()
+        link = BinaryLink(ser) if args.binary else AsciiLink(ser)
+        for n, lane in enumerate(lanes):
+            run_lane(link, lane, args.count, args.timeout, args.rate, n * args.count)
+            time.sleep(0.2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
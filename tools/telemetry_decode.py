@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Decode telemetry batches published by components/telemetry into CSV.
+
+Batch and schema layout: components/telemetry/include/telemetry_batch.h
+(CBOR map with small integer keys, samples as a flat [dt, field, value]
+array; "telemetry/lz4" carries the same map as an LZ4 block with a 4-byte
+little-endian size prefix). No third-party modules needed.
+
+  # record from the broker
+  mosquitto_sub -h broker -t 'device/+/telemetry/#' -F '%t %x' > batches.txt
+  python tools/telemetry_decode.py batches.txt > samples.csv
+
+  # against the host benchmark, which writes the same format
+  make -C tools/host_sim build/telemetry_bench
+  tools/host_sim/build/telemetry_bench --dump /tmp/b.txt --samples /tmp/s.csv
+  python tools/telemetry_decode.py /tmp/b.txt --check /tmp/s.csv
+
+Output columns: t_ms,field,value with FLOAT fields scaled back from 0.1
+units. Gaps in the batch sequence and samples the device dropped are
+reported on stderr. With the flash queue (CONFIG_TELEMETRY_STORE) the
+sequence number continues across reboots and a batch may be published
+twice around a reboot; repeated batches (same sequence number, same bytes)
+are skipped. --check compares the decoded raw samples against a
+CSV of raw samples (t_ms,field,value) and exits non-zero on mismatch.
+"""
+
+import argparse
+import struct
+import sys
+
+TYPE_BOOL, TYPE_INT, TYPE_FLOAT = 0, 1, 2
+
+
+def cbor_decode(data, pos=0):
+    """Decodes the CBOR subset the device writes: ints, text, arrays, maps."""
+    head = data[pos]
+    major, info = head >> 5, head & 0x1F
+    pos += 1
+    if info < 24:
+        value = info
+    elif info <= 27:
+        n = 1 << (info - 24)
+        value = int.from_bytes(data[pos:pos + n], "big")
+        pos += n
+    else:
+        raise ValueError(f"unsupported CBOR head 0x{head:02x}")
+    if major == 0:
+        return value, pos
+    if major == 1:
+        return -1 - value, pos
+    if major == 3:
+        return data[pos:pos + value].decode(), pos + value
+    if major == 4:
+        items = []
+        for _ in range(value):
+            item, pos = cbor_decode(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(value):
+            key, pos = cbor_decode(data, pos)
+            result[key], pos = cbor_decode(data, pos)
+        return result, pos
+    raise ValueError(f"unsupported CBOR major type {major}")
+
+
+def lz4_decompress(data):
+    """LZ4 block with a 4-byte little-endian size prefix."""
+    size = struct.unpack_from("<I", data)[0]
+    out = bytearray()
+    pos = 4
+    while pos < len(data):
+        token = data[pos]
+        pos += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = data[pos]
+                pos += 1
+                lit += b
+                if b != 255:
+                    break
+        out += data[pos:pos + lit]
+        pos += lit
+        if pos >= len(data):
+            break
+        offset = data[pos] | data[pos + 1] << 8
+        pos += 2
+        match = (token & 0x0F) + 4
+        if token & 0x0F == 15:
+            while True:
+                b = data[pos]
+                pos += 1
+                match += b
+                if b != 255:
+                    break
+        start = len(out) - offset
+        for i in range(match):
+            out.append(out[start + i])
+    if len(out) != size:
+        raise ValueError(f"LZ4 size mismatch: {len(out)} != {size}")
+    return bytes(out)
+
+
+class Decoder:
+    def __init__(self):
+        self.schema = None
+        self.seq = None
+        self.samples = []
+        self.lost_batches = 0
+        self.dropped = 0
+        self.duplicates = 0
+        self.seen = {}
+
+    def feed(self, topic, payload):
+        if topic.endswith("/telemetry/schema"):
+            schema, _ = cbor_decode(payload)
+            self.schema = [(name, ftype) for name, ftype in schema[1]]
+            return
+        if topic.endswith("/telemetry/lz4"):
+            payload = lz4_decompress(payload)
+        elif not topic.endswith("/telemetry"):
+            return
+        batch, _ = cbor_decode(payload)
+        seq = batch[0]
+        if self.seen.get(seq) == payload:
+            self.duplicates += 1
+            return
+        self.seen[seq] = payload
+        if self.seq is not None and seq <= self.seq:
+            print(f"batch sequence restarted: {self.seq} -> {seq}", file=sys.stderr)
+        elif self.seq is not None and seq != self.seq + 1:
+            lost = (seq - self.seq - 1) & 0xFFFFFFFF
+            self.lost_batches += lost
+            print(f"batch sequence gap: {self.seq} -> {seq} ({lost} lost)", file=sys.stderr)
+        self.seq = seq
+        if self.schema is not None and batch[2] != len(self.schema):
+            print(f"batch {seq}: field count {batch[2]} differs from schema ({len(self.schema)})", file=sys.stderr)
+        if batch.get(4):
+            self.dropped += batch[4]
+            print(f"batch {seq}: device dropped {batch[4]} samples", file=sys.stderr)
+        t = batch[1]
+        flat = batch.get(3, [])
+        for i in range(0, len(flat), 3):
+            t += flat[i]
+            self.samples.append((t, flat[i + 1], flat[i + 2]))
+
+    def value(self, field, raw):
+        if self.schema is not None and field < len(self.schema) and self.schema[field][1] == TYPE_FLOAT:
+            return f"{raw / 10:.1f}"
+        return str(raw)
+
+    def name(self, field):
+        if self.schema is not None and field < len(self.schema):
+            return self.schema[field][0]
+        return str(field)
+
+
+def read_csv(path):
+    rows = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if line and line[0].isdigit():
+                rows.append(tuple(int(x) for x in line.split(",")))
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="lines of '<topic> <hex payload>' (mosquitto_sub -F '%%t %%x'), - for stdin")
+    parser.add_argument("--names", action="store_true", help="print field names from the schema instead of numbers")
+    parser.add_argument("--check", metavar="CSV", help="compare raw decoded samples with this CSV")
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    f = sys.stdin if args.input == "-" else open(args.input)
+    with f:
+        for line in f:
+            parts = line.split()
+            if len(parts) == 2:
+                decoder.feed(parts[0], bytes.fromhex(parts[1]))
+
+    if args.check:
+        expected = read_csv(args.check)
+        if decoder.samples != expected:
+            first = next((i for i, (a, b) in enumerate(zip(decoder.samples, expected)) if a != b),
+                         min(len(decoder.samples), len(expected)))
+            print(f"mismatch at sample {first}: decoded {len(decoder.samples)}, expected {len(expected)}",
+                  file=sys.stderr)
+            return 1
+        print(f"{len(expected)} samples match", file=sys.stderr)
+        return 0
+
+    print("t_ms,field,value")
+    for t, field, raw in decoder.samples:
+        print(f"{t},{decoder.name(field) if args.names else field},{decoder.value(field, raw)}")
+    if decoder.lost_batches or decoder.dropped or decoder.duplicates:
+        print(f"lost batches: {decoder.lost_batches}, dropped samples: {decoder.dropped}, "
+              f"duplicate batches: {decoder.duplicates}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,367 @@
+#!/usr/bin/env python3
+"""Screen-link benchmark: ASCII lines vs. binary COBS/CRC frames.
+
+Talks to the main board over a USB-serial adapter wired to the screen UART
+(CONFIG_UART_SERVICE_TX_PIN / RX_PIN) and measures, for each mode:
+  * round-trip latency of one command -> first reply (p50/p95/p99/max)
+  * sustained commands per second
+  * bytes on the wire per command and reply
+
+Frame format is documented in components/uart_service/include/uart_frame.h.
+
+  pip install pyserial
+  python tools/uart_bench.py --port /dev/ttyUSB0 --mode both --count 1000
+  python tools/uart_bench.py --offline        # encode/decode cost only, no board
+
+The UART source is rate limited by the dispatcher
+(CONFIG_COMMAND_DISPATCHER_UART_RATE); set it to 0 for throughput runs,
+otherwise throttled replies are counted and reported.
+
+--stream SECONDS keeps --window ping:<id> probes in flight (never rate
+limited) for the given time and reports sustained commands/s, bytes/s in
+both directions and the device CPU load from "diag:cpu" (needs
+CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS). Run it once on firmware built with
+and once without CONFIG_UART_SERVICE_DMA to compare the UART driver against
+the UHCI + GDMA transport at the same baud rate:
+
+  python tools/uart_bench.py --port /dev/ttyUSB0 --baud 2000000 --mode ascii --stream 10 --pad 64
+"""
+
+import argparse
+import statistics
+import sys
+import time
+
+FRAME_VERSION = 1
+TYPE_DATA, TYPE_ACK, TYPE_NAK, TYPE_HEARTBEAT = 0, 1, 2, 3
+HEARTBEAT_LINE = b"HB"
+FLAG_SYN = 0x80
+OP_COMMAND, OP_STATUS = 0x01, 0x02
+
+
+def crc16(data: bytes) -> int:
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray(b"\x00")
+    code_pos, code = 0, 1
+    for i, b in enumerate(data):
+        if b:
+            out.append(b)
+            code += 1
+        if not b or code == 0xFF:
+            out[code_pos] = code
+            code = 1
+            if b and i + 1 == len(data):
+                return bytes(out)
+            code_pos = len(out)
+            out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            raise ValueError("bad COBS")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(ftype: int, seq: int, opcode: int = 0, payload: bytes = b"", flags: int = 0) -> bytes:
+    raw = bytes([FRAME_VERSION, (ftype & 0x0F) | (flags & 0xF0), seq & 0xFF, opcode]) + payload
+    crc = crc16(raw)
+    return b"\x00" + cobs_encode(raw + bytes([crc & 0xFF, crc >> 8])) + b"\x00"
+
+
+def decode_frame(body: bytes):
+    raw = cobs_decode(body)
+    if len(raw) < 6:
+        raise ValueError("short frame")
+    if crc16(raw[:-2]) != raw[-2] | raw[-1] << 8:
+        raise ValueError("bad CRC")
+    if raw[0] != FRAME_VERSION:
+        raise ValueError("bad version")
+    return raw[1] & 0x0F, raw[1] & 0xF0, raw[2], raw[3], raw[4:-2]
+
+
+class AsciiLink:
+    name = "ascii"
+
+    def __init__(self, ser):
+        self.ser = ser
+        self.buf = bytearray()
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+
+    def send(self, cmd: str):
+        data = cmd.encode() + b"\n"
+        self.tx_bytes += len(data)
+        self.ser.write(data)
+
+    def recv(self, timeout: float):
+        deadline = time.perf_counter() + timeout
+        while True:
+            nl = self.buf.find(b"\n")
+            if nl >= 0:
+                line = bytes(self.buf[:nl])
+                del self.buf[:nl + 1]
+                self.rx_bytes += nl + 1
+                line = line.rstrip(b"\r")
+                if line and line[0] != 0 and line != HEARTBEAT_LINE:
+                    return line.decode(errors="replace")
+                continue
+            if time.perf_counter() >= deadline:
+                return None
+            self.buf += self.ser.read(self.ser.in_waiting or 1)
+
+
+class BinaryLink:
+    """Stop-and-wait sender and ACKing receiver, mirroring uart_service."""
+
+    name = "binary"
+
+    def __init__(self, ser, ack_timeout=0.05, retries=3):
+        self.ser = ser
+        self.buf = bytearray()
+        self.seq = 0
+        self.syn = True
+        self.ack_timeout = ack_timeout
+        self.retries = retries
+        self.pending = []          # received DATA payloads not yet consumed
+        self.acks = []
+        self.last_rx_seq = None
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+        self.retransmits = 0
+        self.rx_errors = 0
+
+    def _write(self, data: bytes):
+        self.tx_bytes += len(data)
+        self.ser.write(data)
+
+    def _pump(self, timeout: float):
+        """Read until at least one frame was processed or the timeout expires."""
+        deadline = time.perf_counter() + timeout
+        while True:
+            start = self.buf.find(b"\x00")
+            if start >= 0:
+                end = self.buf.find(b"\x00", start + 1)
+                if end == start + 1:
+                    del self.buf[:start + 1]
+                    continue
+                if end > start:
+                    body = bytes(self.buf[start + 1:end])
+                    del self.buf[:end + 1]
+                    self.rx_bytes += len(body) + 2
+                    self._handle(body)
+                    return True
+            if time.perf_counter() >= deadline:
+                return False
+            self.buf += self.ser.read(self.ser.in_waiting or 1)
+
+    def _handle(self, body: bytes):
+        try:
+            ftype, flags, seq, opcode, payload = decode_frame(body)
+        except ValueError:
+            self.rx_errors += 1
+            self._write(encode_frame(TYPE_NAK, self.last_rx_seq or 0))
+            return
+        if ftype == TYPE_HEARTBEAT:
+            return
+        if ftype in (TYPE_ACK, TYPE_NAK):
+            self.acks.append((ftype, seq))
+            return
+        self._write(encode_frame(TYPE_ACK, seq))
+        duplicate = self.last_rx_seq == seq
+        if (flags & FLAG_SYN) and not duplicate:
+            self.last_rx_seq = None
+        if self.last_rx_seq == seq:
+            return
+        self.last_rx_seq = seq
+        self.pending.append(payload.decode(errors="replace"))
+
+    def send(self, cmd: str):
+        self.seq = (self.seq + 1) & 0xFF
+        frame = encode_frame(TYPE_DATA, self.seq, OP_COMMAND, cmd.encode(), FLAG_SYN if self.syn else 0)
+        for attempt in range(self.retries + 1):
+            if attempt:
+                self.retransmits += 1
+            self._write(frame)
+            deadline = time.perf_counter() + self.ack_timeout
+            while time.perf_counter() < deadline:
+                if not self.acks and not self._pump(deadline - time.perf_counter()):
+                    break
+                while self.acks:
+                    ftype, seq = self.acks.pop(0)
+                    if ftype == TYPE_NAK:
+                        deadline = 0
+                        break
+                    if seq == self.seq:
+                        self.syn = False
+                        return
+        raise RuntimeError(f"frame {self.seq} not acknowledged")
+
+    def recv(self, timeout: float):
+        deadline = time.perf_counter() + timeout
+        while not self.pending:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0 or not self._pump(remaining):
+                return None
+        return self.pending.pop(0)
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    k = min(len(values) - 1, max(0, int(round(p / 100.0 * (len(values) - 1)))))
+    return values[k]
+
+
+def run_link(link, command, count, timeout, rate):
+    latencies = []
+    lost = throttled = 0
+    interval = 1.0 / rate if rate > 0 else 0.0
+    t_start = time.perf_counter()
+    for i in range(count):
+        t0 = time.perf_counter()
+        link.send(command)
+        reply = link.recv(timeout)
+        t1 = time.perf_counter()
+        if reply is None:
+            lost += 1
+            continue
+        if reply.startswith("STATUS:THROTTLED"):
+            throttled += 1
+            link.recv(timeout)   # the command itself was dropped; skip its (missing) reply
+            continue
+        latencies.append((t1 - t0) * 1e3)
+        if interval:
+            time.sleep(max(0.0, interval - (time.perf_counter() - t0)))
+    elapsed = time.perf_counter() - t_start
+
+    print(f"[{link.name}] {count} x '{command}'")
+    if latencies:
+        print(f"  rtt ms   p50={percentile(latencies, 50):.2f} p95={percentile(latencies, 95):.2f} "
+              f"p99={percentile(latencies, 99):.2f} max={max(latencies):.2f} mean={statistics.mean(latencies):.2f}")
+    print(f"  rate     {len(latencies) / elapsed:.1f} cmd/s")
+    print(f"  wire     tx {link.tx_bytes / count:.1f} B/cmd, rx {link.rx_bytes / count:.1f} B/cmd")
+    print(f"  lost={lost} throttled={throttled}"
+          + (f" retransmits={link.retransmits} rx_errors={link.rx_errors}" if isinstance(link, BinaryLink) else ""))
+
+
+def query_cpu(link, timeout):
+    """Send diag:cpu and return the per-core load line (also restarts the device's window)."""
+    link.send("diag:cpu")
+    deadline = time.perf_counter() + timeout * 4
+    while time.perf_counter() < deadline:
+        reply = link.recv(timeout)
+        if reply is not None and reply.startswith("STATUS:DIAG:CPU:"):
+            return reply[len("STATUS:DIAG:CPU:"):]
+    return "n/a"
+
+
+def run_stream(link, seconds, window, pad, timeout):
+    query_cpu(link, timeout)
+    filler = ":" + "x" * pad if pad else ""
+    sent = answered = 0
+    tx0, rx0 = link.tx_bytes, link.rx_bytes
+    t_start = time.perf_counter()
+    t_end = t_start + seconds
+    while True:
+        if time.perf_counter() < t_end and sent - answered < window:
+            link.send(f"ping:{sent}{filler}")
+            sent += 1
+            continue
+        if sent == answered:
+            break
+        reply = link.recv(timeout)
+        if reply is None:
+            break                       # whatever is still outstanding is lost
+        if reply.startswith("STATUS:PROBE:"):
+            answered += 1
+    elapsed = time.perf_counter() - t_start
+    tx, rx = link.tx_bytes - tx0, link.rx_bytes - rx0
+    cpu = query_cpu(link, timeout)
+
+    print(f"[{link.name}] stream {seconds:g} s, window {window}, {tx / max(sent, 1):.0f} B/cmd")
+    print(f"  rate     {answered / elapsed:.0f} cmd/s, lost={sent - answered}")
+    print(f"  wire     tx {tx / elapsed:.0f} B/s, rx {rx / elapsed:.0f} B/s")
+    print(f"  device   cpu {cpu} (per mille)")
+
+
+def run_offline(command, reply, count):
+    cmd_b, reply_b = command.encode(), reply.encode()
+
+    t0 = time.perf_counter()
+    for _ in range(count):
+        line = cmd_b + b"\n"
+        line.rstrip(b"\n").decode()
+    ascii_us = (time.perf_counter() - t0) / count * 1e6
+
+    t0 = time.perf_counter()
+    for i in range(count):
+        frame = encode_frame(TYPE_DATA, i, OP_COMMAND, cmd_b)
+        decode_frame(frame[1:-1])
+    binary_us = (time.perf_counter() - t0) / count * 1e6
+
+    print(f"offline, {count} messages (host CPU, pure Python)")
+    print(f"  ascii  : {ascii_us:.2f} us/msg, {len(cmd_b) + 1} + {len(reply_b) + 1} B per exchange")
+    ack = len(encode_frame(TYPE_ACK, 0))
+    print(f"  binary : {binary_us:.2f} us/msg, "
+          f"{len(encode_frame(TYPE_DATA, 0, OP_COMMAND, cmd_b))} + {len(encode_frame(TYPE_DATA, 0, OP_STATUS, reply_b))}"
+          f" B per exchange + 2 x {ack} B ACK")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", help="serial port wired to the screen UART")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--mode", choices=["ascii", "binary", "both"], default="both")
+    ap.add_argument("--count", type=int, default=500)
+    ap.add_argument("--command", default="relay:status", help="command that produces exactly one reply")
+    ap.add_argument("--timeout", type=float, default=0.5, help="reply timeout (s)")
+    ap.add_argument("--rate", type=float, default=0, help="pace commands to N/s (0 = as fast as possible)")
+    ap.add_argument("--offline", action="store_true", help="only measure encode/decode cost, no board")
+    ap.add_argument("--stream", type=float, metavar="SECONDS", help="sustained throughput and device CPU load")
+    ap.add_argument("--window", type=int, default=8, help="probes in flight during --stream")
+    ap.add_argument("--pad", type=int, default=0, help="extra bytes per --stream command (max 80)")
+    args = ap.parse_args()
+
+    if args.offline:
+        run_offline(args.command, "STATUS:RELAY_OFF", args.count * 100)
+        return 0
+    if not args.port:
+        ap.error("--port is required unless --offline is given")
+
+    import serial  # pyserial
+
+    with serial.Serial(args.port, args.baud, timeout=0) as ser:
+        modes = ["ascii", "binary"] if args.mode == "both" else [args.mode]
+        for mode in modes:
+            ser.reset_input_buffer()
+            link = AsciiLink(ser) if mode == "ascii" else BinaryLink(ser)
+            if args.stream:
+                run_stream(link, args.stream, args.window, min(args.pad, 80), args.timeout)
+            else:
+                run_link(link, args.command, args.count, args.timeout, args.rate)
+            time.sleep(0.2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
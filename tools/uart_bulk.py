@@ -0,0 +1,442 @@
+#!/usr/bin/env python3
+"""Bulk transfer over the screen UART: the screen side of uart_service_bulk_*.
+
+Protocol: UART_FRAME_TYPE_BULK in components/uart_service/include/uart_frame.h
+(go-back-N sliding window, per-chunk frame CRC16, CRC-32 of the whole payload
+checked at the end, resume from the receiver's offset).
+
+  pip install pyserial
+  # push a file to the main board (needs a registered bulk sink)
+  python tools/uart_bulk.py --port /dev/ttyUSB0 --baud 921600 send assets.bin
+  # have the main board send something and store it
+  python tools/uart_bulk.py --port /dev/ttyUSB0 receive out.bin --request "host:bulk_send:65536"
+
+  # against the host build (tools/host_sim), which stores received data in memory
+  make -C tools/host_sim
+  python tools/uart_bulk.py --sim --ping-interval 0.02 send --random 1048576
+  python tools/uart_bulk.py --sim send --random 262144 --interrupt-at 0.5   # then resumes
+  python tools/uart_bulk.py --sim receive - --request "host:bulk_send:262144"
+
+--ping-interval sends "ping:<n>" text commands while the transfer runs and
+reports their round-trip latency, i.e. what command traffic sees while the
+bulk channel saturates the link. --interrupt-at F aborts the first attempt
+after fraction F was sent and starts a second one, which must resume from
+the receiver's offset. With --baud, throughput is also given as a share of
+the wire rate (10 bits per byte). --loss P drops each DATA frame sent or
+received with probability P to exercise NAK / go-back-N / timeout recovery.
+"""
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+import time
+import zlib
+from collections import deque
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from uart_bench import decode_frame, encode_frame, percentile  # noqa: E402
+
+TYPE_BULK = 4
+OFFER, ACCEPT, REJECT, DATA, ACK, NAK, END, DONE, ABORT = range(1, 10)
+STATUS = {0: "OK", 1: "NO_SINK", 2: "BUSY", 3: "REFUSED", 4: "IO_ERROR", 5: "BAD_CRC", 6: "CANCELLED", 7: "TIMEOUT"}
+ST_OK, ST_BAD_CRC, ST_CANCELLED = 0, 5, 6
+NAME_MAX = 32
+
+
+class BulkLink:
+    """Splits the byte stream into text lines and frames; bulk frames become events."""
+
+    def __init__(self, ser, ping_interval=None, loss=0.0):
+        self.ser = ser
+        self.loss = loss
+        self.buf = bytearray()
+        self.in_frame = False
+        self.events = deque()
+        self.lines = deque()
+        self.tx_bytes = 0
+        self.rx_errors = 0
+        self.ping_interval = ping_interval
+        self.ping_seq = 0
+        self.ping_next = time.perf_counter()
+        self.pings = {}
+        self.ping_latencies = []
+
+    def write(self, data: bytes):
+        self.tx_bytes += len(data)
+        self.ser.write(data)
+
+    def send_bulk(self, op: int, tid: int, payload: bytes = b""):
+        if op == DATA and self.loss and random.random() < self.loss:
+            return
+        self.write(encode_frame(TYPE_BULK, tid, op, payload))
+
+    def line(self, text: str):
+        self.write(text.encode() + b"\n")
+
+    def _parse(self):
+        while True:
+            if self.in_frame:
+                end = self.buf.find(b"\x00")
+                if end < 0:
+                    return
+                body = bytes(self.buf[:end])
+                del self.buf[:end + 1]
+                if not body:
+                    continue            # back-to-back delimiters
+                self.in_frame = False
+                self._frame(body)
+                continue
+            nl = self.buf.find(b"\n")
+            z = self.buf.find(b"\x00")
+            if z >= 0 and (nl < 0 or z < nl):
+                del self.buf[:z + 1]
+                self.in_frame = True
+                continue
+            if nl < 0:
+                return
+            text = self.buf[:nl].rstrip(b"\r").decode(errors="replace")
+            del self.buf[:nl + 1]
+            self._line(text)
+
+    def _frame(self, body: bytes):
+        try:
+            ftype, _flags, seq, opcode, payload = decode_frame(body)
+        except ValueError:
+            self.rx_errors += 1
+            return
+        if ftype == TYPE_BULK and not (opcode == DATA and self.loss and random.random() < self.loss):
+            self.events.append((opcode, seq, payload))
+
+    def _line(self, text: str):
+        if text == "HB" or not text:
+            return
+        if text.startswith("STATUS:PROBE:"):
+            n = int(text.split(":")[2])
+            sent = self.pings.pop(n, None)
+            if sent is not None:
+                self.ping_latencies.append((time.perf_counter() - sent) * 1e6)
+            return
+        self.lines.append(text)
+
+    def pump(self, timeout: float):
+        """Read what is available (waiting up to timeout for the first byte) and parse it."""
+        now = time.perf_counter()
+        if self.ping_interval and now >= self.ping_next:
+            self.ping_seq += 1
+            self.pings[self.ping_seq] = now
+            self.line(f"ping:{self.ping_seq}")
+            self.ping_next = now + self.ping_interval
+        deadline = now + timeout
+        while True:
+            data = self.ser.read(self.ser.in_waiting or 1)
+            if data:
+                self.buf += data
+                self._parse()
+                if not self.ser.in_waiting:
+                    return
+            elif time.perf_counter() >= deadline:
+                return
+
+    def event(self, tid: int, timeout: float):
+        """Next bulk event of transfer tid (other transfers' events are dropped), or None."""
+        deadline = time.perf_counter() + timeout
+        while True:
+            while self.events:
+                ev = self.events.popleft()
+                if ev[1] == tid or ev[0] == OFFER:
+                    return ev
+            left = deadline - time.perf_counter()
+            if left <= 0:
+                return None
+            self.pump(min(left, 0.002))
+
+    def wait_line(self, prefix: str, timeout: float):
+        deadline = time.perf_counter() + timeout
+        while time.perf_counter() < deadline:
+            while self.lines:
+                text = self.lines.popleft()
+                if text.startswith(prefix):
+                    return text
+            self.pump(0.01)
+        return None
+
+
+class Sender:
+    def __init__(self, link, chunk, ack_timeout, retries, session_timeout):
+        self.link = link
+        self.chunk = chunk
+        self.ack_timeout = ack_timeout
+        self.retries = retries
+        self.session_timeout = session_timeout
+        self.tid = random.randint(1, 254)
+        self.chunks = self.resent = 0
+
+    def send(self, data: bytes, kind: int, name: str, stop_at=None):
+        """Returns (status name, resumed-from offset)."""
+        link = self.link
+        self.tid = self.tid % 255 + 1
+        tid = self.tid
+        size = len(data)
+        offer = struct.pack("<BII", kind, size, zlib.crc32(data)) + name.encode()[:NAME_MAX]
+
+        deadline = time.perf_counter() + self.session_timeout
+        while True:
+            if time.perf_counter() > deadline:
+                return "TIMEOUT (no ACCEPT)", 0
+            link.send_bulk(OFFER, tid, offer)
+            ev = link.event(tid, self.ack_timeout)
+            if ev is None or ev[0] == OFFER:
+                continue
+            if ev[0] == ACCEPT:
+                base, window, max_chunk = struct.unpack("<IBH", ev[2][:7])
+                break
+            if ev[0] in (REJECT, ABORT):
+                return "REJECTED " + STATUS.get(ev[2][0], str(ev[2][0])), 0
+        chunk = min(self.chunk, max_chunk)
+        resumed = base
+        nxt = high = base
+        last_activity = time.perf_counter()
+        timeouts = 0
+
+        def handle(ev):
+            nonlocal base, nxt, timeouts, last_activity
+            op, _, payload = ev
+            if op == ACK:
+                off = struct.unpack("<I", payload[:4])[0]
+                if base < off <= high:
+                    base = off
+                    nxt = max(nxt, base)
+                    timeouts = 0
+                    last_activity = time.perf_counter()
+            elif op == NAK:
+                off = struct.unpack("<I", payload[:4])[0]
+                if base <= off < nxt:
+                    nxt = off
+            elif op == ABORT:
+                return "ABORTED " + STATUS.get(payload[0], str(payload[0]))
+            return None
+
+        while True:
+            while base < size:
+                while nxt < size and nxt - base < window * chunk:
+                    part = data[nxt:nxt + chunk]
+                    link.send_bulk(DATA, tid, struct.pack("<I", nxt) + part)
+                    self.chunks += 1
+                    if nxt < high:
+                        self.resent += 1
+                    nxt += len(part)
+                    high = max(high, nxt)
+                    last_activity = time.perf_counter()
+                    if stop_at is not None and nxt >= stop_at:
+                        link.send_bulk(ABORT, tid, bytes([ST_CANCELLED]))
+                        return "INTERRUPTED", resumed
+                    link.pump(0)
+                    while link.events:
+                        ev = link.events.popleft()
+                        if ev[1] == tid and (err := handle(ev)):
+                            return err, resumed
+                left = last_activity + self.ack_timeout - time.perf_counter()
+                ev = link.event(tid, left) if left > 0 else None
+                if ev is not None:
+                    if (err := handle(ev)):
+                        return err, resumed
+                    continue
+                if last_activity + self.ack_timeout > time.perf_counter():
+                    continue
+                timeouts += 1
+                if timeouts > self.retries:
+                    link.send_bulk(ABORT, tid, bytes([7]))
+                    return "TIMEOUT", resumed
+                nxt = base
+                last_activity = time.perf_counter()
+
+            for _ in range(self.retries + 1):
+                link.send_bulk(END, tid)
+                ev = link.event(tid, self.ack_timeout)
+                while ev is not None and ev[0] not in (DONE, NAK, ABORT):
+                    ev = link.event(tid, self.ack_timeout)
+                if ev is None:
+                    continue
+                if ev[0] == DONE:
+                    return STATUS.get(ev[2][0], str(ev[2][0])), resumed
+                if ev[0] == ABORT:
+                    return "ABORTED " + STATUS.get(ev[2][0], str(ev[2][0])), resumed
+                base = nxt = struct.unpack("<I", ev[2][:4])[0]
+                break
+            else:
+                return "TIMEOUT (no DONE)", resumed
+
+
+def receive(link, window, chunk, timeout, resume: bytes = b""):
+    """Accepts the next OFFER and receives it; returns (status name, data, info)."""
+    ev = None
+    deadline = time.perf_counter() + timeout
+    while ev is None or ev[0] != OFFER:
+        if time.perf_counter() > deadline:
+            return "TIMEOUT (no OFFER)", b"", {}
+        ev = link.event(-1, 0.05)
+    tid = ev[1]
+    kind, size, crc = struct.unpack("<BII", ev[2][:9])
+    info = {"kind": kind, "size": size, "crc32": crc, "name": ev[2][9:].decode(errors="replace")}
+    data = bytearray(resume[:size])
+    link.send_bulk(ACCEPT, tid, struct.pack("<IBH", len(data), window, chunk))
+    nak_for = None
+    last = time.perf_counter()
+    while True:
+        ev = link.event(tid, 0.05)
+        if ev is None:
+            if time.perf_counter() - last > timeout:
+                link.send_bulk(ABORT, tid, bytes([7]))
+                return "TIMEOUT", bytes(data), info
+            continue
+        last = time.perf_counter()
+        op, _, payload = ev
+        if op == OFFER:
+            link.send_bulk(ACCEPT, tid, struct.pack("<IBH", len(data), window, chunk))
+        elif op == DATA:
+            off = struct.unpack("<I", payload[:4])[0]
+            if off == len(data):
+                data += payload[4:]
+                nak_for = None
+                link.send_bulk(ACK, tid, struct.pack("<I", len(data)))
+            elif off < len(data):
+                link.send_bulk(ACK, tid, struct.pack("<I", len(data)))
+            elif nak_for != len(data):
+                nak_for = len(data)
+                link.send_bulk(NAK, tid, struct.pack("<I", len(data)))
+        elif op == END:
+            ok = len(data) == size and zlib.crc32(data) == crc
+            link.send_bulk(DONE, tid, bytes([ST_OK if ok else ST_BAD_CRC]))
+            return ("OK" if ok else "BAD_CRC"), bytes(data), info
+        elif op == ABORT:
+            return "ABORTED " + STATUS.get(payload[0], str(payload[0])), bytes(data), info
+
+
+def start_sim(path):
+    proc = subprocess.Popen([path, "--no-rate-limit"], stdout=subprocess.PIPE, text=True,
+                            env=dict(os.environ, HOST_LOG_LEVEL=os.environ.get("HOST_LOG_LEVEL", "1")))
+    banner = proc.stdout.readline().split()
+    if len(banner) != 2 or banner[0] != "PTY":
+        proc.kill()
+        raise SystemExit(f"unexpected output from {path}: {banner}")
+    sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "host_sim"))
+    from bench import PtyPort  # noqa: E402
+    return proc, PtyPort(banner[1])
+
+
+def report(title, nbytes, elapsed, baud, link):
+    rate = nbytes / elapsed if elapsed > 0 else 0
+    line = f"  {title}: {nbytes} B in {elapsed:.3f} s = {rate / 1024:.1f} KiB/s"
+    if baud:
+        line += f" ({rate * 10 / baud * 100:.0f}% of {baud} baud)"
+    print(line)
+    if link.ping_latencies:
+        lat = link.ping_latencies
+        print(f"  ping during transfer: n={len(lat)} p50={percentile(lat, 50):.0f} p99={percentile(lat, 99):.0f} "
+              f"max={max(lat):.0f} us, lost={len(link.pings)}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", help="serial port wired to the screen UART")
+    ap.add_argument("--baud", type=int, default=0, help="serial baud rate (also used for the wire-rate share)")
+    ap.add_argument("--sim", action="store_true", help="start the host build and talk to its pseudo-terminal")
+    ap.add_argument("--sim-path", default=os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                                       "host_sim", "build", "host_sim"), help="host_sim executable")
+    ap.add_argument("--chunk", type=int, default=512, help="largest chunk to send / accept")
+    ap.add_argument("--window", type=int, default=8, help="window to advertise when receiving")
+    ap.add_argument("--ack-timeout", type=float, default=0.2)
+    ap.add_argument("--retries", type=int, default=5)
+    ap.add_argument("--timeout", type=float, default=5.0, help="session timeout (s)")
+    ap.add_argument("--ping-interval", type=float, help="send ping commands at this interval during the transfer")
+    ap.add_argument("--loss", type=float, default=0.0, help="drop this share of DATA frames (both directions)")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    sp = sub.add_parser("send")
+    sp.add_argument("file", nargs="?")
+    sp.add_argument("--random", type=int, metavar="BYTES", help="send random data instead of a file")
+    sp.add_argument("--kind", type=int, default=0)
+    sp.add_argument("--name", help="transfer name (default: file name)")
+    sp.add_argument("--interrupt-at", type=float, metavar="F", help="abort after fraction F, then resume")
+    rp = sub.add_parser("receive")
+    rp.add_argument("out", help="output file, - to only verify")
+    rp.add_argument("--request", help="command line that makes the board start sending")
+    rp.add_argument("--resume", action="store_true", help="continue from the existing output file")
+    args = ap.parse_args()
+
+    proc = None
+    if args.sim:
+        proc, ser = start_sim(args.sim_path)
+    elif args.port:
+        import serial
+        ser = serial.Serial(args.port, args.baud or 115200, timeout=0)
+    else:
+        ap.error("--port or --sim is required")
+
+    link = BulkLink(ser, args.ping_interval, args.loss)
+    failed = False
+    try:
+        if args.cmd == "send":
+            if args.random is not None:
+                data = random.randbytes(args.random)
+                name = args.name or "random"
+            elif args.file:
+                with open(args.file, "rb") as f:
+                    data = f.read()
+                name = args.name or os.path.basename(args.file)
+            else:
+                ap.error("send needs a file or --random")
+            sender = Sender(link, args.chunk, args.ack_timeout, args.retries, args.timeout)
+            attempts = [int(len(data) * args.interrupt_at)] if args.interrupt_at is not None else []
+            attempts.append(None)
+            for stop_at in attempts:
+                t0 = time.perf_counter()
+                status, resumed = sender.send(data, args.kind, name, stop_at)
+                elapsed = time.perf_counter() - t0
+                sent = (stop_at or len(data)) - resumed
+                print(f"[send] {name}: {status}, resumed from {resumed}, chunks={sender.chunks} resent={sender.resent}")
+                report("payload", sent, elapsed, args.baud, link)
+                if stop_at is None:
+                    failed = status != "OK"
+                elif status != "INTERRUPTED":
+                    failed = True
+                    break
+            if args.sim and not failed:
+                line = link.wait_line("STATUS:HOST:BULK_RECEIVED:", 2.0)
+                while line is not None and ":ESP_ERR_NOT_FINISHED:" in line:   # the interrupted attempt
+                    line = link.wait_line("STATUS:HOST:BULK_RECEIVED:", 2.0)
+                expected = f"STATUS:HOST:BULK_RECEIVED:ESP_OK:{len(data)}:{zlib.crc32(data):08x}"
+                print(f"  device: {line}")
+                failed = line != expected
+        else:
+            resume = b""
+            if args.resume and args.out != "-" and os.path.exists(args.out):
+                with open(args.out, "rb") as f:
+                    resume = f.read()
+            if args.request:
+                link.line(args.request)
+            t0 = time.perf_counter()
+            status, data, info = receive(link, args.window, args.chunk, args.timeout, resume)
+            elapsed = time.perf_counter() - t0
+            print(f"[receive] {info.get('name')!r} kind={info.get('kind')} size={info.get('size')}: {status}")
+            report("payload", len(data) - len(resume), elapsed, args.baud, link)
+            if args.out != "-":
+                with open(args.out, "wb") as f:
+                    f.write(data)
+            failed = status != "OK"
+            if args.request:
+                print(f"  device: {link.wait_line('STATUS:HOST:BULK_SENT:', 2.0) or 'no completion line'}")
+        if link.rx_errors:
+            print(f"  corrupt frames received: {link.rx_errors}")
+    finally:
+        ser.close()
+        if proc is not None:
+            proc.kill()
+            proc.wait()
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())